@@ -10,6 +10,14 @@
  * This example creates a simple network in which all LoRaWAN components are
  * simulated: end devices, some gateways and a network server.
  * Two end devices are already configured to send unconfirmed and confirmed messages respectively.
+ *
+ * Additional devices sending periodic packets can be added to use this example as a benchmark of
+ * the network server: in benchmark mode, logging is disabled and the wall clock time taken by the
+ * simulation is printed along with the number of packets received by the network server.
+ * Devices that never transmit can also be registered at the network server, to measure the cost
+ * of registering and looking up devices in a large network. Where the operating system reports
+ * it, the memory taken by each registered device and the peak resident memory of the process are
+ * printed as well.
  */
 
 #include "ns3/command-line.h"
@@ -30,46 +38,107 @@
 #include "ns3/periodic-sender.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/string.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
 
 using namespace ns3;
 using namespace lorawan;
 
 NS_LOG_COMPONENT_DEFINE("NetworkServerExample");
 
+/**
+ * Number of packets received by the network server.
+ */
+uint32_t g_receivedPackets = 0;
+
+/**
+ * Record a packet reception at the network server.
+ *
+ * \param packet The received packet.
+ */
+void
+OnPacketReceivedByServer(Ptr<const Packet> packet)
+{
+    g_receivedPackets++;
+}
+
+/**
+ * Read a memory figure of the process from /proc/self/status, where available.
+ *
+ * \param field The name of the field, for instance VmRSS for the resident memory or VmHWM for
+ * its peak.
+ * \return The value of the field in kB, or zero when it cannot be read.
+ */
+uint64_t
+GetProcessMemoryKb(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            uint64_t kb = 0;
+            std::istringstream(line.substr(field.size() + 1)) >> kb;
+            return kb;
+        }
+    }
+    return 0;
+}
+
 int
 main(int argc, char* argv[])
 {
     bool verbose = false;
+    bool benchmark = false;
+    int nPeriodicDevices = 0;
+    int nRegisteredDevices = 0;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Whether to print output or not", verbose);
+    cmd.AddValue("benchmark",
+                 "Whether to disable logging and print the wall clock time of the simulation",
+                 benchmark);
+    cmd.AddValue("nPeriodicDevices",
+                 "Number of additional devices sending a packet every 60 seconds",
+                 nPeriodicDevices);
+    cmd.AddValue("nRegisteredDevices",
+                 "Number of additional silent devices registered at the network server",
+                 nRegisteredDevices);
     cmd.Parse(argc, argv);
 
     // Logging
     //////////
 
-    LogComponentEnable("NetworkServerExample", LOG_LEVEL_ALL);
-    LogComponentEnable("NetworkServer", LOG_LEVEL_ALL);
-    LogComponentEnable("GatewayLorawanMac", LOG_LEVEL_ALL);
-    // LogComponentEnable("LoraFrameHeader", LOG_LEVEL_ALL);
-    // LogComponentEnable("LorawanMacHeader", LOG_LEVEL_ALL);
-    // LogComponentEnable("MacCommand", LOG_LEVEL_ALL);
-    // LogComponentEnable("GatewayLoraPhy", LOG_LEVEL_ALL);
-    // LogComponentEnable("LoraPhy", LOG_LEVEL_ALL);
-    // LogComponentEnable("LoraChannel", LOG_LEVEL_ALL);
-    // LogComponentEnable("EndDeviceLoraPhy", LOG_LEVEL_ALL);
-    // LogComponentEnable("LogicalLoraChannelHelper", LOG_LEVEL_ALL);
-    LogComponentEnable("EndDeviceLorawanMac", LOG_LEVEL_ALL);
-    LogComponentEnable("ClassAEndDeviceLorawanMac", LOG_LEVEL_ALL);
-    // LogComponentEnable ("OneShotSender", LOG_LEVEL_ALL);
-    // LogComponentEnable("PointToPointNetDevice", LOG_LEVEL_ALL);
-    // LogComponentEnable ("Forwarder", LOG_LEVEL_ALL);
-    // LogComponentEnable ("OneShotSender", LOG_LEVEL_ALL);
-    // LogComponentEnable ("DeviceStatus", LOG_LEVEL_ALL);
-    // LogComponentEnable ("GatewayStatus", LOG_LEVEL_ALL);
-    LogComponentEnableAll(LOG_PREFIX_FUNC);
-    LogComponentEnableAll(LOG_PREFIX_NODE);
-    LogComponentEnableAll(LOG_PREFIX_TIME);
+    if (!benchmark)
+    {
+        LogComponentEnable("NetworkServerExample", LOG_LEVEL_ALL);
+        LogComponentEnable("NetworkServer", LOG_LEVEL_ALL);
+        LogComponentEnable("GatewayLorawanMac", LOG_LEVEL_ALL);
+        // LogComponentEnable("LoraFrameHeader", LOG_LEVEL_ALL);
+        // LogComponentEnable("LorawanMacHeader", LOG_LEVEL_ALL);
+        // LogComponentEnable("MacCommand", LOG_LEVEL_ALL);
+        // LogComponentEnable("GatewayLoraPhy", LOG_LEVEL_ALL);
+        // LogComponentEnable("LoraPhy", LOG_LEVEL_ALL);
+        // LogComponentEnable("LoraChannel", LOG_LEVEL_ALL);
+        // LogComponentEnable("EndDeviceLoraPhy", LOG_LEVEL_ALL);
+        // LogComponentEnable("LogicalLoraChannelHelper", LOG_LEVEL_ALL);
+        LogComponentEnable("EndDeviceLorawanMac", LOG_LEVEL_ALL);
+        LogComponentEnable("ClassAEndDeviceLorawanMac", LOG_LEVEL_ALL);
+        // LogComponentEnable ("OneShotSender", LOG_LEVEL_ALL);
+        // LogComponentEnable("PointToPointNetDevice", LOG_LEVEL_ALL);
+        // LogComponentEnable ("Forwarder", LOG_LEVEL_ALL);
+        // LogComponentEnable ("OneShotSender", LOG_LEVEL_ALL);
+        // LogComponentEnable ("DeviceStatus", LOG_LEVEL_ALL);
+        // LogComponentEnable ("GatewayStatus", LOG_LEVEL_ALL);
+        LogComponentEnableAll(LOG_PREFIX_FUNC);
+        LogComponentEnableAll(LOG_PREFIX_NODE);
+        LogComponentEnableAll(LOG_PREFIX_TIME);
+    }
 
     // Create a simple wireless channel
     ///////////////////////////////////
@@ -148,6 +217,27 @@ main(int argc, char* argv[])
     // oneShotHelper.SetSendTime (Seconds (12));
     // oneShotHelper.Install(endDevices.Get (2));
 
+    // Create the additional periodic devices around the first gateway
+    NodeContainer periodicDevices;
+    periodicDevices.Create(nPeriodicDevices);
+    MobilityHelper mobilityPeriodic;
+    mobilityPeriodic.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                                          "rho",
+                                          DoubleValue(3000.0),
+                                          "X",
+                                          DoubleValue(0.0),
+                                          "Y",
+                                          DoubleValue(0.0));
+    mobilityPeriodic.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobilityPeriodic.Install(periodicDevices);
+    helper.Install(phyHelper, macHelper, periodicDevices);
+
+    PeriodicSenderHelper periodicSenderHelper;
+    periodicSenderHelper.SetPeriod(Seconds(60));
+    periodicSenderHelper.Install(periodicDevices);
+
+    endDevices.Add(periodicDevices);
+
     ////////////////
     // Create gateways //
     ////////////////
@@ -187,16 +277,72 @@ main(int argc, char* argv[])
     NetworkServerHelper networkServerHelper;
     networkServerHelper.SetGatewaysP2P(gwRegistration);
     networkServerHelper.SetEndDevices(endDevices);
-    networkServerHelper.Install(networkServer);
+    ApplicationContainer serverApps = networkServerHelper.Install(networkServer);
+    serverApps.Get(0)->TraceConnectWithoutContext("ReceivedPacket",
+                                                  MakeCallback(&OnPacketReceivedByServer));
+
+    // Register the silent devices, on a network ID that is not used by the others
+    if (nRegisteredDevices > 0)
+    {
+        Ptr<NetworkStatus> status =
+            DynamicCast<NetworkServer>(serverApps.Get(0))->GetNetworkStatus();
+
+        uint64_t rssBeforeKb = GetProcessMemoryKb("VmRSS");
+        SystemWallClockMs registryClock;
+        registryClock.Start();
+        status->ReserveEndDevices(status->CountEndDevices() + nRegisteredDevices);
+        for (int i = 0; i < nRegisteredDevices; i++)
+        {
+            status->AddNode(LoraDeviceAddress(127, i));
+        }
+        int64_t registrationMs = registryClock.End();
+        uint64_t rssAfterKb = GetProcessMemoryKb("VmRSS");
+
+        registryClock.Start();
+        uint32_t nFound = 0;
+        for (int i = 0; i < nRegisteredDevices; i++)
+        {
+            nFound += bool(status->GetEndDeviceStatus(LoraDeviceAddress(127, i)));
+        }
+        int64_t lookupMs = registryClock.End();
+
+        if (benchmark)
+        {
+            std::cout << "Registered " << nRegisteredDevices << " devices in " << registrationMs
+                      << " ms, looked up " << nFound << " of them in " << lookupMs << " ms"
+                      << std::endl;
+            if (rssAfterKb > 0)
+            {
+                std::cout << "Registered devices take "
+                          << double(rssAfterKb - std::min(rssBeforeKb, rssAfterKb)) * 1024 /
+                                 nRegisteredDevices
+                          << " bytes each" << std::endl;
+            }
+        }
+    }
 
     // Install the Forwarder application on the gateways
     ForwarderHelper forwarderHelper;
     forwarderHelper.Install(gateways);
 
     // Start simulation
+    SystemWallClockMs clock;
+    clock.Start();
     Simulator::Stop(Seconds(800));
     Simulator::Run();
+    int64_t elapsedMs = clock.End();
     Simulator::Destroy();
 
+    if (benchmark)
+    {
+        std::cout << "Network server received " << g_receivedPackets << " packets, simulation took "
+                  << elapsedMs << " ms" << std::endl;
+        uint64_t peakRssKb = GetProcessMemoryKb("VmHWM");
+        if (peakRssKb > 0)
+        {
+            std::cout << "Peak resident memory " << peakRssKb << " kB" << std::endl;
+        }
+    }
+
     return 0;
 }
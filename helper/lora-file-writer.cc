@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-file-writer.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <fstream>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraFileWriter");
+
+LoraFileWriter::LoraFileWriter()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_thread = std::thread(&LoraFileWriter::DoWrite, this);
+}
+
+LoraFileWriter::~LoraFileWriter()
+{
+    NS_LOG_FUNCTION(this);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queued.notify_one();
+    m_thread.join();
+}
+
+void
+LoraFileWriter::Write(std::string filename, std::string text, bool truncate)
+{
+    NS_LOG_FUNCTION(this << filename << text.size() << truncate);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_chunks.size() + m_writing < m_maxPending; });
+        m_chunks.push_back({std::move(filename), std::move(text), truncate});
+    }
+    m_queued.notify_one();
+}
+
+void
+LoraFileWriter::Flush()
+{
+    NS_LOG_FUNCTION(this);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_chunks.empty() && !m_writing; });
+}
+
+void
+LoraFileWriter::DoWrite()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_queued.wait(lock, [this] { return !m_chunks.empty() || m_stopping; });
+        if (m_chunks.empty())
+        {
+            return;
+        }
+        Chunk chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+        m_writing = true;
+        lock.unlock();
+
+        std::ofstream outputFile(chunk.filename,
+                                 std::ofstream::out |
+                                     (chunk.truncate ? std::ofstream::trunc : std::ofstream::app));
+        outputFile << chunk.text;
+        outputFile.close();
+        NS_ABORT_MSG_IF(outputFile.fail(), "Could not write " << chunk.filename);
+
+        lock.lock();
+        m_writing = false;
+        m_done.notify_all();
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
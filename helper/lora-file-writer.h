@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_FILE_WRITER_H
+#define LORA_FILE_WRITER_H
+
+#include "ns3/simple-ref-count.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * Writes text to files from a dedicated thread, so that the simulation does not wait for disk
+ * operations.
+ *
+ * Callers format their output in memory and hand it over as a chunk. Chunks are written in
+ * order, each one opening its file, appending (or truncating it first) and closing it. At most
+ * two chunks are pending at any time, one being written and one waiting: a caller handing over
+ * a chunk only blocks when the thread falls further behind.
+ */
+class LoraFileWriter : public SimpleRefCount<LoraFileWriter>
+{
+  public:
+    LoraFileWriter();  //!< Default constructor, starting the thread
+    ~LoraFileWriter(); //!< Destructor, writing pending chunks and stopping the thread
+
+    /**
+     * Hand a chunk of text over to the writing thread.
+     *
+     * \param filename The file to write the chunk to.
+     * \param text The text of the chunk.
+     * \param truncate Whether to delete the contents of the file before writing the chunk,
+     * rather than appending to it.
+     */
+    void Write(std::string filename, std::string text, bool truncate);
+
+    /**
+     * Wait until all chunks handed over are written.
+     */
+    void Flush();
+
+  private:
+    /**
+     * A chunk of text to write.
+     */
+    struct Chunk
+    {
+        std::string filename; //!< The file to write the chunk to
+        std::string text;     //!< The text of the chunk
+        bool truncate;        //!< Whether to delete the contents of the file first
+    };
+
+    /**
+     * Write the chunks handed over, until the writer is destroyed. Run by the writing thread.
+     */
+    void DoWrite();
+
+    std::thread m_thread;             //!< The writing thread
+    std::mutex m_mutex;               //!< Protects the members below
+    std::condition_variable m_queued; //!< Signals a new chunk or the stop
+    std::condition_variable m_done;   //!< Signals a chunk written
+    std::deque<Chunk> m_chunks;       //!< Chunks waiting to be written
+    bool m_writing = false;           //!< Whether the thread is writing a chunk
+    bool m_stopping = false;          //!< Whether the thread should stop when done
+    std::size_t m_maxPending = 2;     //!< Pending chunks making callers wait
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_FILE_WRITER_H */
@@ -8,9 +8,14 @@
 
 #include "lora-helper.h"
 
+#include "ns3/energy-source-container.h"
 #include "ns3/log.h"
+#include "ns3/lora-instrumentation.h"
+#include "ns3/network-server.h"
 
-#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <sstream>
 
 namespace ns3
 {
@@ -83,6 +88,37 @@ LoraHelper::Install(const LoraPhyHelper& phyHelper,
                     MakeCallback(&LoraPacketTracker::LostBecauseTxCallback, m_packetTracker));
             }
         }
+        if (m_traceWriter)
+        {
+            phy->TraceConnectWithoutContext(
+                "StartSending",
+                MakeCallback(&LoraTraceWriter::TransmissionCallback, m_traceWriter));
+            if (phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleGatewayLoraPhy"))
+            {
+                phy->TraceConnectWithoutContext(
+                    "ReceivedPacket",
+                    MakeCallback(&LoraTraceWriter::PacketReceptionCallback, m_traceWriter));
+                phy->TraceConnectWithoutContext(
+                    "LostPacketBecauseInterference",
+                    MakeCallback(&LoraTraceWriter::InterferenceCallback, m_traceWriter));
+                phy->TraceConnectWithoutContext(
+                    "LostPacketBecauseNoMoreReceivers",
+                    MakeCallback(&LoraTraceWriter::NoMoreReceiversCallback, m_traceWriter));
+                phy->TraceConnectWithoutContext(
+                    "LostPacketBecauseUnderSensitivity",
+                    MakeCallback(&LoraTraceWriter::UnderSensitivityCallback, m_traceWriter));
+                phy->TraceConnectWithoutContext(
+                    "NoReceptionBecauseTransmitting",
+                    MakeCallback(&LoraTraceWriter::LostBecauseTxCallback, m_traceWriter));
+            }
+        }
+        if (m_kpiTracker &&
+            phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleEndDeviceLoraPhy"))
+        {
+            phy->TraceConnectWithoutContext(
+                "StartSending",
+                MakeCallback(&LoraKpiTracker::TransmissionCallback, m_kpiTracker));
+        }
 
         // Create the MAC
         Ptr<LorawanMac> mac = macHelper.Create(node, device);
@@ -115,6 +151,42 @@ LoraHelper::Install(const LoraPhyHelper& phyHelper,
                     MakeCallback(&LoraPacketTracker::MacGwReceptionCallback, m_packetTracker));
             }
         }
+        if (m_traceWriter)
+        {
+            if (phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleEndDeviceLoraPhy"))
+            {
+                mac->TraceConnectWithoutContext(
+                    "SentNewPacket",
+                    MakeCallback(&LoraTraceWriter::MacTransmissionCallback, m_traceWriter));
+                mac->TraceConnectWithoutContext(
+                    "RequiredTransmissions",
+                    MakeCallback(&LoraTraceWriter::RequiredTransmissionsCallback, m_traceWriter));
+            }
+            else if (phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleGatewayLoraPhy"))
+            {
+                mac->TraceConnectWithoutContext(
+                    "ReceivedPacket",
+                    MakeCallback(&LoraTraceWriter::MacGwReceptionCallback, m_traceWriter));
+            }
+        }
+        if (m_kpiTracker)
+        {
+            if (phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleEndDeviceLoraPhy"))
+            {
+                mac->TraceConnectWithoutContext(
+                    "SentNewPacket",
+                    MakeCallback(&LoraKpiTracker::MacTransmissionCallback, m_kpiTracker));
+                mac->TraceConnectWithoutContext(
+                    "RequiredTransmissions",
+                    MakeCallback(&LoraKpiTracker::RequiredTransmissionsCallback, m_kpiTracker));
+            }
+            else if (phyHelper.GetDeviceType() == TypeId::LookupByName("ns3::SimpleGatewayLoraPhy"))
+            {
+                mac->TraceConnectWithoutContext(
+                    "ReceivedPacket",
+                    MakeCallback(&LoraKpiTracker::MacGwReceptionCallback, m_kpiTracker));
+            }
+        }
 
         node->AddDevice(device);
         devices.Add(device);
@@ -147,6 +219,68 @@ LoraHelper::GetPacketTracker()
     return *m_packetTracker;
 }
 
+int64_t
+LoraHelper::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+
+    int64_t currentStream = stream;
+    if (m_packetTracker)
+    {
+        currentStream += m_packetTracker->AssignStreams(currentStream);
+    }
+    return (currentStream - stream);
+}
+
+void
+LoraHelper::EnableKpiTracking()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_kpiTracker = new LoraKpiTracker();
+}
+
+LoraKpiTracker&
+LoraHelper::GetKpiTracker()
+{
+    NS_LOG_FUNCTION(this);
+
+    return *m_kpiTracker;
+}
+
+void
+LoraHelper::EnableBinaryTracing(std::string prefix)
+{
+    NS_LOG_FUNCTION(this << prefix);
+
+    // Create the writer, and complete its files at the end of the simulation
+    m_traceWriter = new LoraTraceWriter(prefix);
+    Simulator::ScheduleDestroy(&LoraTraceWriter::Close, m_traceWriter);
+}
+
+LoraTraceWriter&
+LoraHelper::GetTraceWriter()
+{
+    NS_LOG_FUNCTION(this);
+
+    return *m_traceWriter;
+}
+
+void
+LoraHelper::EnablePeriodicDeviceStatusTracing(NodeContainer endDevices, Time interval)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_traceWriter, "Binary tracing is not enabled");
+    m_traceWriter->WriteDeviceStatus(endDevices);
+
+    Simulator::Schedule(interval,
+                        &LoraHelper::EnablePeriodicDeviceStatusTracing,
+                        this,
+                        endDevices,
+                        interval);
+}
+
 void
 LoraHelper::EnableSimulationTimePrinting(Time interval)
 {
@@ -179,19 +313,7 @@ LoraHelper::DoPrintDeviceStatus(NodeContainer endDevices,
                                 NodeContainer gateways,
                                 std::string filename)
 {
-    const char* c = filename.c_str();
-    std::ofstream outputFile;
-    if (Simulator::Now() == Seconds(0))
-    {
-        // Delete contents of the file as it is opened
-        outputFile.open(c, std::ofstream::out | std::ofstream::trunc);
-    }
-    else
-    {
-        // Only append to the file
-        outputFile.open(c, std::ofstream::out | std::ofstream::app);
-    }
-
+    std::ostringstream output;
     Time currentTime = Simulator::Now();
     for (auto j = endDevices.Begin(); j != endDevices.End(); ++j)
     {
@@ -206,8 +328,8 @@ LoraHelper::DoPrintDeviceStatus(NodeContainer endDevices,
         int dr = int(mac->GetDataRate());
         double txPower = mac->GetTransmissionPower();
         Vector pos = position->GetPosition();
-        outputFile << currentTime.GetSeconds() << " " << object->GetId() << " " << pos.x << " "
-                   << pos.y << " " << dr << " " << unsigned(txPower) << std::endl;
+        output << currentTime.GetSeconds() << " " << object->GetId() << " " << pos.x << " " << pos.y
+               << " " << dr << " " << unsigned(txPower) << "\n";
     }
     // for (NodeContainer::Iterator j = gateways.Begin (); j != gateways.End (); ++j)
     //   {
@@ -218,7 +340,7 @@ LoraHelper::DoPrintDeviceStatus(NodeContainer endDevices,
     //                << object->GetId () <<  " "
     //                << pos.x << " " << pos.y << " " << "-1 -1" << std::endl;
     //   }
-    outputFile.close();
+    WriteToFile(filename, output.str());
 }
 
 void
@@ -243,32 +365,21 @@ LoraHelper::DoPrintPhyPerformance(NodeContainer gateways, std::string filename)
 {
     NS_LOG_FUNCTION(this);
 
-    const char* c = filename.c_str();
-    std::ofstream outputFile;
-    if (Simulator::Now() == Seconds(0))
-    {
-        // Delete contents of the file as it is opened
-        outputFile.open(c, std::ofstream::out | std::ofstream::trunc);
-    }
-    else
-    {
-        // Only append to the file
-        outputFile.open(c, std::ofstream::out | std::ofstream::app);
-    }
+    std::ostringstream output;
 
     for (auto it = gateways.Begin(); it != gateways.End(); ++it)
     {
         int systemId = (*it)->GetId();
-        outputFile << Simulator::Now().GetSeconds() << " " << std::to_string(systemId) << " "
-                   << m_packetTracker->PrintPhyPacketsPerGw(m_lastPhyPerformanceUpdate,
-                                                            Simulator::Now(),
-                                                            systemId)
-                   << std::endl;
+        output << Simulator::Now().GetSeconds() << " " << std::to_string(systemId) << " "
+               << m_packetTracker->PrintPhyPacketsPerGw(m_lastPhyPerformanceUpdate,
+                                                        Simulator::Now(),
+                                                        systemId)
+               << "\n";
     }
 
     m_lastPhyPerformanceUpdate = Simulator::Now();
 
-    outputFile.close();
+    WriteToFile(filename, output.str());
 }
 
 void
@@ -290,27 +401,310 @@ LoraHelper::DoPrintGlobalPerformance(std::string filename)
 {
     NS_LOG_FUNCTION(this);
 
-    const char* c = filename.c_str();
-    std::ofstream outputFile;
-    if (Simulator::Now() == Seconds(0))
+    std::ostringstream output;
+
+    output << Simulator::Now().GetSeconds() << " "
+           << m_packetTracker->CountMacPacketsGlobally(m_lastGlobalPerformanceUpdate,
+                                                       Simulator::Now())
+           << "\n";
+
+    m_lastGlobalPerformanceUpdate = Simulator::Now();
+
+    WriteToFile(filename, output.str());
+}
+
+void
+LoraHelper::WriteToFile(std::string filename, std::string text)
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    if (!m_fileWriter)
     {
-        // Delete contents of the file as it is opened
-        outputFile.open(c, std::ofstream::out | std::ofstream::trunc);
+        m_fileWriter = Create<LoraFileWriter>();
     }
-    else
+
+    // Delete contents of the file at the start of the simulation, and only append to it later
+    m_fileWriter->Write(std::move(filename), std::move(text), Simulator::Now() == Seconds(0));
+}
+
+void
+LoraHelper::EnableMetricsSampling(std::string filename, Time interval)
+{
+    NS_LOG_FUNCTION(this << filename << interval);
+
+    // The first sample only happens once the simulation runs, after metrics are registered
+    m_metricsSampler = new LoraMetricsSampler();
+    m_metricsSampler->SetOutput(filename);
+    m_metricsSampler->Start(interval);
+    Simulator::ScheduleDestroy(&LoraMetricsSampler::Flush, m_metricsSampler);
+}
+
+LoraMetricsSampler&
+LoraHelper::GetMetricsSampler()
+{
+    NS_LOG_FUNCTION(this);
+
+    return *m_metricsSampler;
+}
+
+void
+LoraHelper::SampleGatewayMetrics(NodeContainer gateways)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_metricsSampler, "Metrics sampling is not enabled");
+    for (auto it = gateways.Begin(); it != gateways.End(); ++it)
     {
-        // Only append to the file
-        outputFile.open(c, std::ofstream::out | std::ofstream::app);
+        Ptr<LoraNetDevice> loraNetDevice = DynamicCast<LoraNetDevice>((*it)->GetDevice(0));
+        NS_ASSERT(loraNetDevice);
+        loraNetDevice->GetPhy()->TraceConnectWithoutContext(
+            "OccupiedReceptionPaths",
+            MakeCallback(&LoraHelper::OccupiedReceptionPathsCallback, this));
     }
+    m_metricsSampler->AddGauge("occupied_reception_paths",
+                               [this]() { return m_occupiedReceptionPaths; });
+}
 
-    outputFile << Simulator::Now().GetSeconds() << " "
-               << m_packetTracker->CountMacPacketsGlobally(m_lastGlobalPerformanceUpdate,
-                                                           Simulator::Now())
-               << std::endl;
+void
+LoraHelper::SampleEndDeviceMetrics(NodeContainer endDevices)
+{
+    NS_LOG_FUNCTION(this);
 
-    m_lastGlobalPerformanceUpdate = Simulator::Now();
+    NS_ASSERT_MSG(m_metricsSampler, "Metrics sampling is not enabled");
+    NS_ABORT_MSG_IF(endDevices.GetN() == 0, "No devices to sample");
+    Ptr<LoraNetDevice> firstDevice = DynamicCast<LoraNetDevice>(endDevices.Get(0)->GetDevice(0));
+    NS_ASSERT(firstDevice);
+    std::vector<Ptr<const SubBand>> subBands =
+        firstDevice->GetMac()->GetLogicalLoraChannelHelper().GetSubBandList();
+
+    // Values refreshed by a single scan of the devices before each sample
+    auto airtimes = std::make_shared<std::vector<double>>(subBands.size());
+    auto remainingEnergy = std::make_shared<double>(0);
+    m_metricsSampler->AddUpdate([endDevices, airtimes, remainingEnergy]() {
+        std::fill(airtimes->begin(), airtimes->end(), 0);
+        *remainingEnergy = 0;
+        for (auto it = endDevices.Begin(); it != endDevices.End(); ++it)
+        {
+            Ptr<LoraNetDevice> loraNetDevice = DynamicCast<LoraNetDevice>((*it)->GetDevice(0));
+            LogicalLoraChannelHelper channelHelper =
+                loraNetDevice->GetMac()->GetLogicalLoraChannelHelper();
+            for (std::size_t i = 0; i < airtimes->size(); i++)
+            {
+                (*airtimes)[i] += channelHelper.GetSubBandAirtime(i).GetSeconds();
+            }
+
+            Ptr<EnergySourceContainer> sources = (*it)->GetObject<EnergySourceContainer>();
+            if (sources)
+            {
+                for (auto source = sources->Begin(); source != sources->End(); ++source)
+                {
+                    *remainingEnergy += (*source)->GetRemainingEnergy();
+                }
+            }
+        }
+    });
+
+    // The rate of the airtime, normalized by the allowed airtime, is the utilization
+    for (std::size_t i = 0; i < subBands.size(); i++)
+    {
+        double allowedFraction = endDevices.GetN() * subBands[i]->GetDutyCycle();
+        m_metricsSampler->AddCounter("subband" + std::to_string(i) + "_duty_cycle_utilization",
+                                     [airtimes, i, allowedFraction]() {
+                                         return (*airtimes)[i] / allowedFraction;
+                                     });
+    }
+    m_metricsSampler->AddGauge("remaining_energy",
+                               [remainingEnergy]() { return *remainingEnergy; });
+}
+
+void
+LoraHelper::SampleNetworkServerMetrics(Ptr<Node> networkServer)
+{
+    NS_LOG_FUNCTION(this << networkServer);
+
+    NS_ASSERT_MSG(m_metricsSampler, "Metrics sampling is not enabled");
+    Ptr<NetworkScheduler> scheduler;
+    for (uint32_t i = 0; i < networkServer->GetNApplications(); i++)
+    {
+        Ptr<NetworkServer> app = DynamicCast<NetworkServer>(networkServer->GetApplication(i));
+        if (app)
+        {
+            scheduler = app->GetNetworkScheduler();
+        }
+    }
+    NS_ABORT_MSG_IF(!scheduler, "No NetworkServer application on node " << networkServer->GetId());
+    m_metricsSampler->AddGauge("ns_pending_receive_windows", [scheduler]() {
+        return scheduler->GetNPendingReceiveWindows();
+    });
+}
+
+void
+LoraHelper::SamplePacketTrackerMetrics()
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_metricsSampler, "Metrics sampling is not enabled");
+    NS_ASSERT_MSG(m_packetTracker, "Packet tracking is not enabled");
+    LoraPacketTracker* tracker = m_packetTracker;
+    m_metricsSampler->AddCounter("phy_sent",
+                                 [tracker]() { return tracker->CountPhyPacketsSent(); });
+    const std::vector<std::pair<std::string, PhyPacketOutcome>> outcomes = {
+        {"phy_received", RECEIVED},
+        {"phy_interfered", INTERFERED},
+        {"phy_no_more_receivers", NO_MORE_RECEIVERS},
+        {"phy_under_sensitivity", UNDER_SENSITIVITY},
+        {"phy_lost_because_tx", LOST_BECAUSE_TX}};
+    for (const auto& [name, outcome] : outcomes)
+    {
+        m_metricsSampler->AddCounter(name, [tracker, outcome = outcome]() {
+            return tracker->CountPhyOutcomes(outcome);
+        });
+    }
+}
+
+void
+LoraHelper::EnablePacketAudit(NodeContainer nodes, std::string filename, Time interval)
+{
+    NS_LOG_FUNCTION(this << filename << interval);
+
+    m_packetAudit = new LoraPacketAudit();
+    using PacketVisitor = LoraPacketAudit::PacketVisitor;
+
+    // Events are kept until they are old enough to be cleaned up
+    m_packetAudit->AddHolder("interference_events", [nodes](const PacketVisitor& visit) {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it)
+        {
+            for (uint32_t i = 0; i < (*it)->GetNDevices(); i++)
+            {
+                Ptr<LoraNetDevice> loraNetDevice = DynamicCast<LoraNetDevice>((*it)->GetDevice(i));
+                if (loraNetDevice && loraNetDevice->GetPhy())
+                {
+                    for (const auto& event : loraNetDevice->GetPhy()->GetInterferenceEvents())
+                    {
+                        visit(event->GetPacket());
+                    }
+                }
+            }
+        }
+    });
+    m_packetAudit->AddHolder("end_device_retransmissions", [nodes](const PacketVisitor& visit) {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it)
+        {
+            for (uint32_t i = 0; i < (*it)->GetNDevices(); i++)
+            {
+                Ptr<LoraNetDevice> loraNetDevice = DynamicCast<LoraNetDevice>((*it)->GetDevice(i));
+                if (!loraNetDevice)
+                {
+                    continue;
+                }
+                Ptr<EndDeviceLorawanMac> mac =
+                    DynamicCast<EndDeviceLorawanMac>(loraNetDevice->GetMac());
+                if (mac)
+                {
+                    visit(mac->GetRetransmissionPacket());
+                }
+            }
+        }
+    });
+    m_packetAudit->AddHolder("ns_received_packets", [nodes](const PacketVisitor& visit) {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it)
+        {
+            for (uint32_t i = 0; i < (*it)->GetNApplications(); i++)
+            {
+                Ptr<NetworkServer> app = DynamicCast<NetworkServer>((*it)->GetApplication(i));
+                if (!app)
+                {
+                    continue;
+                }
+                for (const auto& [address, status] : app->GetNetworkStatus()->m_endDeviceStatuses)
+                {
+                    for (const auto& [packet, info] : status->GetReceivedPacketList())
+                    {
+                        visit(packet);
+                        visit(info.packet);
+                    }
+                }
+            }
+        }
+    });
 
-    outputFile.close();
+    // The tracker may be enabled after the audit
+    m_packetAudit->AddHolder("tracker_phy_packets", [this](const PacketVisitor& visit) {
+        if (m_packetTracker)
+        {
+            m_packetTracker->VisitPhyPackets(visit);
+        }
+    });
+    m_packetAudit->AddHolder("tracker_mac_packets", [this](const PacketVisitor& visit) {
+        if (m_packetTracker)
+        {
+            m_packetTracker->VisitMacPackets(visit);
+        }
+    });
+
+    m_packetAudit->Start(interval);
+    Simulator::ScheduleDestroy(&LoraPacketAudit::PrintReport, m_packetAudit, filename);
+}
+
+void
+LoraHelper::SamplePacketAuditMetrics()
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_metricsSampler, "Metrics sampling is not enabled");
+    NS_ASSERT_MSG(m_packetAudit, "Packet audit is not enabled");
+    LoraPacketAudit* audit = m_packetAudit;
+    m_metricsSampler->AddUpdate([audit]() { audit->Audit(); });
+    for (std::size_t i = 0; i < audit->GetNHolders(); i++)
+    {
+        m_metricsSampler->AddGauge(audit->GetName(i) + "_packets",
+                                   [audit, i]() { return audit->GetPackets(i); });
+        m_metricsSampler->AddGauge(audit->GetName(i) + "_bytes",
+                                   [audit, i]() { return audit->GetBytes(i); });
+    }
+    m_metricsSampler->AddGauge("live_packets", [audit]() { return audit->GetLivePackets(); });
+    m_metricsSampler->AddGauge("live_bytes", [audit]() { return audit->GetLiveBytes(); });
+}
+
+LoraPacketAudit&
+LoraHelper::GetPacketAudit()
+{
+    NS_LOG_FUNCTION(this);
+
+    return *m_packetAudit;
+}
+
+void
+LoraHelper::OccupiedReceptionPathsCallback(int oldValue, int newValue)
+{
+    m_occupiedReceptionPaths += newValue - oldValue;
+}
+
+void
+LoraHelper::EnableInstrumentationDump(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    Simulator::ScheduleDestroy(&LoraInstrumentation::Dump, filename);
+}
+
+void
+LoraHelper::DumpInstrumentation(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    LoraInstrumentation::Dump(filename);
+}
+
+void
+LoraHelper::FlushPrinting()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_fileWriter)
+    {
+        m_fileWriter->Flush();
+    }
 }
 
 void
@@ -9,8 +9,13 @@
 #ifndef LORA_HELPER_H
 #define LORA_HELPER_H
 
+#include "lora-file-writer.h"
+#include "lora-kpi-tracker.h"
+#include "lora-metrics-sampler.h"
+#include "lora-packet-audit.h"
 #include "lora-packet-tracker.h"
 #include "lora-phy-helper.h"
+#include "lora-trace-writer.h"
 #include "lorawan-mac-helper.h"
 
 #include "ns3/lora-net-device.h"
@@ -71,6 +76,34 @@ class LoraHelper
      */
     void EnablePacketTracking();
 
+    /**
+     * Enable accumulating per-device performance indicators via trace sources.
+     *
+     * This method must be called before devices are installed.
+     */
+    void EnableKpiTracking();
+
+    /**
+     * Enable writing PHY and MAC events to binary files via trace sources.
+     *
+     * This method must be called before devices are installed. Files are closed when the
+     * simulator is destroyed.
+     *
+     * \param prefix The prefix of the file names, as described in LoraTraceWriter.
+     */
+    void EnableBinaryTracing(std::string prefix);
+
+    /**
+     * Periodically write the status of devices to the binary trace.
+     *
+     * For each input device write the current position, data rate and transmission power
+     * settings.
+     *
+     * \param endDevices The devices to track.
+     * \param interval The time interval for writing.
+     */
+    void EnablePeriodicDeviceStatusTracing(NodeContainer endDevices, Time interval);
+
     /**
      * Periodically prints the simulation time to the standard output.
      *
@@ -138,6 +171,100 @@ class LoraHelper
      */
     void DoPrintGlobalPerformance(std::string filename);
 
+    /**
+     * Periodically sample network metrics into a time series, written to a CSV file.
+     *
+     * Metrics are registered with the Sample*Metrics methods, or directly on the sampler, before
+     * the simulation runs. All of them are sampled by a single periodic event. The file is
+     * complete when the simulator is destroyed.
+     *
+     * \param filename The output filename.
+     * \param interval The time interval for sampling.
+     */
+    void EnableMetricsSampling(std::string filename, Time interval);
+
+    /**
+     * Sample the number of occupied reception paths over all gateways in the container.
+     *
+     * The number is kept up to date via trace sources, and gateways are not scanned when
+     * sampling.
+     *
+     * \param gateways The gateways to track.
+     */
+    void SampleGatewayMetrics(NodeContainer gateways);
+
+    /**
+     * Sample the duty cycle utilization of each SubBand, as the fraction of the transmission
+     * time allowed by its duty cycle used on average by the devices in the container, and the
+     * total remaining energy of their energy sources, if any.
+     *
+     * Devices are scanned once per sample for all these metrics. SubBands are those of the
+     * first device.
+     *
+     * \param endDevices The devices to track.
+     */
+    void SampleEndDeviceMetrics(NodeContainer endDevices);
+
+    /**
+     * Sample the number of receive window opportunities waiting in the queue of the scheduler
+     * of a Network Server.
+     *
+     * \param networkServer The node the NetworkServer application is installed on.
+     */
+    void SampleNetworkServerMetrics(Ptr<Node> networkServer);
+
+    /**
+     * Sample the rates of PHY packets sent and of their outcomes at gateways, as counted by the
+     * Packet Tracker, which must be enabled.
+     */
+    void SamplePacketTrackerMetrics();
+
+    /**
+     * Periodically audit the packets retained by the lorawan structures of the nodes in the
+     * container, and write a report of the audits to a file when the simulator is destroyed.
+     *
+     * Packets are counted in the interference helpers of PHYs, the retransmission buffers of end
+     * device MACs, the received packet histories of Network Servers and, if enabled, the Packet
+     * Tracker. Nodes are scanned at every audit, so devices and applications installed later are
+     * audited as well.
+     *
+     * \param nodes The nodes to audit.
+     * \param filename The output filename, as described in LoraPacketAudit::WriteReport.
+     * \param interval The time interval for auditing.
+     */
+    void EnablePacketAudit(NodeContainer nodes, std::string filename, Time interval);
+
+    /**
+     * Sample the numbers of packets and bytes retained by each holder of the packet audit, and
+     * by all of them, auditing at every sample. The packet audit must be enabled.
+     */
+    void SamplePacketAuditMetrics();
+
+    /**
+     * Write the counters and timers of LoraInstrumentation to a file when the simulator is
+     * destroyed.
+     *
+     * \param filename The output filename, written as JSON if it ends with .json, and as CSV
+     * otherwise.
+     */
+    void EnableInstrumentationDump(std::string filename);
+
+    /**
+     * Write the current counters and timers of LoraInstrumentation to a file.
+     *
+     * \param filename The output filename, written as JSON if it ends with .json, and as CSV
+     * otherwise.
+     */
+    void DumpInstrumentation(std::string filename);
+
+    /**
+     * Wait until the output of periodic printers is written to files.
+     *
+     * Printers format their output in the simulation thread, and hand it over to a writing
+     * thread. Output is also completely written when the helper is destroyed.
+     */
+    void FlushPrinting();
+
     /**
      * Get a reference to the Packet Tracker object.
      *
@@ -145,7 +272,48 @@ class LoraHelper
      */
     LoraPacketTracker& GetPacketTracker();
 
-    LoraPacketTracker* m_packetTracker = nullptr; //!< Pointer to the Packet Tracker object
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by the objects of this helper, currently the packet tracker if enabled.
+     *
+     * \param stream The first stream index to use.
+     * \return The number of stream indices assigned by this helper.
+     */
+    int64_t AssignStreams(int64_t stream);
+
+    /**
+     * Get a reference to the binary trace writer.
+     *
+     * \return the reference to the binary trace writer.
+     */
+    LoraTraceWriter& GetTraceWriter();
+
+    /**
+     * Get a reference to the per-device performance indicators.
+     *
+     * \return the reference to the KPI tracker.
+     */
+    LoraKpiTracker& GetKpiTracker();
+
+    /**
+     * Get a reference to the metrics sampler.
+     *
+     * \return the reference to the metrics sampler.
+     */
+    LoraMetricsSampler& GetMetricsSampler();
+
+    /**
+     * Get a reference to the packet audit.
+     *
+     * \return the reference to the packet audit.
+     */
+    LoraPacketAudit& GetPacketAudit();
+
+    LoraPacketTracker* m_packetTracker = nullptr;   //!< Pointer to the Packet Tracker object
+    LoraTraceWriter* m_traceWriter = nullptr;       //!< Pointer to the binary trace writer
+    LoraKpiTracker* m_kpiTracker = nullptr;         //!< Pointer to the KPI tracker
+    LoraMetricsSampler* m_metricsSampler = nullptr; //!< Pointer to the metrics sampler
+    LoraPacketAudit* m_packetAudit = nullptr;       //!< Pointer to the packet audit
     time_t m_oldtime; //!< Real time (i.e., physical) of the last simulation time print
 
     /**
@@ -172,6 +340,25 @@ class LoraHelper
      */
     void DoPrintSimulationTime(Time interval);
 
+    /**
+     * Hand the output of a printer over to the writing thread.
+     *
+     * \param filename The output filename.
+     * \param text The output.
+     */
+    void WriteToFile(std::string filename, std::string text);
+
+    /**
+     * Keep the number of occupied reception paths of all sampled gateways up to date.
+     *
+     * \param oldValue The previous number of occupied paths at a gateway.
+     * \param newValue The new number of occupied paths at the gateway.
+     */
+    void OccupiedReceptionPathsCallback(int oldValue, int newValue);
+
+    Ptr<LoraFileWriter> m_fileWriter; //!< Writes the output of printers, created on first use
+    int m_occupiedReceptionPaths = 0; //!< Occupied reception paths of sampled gateways
+
     Time m_lastPhyPerformanceUpdate;    //!< Timestamp of the last PHY performance update
     Time m_lastGlobalPerformanceUpdate; //!< Timestamp of the last global performance update
 };
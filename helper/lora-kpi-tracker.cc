@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-kpi-tracker.h"
+
+#include "ns3/abort.h"
+#include "ns3/energy-source-container.h"
+#include "ns3/log.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+
+#include <fstream>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraKpiTracker");
+
+LoraKpiTracker::LoraKpiTracker()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+LoraKpiTracker::~LoraKpiTracker()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+LoraKpiTracker::TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    NS_LOG_FUNCTION(this << packet << systemId);
+
+    GetEntry(systemId).transmissions++;
+}
+
+void
+LoraKpiTracker::MacTransmissionCallback(Ptr<const Packet> packet)
+{
+    NS_LOG_FUNCTION(this << packet);
+
+    uint32_t nodeId = Simulator::GetContext();
+    GetEntry(nodeId).sent++;
+
+    // Forget the previous packet of the device, so that at most one packet per device is
+    // waiting for its first reception
+    PendingPacket& pending = m_pending[nodeId];
+    if (pending.valid)
+    {
+        m_pendingDevices.erase(pending.uid);
+    }
+    pending.uid = packet->GetUid();
+    pending.size = packet->GetSize();
+    pending.sendTime = Simulator::Now();
+    pending.valid = true;
+    m_pendingDevices[pending.uid] = nodeId;
+}
+
+void
+LoraKpiTracker::MacGwReceptionCallback(Ptr<const Packet> packet)
+{
+    NS_LOG_FUNCTION(this << packet);
+
+    // Only the first reception of a packet, by any gateway, finds it pending
+    auto it = m_pendingDevices.find(packet->GetUid());
+    if (it == m_pendingDevices.end())
+    {
+        return;
+    }
+    uint32_t nodeId = it->second;
+    m_pendingDevices.erase(it);
+
+    PendingPacket& pending = m_pending[nodeId];
+    pending.valid = false;
+
+    DeviceKpis& kpis = m_devices[nodeId];
+    double latency = (Simulator::Now() - pending.sendTime).GetSeconds();
+    kpis.delivered++;
+    kpis.deliveredBytes += pending.size;
+    kpis.latencySum += latency;
+    kpis.latency.Add(latency);
+}
+
+void
+LoraKpiTracker::RequiredTransmissionsCallback(uint8_t reqTx,
+                                              bool success,
+                                              Time firstAttempt,
+                                              Ptr<Packet> packet)
+{
+    NS_LOG_FUNCTION(this << (unsigned)reqTx << success << firstAttempt << packet);
+
+    DeviceKpis& kpis = GetEntry(Simulator::GetContext());
+    kpis.retxProcesses++;
+    kpis.retxAttempts += reqTx;
+    kpis.retxSuccesses += success;
+}
+
+uint32_t
+LoraKpiTracker::GetNDevices() const
+{
+    return m_devices.size();
+}
+
+const LoraKpiTracker::DeviceKpis&
+LoraKpiTracker::GetDeviceKpis(uint32_t nodeId) const
+{
+    static const DeviceKpis empty;
+    return nodeId < m_devices.size() ? m_devices[nodeId] : empty;
+}
+
+double
+LoraKpiTracker::GetEnergyConsumption(uint32_t nodeId) const
+{
+    NS_LOG_FUNCTION(this << nodeId);
+
+    if (nodeId >= NodeList::GetNNodes())
+    {
+        return 0;
+    }
+    Ptr<EnergySourceContainer> sources =
+        NodeList::GetNode(nodeId)->GetObject<EnergySourceContainer>();
+    if (!sources)
+    {
+        return 0;
+    }
+
+    double energy = 0;
+    for (auto it = sources->Begin(); it != sources->End(); ++it)
+    {
+        DeviceEnergyModelContainer models =
+            (*it)->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
+        for (auto model = models.Begin(); model != models.End(); ++model)
+        {
+            energy += (*model)->GetTotalEnergyConsumption();
+        }
+    }
+    return energy;
+}
+
+void
+LoraKpiTracker::WriteDeviceKpis(std::ostream& os) const
+{
+    NS_LOG_FUNCTION(this);
+
+    os << "node sent delivered pdr delivered_bytes transmissions retx_processes retx_attempts "
+          "retx_successes latency_mean latency_p50 latency_p95 latency_p99 energy "
+          "energy_per_byte\n";
+    for (uint32_t nodeId = 0; nodeId < m_devices.size(); nodeId++)
+    {
+        const DeviceKpis& kpis = m_devices[nodeId];
+        if (kpis.sent == 0)
+        {
+            continue;
+        }
+
+        double energy = GetEnergyConsumption(nodeId);
+        os << nodeId << " " << kpis.sent << " " << kpis.delivered << " "
+           << double(kpis.delivered) / kpis.sent << " " << kpis.deliveredBytes << " "
+           << kpis.transmissions << " " << kpis.retxProcesses << " " << kpis.retxAttempts << " "
+           << kpis.retxSuccesses << " "
+           << (kpis.delivered ? kpis.latencySum / kpis.delivered : 0) << " "
+           << kpis.latency.GetQuantile(0.5) << " " << kpis.latency.GetQuantile(0.95) << " "
+           << kpis.latency.GetQuantile(0.99) << " " << energy << " "
+           << (kpis.deliveredBytes ? energy / kpis.deliveredBytes : 0) << "\n";
+    }
+}
+
+void
+LoraKpiTracker::PrintDeviceKpis(std::string filename) const
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    std::ofstream outputFile(filename, std::ofstream::out | std::ofstream::trunc);
+    NS_ABORT_MSG_IF(!outputFile, "Could not open " << filename);
+    WriteDeviceKpis(outputFile);
+}
+
+LoraKpiTracker::DeviceKpis&
+LoraKpiTracker::GetEntry(uint32_t nodeId)
+{
+    NS_ABORT_MSG_IF(nodeId == Simulator::NO_CONTEXT, "Events must have the context of a node");
+    if (nodeId >= m_devices.size())
+    {
+        m_devices.resize(nodeId + 1);
+        m_pending.resize(nodeId + 1);
+    }
+    return m_devices[nodeId];
+}
+
+} // namespace lorawan
+} // namespace ns3
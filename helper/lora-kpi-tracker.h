@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_KPI_TRACKER_H
+#define LORA_KPI_TRACKER_H
+
+#include "lora-quantile-sketch.h"
+
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A trace sink accumulating key performance indicators of each end device: packet delivery
+ * ratio, retransmissions, latency and energy per delivered byte.
+ *
+ * Unlike LoraPacketTracker, packets are not retained: each device only has running sums, counts
+ * and a quantile sketch of its latencies, in a table indexed by node id, so that memory grows
+ * with the number of devices rather than with the number of packets. A packet is delivered when
+ * it is first received by the MAC layer of a gateway, and its latency is the time from the MAC
+ * layer of the device sending it to that reception. To match receptions with devices, only the
+ * last packet sent by each device is remembered: a packet received after its device sent a new
+ * one is not counted as delivered.
+ */
+class LoraKpiTracker
+{
+  public:
+    /**
+     * The indicators of a device.
+     */
+    struct DeviceKpis
+    {
+        uint64_t sent = 0;           //!< Packets sent by the MAC layer
+        uint64_t delivered = 0;      //!< Packets received by at least one gateway
+        uint64_t deliveredBytes = 0; //!< Bytes of delivered packets, MAC headers included
+        uint64_t transmissions = 0;  //!< Transmissions by the PHY layer, retransmissions included
+        uint64_t retxProcesses = 0;  //!< Completed retransmission processes of confirmed packets
+        uint64_t retxAttempts = 0;   //!< Transmissions attempted during the processes
+        uint64_t retxSuccesses = 0;  //!< Processes ended with an acknowledgment
+        double latencySum = 0;       //!< Sum of the latencies of delivered packets [s]
+        LoraQuantileSketch latency;  //!< Latencies of delivered packets [s]
+    };
+
+    LoraKpiTracker();  //!< Default constructor
+    ~LoraKpiTracker(); //!< Destructor
+
+    /**
+     * Trace a packet TX start by the PHY layer of an end device.
+     *
+     * \param packet The packet being transmitted.
+     * \param systemId Id of the node transmitting the packet.
+     */
+    void TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a packet leaving the MAC layer of an end device.
+     *
+     * \param packet The packet being sent.
+     */
+    void MacTransmissionCallback(Ptr<const Packet> packet);
+
+    /**
+     * Trace a packet received by the MAC layer of a gateway.
+     *
+     * \param packet The packet being received.
+     */
+    void MacGwReceptionCallback(Ptr<const Packet> packet);
+
+    /**
+     * Trace the exit status of a MAC layer packet retransmission process of an end device.
+     *
+     * \param reqTx Number of transmissions attempted during the process.
+     * \param success Whether the retransmission procedure was successful.
+     * \param firstAttempt Timestamp of the initial transmission attempt.
+     * \param packet The packet being retransmitted.
+     */
+    void RequiredTransmissionsCallback(uint8_t reqTx,
+                                       bool success,
+                                       Time firstAttempt,
+                                       Ptr<Packet> packet);
+
+    /**
+     * Get the size of the table, that is, one more than the largest node id seen so far.
+     *
+     * \return The number of entries of the table.
+     */
+    uint32_t GetNDevices() const;
+
+    /**
+     * Get the indicators of a device. Nodes that never sent a packet have empty indicators.
+     *
+     * \param nodeId The id of the node of the device.
+     * \return The indicators of the device.
+     */
+    const DeviceKpis& GetDeviceKpis(uint32_t nodeId) const;
+
+    /**
+     * Get the energy consumed by the radio of a device, as accounted by the LoraRadioEnergyModel
+     * objects installed on its node.
+     *
+     * \param nodeId The id of the node of the device.
+     * \return The energy consumed [J], or 0 if no energy model is installed.
+     */
+    double GetEnergyConsumption(uint32_t nodeId) const;
+
+    /**
+     * Write the table of indicators, with a header line and a line for each device that sent
+     * at least one packet. Columns are separated by spaces: node id, packets sent, packets
+     * delivered, delivery ratio, delivered bytes, PHY transmissions, retransmission processes,
+     * attempts and successes, mean, median, 95th and 99th percentile latency [s], consumed
+     * energy [J] and energy per delivered byte [J].
+     *
+     * \param os The stream to write to.
+     */
+    void WriteDeviceKpis(std::ostream& os) const;
+
+    /**
+     * Write the table of indicators to a file, as described in WriteDeviceKpis.
+     *
+     * \param filename The output filename.
+     */
+    void PrintDeviceKpis(std::string filename) const;
+
+  private:
+    /**
+     * Get the entry of a device, growing the table if needed.
+     *
+     * \param nodeId The id of the node of the device.
+     * \return The entry of the device.
+     */
+    DeviceKpis& GetEntry(uint32_t nodeId);
+
+    /**
+     * The last packet sent by a device, waiting for its first reception.
+     */
+    struct PendingPacket
+    {
+        uint64_t uid = 0;   //!< The uid of the packet
+        uint32_t size = 0;  //!< The size of the packet [bytes]
+        Time sendTime;      //!< The time the MAC layer sent the packet
+        bool valid = false; //!< Whether the packet is still waiting
+    };
+
+    std::vector<DeviceKpis> m_devices;                       //!< Indicators, indexed by node id
+    std::vector<PendingPacket> m_pending;                    //!< Pending packets, by node id
+    std::unordered_map<uint64_t, uint32_t> m_pendingDevices; //!< Node ids of pending packets
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_KPI_TRACKER_H */
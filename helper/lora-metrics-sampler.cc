@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-metrics-sampler.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <sstream>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraMetricsSampler");
+
+LoraMetricsSampler::LoraMetricsSampler(uint32_t capacity)
+    : m_capacity(capacity)
+{
+    NS_LOG_FUNCTION(this << capacity);
+
+    NS_ABORT_MSG_IF(capacity == 0, "At least one row must be kept in memory");
+}
+
+LoraMetricsSampler::~LoraMetricsSampler()
+{
+    NS_LOG_FUNCTION(this);
+
+    // The writer completes the pending rows when destroyed
+    WritePending();
+}
+
+void
+LoraMetricsSampler::SetOutput(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    // Rows recorded before are not written
+    m_filename = filename;
+    m_fileWriter = Create<LoraFileWriter>();
+    m_headerWritten = false;
+    m_nWritten = m_nSamples;
+}
+
+void
+LoraMetricsSampler::AddGauge(std::string name, std::function<double()> source)
+{
+    NS_LOG_FUNCTION(this << name);
+
+    NS_ABORT_MSG_IF(m_started, "Metrics must be registered before sampling starts");
+    m_metrics.push_back({std::move(name), std::move(source), false});
+}
+
+void
+LoraMetricsSampler::AddCounter(std::string name, std::function<double()> source)
+{
+    NS_LOG_FUNCTION(this << name);
+
+    NS_ABORT_MSG_IF(m_started, "Metrics must be registered before sampling starts");
+    m_metrics.push_back({std::move(name), std::move(source), true});
+}
+
+void
+LoraMetricsSampler::AddUpdate(std::function<void()> update)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ABORT_MSG_IF(m_started, "Updates must be registered before sampling starts");
+    m_updates.push_back(std::move(update));
+}
+
+void
+LoraMetricsSampler::Start(Time interval)
+{
+    NS_LOG_FUNCTION(this << interval);
+
+    NS_ABORT_MSG_IF(!interval.IsStrictlyPositive(), "The interval must be positive");
+    m_interval = interval;
+    m_event.Cancel();
+    m_event = Simulator::ScheduleNow(&LoraMetricsSampler::Sample, this);
+}
+
+void
+LoraMetricsSampler::Stop()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_event.Cancel();
+}
+
+void
+LoraMetricsSampler::Flush()
+{
+    NS_LOG_FUNCTION(this);
+
+    WritePending();
+    if (m_fileWriter)
+    {
+        m_fileWriter->Flush();
+    }
+}
+
+std::size_t
+LoraMetricsSampler::GetNMetrics() const
+{
+    return m_metrics.size();
+}
+
+std::string
+LoraMetricsSampler::GetName(std::size_t metric) const
+{
+    return m_metrics.at(metric).name;
+}
+
+uint64_t
+LoraMetricsSampler::GetNSamples() const
+{
+    return m_nSamples;
+}
+
+Time
+LoraMetricsSampler::GetSampleTime(uint64_t sample) const
+{
+    return m_times[GetSlot(sample)];
+}
+
+double
+LoraMetricsSampler::GetValue(uint64_t sample, std::size_t metric) const
+{
+    NS_ABORT_MSG_IF(metric >= m_metrics.size(), "Unknown metric " << metric);
+    return m_values[GetSlot(sample) * m_metrics.size() + metric];
+}
+
+void
+LoraMetricsSampler::Sample()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_event = Simulator::Schedule(m_interval, &LoraMetricsSampler::Sample, this);
+
+    for (auto& update : m_updates)
+    {
+        update();
+    }
+
+    if (!m_started)
+    {
+        // Only read counters, whose rates are computed from the next sample on
+        m_started = true;
+        m_times.resize(m_capacity);
+        m_values.resize(std::size_t(m_capacity) * m_metrics.size());
+        for (auto& metric : m_metrics)
+        {
+            metric.previous = metric.counter ? metric.source() : 0;
+        }
+        return;
+    }
+
+    // Write the rows the new one would overwrite first
+    if (m_fileWriter && m_nSamples - m_nWritten == m_capacity)
+    {
+        WritePending();
+    }
+
+    std::size_t slot = m_nSamples % m_capacity;
+    m_times[slot] = Simulator::Now();
+    double* values = &m_values[slot * m_metrics.size()];
+    for (auto& metric : m_metrics)
+    {
+        double value = metric.source();
+        if (metric.counter)
+        {
+            *values++ = (value - metric.previous) / m_interval.GetSeconds();
+            metric.previous = value;
+        }
+        else
+        {
+            *values++ = value;
+        }
+    }
+    m_nSamples++;
+}
+
+std::size_t
+LoraMetricsSampler::GetSlot(uint64_t sample) const
+{
+    NS_ABORT_MSG_IF(sample >= m_nSamples || m_nSamples - sample > m_capacity,
+                    "Row " << sample << " is not in memory");
+    return sample % m_capacity;
+}
+
+void
+LoraMetricsSampler::WritePending()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (!m_fileWriter || (m_nWritten == m_nSamples && m_headerWritten))
+    {
+        return;
+    }
+
+    std::ostringstream output;
+    if (!m_headerWritten)
+    {
+        output << "time";
+        for (const auto& metric : m_metrics)
+        {
+            output << "," << metric.name;
+        }
+        output << "\n";
+    }
+    for (; m_nWritten < m_nSamples; m_nWritten++)
+    {
+        std::size_t slot = m_nWritten % m_capacity;
+        output << m_times[slot].GetSeconds();
+        for (std::size_t metric = 0; metric < m_metrics.size(); metric++)
+        {
+            output << "," << m_values[slot * m_metrics.size() + metric];
+        }
+        output << "\n";
+    }
+    m_fileWriter->Write(m_filename, output.str(), !m_headerWritten);
+    m_headerWritten = true;
+}
+
+} // namespace lorawan
+} // namespace ns3
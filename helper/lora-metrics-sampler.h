@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_METRICS_SAMPLER_H
+#define LORA_METRICS_SAMPLER_H
+
+#include "lora-file-writer.h"
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * Samples a set of network metrics at regular intervals into an in-memory time series.
+ *
+ * Metrics are registered before sampling starts, as gauges, whose value is recorded as is, or
+ * as counters, whose increase since the previous sample is recorded as a rate per second. A
+ * single periodic event runs update functions, which can refresh the values read by several
+ * metrics in one pass, and then reads all metrics into a row of the series.
+ *
+ * The last rows are kept in a ring buffer, where they can be read during the simulation. If an
+ * output file is set, rows are written as CSV (a time column in seconds, then a column per
+ * metric) in batches, when the buffer is about to overwrite rows that were not written yet and
+ * when the sampler is flushed, through a LoraFileWriter so that the simulation does not wait for
+ * disk operations.
+ */
+class LoraMetricsSampler
+{
+  public:
+    /**
+     * Create a sampler.
+     *
+     * \param capacity The number of rows kept in memory, which is also the size of output
+     * batches.
+     */
+    LoraMetricsSampler(uint32_t capacity = 1024);
+
+    ~LoraMetricsSampler(); //!< Destructor, writing pending rows
+
+    /**
+     * Set the file rows are written to, from the next row on. Its previous contents are deleted.
+     *
+     * \param filename The output filename.
+     */
+    void SetOutput(std::string filename);
+
+    /**
+     * Register a gauge, recorded as its current value.
+     *
+     * \param name The name of the metric, used as column name.
+     * \param source The function returning the current value.
+     */
+    void AddGauge(std::string name, std::function<double()> source);
+
+    /**
+     * Register a counter, recorded as the rate per second of its increase since the previous
+     * sample.
+     *
+     * \param name The name of the metric, used as column name.
+     * \param source The function returning the current value of the counter.
+     */
+    void AddCounter(std::string name, std::function<double()> source);
+
+    /**
+     * Register a function run before the metrics are read at every sample.
+     *
+     * \param update The function.
+     */
+    void AddUpdate(std::function<void()> update);
+
+    /**
+     * Start sampling. The counters are first read when the simulation reaches the current time
+     * (e.g., as soon as it runs, if called before running it), and the first row is recorded one
+     * interval later. Metrics cannot be registered after the counters are first read.
+     *
+     * \param interval The time between samples.
+     */
+    void Start(Time interval);
+
+    /**
+     * Stop sampling.
+     */
+    void Stop();
+
+    /**
+     * Write the rows not yet written to the output file, if any, and wait until they are
+     * written.
+     */
+    void Flush();
+
+    /**
+     * Get the number of metrics.
+     *
+     * \return The number of metrics.
+     */
+    std::size_t GetNMetrics() const;
+
+    /**
+     * Get the name of a metric.
+     *
+     * \param metric The index of the metric, in order of registration.
+     * \return The name of the metric.
+     */
+    std::string GetName(std::size_t metric) const;
+
+    /**
+     * Get the number of rows recorded since the start, including those no longer in memory.
+     *
+     * \return The number of rows.
+     */
+    uint64_t GetNSamples() const;
+
+    /**
+     * Get the time of a row, which must still be in memory.
+     *
+     * \param sample The index of the row, from 0 for the first row recorded.
+     * \return The time of the row.
+     */
+    Time GetSampleTime(uint64_t sample) const;
+
+    /**
+     * Get the value of a metric in a row, which must still be in memory.
+     *
+     * \param sample The index of the row, from 0 for the first row recorded.
+     * \param metric The index of the metric, in order of registration.
+     * \return The value of the metric.
+     */
+    double GetValue(uint64_t sample, std::size_t metric) const;
+
+  private:
+    /**
+     * A registered metric.
+     */
+    struct Metric
+    {
+        std::string name;               //!< The name of the metric
+        std::function<double()> source; //!< The function returning its value
+        bool counter;                   //!< Whether the metric is a counter
+        double previous = 0;            //!< The value of a counter at the previous sample
+    };
+
+    /**
+     * Record a row, or read the counters for the first time, and schedule the next sample.
+     */
+    void Sample();
+
+    /**
+     * Get the position of a row in the ring buffer, checking that it is still in memory.
+     *
+     * \param sample The index of the row.
+     * \return The position of the row.
+     */
+    std::size_t GetSlot(uint64_t sample) const;
+
+    /**
+     * Hand the rows not yet written over to the writing thread.
+     */
+    void WritePending();
+
+    uint32_t m_capacity;                          //!< The number of rows kept in memory
+    std::vector<Metric> m_metrics;                //!< The metrics, in order of registration
+    std::vector<std::function<void()>> m_updates; //!< The functions run before every sample
+    Time m_interval;                              //!< The time between samples
+    EventId m_event;                              //!< The next sample
+    bool m_started = false;                       //!< Whether sampling started
+    std::vector<Time> m_times;                    //!< The times of the rows in memory
+    std::vector<double> m_values;                 //!< The values of the rows in memory, by row
+    uint64_t m_nSamples = 0;                      //!< The number of rows recorded
+    uint64_t m_nWritten = 0;                      //!< The number of rows already written
+    std::string m_filename;                       //!< The output filename, if any
+    Ptr<LoraFileWriter> m_fileWriter;             //!< Writes rows, created with the output
+    bool m_headerWritten = false;                 //!< Whether the output has its header
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_METRICS_SAMPLER_H */
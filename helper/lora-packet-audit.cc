@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-packet-audit.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/lora-instrumentation.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraPacketAudit");
+
+LoraPacketAudit::LoraPacketAudit()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+LoraPacketAudit::~LoraPacketAudit()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+LoraPacketAudit::AddHolder(std::string name, Holder holder)
+{
+    NS_LOG_FUNCTION(this << name);
+
+    m_holders.push_back({std::move(name), std::move(holder), Counts()});
+}
+
+void
+LoraPacketAudit::Audit()
+{
+    NS_LOG_FUNCTION(this);
+
+    LORAWAN_TIME_SCOPE("LoraPacketAudit/Audit");
+
+    // A structure may reference a packet more than once, and several structures may reference
+    // the same packet, so packets are counted once per holder and once overall
+    std::unordered_set<const Packet*> live;
+    std::unordered_set<const Packet*> held;
+    m_live.packets = 0;
+    m_live.bytes = 0;
+    for (auto& entry : m_holders)
+    {
+        held.clear();
+        Counts& counts = entry.counts;
+        counts.packets = 0;
+        counts.bytes = 0;
+        entry.holder([&](Ptr<const Packet> packet) {
+            if (!packet || !held.insert(PeekPointer(packet)).second)
+            {
+                return;
+            }
+            counts.packets++;
+            counts.bytes += packet->GetSize();
+            if (live.insert(PeekPointer(packet)).second)
+            {
+                m_live.packets++;
+                m_live.bytes += packet->GetSize();
+            }
+        });
+        counts.peakPackets = std::max(counts.peakPackets, counts.packets);
+        counts.peakBytes = std::max(counts.peakBytes, counts.bytes);
+        NS_LOG_DEBUG(entry.name << ": " << counts.packets << " packets, " << counts.bytes
+                                << " bytes");
+    }
+    m_live.peakPackets = std::max(m_live.peakPackets, m_live.packets);
+    m_live.peakBytes = std::max(m_live.peakBytes, m_live.bytes);
+    m_nAudits++;
+}
+
+void
+LoraPacketAudit::Start(Time interval)
+{
+    NS_LOG_FUNCTION(this << interval);
+
+    NS_ABORT_MSG_IF(!interval.IsStrictlyPositive(), "The interval must be positive");
+    m_interval = interval;
+    m_event.Cancel();
+    m_event = Simulator::ScheduleNow(&LoraPacketAudit::DoPeriodicAudit, this);
+}
+
+void
+LoraPacketAudit::Stop()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_event.Cancel();
+}
+
+uint64_t
+LoraPacketAudit::GetNAudits() const
+{
+    return m_nAudits;
+}
+
+std::size_t
+LoraPacketAudit::GetNHolders() const
+{
+    return m_holders.size();
+}
+
+std::string
+LoraPacketAudit::GetName(std::size_t holder) const
+{
+    return m_holders.at(holder).name;
+}
+
+uint64_t
+LoraPacketAudit::GetPackets(std::size_t holder) const
+{
+    return m_holders.at(holder).counts.packets;
+}
+
+uint64_t
+LoraPacketAudit::GetBytes(std::size_t holder) const
+{
+    return m_holders.at(holder).counts.bytes;
+}
+
+uint64_t
+LoraPacketAudit::GetLivePackets() const
+{
+    return m_live.packets;
+}
+
+uint64_t
+LoraPacketAudit::GetLiveBytes() const
+{
+    return m_live.bytes;
+}
+
+void
+LoraPacketAudit::WriteReport(std::ostream& os) const
+{
+    NS_LOG_FUNCTION(this);
+
+    std::vector<const HolderEntry*> entries;
+    uint64_t totalPeakBytes = 0;
+    for (const auto& entry : m_holders)
+    {
+        entries.push_back(&entry);
+        totalPeakBytes += entry.counts.peakBytes;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+        return a->counts.peakBytes > b->counts.peakBytes;
+    });
+
+    auto writeLine = [&os, totalPeakBytes](const std::string& name, const Counts& counts) {
+        os << name << " " << counts.packets << " " << counts.bytes << " " << counts.peakPackets
+           << " " << counts.peakBytes << " "
+           << (totalPeakBytes ? double(counts.peakBytes) / totalPeakBytes : 0) << "\n";
+    };
+    os << "holder packets bytes peak_packets peak_bytes peak_share\n";
+    for (const HolderEntry* entry : entries)
+    {
+        writeLine(entry->name, entry->counts);
+    }
+    writeLine("live", m_live);
+}
+
+void
+LoraPacketAudit::PrintReport(std::string filename) const
+{
+    NS_LOG_FUNCTION(this << filename);
+
+    std::ofstream outputFile(filename, std::ofstream::out | std::ofstream::trunc);
+    NS_ABORT_MSG_IF(!outputFile, "Could not open " << filename);
+    WriteReport(outputFile);
+}
+
+void
+LoraPacketAudit::DoPeriodicAudit()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_event = Simulator::Schedule(m_interval, &LoraPacketAudit::DoPeriodicAudit, this);
+    Audit();
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_PACKET_AUDIT_H
+#define LORA_PACKET_AUDIT_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A diagnostic counting the packets retained by the structures of the simulation, to find
+ * which of them keep packets alive longer than needed.
+ *
+ * Each holder is a named function calling a visitor on every packet a kind of structure
+ * currently references, for instance the events of the interference helpers of all PHYs. An
+ * audit visits all holders, and counts the distinct packets and their bytes for each holder and
+ * overall, keeping the peak values reached so far. Bytes are packet sizes, headers included, so
+ * they underestimate the memory used by packet objects and their metadata.
+ *
+ * Audits visit every retained packet, so they are meant to run at a coarse interval.
+ */
+class LoraPacketAudit
+{
+  public:
+    /**
+     * A function called on each packet held.
+     */
+    typedef std::function<void(Ptr<const Packet>)> PacketVisitor;
+
+    /**
+     * A function calling a visitor on each packet held by a kind of structure.
+     */
+    typedef std::function<void(const PacketVisitor&)> Holder;
+
+    LoraPacketAudit();  //!< Default constructor
+    ~LoraPacketAudit(); //!< Destructor
+
+    /**
+     * Register a holder.
+     *
+     * \param name The name of the holder, used in the report.
+     * \param holder The function visiting the packets of the holder.
+     */
+    void AddHolder(std::string name, Holder holder);
+
+    /**
+     * Count the packets of all holders now.
+     */
+    void Audit();
+
+    /**
+     * Start auditing periodically, from the current time.
+     *
+     * \param interval The time between audits.
+     */
+    void Start(Time interval);
+
+    /**
+     * Stop auditing periodically.
+     */
+    void Stop();
+
+    /**
+     * Get the number of audits performed.
+     *
+     * \return The number of audits.
+     */
+    uint64_t GetNAudits() const;
+
+    /**
+     * Get the number of holders.
+     *
+     * \return The number of holders.
+     */
+    std::size_t GetNHolders() const;
+
+    /**
+     * Get the name of a holder.
+     *
+     * \param holder The index of the holder, in order of registration.
+     * \return The name of the holder.
+     */
+    std::string GetName(std::size_t holder) const;
+
+    /**
+     * Get the number of distinct packets of a holder at the last audit.
+     *
+     * \param holder The index of the holder, in order of registration.
+     * \return The number of packets.
+     */
+    uint64_t GetPackets(std::size_t holder) const;
+
+    /**
+     * Get the bytes of the distinct packets of a holder at the last audit.
+     *
+     * \param holder The index of the holder, in order of registration.
+     * \return The number of bytes.
+     */
+    uint64_t GetBytes(std::size_t holder) const;
+
+    /**
+     * Get the number of distinct packets held by any holder at the last audit.
+     *
+     * \return The number of packets.
+     */
+    uint64_t GetLivePackets() const;
+
+    /**
+     * Get the bytes of the distinct packets held by any holder at the last audit.
+     *
+     * \return The number of bytes.
+     */
+    uint64_t GetLiveBytes() const;
+
+    /**
+     * Write the report of the audits, with a header line, a line for each holder by decreasing
+     * peak bytes, and a last line for the distinct packets of all holders, named live. Columns
+     * are separated by spaces: name, packets and bytes at the last audit, peak packets and peak
+     * bytes over all audits, and share of the peak bytes of all holders.
+     *
+     * \param os The stream to write to.
+     */
+    void WriteReport(std::ostream& os) const;
+
+    /**
+     * Write the report of the audits to a file, as described in WriteReport.
+     *
+     * \param filename The output filename.
+     */
+    void PrintReport(std::string filename) const;
+
+  private:
+    /**
+     * Audit and schedule the next audit.
+     */
+    void DoPeriodicAudit();
+
+    /**
+     * The counts of a holder, or of all of them.
+     */
+    struct Counts
+    {
+        uint64_t packets = 0;     //!< Distinct packets at the last audit
+        uint64_t bytes = 0;       //!< Bytes of the packets at the last audit
+        uint64_t peakPackets = 0; //!< Largest number of packets over all audits
+        uint64_t peakBytes = 0;   //!< Largest number of bytes over all audits
+    };
+
+    /**
+     * A registered holder.
+     */
+    struct HolderEntry
+    {
+        std::string name; //!< The name of the holder
+        Holder holder;    //!< The function visiting its packets
+        Counts counts;    //!< Its counts
+    };
+
+    std::vector<HolderEntry> m_holders; //!< The holders, in order of registration
+    Counts m_live;                      //!< The counts of all holders together
+    uint64_t m_nAudits = 0;             //!< The number of audits performed
+    Time m_interval;                    //!< The time between periodic audits
+    EventId m_event;                    //!< The next periodic audit
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_PACKET_AUDIT_H */
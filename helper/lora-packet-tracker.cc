@@ -8,10 +8,14 @@
 
 #include "lora-packet-tracker.h"
 
+#include "ns3/abort.h"
 #include "ns3/log.h"
+#include "ns3/lora-instrumentation.h"
+#include "ns3/lora-tag.h"
 #include "ns3/lorawan-mac-header.h"
 #include "ns3/simulator.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -22,6 +26,7 @@ namespace lorawan
 NS_LOG_COMPONENT_DEFINE("LoraPacketTracker");
 
 LoraPacketTracker::LoraPacketTracker()
+    : m_nextRetirement(1024)
 {
     NS_LOG_FUNCTION(this);
 }
@@ -31,6 +36,57 @@ LoraPacketTracker::~LoraPacketTracker()
     NS_LOG_FUNCTION(this);
 }
 
+void
+LoraPacketTracker::EnableStreamingMode(Time bucketSize, Time retirementDelay)
+{
+    NS_LOG_FUNCTION(this << bucketSize << retirementDelay);
+
+    NS_ABORT_MSG_IF(!m_packetTracker.empty() || !m_macPacketTracker.empty() ||
+                        !m_reTransmissionsByFirstAttempt.empty(),
+                    "Streaming mode must be enabled before any packet is tracked");
+    NS_ABORT_MSG_IF(!bucketSize.IsStrictlyPositive(), "The bucket size must be positive");
+    NS_ABORT_MSG_IF(!retirementDelay.IsStrictlyPositive(), "The retirement delay must be positive");
+
+    m_streaming = true;
+    m_bucketSizeNs = bucketSize.GetNanoSeconds();
+    m_retirementDelay = retirementDelay;
+}
+
+void
+LoraPacketTracker::EnableRetransmissionSampling(uint32_t maxSamples)
+{
+    NS_LOG_FUNCTION(this << maxSamples);
+
+    m_maxRetransmissionSamples = maxSamples;
+    m_retxSamples.clear();
+    m_retxSamples.reserve(maxSamples);
+    m_nRetransmissions = 0;
+    if (!m_retxSamplingRng)
+    {
+        m_retxSamplingRng = CreateObject<UniformRandomVariable>();
+    }
+}
+
+const std::vector<RetransmissionStatus>&
+LoraPacketTracker::GetRetransmissionSamples() const
+{
+    return m_retxSamples;
+}
+
+int64_t
+LoraPacketTracker::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+
+    // Sampling may be enabled later, and must then keep the stream
+    if (!m_retxSamplingRng)
+    {
+        m_retxSamplingRng = CreateObject<UniformRandomVariable>();
+    }
+    m_retxSamplingRng->SetStream(stream);
+    return 1;
+}
+
 /////////////////
 // MAC metrics //
 /////////////////
@@ -48,7 +104,32 @@ LoraPacketTracker::MacTransmissionCallback(Ptr<const Packet> packet)
         status.senderId = Simulator::GetContext();
         status.receivedTime = Time::Max();
 
-        m_macPacketTracker.insert(std::pair<Ptr<const Packet>, MacPacketStatus>(packet, status));
+        auto inserted = m_macPacketTracker.insert(
+            std::pair<Ptr<const Packet>, MacPacketStatus>(packet, status));
+        if (inserted.second)
+        {
+            LORAWAN_COUNT("LoraPacketTracker/MacPacketsTracked", 1);
+
+            // Packets are sent in time order, so they are appended to the index
+            m_macPacketsBySendTime.emplace_hint(m_macPacketsBySendTime.end(),
+                                                status.sendTime,
+                                                inserted.first);
+            if (m_streaming)
+            {
+                m_lifecycles.try_emplace(PeekPointer(packet),
+                                         Lifecycle{status.sendTime, IsConfirmed(packet), false});
+            }
+            if (m_macPacketsSent++ == 0)
+            {
+                m_firstMacSendTime = status.sendTime;
+            }
+            m_lastMacSendTime = status.sendTime;
+        }
+
+        if (m_streaming && m_packetTracker.size() + m_macPacketTracker.size() >= m_nextRetirement)
+        {
+            RetireFinishedPackets();
+        }
     }
 }
 
@@ -62,13 +143,50 @@ LoraPacketTracker::RequiredTransmissionsCallback(uint8_t reqTx,
     NS_LOG_DEBUG("Packet: " << packet << "ReqTx " << unsigned(reqTx) << ", succ: " << success
                             << ", firstAttempt: " << firstAttempt.GetSeconds());
 
+    // Only a compact record is kept, so that the packet can be freed
     RetransmissionStatus entry;
     entry.firstAttempt = firstAttempt;
     entry.finishTime = Simulator::Now();
     entry.reTxAttempts = reqTx;
     entry.successful = success;
+    entry.packetUid = packet->GetUid();
+    entry.senderId = Simulator::GetContext();
+    entry.sf = GetSfIndex(packet) + 7;
+
+    if (m_streaming)
+    {
+        GetStreamingCounters(firstAttempt)
+            .retransmissions[GetRetransmissionBin(reqTx, success, entry.sf)]++;
+
+        // The packet will not be transmitted again
+        auto lifecycle = m_lifecycles.find(PeekPointer(packet));
+        if (lifecycle != m_lifecycles.end())
+        {
+            lifecycle->second.ended = true;
+        }
+    }
+    else
+    {
+        m_reTransmissionsByFirstAttempt.emplace(firstAttempt, entry);
+    }
 
-    m_reTransmissionTracker.insert(std::pair<Ptr<Packet>, RetransmissionStatus>(packet, entry));
+    // Keep a uniform sample of the processes (reservoir sampling)
+    if (m_maxRetransmissionSamples > 0)
+    {
+        if (m_retxSamples.size() < m_maxRetransmissionSamples)
+        {
+            m_retxSamples.push_back(entry);
+        }
+        else
+        {
+            uint64_t slot = m_retxSamplingRng->GetInteger(0, m_nRetransmissions);
+            if (slot < m_maxRetransmissionSamples)
+            {
+                m_retxSamples[slot] = entry;
+            }
+        }
+        m_nRetransmissions++;
+    }
 }
 
 void
@@ -83,12 +201,16 @@ LoraPacketTracker::MacGwReceptionCallback(Ptr<const Packet> packet)
         auto it = m_macPacketTracker.find(packet);
         if (it != m_macPacketTracker.end())
         {
+            // The packet counts as received at its first reception
+            m_macPacketsReceived += (*it).second.receptionTimes.empty();
             (*it).second.receptionTimes.insert(
                 std::pair<int, Time>(Simulator::GetContext(), Simulator::Now()));
         }
         else
         {
-            NS_ABORT_MSG("Packet not found in tracker");
+            // The packets of a LoraEndDeviceFleet are never tracked, and copies of a packet
+            // can reach a gateway after it was retired in streaming mode
+            NS_LOG_DEBUG("Ignoring gateway reception of an untracked packet");
         }
     }
 }
@@ -109,74 +231,100 @@ LoraPacketTracker::TransmissionCallback(Ptr<const Packet> packet, uint32_t edId)
         status.sendTime = Simulator::Now();
         status.senderId = edId;
 
-        m_packetTracker.insert(std::pair<Ptr<const Packet>, PacketStatus>(packet, status));
+        auto inserted =
+            m_packetTracker.insert(std::pair<Ptr<const Packet>, PacketStatus>(packet, status));
+        if (inserted.second)
+        {
+            LORAWAN_COUNT("LoraPacketTracker/PhyPacketsTracked", 1);
+
+            // Packets are sent in time order, so they are appended to the index
+            m_phyPacketsBySendTime.emplace_hint(m_phyPacketsBySendTime.end(),
+                                                status.sendTime,
+                                                inserted.first);
+            if (m_phyPacketsSent++ == 0)
+            {
+                m_firstPhySendTime = status.sendTime;
+            }
+            m_lastPhySendTime = status.sendTime;
+        }
+
+        // Retransmissions of a packet delay its retirement
+        if (m_streaming)
+        {
+            m_lifecycles
+                .try_emplace(PeekPointer(packet),
+                             Lifecycle{status.sendTime, IsConfirmed(packet), false})
+                .first->second.lastTransmission = status.sendTime;
+        }
+
+        if (m_streaming && m_packetTracker.size() + m_macPacketTracker.size() >= m_nextRetirement)
+        {
+            RetireFinishedPackets();
+        }
     }
 }
 
 void
 LoraPacketTracker::PacketReceptionCallback(Ptr<const Packet> packet, uint32_t gwId)
 {
-    if (IsUplink(packet))
-    {
-        // Remove the successfully received packet from the list of sent ones
-        NS_LOG_INFO("PHY packet " << packet << " was successfully received at gateway " << gwId);
+    // Remove the successfully received packet from the list of sent ones
+    NS_LOG_INFO("PHY packet " << packet << " was successfully received at gateway " << gwId);
 
-        auto it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId, RECEIVED));
-    }
+    InsertOutcome(packet, gwId, RECEIVED);
 }
 
 void
 LoraPacketTracker::InterferenceCallback(Ptr<const Packet> packet, uint32_t gwId)
 {
-    if (IsUplink(packet))
-    {
-        NS_LOG_INFO("PHY packet " << packet << " was interfered at gateway " << gwId);
+    NS_LOG_INFO("PHY packet " << packet << " was interfered at gateway " << gwId);
 
-        auto it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId, INTERFERED));
-    }
+    InsertOutcome(packet, gwId, INTERFERED);
 }
 
 void
 LoraPacketTracker::NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t gwId)
 {
-    if (IsUplink(packet))
-    {
-        NS_LOG_INFO("PHY packet " << packet << " was lost because no more receivers at gateway "
-                                  << gwId);
-        auto it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(
-            std::pair<int, enum PhyPacketOutcome>(gwId, NO_MORE_RECEIVERS));
-    }
+    NS_LOG_INFO("PHY packet " << packet << " was lost because no more receivers at gateway "
+                              << gwId);
+    InsertOutcome(packet, gwId, NO_MORE_RECEIVERS);
 }
 
 void
 LoraPacketTracker::UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t gwId)
 {
-    if (IsUplink(packet))
-    {
-        NS_LOG_INFO("PHY packet " << packet << " was lost because under sensitivity at gateway "
-                                  << gwId);
+    NS_LOG_INFO("PHY packet " << packet << " was lost because under sensitivity at gateway "
+                              << gwId);
 
-        auto it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(
-            std::pair<int, enum PhyPacketOutcome>(gwId, UNDER_SENSITIVITY));
-    }
+    InsertOutcome(packet, gwId, UNDER_SENSITIVITY);
 }
 
 void
 LoraPacketTracker::LostBecauseTxCallback(Ptr<const Packet> packet, uint32_t gwId)
 {
-    if (IsUplink(packet))
+    NS_LOG_INFO(
+        "PHY packet " << packet
+                      << " was lost because of concurrent downlink transmission at gateway "
+                      << gwId);
+
+    InsertOutcome(packet, gwId, LOST_BECAUSE_TX);
+}
+
+void
+LoraPacketTracker::InsertOutcome(Ptr<const Packet> packet, int gwId, PhyPacketOutcome outcome)
+{
+    auto it = m_packetTracker.find(packet);
+    if (it == m_packetTracker.end())
     {
-        NS_LOG_INFO(
-            "PHY packet " << packet
-                          << " was lost because of concurrent downlink transmission at gateway "
-                          << gwId);
+        // Downlink packets are never tracked, and neither are the packets of a
+        // LoraEndDeviceFleet, whose sends are not traced
+        NS_LOG_DEBUG("Ignoring outcome of an untracked packet");
+        return;
+    }
 
-        auto it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId, LOST_BECAUSE_TX));
+    // Only the first outcome of a packet at a gateway counts
+    if ((*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId, outcome)).second)
+    {
+        m_phyOutcomesPerGw[gwId][outcome]++;
     }
 }
 
@@ -185,9 +333,12 @@ LoraPacketTracker::IsUplink(Ptr<const Packet> packet)
 {
     NS_LOG_FUNCTION(this);
 
+    // Peek the first byte of the packet, which holds the MType, instead of
+    // copying the packet to remove the header
+    uint8_t firstByte = 0;
+    packet->CopyData(&firstByte, 1);
     LorawanMacHeader mHdr;
-    Ptr<Packet> copy = packet->Copy();
-    copy->RemoveHeader(mHdr);
+    mHdr.SetMType(LorawanMacHeader::MType(firstByte >> 5));
     return mHdr.IsUplink();
 }
 
@@ -197,6 +348,20 @@ LoraPacketTracker::IsUplink(Ptr<const Packet> packet)
 
 std::vector<int>
 LoraPacketTracker::CountPhyPacketsPerGw(Time startTime, Time stopTime, int gwId)
+{
+    return CountPhyPackets(startTime, stopTime, gwId, -1);
+}
+
+std::vector<int>
+LoraPacketTracker::CountPhyPacketsPerGw(Time startTime, Time stopTime, int gwId, uint8_t sf)
+{
+    NS_ASSERT_MSG(sf >= 7 && sf <= 12, "Only spreading factors from 7 to 12 are counted");
+
+    return CountPhyPackets(startTime, stopTime, gwId, sf - 7);
+}
+
+std::vector<int>
+LoraPacketTracker::CountPhyPackets(Time startTime, Time stopTime, int gwId, int sfIndex)
 {
     // Vector packetCounts will contain - for the interval given in the input of
     // the function, the following fields: totPacketsSent receivedPackets
@@ -204,102 +369,99 @@ LoraPacketTracker::CountPhyPacketsPerGw(Time startTime, Time stopTime, int gwId)
 
     std::vector<int> packetCounts(6, 0);
 
-    for (auto itPhy = m_packetTracker.begin(); itPhy != m_packetTracker.end(); ++itPhy)
+    // Intervals covering all packets are answered by the running totals
+    if (sfIndex < 0 && m_phyPacketsSent > 0 && startTime <= m_firstPhySendTime &&
+        stopTime >= m_lastPhySendTime)
     {
-        if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+        packetCounts.at(0) = m_phyPacketsSent;
+        auto gwIt = m_phyOutcomesPerGw.find(gwId);
+        for (int outcome = 0; gwIt != m_phyOutcomesPerGw.end() && outcome < N_OUTCOMES; outcome++)
         {
-            packetCounts.at(0)++;
+            packetCounts.at(outcome + 1) = gwIt->second[outcome];
+        }
+        return packetCounts;
+    }
 
-            NS_LOG_DEBUG("Dealing with packet " << (*itPhy).second.packet);
-            NS_LOG_DEBUG("This packet was received by " << (*itPhy).second.outcomes.size()
-                                                        << " gateways");
+    if (m_streaming)
+    {
+        RetireFinishedPackets();
 
-            if ((*itPhy).second.outcomes.count(gwId) > 0)
+        // The outcome of index i is counted in field i + 1
+        for (const StreamingCounters* counters : GetStreamingCounters(startTime, stopTime))
+        {
+            auto gwIt = counters->phyOutcomes.find(gwId);
+            for (int sf = 0; sf < N_SFS; sf++)
             {
-                switch ((*itPhy).second.outcomes.at(gwId))
+                if (sfIndex >= 0 && sf != sfIndex)
                 {
-                case RECEIVED: {
-                    packetCounts.at(1)++;
-                    break;
-                }
-                case INTERFERED: {
-                    packetCounts.at(2)++;
-                    break;
-                }
-                case NO_MORE_RECEIVERS: {
-                    packetCounts.at(3)++;
-                    break;
-                }
-                case UNDER_SENSITIVITY: {
-                    packetCounts.at(4)++;
-                    break;
-                }
-                case LOST_BECAUSE_TX: {
-                    packetCounts.at(5)++;
-                    break;
-                }
-                case UNSET: {
-                    break;
+                    continue;
                 }
+                packetCounts.at(0) += counters->phySent[sf];
+                for (int outcome = 0; gwIt != counters->phyOutcomes.end() && outcome < N_OUTCOMES;
+                     outcome++)
+                {
+                    packetCounts.at(outcome + 1) += gwIt->second[outcome * N_SFS + sf];
                 }
             }
         }
     }
 
-    return packetCounts;
-}
-
-std::string
-LoraPacketTracker::PrintPhyPacketsPerGw(Time startTime, Time stopTime, int gwId)
-{
-    // Vector packetCounts will contain - for the interval given in the input of
-    // the function, the following fields: totPacketsSent receivedPackets
-    // interferedPackets noMoreGwPackets underSensitivityPackets lostBecauseTxPackets
-
-    std::vector<int> packetCounts(6, 0);
-
-    for (auto itPhy = m_packetTracker.begin(); itPhy != m_packetTracker.end(); ++itPhy)
+    // Only visit the packets sent in the interval
+    for (auto index = m_phyPacketsBySendTime.lower_bound(startTime);
+         index != m_phyPacketsBySendTime.end() && index->first <= stopTime;
+         ++index)
     {
-        if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+        auto itPhy = index->second;
+        if (sfIndex >= 0 && GetSfIndex((*itPhy).first) != sfIndex)
         {
-            packetCounts.at(0)++;
+            continue;
+        }
 
-            NS_LOG_DEBUG("Dealing with packet " << (*itPhy).second.packet);
-            NS_LOG_DEBUG("This packet was received by " << (*itPhy).second.outcomes.size()
-                                                        << " gateways");
+        packetCounts.at(0)++;
 
-            if ((*itPhy).second.outcomes.count(gwId) > 0)
+        NS_LOG_DEBUG("Dealing with packet " << (*itPhy).second.packet);
+        NS_LOG_DEBUG("This packet was received by " << (*itPhy).second.outcomes.size()
+                                                    << " gateways");
+
+        if ((*itPhy).second.outcomes.count(gwId) > 0)
+        {
+            switch ((*itPhy).second.outcomes.at(gwId))
             {
-                switch ((*itPhy).second.outcomes.at(gwId))
-                {
-                case RECEIVED: {
-                    packetCounts.at(1)++;
-                    break;
-                }
-                case INTERFERED: {
-                    packetCounts.at(2)++;
-                    break;
-                }
-                case NO_MORE_RECEIVERS: {
-                    packetCounts.at(3)++;
-                    break;
-                }
-                case UNDER_SENSITIVITY: {
-                    packetCounts.at(4)++;
-                    break;
-                }
-                case LOST_BECAUSE_TX: {
-                    packetCounts.at(5)++;
-                    break;
-                }
-                case UNSET: {
-                    break;
-                }
-                }
+            case RECEIVED: {
+                packetCounts.at(1)++;
+                break;
+            }
+            case INTERFERED: {
+                packetCounts.at(2)++;
+                break;
+            }
+            case NO_MORE_RECEIVERS: {
+                packetCounts.at(3)++;
+                break;
+            }
+            case UNDER_SENSITIVITY: {
+                packetCounts.at(4)++;
+                break;
+            }
+            case LOST_BECAUSE_TX: {
+                packetCounts.at(5)++;
+                break;
+            }
+            case UNSET: {
+                break;
+            }
             }
         }
     }
 
+    return packetCounts;
+}
+
+std::string
+LoraPacketTracker::PrintPhyPacketsPerGw(Time startTime, Time stopTime, int gwId)
+{
+    std::vector<int> packetCounts = CountPhyPacketsPerGw(startTime, stopTime, gwId);
+
     std::string output("");
     for (int i = 0; i < 6; ++i)
     {
@@ -316,15 +478,34 @@ LoraPacketTracker::CountMacPacketsGlobally(Time startTime, Time stopTime)
 
     double sent = 0;
     double received = 0;
-    for (auto it = m_macPacketTracker.begin(); it != m_macPacketTracker.end(); ++it)
+
+    // Intervals covering all packets are answered by the running totals
+    if (m_macPacketsSent > 0 && startTime <= m_firstMacSendTime && stopTime >= m_lastMacSendTime)
     {
-        if ((*it).second.sendTime >= startTime && (*it).second.sendTime <= stopTime)
+        sent = m_macPacketsSent;
+        received = m_macPacketsReceived;
+        return std::to_string(sent) + " " + std::to_string(received);
+    }
+
+    if (m_streaming)
+    {
+        RetireFinishedPackets();
+
+        for (const StreamingCounters* counters : GetStreamingCounters(startTime, stopTime))
         {
-            sent++;
-            if (!(*it).second.receptionTimes.empty())
-            {
-                received++;
-            }
+            sent += counters->macSent;
+            received += counters->macReceived;
+        }
+    }
+
+    for (auto index = m_macPacketsBySendTime.lower_bound(startTime);
+         index != m_macPacketsBySendTime.end() && index->first <= stopTime;
+         ++index)
+    {
+        sent++;
+        if (!index->second->second.receptionTimes.empty())
+        {
+            received++;
         }
     }
 
@@ -338,22 +519,299 @@ LoraPacketTracker::CountMacPacketsGloballyCpsr(Time startTime, Time stopTime)
 
     double sent = 0;
     double received = 0;
-    for (auto it = m_reTransmissionTracker.begin(); it != m_reTransmissionTracker.end(); ++it)
+    std::vector<int> histogram = CountRetransmissionHistogram(startTime, stopTime);
+    for (int attempts = 1; attempts <= MAX_ATTEMPTS; attempts++)
+    {
+        for (uint8_t sf = 7; sf <= 12; sf++)
+        {
+            sent += histogram[GetRetransmissionBin(attempts, false, sf)];
+            received += histogram[GetRetransmissionBin(attempts, true, sf)];
+        }
+    }
+    sent += received;
+
+    return std::to_string(sent) + " " + std::to_string(received);
+}
+
+std::string
+LoraPacketTracker::CountRetransmissions(Time startTime, Time stopTime)
+{
+    NS_LOG_FUNCTION(this << startTime << stopTime);
+
+    std::vector<int> histogram = CountRetransmissionHistogram(startTime, stopTime);
+    std::string output("");
+    for (int attempts = 1; attempts <= MAX_ATTEMPTS; attempts++)
+    {
+        int successful = 0;
+        for (uint8_t sf = 7; sf <= 12; sf++)
+        {
+            successful += histogram[GetRetransmissionBin(attempts, true, sf)];
+        }
+        output += (attempts > 1 ? " " : "") + std::to_string(successful);
+    }
+
+    return output;
+}
+
+std::vector<int>
+LoraPacketTracker::CountRetransmissionHistogram(Time startTime, Time stopTime)
+{
+    NS_LOG_FUNCTION(this << startTime << stopTime);
+
+    std::vector<int> histogram(N_RETX_BINS, 0);
+
+    if (m_streaming)
     {
-        if ((*it).second.firstAttempt >= startTime && (*it).second.firstAttempt <= stopTime)
+        for (const StreamingCounters* counters : GetStreamingCounters(startTime, stopTime))
         {
-            sent++;
-            NS_LOG_DEBUG("Found a packet");
-            NS_LOG_DEBUG("Number of attempts: " << unsigned(it->second.reTxAttempts)
-                                                << ", successful: " << it->second.successful);
-            if (it->second.successful)
+            for (int bin = 0; bin < N_RETX_BINS; bin++)
             {
-                received++;
+                histogram[bin] += counters->retransmissions[bin];
             }
         }
     }
 
-    return std::to_string(sent) + " " + std::to_string(received);
+    for (auto index = m_reTransmissionsByFirstAttempt.lower_bound(startTime);
+         index != m_reTransmissionsByFirstAttempt.end() && index->first <= stopTime;
+         ++index)
+    {
+        const RetransmissionStatus& status = index->second;
+        NS_LOG_DEBUG("Number of attempts: " << unsigned(status.reTxAttempts)
+                                            << ", successful: " << status.successful);
+        histogram[GetRetransmissionBin(status.reTxAttempts, status.successful, status.sf)]++;
+    }
+
+    return histogram;
+}
+
+std::size_t
+LoraPacketTracker::GetRetransmissionBin(uint8_t attempts, bool successful, uint8_t sf)
+{
+    int attemptsIndex = std::min(std::max<int>(attempts, 1), MAX_ATTEMPTS) - 1;
+    int sfIndex = std::min(std::max<int>(sf, 7), 12) - 7;
+    return (attemptsIndex * 2 + successful) * N_SFS + sfIndex;
+}
+
+std::vector<int>
+LoraPacketTracker::CountMacPacketsPerDevice(uint32_t senderId)
+{
+    NS_LOG_FUNCTION(this << senderId);
+
+    std::vector<int> packetCounts(2, 0);
+
+    if (m_streaming)
+    {
+        RetireFinishedPackets();
+
+        auto it = m_deliveryCounters.find(senderId);
+        if (it != m_deliveryCounters.end())
+        {
+            packetCounts.at(0) += it->second.sent;
+            packetCounts.at(1) += it->second.received;
+        }
+    }
+
+    for (const auto& [packet, status] : m_macPacketTracker)
+    {
+        if (status.senderId == senderId)
+        {
+            packetCounts.at(0)++;
+            if (!status.receptionTimes.empty())
+            {
+                packetCounts.at(1)++;
+            }
+        }
+    }
+
+    return packetCounts;
+}
+
+int
+LoraPacketTracker::CountPhyPacketsSent() const
+{
+    return m_phyPacketsSent;
+}
+
+int
+LoraPacketTracker::CountPhyOutcomes(PhyPacketOutcome outcome) const
+{
+    NS_ABORT_MSG_IF(outcome == UNSET, "Unset outcomes are not counted");
+
+    int count = 0;
+    for (const auto& [gwId, outcomes] : m_phyOutcomesPerGw)
+    {
+        count += outcomes[outcome];
+    }
+    return count;
+}
+
+void
+LoraPacketTracker::VisitPhyPackets(const std::function<void(Ptr<const Packet>)>& visitor) const
+{
+    for (const auto& [packet, status] : m_packetTracker)
+    {
+        visitor(packet);
+    }
+}
+
+void
+LoraPacketTracker::VisitMacPackets(const std::function<void(Ptr<const Packet>)>& visitor) const
+{
+    for (const auto& [packet, status] : m_macPacketTracker)
+    {
+        visitor(packet);
+    }
+}
+
+////////////////////
+// Streaming mode //
+////////////////////
+
+bool
+LoraPacketTracker::IsConfirmed(Ptr<const Packet> packet)
+{
+    uint8_t firstByte = 0;
+    packet->CopyData(&firstByte, 1);
+    return LorawanMacHeader::MType(firstByte >> 5) == LorawanMacHeader::CONFIRMED_DATA_UP;
+}
+
+int
+LoraPacketTracker::GetSfIndex(Ptr<const Packet> packet)
+{
+    LoraTag tag;
+    packet->PeekPacketTag(tag);
+    int sf = tag.GetSpreadingFactor();
+    return std::min(std::max(sf, 7), 12) - 7;
+}
+
+void
+LoraPacketTracker::RetireFinishedPackets()
+{
+    NS_LOG_FUNCTION(this);
+
+    LORAWAN_TIME_SCOPE("LoraPacketTracker/RetireFinishedPackets");
+
+    // A packet that will not be transmitted again has its final outcomes at
+    // all gateways once its last transmission and receive windows are over.
+    // Both maps use the same test, so a packet leaves them at the same time.
+    Time now = Simulator::Now();
+    auto isFinished = [this, now](Ptr<const Packet> packet) {
+        auto lifecycle = m_lifecycles.find(PeekPointer(packet));
+        return lifecycle == m_lifecycles.end() ||
+               ((!lifecycle->second.confirmed || lifecycle->second.ended) &&
+                now >= lifecycle->second.lastTransmission + m_retirementDelay);
+    };
+
+    for (auto it = m_packetTracker.begin(); it != m_packetTracker.end();)
+    {
+        if (!isFinished(it->first))
+        {
+            ++it;
+            continue;
+        }
+
+        const PacketStatus& status = it->second;
+        int sfIndex = GetSfIndex(it->first);
+        StreamingCounters& counters = GetStreamingCounters(status.sendTime);
+        counters.phySent[sfIndex]++;
+        for (const auto& [gwId, outcome] : status.outcomes)
+        {
+            if (outcome != UNSET)
+            {
+                counters.phyOutcomes[gwId][outcome * N_SFS + sfIndex]++;
+            }
+        }
+
+        auto range = m_phyPacketsBySendTime.equal_range(status.sendTime);
+        for (auto index = range.first; index != range.second; ++index)
+        {
+            if (index->second == it)
+            {
+                m_phyPacketsBySendTime.erase(index);
+                break;
+            }
+        }
+        if (m_macPacketTracker.count(it->first) == 0)
+        {
+            m_lifecycles.erase(PeekPointer(it->first));
+        }
+        it = m_packetTracker.erase(it);
+        LORAWAN_COUNT("LoraPacketTracker/PhyPacketsRetired", 1);
+    }
+
+    for (auto it = m_macPacketTracker.begin(); it != m_macPacketTracker.end();)
+    {
+        if (!isFinished(it->first))
+        {
+            ++it;
+            continue;
+        }
+
+        const MacPacketStatus& status = it->second;
+        bool received = !status.receptionTimes.empty();
+        StreamingCounters& counters = GetStreamingCounters(status.sendTime);
+        counters.macSent++;
+        counters.macReceived += received;
+        DeliveryCounters& delivery = m_deliveryCounters[status.senderId];
+        delivery.sent++;
+        delivery.received += received;
+
+        auto range = m_macPacketsBySendTime.equal_range(status.sendTime);
+        for (auto index = range.first; index != range.second; ++index)
+        {
+            if (index->second == it)
+            {
+                m_macPacketsBySendTime.erase(index);
+                break;
+            }
+        }
+        m_lifecycles.erase(PeekPointer(it->first));
+        it = m_macPacketTracker.erase(it);
+        LORAWAN_COUNT("LoraPacketTracker/MacPacketsRetired", 1);
+    }
+
+    // Retire again when the number of tracked packets doubles, so that each
+    // packet is checked a constant number of times on average
+    m_nextRetirement =
+        std::max<std::size_t>(1024, 2 * (m_packetTracker.size() + m_macPacketTracker.size()));
+
+    NS_LOG_DEBUG("Tracking " << m_packetTracker.size() << " PHY and " << m_macPacketTracker.size()
+                             << " MAC packets after retirement");
+}
+
+LoraPacketTracker::StreamingCounters&
+LoraPacketTracker::GetStreamingCounters(Time sendTime)
+{
+    int64_t sendTimeNs = sendTime.GetNanoSeconds();
+    StreamingBucket& bucket = m_buckets[sendTimeNs / m_bucketSizeNs];
+    return sendTimeNs % m_bucketSizeNs == 0 ? bucket.atStart : bucket.interior;
+}
+
+std::vector<const LoraPacketTracker::StreamingCounters*>
+LoraPacketTracker::GetStreamingCounters(Time startTime, Time stopTime)
+{
+    int64_t startNs = startTime.GetNanoSeconds();
+    int64_t stopNs = stopTime.GetNanoSeconds();
+    NS_ABORT_MSG_IF(startNs % m_bucketSizeNs != 0 || stopNs % m_bucketSizeNs != 0,
+                    "In streaming mode, intervals must start and end at multiples of the bucket "
+                    "size");
+
+    // Both ends of the interval are included, so that packets sent at its end
+    // are counted through the start of the last bucket
+    std::vector<const StreamingCounters*> counters;
+    int64_t lastBucket = stopNs / m_bucketSizeNs;
+    for (auto it = m_buckets.lower_bound(startNs / m_bucketSizeNs);
+         stopNs >= startNs && it != m_buckets.end() && it->first <= lastBucket;
+         ++it)
+    {
+        counters.push_back(&it->second.atStart);
+        if (it->first < lastBucket)
+        {
+            counters.push_back(&it->second.interior);
+        }
+    }
+
+    return counters;
 }
 
 } // namespace lorawan
@@ -11,9 +11,14 @@
 
 #include "ns3/nstime.h"
 #include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
 
+#include <array>
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -66,6 +71,8 @@ struct MacPacketStatus
  * \ingroup lorawan
  *
  * Stores (optionally enabled) MAC layer packet retransmission process metrics of end devices.
+ *
+ * \remark The packet is identified by its uid, so that it is not kept alive by the tracker.
  */
 struct RetransmissionStatus
 {
@@ -73,16 +80,32 @@ struct RetransmissionStatus
     Time finishTime;      //!< Timestamp of the conclusion of the retransmission process
     uint8_t reTxAttempts; //!< Number of transmissions attempted during the process
     bool successful;      //!< Whether the retransmission procedure was successful
+    uint64_t packetUid;   //!< Uid of the packet
+    uint32_t senderId;    //!< Node id of the packet sender
+    uint8_t sf;           //!< Spreading factor of the last attempt
 };
 
 typedef std::map<Ptr<const Packet>, MacPacketStatus> MacPacketData;
 typedef std::map<Ptr<const Packet>, PacketStatus> PhyPacketData;
-typedef std::map<Ptr<const Packet>, RetransmissionStatus> RetransmissionData;
 
 /**
  * \ingroup lorawan
  *
  * Tracks and stores packets sent in the simulation and provides aggregation functionality
+ *
+ * By default, the status of every packet is stored until the end of the simulation. In streaming
+ * mode, the status of a packet is only kept while its outcomes can still change, that is, until
+ * the packet can not be transmitted again (it is unconfirmed, or its retransmission process
+ * ended) and the retirement delay passed since its last transmission, so that all gateways
+ * reported their outcome and the last receive window of the device closed. It is then folded
+ * into counters per time bucket (and per gateway, outcome and spreading factor) and per device,
+ * and the packet is released. Counting functions return the same values in both modes, provided
+ * that the time intervals they are given start and end at multiples of the bucket size.
+ *
+ * Tracked packets are also indexed by send time, so that counting functions only visit the
+ * packets sent in the requested interval. Intervals covering all packets sent so far are answered
+ * in constant time from totals, including the outcome histogram of each gateway, that are kept up
+ * to date as packets are traced.
  */
 class LoraPacketTracker
 {
@@ -90,6 +113,41 @@ class LoraPacketTracker
     LoraPacketTracker();  //!< Default constructor
     ~LoraPacketTracker(); //!< Destructor
 
+    /**
+     * Enable the streaming mode. This must be done before any packet is tracked.
+     *
+     * \param bucketSize The size of the time buckets the counters are kept for. The start and the
+     * end of the intervals given to counting functions must be multiples of it.
+     * \param retirementDelay The time after the start of the last transmission of a packet after
+     * which its outcomes are final. It must exceed the time on air of the longest packet plus the
+     * end of the second receive window.
+     */
+    void EnableStreamingMode(Time bucketSize, Time retirementDelay = Seconds(15));
+
+    /**
+     * Keep a uniform random sample of the retransmission processes, for debugging. Processes are
+     * otherwise only counted.
+     *
+     * \param maxSamples The maximum number of processes in the sample.
+     */
+    void EnableRetransmissionSampling(uint32_t maxSamples);
+
+    /**
+     * Get the sample of retransmission processes, in no particular order.
+     *
+     * \return The sampled processes.
+     */
+    const std::vector<RetransmissionStatus>& GetRetransmissionSamples() const;
+
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by this tracker, that is the one choosing the sampled retransmission processes.
+     *
+     * \param stream The first stream index to use.
+     * \return The number of stream indices assigned by this tracker.
+     */
+    int64_t AssignStreams(int64_t stream);
+
     ///////////////////////////
     // PHY layer trace sinks //
     ///////////////////////////
@@ -184,7 +242,8 @@ class LoraPacketTracker
     ///////////////////////////////
 
     /**
-     * Check whether a packet is uplink.
+     * Check whether a packet is uplink, by reading the MType in its first byte. Outcome trace
+     * sinks do not need it, since only uplink packets are tracked at transmission.
      *
      * \param packet The packet to be checked.
      * \return True if the packet is uplink, false otherwise.
@@ -210,6 +269,17 @@ class LoraPacketTracker
      * interferedPackets, noMoreGwPackets, underSensitivityPackets, lostBecauseTxPackets].
      */
     std::vector<int> CountPhyPacketsPerGw(Time startTime, Time stopTime, int systemId);
+    /**
+     * Count packets sent with a given spreading factor in a time interval to evaluate the
+     * performance at PHY level of a specific gateway.
+     *
+     * \param startTime Timestamp of the start of the measurement.
+     * \param stopTime Timestamp of the end of the measurement.
+     * \param systemId Node id of the gateway.
+     * \param sf The spreading factor of the packets to count.
+     * \return A vector with the same fields as CountPhyPacketsPerGw.
+     */
+    std::vector<int> CountPhyPacketsPerGw(Time startTime, Time stopTime, int systemId, uint8_t sf);
     /**
      * \copydoc ns3::lorawan::LoraPacketTracker::CountPhyPacketsPerGw
      * \return Values in the output vector are formatted into a space-separated string.
@@ -237,12 +307,41 @@ class LoraPacketTracker
      *
      * \param startTime Timestamp of the start of the measurement.
      * \param stopTime Timestamp of the end of the measurement.
-     * \return String of output values.
-     *
-     * \todo Not implemented, this is a placeholder for future implementation.
+     * \return Space-separated string containing, for each number of attempts from 1 to
+     * MAX_ATTEMPTS, the number of successful processes that needed it, with processes that needed
+     * more attempts counted with the last one.
      */
     std::string CountRetransmissions(Time startTime, Time stopTime);
 
+    /**
+     * In a time interval, count the retransmission processes by number of attempts, outcome and
+     * spreading factor of the last attempt. Processes are counted at the time of their first
+     * attempt.
+     *
+     * \param startTime Timestamp of the start of the measurement.
+     * \param stopTime Timestamp of the end of the measurement.
+     * \return A vector with the number of processes in each bin, indexed by
+     * GetRetransmissionBin.
+     */
+    std::vector<int> CountRetransmissionHistogram(Time startTime, Time stopTime);
+
+    /**
+     * Get the bin of a retransmission process in the vector returned by
+     * CountRetransmissionHistogram.
+     *
+     * \param attempts The number of transmissions attempted during the process, with processes
+     * that needed more than MAX_ATTEMPTS counted as MAX_ATTEMPTS.
+     * \param successful Whether the process was successful.
+     * \param sf The spreading factor of the last attempt, from 7 to 12.
+     * \return The index of the bin.
+     */
+    static std::size_t GetRetransmissionBin(uint8_t attempts, bool successful, uint8_t sf);
+
+    /**
+     * The largest number of attempts of a retransmission process counted on its own.
+     */
+    static constexpr int MAX_ATTEMPTS = 15;
+
     /**
      * In a time interval, count packets to evaluate the global performance at MAC level of the
      * whole network. In this case, a MAC layer packet is labeled as successful if it was successful
@@ -268,10 +367,226 @@ class LoraPacketTracker
      */
     std::string CountMacPacketsGloballyCpsr(Time startTime, Time stopTime);
 
+    /**
+     * Count the packets sent by a device over the whole simulation, and those that were received
+     * by at least one gateway.
+     *
+     * \param senderId Node id of the device.
+     * \return A vector comprised of the following fields: [sentPackets, receivedPackets].
+     */
+    std::vector<int> CountMacPacketsPerDevice(uint32_t senderId);
+
+    /**
+     * Count the PHY packets sent over the whole simulation, without scanning packets.
+     *
+     * \return The number of packets.
+     */
+    int CountPhyPacketsSent() const;
+
+    /**
+     * Count the outcomes of a type at all gateways over the whole simulation, without scanning
+     * packets.
+     *
+     * \param outcome The outcome.
+     * \return The number of outcomes.
+     */
+    int CountPhyOutcomes(PhyPacketOutcome outcome) const;
+
+    /**
+     * Call a function on each packet currently held for PHY layer metrics.
+     *
+     * \param visitor The function.
+     */
+    void VisitPhyPackets(const std::function<void(Ptr<const Packet>)>& visitor) const;
+
+    /**
+     * Call a function on each packet currently held for MAC layer metrics.
+     *
+     * \param visitor The function.
+     */
+    void VisitMacPackets(const std::function<void(Ptr<const Packet>)>& visitor) const;
+
   private:
-    PhyPacketData m_packetTracker;              //!< Packet map of PHY layer metrics
-    MacPacketData m_macPacketTracker;           //!< Packet map of MAC layer metrics
-    RetransmissionData m_reTransmissionTracker; //!< Packet map of retransmission process metrics
+    /**
+     * Number of outcomes a packet can be counted with at a gateway (all but UNSET).
+     */
+    static constexpr int N_OUTCOMES = UNSET;
+
+    /**
+     * Number of spreading factors counters are kept for (from 7 to 12).
+     */
+    static constexpr int N_SFS = 6;
+
+    /**
+     * Number of bins of the retransmission histogram (attempts, outcome and spreading factor).
+     */
+    static constexpr int N_RETX_BINS = MAX_ATTEMPTS * 2 * N_SFS;
+
+    /**
+     * Counters of the packets sent in part of a time bucket.
+     */
+    struct StreamingCounters
+    {
+        std::array<int, N_SFS> phySent = {}; //!< PHY packets sent, by spreading factor
+
+        /**
+         * PHY packet outcomes by gateway node id, then by outcome and spreading factor.
+         */
+        std::map<int, std::array<int, N_OUTCOMES * N_SFS>> phyOutcomes;
+
+        int macSent = 0;     //!< MAC packets sent
+        int macReceived = 0; //!< MAC packets received by at least one gateway
+
+        /**
+         * Retransmission processes started, by bin as in GetRetransmissionBin.
+         */
+        std::array<int, N_RETX_BINS> retransmissions = {};
+    };
+
+    /**
+     * Counters of the packets sent in a time bucket. Packets sent exactly at the start of the
+     * bucket are counted apart, since they also belong to intervals ending there.
+     */
+    struct StreamingBucket
+    {
+        StreamingCounters atStart;  //!< Packets sent at the start of the bucket
+        StreamingCounters interior; //!< Packets sent after the start of the bucket
+    };
+
+    /**
+     * Counters of the packets sent by a device.
+     */
+    struct DeliveryCounters
+    {
+        int sent = 0;     //!< Packets sent
+        int received = 0; //!< Packets received by at least one gateway
+    };
+
+    /**
+     * Count PHY packets in a time interval at a gateway.
+     *
+     * \param startTime Timestamp of the start of the measurement.
+     * \param stopTime Timestamp of the end of the measurement.
+     * \param gwId Node id of the gateway.
+     * \param sfIndex The index of the spreading factor of the packets to count, or -1 for all.
+     * \return A vector with the same fields as CountPhyPacketsPerGw.
+     */
+    std::vector<int> CountPhyPackets(Time startTime, Time stopTime, int gwId, int sfIndex);
+
+    /**
+     * Record the outcome of a PHY packet at a gateway, if it is the first one there.
+     *
+     * \param packet The packet.
+     * \param gwId Node id of the gateway.
+     * \param outcome The outcome of the packet at the gateway.
+     */
+    void InsertOutcome(Ptr<const Packet> packet, int gwId, PhyPacketOutcome outcome);
+
+    /**
+     * Get the index of the spreading factor a packet was last sent with.
+     *
+     * \param packet The packet.
+     * \return The index, from 0 for SF7 to N_SFS - 1 for SF12.
+     */
+    static int GetSfIndex(Ptr<const Packet> packet);
+
+    /**
+     * Check whether an uplink packet is confirmed, by reading the MType in its first byte.
+     *
+     * \param packet The packet.
+     * \return True if the packet is a confirmed uplink, false otherwise.
+     */
+    static bool IsConfirmed(Ptr<const Packet> packet);
+
+    /**
+     * In streaming mode, fold the status of the packets whose outcomes are final into the
+     * counters, and release them.
+     */
+    void RetireFinishedPackets();
+
+    /**
+     * Get the counters of the bucket part a send time falls in, creating them if needed.
+     *
+     * \param sendTime The send time of a packet.
+     * \return The counters.
+     */
+    StreamingCounters& GetStreamingCounters(Time sendTime);
+
+    /**
+     * Get the bucket parts covering a time interval, checking that it is aligned to buckets.
+     *
+     * \param startTime Timestamp of the start of the interval.
+     * \param stopTime Timestamp of the end of the interval.
+     * \return The counters of the bucket parts covering the interval.
+     */
+    std::vector<const StreamingCounters*> GetStreamingCounters(Time startTime, Time stopTime);
+
+    PhyPacketData m_packetTracker;    //!< Packet map of PHY layer metrics
+    MacPacketData m_macPacketTracker; //!< Packet map of MAC layer metrics
+
+    /**
+     * In streaming mode, the progress of a tracked packet, telling when its outcomes are final.
+     */
+    struct Lifecycle
+    {
+        Time lastTransmission; //!< Start of the last transmission of the packet
+        bool confirmed;        //!< Whether the packet may be retransmitted
+        bool ended;            //!< Whether the retransmission process of the packet ended
+    };
+
+    /**
+     * The progress of the packets in the PHY or MAC packet maps, in streaming mode.
+     */
+    std::unordered_map<const Packet*, Lifecycle> m_lifecycles;
+
+    /**
+     * Tracked PHY packets, by send time.
+     */
+    std::multimap<Time, PhyPacketData::iterator> m_phyPacketsBySendTime;
+
+    /**
+     * Tracked MAC packets, by send time.
+     */
+    std::multimap<Time, MacPacketData::iterator> m_macPacketsBySendTime;
+
+    /**
+     * Retransmission processes, by time of the first attempt. Not used in streaming mode, where
+     * processes are only counted.
+     */
+    std::multimap<Time, RetransmissionStatus> m_reTransmissionsByFirstAttempt;
+
+    uint32_t m_maxRetransmissionSamples = 0;         //!< Maximum size of the sample of processes
+    uint32_t m_nRetransmissions = 0;                 //!< Processes ended since the start
+    std::vector<RetransmissionStatus> m_retxSamples; //!< Uniform random sample of processes
+    Ptr<UniformRandomVariable> m_retxSamplingRng;    //!< Chooses the processes to sample
+
+    int m_phyPacketsSent = 0;     //!< PHY packets sent since the start
+    Time m_firstPhySendTime;      //!< Send time of the first PHY packet
+    Time m_lastPhySendTime;       //!< Send time of the last PHY packet
+    int m_macPacketsSent = 0;     //!< MAC packets sent since the start
+    int m_macPacketsReceived = 0; //!< MAC packets received by at least one gateway
+    Time m_firstMacSendTime;      //!< Send time of the first MAC packet
+    Time m_lastMacSendTime;       //!< Send time of the last MAC packet
+
+    /**
+     * PHY packet outcomes since the start, by gateway node id, then by outcome.
+     */
+    std::unordered_map<int, std::array<int, N_OUTCOMES>> m_phyOutcomesPerGw;
+
+    bool m_streaming = false;     //!< Whether the tracker is in streaming mode
+    int64_t m_bucketSizeNs = 0;   //!< The size of the time buckets [ns]
+    Time m_retirementDelay;       //!< Time after the last transmission making outcomes final
+    std::size_t m_nextRetirement; //!< Number of tracked packets triggering the next retirement
+
+    /**
+     * Counters of the retired packets, by time bucket index.
+     */
+    std::map<int64_t, StreamingBucket> m_buckets;
+
+    /**
+     * Counters of the retired MAC packets, by sender node id.
+     */
+    std::unordered_map<uint32_t, DeliveryCounters> m_deliveryCounters;
 };
 } // namespace lorawan
 } // namespace ns3
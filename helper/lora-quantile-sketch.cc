@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-quantile-sketch.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+LoraQuantileSketch::LoraQuantileSketch(double relativeAccuracy, uint32_t maxBuckets)
+    : m_gamma((1 + relativeAccuracy) / (1 - relativeAccuracy)),
+      m_logGamma(std::log(m_gamma)),
+      m_maxBuckets(maxBuckets)
+{
+    NS_ABORT_MSG_IF(relativeAccuracy <= 0 || relativeAccuracy >= 1,
+                    "The relative accuracy must be in (0, 1)");
+    NS_ABORT_MSG_IF(maxBuckets == 0, "At least one bucket is needed");
+}
+
+void
+LoraQuantileSketch::Add(double value)
+{
+    m_count++;
+    if (value <= 0)
+    {
+        m_zeroCount++;
+        return;
+    }
+
+    int32_t index = GetIndex(value);
+    if (m_buckets.empty())
+    {
+        m_offset = index;
+        m_buckets.push_back(0);
+    }
+    else if (index < m_offset)
+    {
+        // Grow downwards, counting the value with the lowest bucket if there are too many
+        int32_t lowest = m_offset + static_cast<int32_t>(m_buckets.size()) -
+                         static_cast<int32_t>(m_maxBuckets);
+        index = std::max(index, lowest);
+        m_buckets.insert(m_buckets.begin(), m_offset - index, 0);
+        m_offset = index;
+    }
+    else if (index >= m_offset + static_cast<int32_t>(m_buckets.size()))
+    {
+        // Grow upwards, collapsing the lowest buckets if there are too many
+        m_buckets.resize(index - m_offset + 1, 0);
+        if (m_buckets.size() > m_maxBuckets)
+        {
+            auto excess = m_buckets.size() - m_maxBuckets;
+            uint64_t collapsed =
+                std::accumulate(m_buckets.begin(), m_buckets.begin() + excess, uint64_t(0));
+            m_buckets.erase(m_buckets.begin(), m_buckets.begin() + excess);
+            m_buckets.front() += collapsed;
+            m_offset += excess;
+        }
+    }
+    m_buckets[index - m_offset]++;
+}
+
+uint64_t
+LoraQuantileSketch::GetCount() const
+{
+    return m_count;
+}
+
+double
+LoraQuantileSketch::GetQuantile(double quantile) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    // Find the bucket of the value of the requested rank, and return the value in the bucket
+    // with the lowest relative error to both its bounds
+    double rank = std::clamp(quantile, 0.0, 1.0) * (m_count - 1);
+    uint64_t cumulative = m_zeroCount;
+    if (rank < cumulative)
+    {
+        return 0;
+    }
+    for (std::size_t i = 0; i < m_buckets.size(); i++)
+    {
+        cumulative += m_buckets[i];
+        if (cumulative > rank)
+        {
+            return 2 * std::pow(m_gamma, m_offset + static_cast<int32_t>(i)) / (m_gamma + 1);
+        }
+    }
+    return 2 * std::pow(m_gamma, m_offset + static_cast<int32_t>(m_buckets.size()) - 1) /
+           (m_gamma + 1);
+}
+
+int32_t
+LoraQuantileSketch::GetIndex(double value) const
+{
+    return static_cast<int32_t>(std::ceil(std::log(value) / m_logGamma));
+}
+
+} // namespace lorawan
+} // namespace ns3
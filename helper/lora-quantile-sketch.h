@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_QUANTILE_SKETCH_H
+#define LORA_QUANTILE_SKETCH_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A DDSketch estimating quantiles of a stream of positive values in constant memory.
+ *
+ * Values are counted in logarithmic buckets: bucket i holds the values in (g^(i-1), g^i], with
+ * g = (1 + a) / (1 - a) for a relative accuracy a, so that any quantile is estimated with relative
+ * error at most a. Values are not stored, and the number of buckets only depends on the ratio
+ * between the largest and the smallest value (e.g., about 230 buckets for values spanning two
+ * orders of magnitude with the default 1% accuracy). If more than a maximum number of buckets is
+ * needed, the lowest ones are collapsed, losing accuracy on the lowest quantiles only.
+ */
+class LoraQuantileSketch
+{
+  public:
+    /**
+     * Create an empty sketch.
+     *
+     * \param relativeAccuracy The relative error of quantile estimates, in (0, 1).
+     * \param maxBuckets The maximum number of buckets.
+     */
+    LoraQuantileSketch(double relativeAccuracy = 0.01, uint32_t maxBuckets = 2048);
+
+    /**
+     * Add a value to the sketch. Values that are not positive are counted as zeros, below all
+     * buckets.
+     *
+     * \param value The value.
+     */
+    void Add(double value);
+
+    /**
+     * Get the number of values added to the sketch.
+     *
+     * \return The number of values.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * Estimate a quantile of the values added to the sketch.
+     *
+     * \param quantile The quantile, in [0, 1] (e.g., 0.95 for the 95th percentile).
+     * \return The estimate, or 0 if the sketch is empty.
+     */
+    double GetQuantile(double quantile) const;
+
+  private:
+    /**
+     * Get the index of the bucket of a value.
+     *
+     * \param value The value, which must be positive.
+     * \return The index of the bucket.
+     */
+    int32_t GetIndex(double value) const;
+
+    double m_gamma;                  //!< The ratio between the bounds of a bucket
+    double m_logGamma;               //!< The natural logarithm of m_gamma
+    uint32_t m_maxBuckets;           //!< The maximum number of buckets
+    std::vector<uint64_t> m_buckets; //!< The counts of contiguous buckets
+    int32_t m_offset = 0;            //!< The index of the first bucket in m_buckets
+    uint64_t m_zeroCount = 0;        //!< The number of values that are not positive
+    uint64_t m_count = 0;            //!< The number of values added
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_QUANTILE_SKETCH_H */
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-trace-writer.h"
+
+#include "ns3/abort.h"
+#include "ns3/end-device-lorawan-mac.h"
+#include "ns3/log.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-tag.h"
+#include "ns3/mobility-model.h"
+#include "ns3/simulator.h"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraTraceWriter");
+
+LoraTraceWriter::LoraTraceWriter(std::string prefix)
+    : m_bufferSize(1 << 20),
+      m_maxQueued(16)
+{
+    NS_LOG_FUNCTION(this << prefix);
+
+    for (int type = 0; type < N_RECORD_TYPES; type++)
+    {
+        RecordFile& recordFile = m_files[type];
+        recordFile.filename = prefix + "-" + GetRecordName(RecordType(type)) + ".npy";
+        recordFile.file = std::fopen(recordFile.filename.c_str(), "wb");
+        NS_ABORT_MSG_IF(!recordFile.file, "Could not open " << recordFile.filename);
+
+        // The header is rewritten with the number of records when closing
+        std::string header = BuildHeader(RecordType(type), 0);
+        std::fwrite(header.data(), 1, header.size(), recordFile.file);
+        recordFile.buffer.reserve(m_bufferSize);
+    }
+
+    m_thread = std::thread(&LoraTraceWriter::DoWrite, this);
+}
+
+LoraTraceWriter::~LoraTraceWriter()
+{
+    NS_LOG_FUNCTION(this);
+
+    Close();
+}
+
+void
+LoraTraceWriter::Close()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_closed)
+    {
+        return;
+    }
+    m_closed = true;
+
+    for (int type = 0; type < N_RECORD_TYPES; type++)
+    {
+        if (!m_files[type].buffer.empty())
+        {
+            Submit(RecordType(type));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queued.notify_one();
+    m_thread.join();
+
+    for (int type = 0; type < N_RECORD_TYPES; type++)
+    {
+        RecordFile& recordFile = m_files[type];
+        std::string header = BuildHeader(RecordType(type), recordFile.nRecords);
+        std::fseek(recordFile.file, 0, SEEK_SET);
+        std::fwrite(header.data(), 1, header.size(), recordFile.file);
+        NS_ABORT_MSG_IF(std::fclose(recordFile.file) != 0,
+                        "Could not write " << recordFile.filename);
+        recordFile.file = nullptr;
+
+        NS_LOG_DEBUG("Wrote " << recordFile.nRecords << " records to " << recordFile.filename);
+    }
+}
+
+uint64_t
+LoraTraceWriter::GetNRecords(RecordType type) const
+{
+    return m_files.at(type).nRecords;
+}
+
+std::string
+LoraTraceWriter::GetFilename(RecordType type) const
+{
+    return m_files.at(type).filename;
+}
+
+///////////////////////
+// PHY layer records //
+///////////////////////
+
+void
+LoraTraceWriter::TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    std::vector<uint8_t>* buffer = StartRecord(TRANSMISSION);
+    if (!buffer)
+    {
+        return;
+    }
+
+    // The MType is in the three most significant bits of the first byte
+    uint8_t firstByte = 0;
+    packet->CopyData(&firstByte, 1);
+    LoraTag tag;
+    packet->PeekPacketTag(tag);
+
+    Put<int64_t>(*buffer, Simulator::Now().GetNanoSeconds());
+    Put<uint64_t>(*buffer, packet->GetUid());
+    Put<uint32_t>(*buffer, systemId);
+    Put<uint8_t>(*buffer, firstByte >> 5);
+    Put<uint8_t>(*buffer, tag.GetSpreadingFactor());
+}
+
+void
+LoraTraceWriter::PacketReceptionCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    WriteOutcome(packet, systemId, RECEIVED);
+}
+
+void
+LoraTraceWriter::InterferenceCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    WriteOutcome(packet, systemId, INTERFERED);
+}
+
+void
+LoraTraceWriter::NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    WriteOutcome(packet, systemId, NO_MORE_RECEIVERS);
+}
+
+void
+LoraTraceWriter::UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    WriteOutcome(packet, systemId, UNDER_SENSITIVITY);
+}
+
+void
+LoraTraceWriter::LostBecauseTxCallback(Ptr<const Packet> packet, uint32_t systemId)
+{
+    WriteOutcome(packet, systemId, LOST_BECAUSE_TX);
+}
+
+void
+LoraTraceWriter::WriteOutcome(Ptr<const Packet> packet, uint32_t gwId, PhyPacketOutcome outcome)
+{
+    std::vector<uint8_t>* buffer = StartRecord(OUTCOME);
+    if (!buffer)
+    {
+        return;
+    }
+
+    Put<int64_t>(*buffer, Simulator::Now().GetNanoSeconds());
+    Put<uint64_t>(*buffer, packet->GetUid());
+    Put<uint32_t>(*buffer, gwId);
+    Put<uint8_t>(*buffer, outcome);
+}
+
+///////////////////////
+// MAC layer records //
+///////////////////////
+
+void
+LoraTraceWriter::MacTransmissionCallback(Ptr<const Packet> packet)
+{
+    WriteDelivery(packet, false);
+}
+
+void
+LoraTraceWriter::MacGwReceptionCallback(Ptr<const Packet> packet)
+{
+    WriteDelivery(packet, true);
+}
+
+void
+LoraTraceWriter::WriteDelivery(Ptr<const Packet> packet, bool received)
+{
+    std::vector<uint8_t>* buffer = StartRecord(DELIVERY);
+    if (!buffer)
+    {
+        return;
+    }
+
+    Put<int64_t>(*buffer, Simulator::Now().GetNanoSeconds());
+    Put<uint64_t>(*buffer, packet->GetUid());
+    Put<uint32_t>(*buffer, Simulator::GetContext());
+    Put<uint8_t>(*buffer, received);
+}
+
+void
+LoraTraceWriter::RequiredTransmissionsCallback(uint8_t reqTx,
+                                               bool success,
+                                               Time firstAttempt,
+                                               Ptr<Packet> packet)
+{
+    std::vector<uint8_t>* buffer = StartRecord(RETRANSMISSION);
+    if (!buffer)
+    {
+        return;
+    }
+
+    Put<int64_t>(*buffer, Simulator::Now().GetNanoSeconds());
+    Put<int64_t>(*buffer, firstAttempt.GetNanoSeconds());
+    Put<uint64_t>(*buffer, packet->GetUid());
+    Put<uint32_t>(*buffer, Simulator::GetContext());
+    Put<uint8_t>(*buffer, reqTx);
+    Put<uint8_t>(*buffer, success);
+}
+
+void
+LoraTraceWriter::WriteDeviceStatus(NodeContainer endDevices)
+{
+    NS_LOG_FUNCTION(this);
+
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    for (auto it = endDevices.Begin(); it != endDevices.End(); ++it)
+    {
+        std::vector<uint8_t>* buffer = StartRecord(DEVICE_STATUS);
+        if (!buffer)
+        {
+            return;
+        }
+
+        Ptr<Node> node = *it;
+        Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+        NS_ASSERT(mobility);
+        Ptr<LoraNetDevice> loraNetDevice = DynamicCast<LoraNetDevice>(node->GetDevice(0));
+        NS_ASSERT(loraNetDevice);
+        Ptr<EndDeviceLorawanMac> mac = DynamicCast<EndDeviceLorawanMac>(loraNetDevice->GetMac());
+        NS_ASSERT(mac);
+        Vector position = mobility->GetPosition();
+
+        Put<int64_t>(*buffer, now);
+        Put<uint32_t>(*buffer, node->GetId());
+        PutDouble(*buffer, position.x);
+        PutDouble(*buffer, position.y);
+        PutDouble(*buffer, position.z);
+        Put<uint8_t>(*buffer, mac->GetDataRate());
+        Put<uint8_t>(*buffer, mac->GetTransmissionPower());
+    }
+}
+
+////////////////////
+// File structure //
+////////////////////
+
+std::vector<LoraTraceWriter::Field>
+LoraTraceWriter::GetFields(RecordType type)
+{
+    switch (type)
+    {
+    case TRANSMISSION:
+        return {{"time", "<i8"},
+                {"packet", "<u8"},
+                {"node", "<u4"},
+                {"mtype", "|u1"},
+                {"sf", "|u1"}};
+    case OUTCOME:
+        return {{"time", "<i8"}, {"packet", "<u8"}, {"gateway", "<u4"}, {"outcome", "|u1"}};
+    case DELIVERY:
+        return {{"time", "<i8"}, {"packet", "<u8"}, {"node", "<u4"}, {"received", "|u1"}};
+    case RETRANSMISSION:
+        return {{"time", "<i8"},
+                {"first_attempt", "<i8"},
+                {"packet", "<u8"},
+                {"node", "<u4"},
+                {"attempts", "|u1"},
+                {"successful", "|u1"}};
+    case DEVICE_STATUS:
+        return {{"time", "<i8"},
+                {"node", "<u4"},
+                {"x", "<f8"},
+                {"y", "<f8"},
+                {"z", "<f8"},
+                {"data_rate", "|u1"},
+                {"tx_power", "|u1"}};
+    default:
+        NS_ABORT_MSG("Unknown record type");
+    }
+    return {};
+}
+
+std::string
+LoraTraceWriter::BuildHeader(RecordType type, uint64_t nRecords)
+{
+    std::string descr;
+    for (const Field& field : GetFields(type))
+    {
+        descr += std::string(descr.empty() ? "" : ", ") + "('" + field.name + "', '" +
+                 field.descr + "')";
+    }
+    std::string dict = "{'descr': [" + descr + "], 'fortran_order': False, 'shape': (";
+
+    // Pad the header as if the number of records had as many digits as possible, so that its
+    // size does not change when it is rewritten
+    std::size_t maxDigits = std::to_string(std::numeric_limits<uint64_t>::max()).size();
+    std::string count = std::to_string(nRecords);
+    dict += count + ",), }" + std::string(maxDigits - count.size(), ' ');
+
+    // Version 1.0 preamble: magic string, version, and little-endian size of the dictionary,
+    // which ends with a newline and is padded so that the data is 64-byte aligned
+    const std::size_t preambleSize = 10;
+    std::size_t size = preambleSize + dict.size() + 1;
+    size = (size + 63) / 64 * 64;
+    dict += std::string(size - preambleSize - dict.size() - 1, ' ') + "\n";
+
+    std::string header = "\x93NUMPY";
+    header += char(1);
+    header += char(0);
+    header += char(dict.size() & 0xff);
+    header += char(dict.size() >> 8);
+    return header + dict;
+}
+
+const char*
+LoraTraceWriter::GetRecordName(RecordType type)
+{
+    switch (type)
+    {
+    case TRANSMISSION:
+        return "transmission";
+    case OUTCOME:
+        return "outcome";
+    case DELIVERY:
+        return "delivery";
+    case RETRANSMISSION:
+        return "retransmission";
+    case DEVICE_STATUS:
+        return "device-status";
+    default:
+        NS_ABORT_MSG("Unknown record type");
+    }
+    return "";
+}
+
+template <typename T>
+void
+LoraTraceWriter::Put(std::vector<uint8_t>& buffer, T value)
+{
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t i = 0; i < sizeof(T); i++)
+    {
+        buffer.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void
+LoraTraceWriter::PutDouble(std::vector<uint8_t>& buffer, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Put<uint64_t>(buffer, bits);
+}
+
+////////////////////
+// Writing thread //
+////////////////////
+
+std::vector<uint8_t>*
+LoraTraceWriter::StartRecord(RecordType type)
+{
+    if (m_closed)
+    {
+        return nullptr;
+    }
+
+    RecordFile& recordFile = m_files[type];
+    if (recordFile.buffer.size() >= m_bufferSize)
+    {
+        Submit(type);
+    }
+    recordFile.nRecords++;
+    return &recordFile.buffer;
+}
+
+void
+LoraTraceWriter::Submit(RecordType type)
+{
+    RecordFile& recordFile = m_files[type];
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_dequeued.wait(lock, [this] { return m_queue.size() < m_maxQueued; });
+        m_queue.emplace_back(type, std::move(recordFile.buffer));
+    }
+    m_queued.notify_one();
+
+    recordFile.buffer = std::vector<uint8_t>();
+    recordFile.buffer.reserve(m_bufferSize);
+}
+
+void
+LoraTraceWriter::DoWrite()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queued.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+        if (m_queue.empty())
+        {
+            return;
+        }
+        auto [type, buffer] = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_dequeued.notify_one();
+
+        // Files are only opened and closed while this thread is not running
+        std::FILE* file = m_files[type].file;
+        NS_ABORT_MSG_IF(std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size(),
+                        "Could not write " << m_files[type].filename);
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_TRACE_WRITER_H
+#define LORA_TRACE_WRITER_H
+
+#include "lora-packet-tracker.h"
+
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A trace sink writing PHY and MAC events to binary files of fixed-width records.
+ *
+ * Each record type is written to its own file, named after a prefix and the record type (e.g.,
+ * prefix-outcome.npy). Files are in the NumPy .npy format: a header describing the fields of the
+ * records (name, little-endian type and width) is followed by the packed records, so that a file
+ * can be memory-mapped as a structured array, whose fields are the columns of the table, with
+ * numpy.load(filename, mmap_mode="r") and handed to pandas.DataFrame. The number of records is
+ * only written to the header when the writer is closed.
+ *
+ * Records are serialized into per-type buffers, and full buffers are written to disk by a
+ * background thread, so that trace sinks never wait for I/O unless the thread falls behind by
+ * more than a few buffers.
+ *
+ * Packets are identified by their uid, which is the same for all layers and all attempts of a
+ * retransmission process, and nodes by their id. Times are in nanoseconds.
+ */
+class LoraTraceWriter
+{
+  public:
+    /**
+     * The types of records, each written to its own file.
+     */
+    enum RecordType
+    {
+        TRANSMISSION,   //!< A PHY packet transmission (time, packet, node, mtype, sf)
+        OUTCOME,        //!< The outcome of a PHY packet at a gateway (time, packet, gateway,
+                        //!< outcome, as in PhyPacketOutcome)
+        DELIVERY,       //!< A MAC packet sent by a device or received by a gateway (time,
+                        //!< packet, node, received)
+        RETRANSMISSION, //!< The end of a retransmission process (time, first_attempt, packet,
+                        //!< node, attempts, successful)
+        DEVICE_STATUS,  //!< A snapshot of the state of a device (time, node, x, y, z, data_rate,
+                        //!< tx_power)
+        N_RECORD_TYPES  //!< Number of record types
+    };
+
+    /**
+     * Create the files of all record types and start the writing thread.
+     *
+     * \param prefix The prefix of the file names, which may include a directory.
+     */
+    LoraTraceWriter(std::string prefix);
+
+    ~LoraTraceWriter(); //!< Destructor, closing the writer if needed
+
+    /**
+     * Write the pending records, complete the file headers and close the files. Further records
+     * are ignored.
+     */
+    void Close();
+
+    /**
+     * Get the number of records of a type written so far.
+     *
+     * \param type The record type.
+     * \return The number of records.
+     */
+    uint64_t GetNRecords(RecordType type) const;
+
+    /**
+     * Get the name of the file records of a type are written to.
+     *
+     * \param type The record type.
+     * \return The file name.
+     */
+    std::string GetFilename(RecordType type) const;
+
+    /**
+     * Trace a packet TX start by the PHY layer of a device.
+     *
+     * \param packet The packet being transmitted.
+     * \param systemId Id of the node transmitting the packet.
+     */
+    void TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a correct packet RX by the PHY layer of a gateway.
+     *
+     * \param packet The packet being received.
+     * \param systemId Id of the gateway.
+     */
+    void PacketReceptionCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a gateway packet loss caused by interference.
+     *
+     * \param packet The packet being received.
+     * \param systemId Id of the gateway.
+     */
+    void InterferenceCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a gateway packet loss caused by lack of free reception paths.
+     *
+     * \param packet The packet being received.
+     * \param systemId Id of the gateway.
+     */
+    void NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a gateway packet loss caused by signal strength under sensitivity.
+     *
+     * \param packet The packet being received.
+     * \param systemId Id of the gateway.
+     */
+    void UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a gateway packet loss caused by concurrent downlink transmission.
+     *
+     * \param packet The packet being received.
+     * \param systemId Id of the gateway.
+     */
+    void LostBecauseTxCallback(Ptr<const Packet> packet, uint32_t systemId);
+
+    /**
+     * Trace a packet leaving the MAC layer of a device.
+     *
+     * \param packet The packet being sent.
+     */
+    void MacTransmissionCallback(Ptr<const Packet> packet);
+
+    /**
+     * Trace a packet received by the MAC layer of a gateway.
+     *
+     * \param packet The packet being received.
+     */
+    void MacGwReceptionCallback(Ptr<const Packet> packet);
+
+    /**
+     * Trace the exit status of a MAC layer packet retransmission process of a device.
+     *
+     * \param reqTx Number of transmissions attempted during the process.
+     * \param success Whether the retransmission procedure was successful.
+     * \param firstAttempt Timestamp of the initial transmission attempt.
+     * \param packet The packet being retransmitted.
+     */
+    void RequiredTransmissionsCallback(uint8_t reqTx,
+                                       bool success,
+                                       Time firstAttempt,
+                                       Ptr<Packet> packet);
+
+    /**
+     * Write a snapshot of the position, data rate and transmission power of devices.
+     *
+     * \param endDevices The devices, with an EndDeviceLorawanMac.
+     */
+    void WriteDeviceStatus(NodeContainer endDevices);
+
+  private:
+    /**
+     * A field of a record, as described in the file header.
+     */
+    struct Field
+    {
+        const char* name;  //!< The name of the field
+        const char* descr; //!< The NumPy type of the field (e.g., <u4)
+    };
+
+    /**
+     * The file and the buffer of a record type.
+     */
+    struct RecordFile
+    {
+        std::FILE* file = nullptr;   //!< The file records are written to
+        std::string filename;        //!< The name of the file
+        std::vector<uint8_t> buffer; //!< Serialized records not handed to the thread yet
+        uint64_t nRecords = 0;       //!< Number of records written
+    };
+
+    /**
+     * Get the fields of a record type.
+     *
+     * \param type The record type.
+     * \return The fields, in the order they are serialized.
+     */
+    static std::vector<Field> GetFields(RecordType type);
+
+    /**
+     * Build the NumPy header of a record type file.
+     *
+     * \param type The record type.
+     * \param nRecords The number of records in the file.
+     * \return The header, padded to a size that does not depend on the number of records.
+     */
+    static std::string BuildHeader(RecordType type, uint64_t nRecords);
+
+    /**
+     * Get the name of a record type, as used in file names.
+     *
+     * \param type The record type.
+     * \return The name.
+     */
+    static const char* GetRecordName(RecordType type);
+
+    /**
+     * Append an integer to a buffer, in little-endian byte order.
+     *
+     * \param buffer The buffer.
+     * \param value The value.
+     */
+    template <typename T>
+    static void Put(std::vector<uint8_t>& buffer, T value);
+
+    /**
+     * Append a double to a buffer, in little-endian byte order.
+     *
+     * \param buffer The buffer.
+     * \param value The value.
+     */
+    static void PutDouble(std::vector<uint8_t>& buffer, double value);
+
+    /**
+     * Get the buffer to serialize a new record of a type in, handing the current one to the
+     * writing thread if it is full.
+     *
+     * \param type The record type.
+     * \return The buffer, or nullptr if the writer is closed.
+     */
+    std::vector<uint8_t>* StartRecord(RecordType type);
+
+    /**
+     * Write a PHY packet outcome record.
+     *
+     * \param packet The packet.
+     * \param gwId Id of the gateway.
+     * \param outcome The outcome.
+     */
+    void WriteOutcome(Ptr<const Packet> packet, uint32_t gwId, PhyPacketOutcome outcome);
+
+    /**
+     * Write a MAC delivery record.
+     *
+     * \param packet The packet.
+     * \param received Whether the packet is received by a gateway, rather than sent by a device.
+     */
+    void WriteDelivery(Ptr<const Packet> packet, bool received);
+
+    /**
+     * Hand a full buffer to the writing thread, waiting if it is too far behind.
+     *
+     * \param type The record type of the buffer.
+     */
+    void Submit(RecordType type);
+
+    /**
+     * Write the buffers handed over, until the writer is closed. Run by the writing thread.
+     */
+    void DoWrite();
+
+    std::array<RecordFile, N_RECORD_TYPES> m_files; //!< The file of each record type
+    bool m_closed = false;                          //!< Whether the writer is closed
+
+    std::thread m_thread;               //!< The writing thread
+    std::mutex m_mutex;                 //!< Protects m_queue and m_stopping
+    std::condition_variable m_queued;   //!< Signals a new buffer or the stop
+    std::condition_variable m_dequeued; //!< Signals a buffer taken by the thread
+    bool m_stopping = false;            //!< Whether the thread should stop when done
+    std::size_t m_bufferSize;           //!< Size of the buffers handed over [bytes]
+    std::size_t m_maxQueued;            //!< Number of queued buffers making trace sinks wait
+
+    /**
+     * Buffers waiting to be written, with their record type.
+     */
+    std::deque<std::pair<RecordType, std::vector<uint8_t>>> m_queue;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_TRACE_WRITER_H */
@@ -8,6 +8,7 @@
 
 #include "lorawan-mac-helper.h"
 
+#include "ns3/abort.h"
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/gateway-lora-phy.h"
 #include "ns3/log.h"
@@ -24,6 +25,35 @@ NS_LOG_COMPONENT_DEFINE("LorawanMacHelper");
 LorawanMacHelper::LorawanMacHelper()
     : m_region(LorawanMacHelper::EU)
 {
+    // The channels and SubBands of each region are created once, and shared by
+    // the channel helpers of all MAC layers created by this helper.
+
+    ////////
+    // EU //
+    ////////
+
+    m_euChannelHelper.AddSubBand(868, 868.6, 0.01, 14);
+    m_euChannelHelper.AddSubBand(868.7, 869.2, 0.001, 14);
+    m_euChannelHelper.AddSubBand(869.4, 869.65, 0.1, 27);
+    m_euChannelHelper.AddChannel(CreateObject<LogicalLoraChannel>(868.1, 0, 5));
+    m_euChannelHelper.AddChannel(CreateObject<LogicalLoraChannel>(868.3, 0, 5));
+    m_euChannelHelper.AddChannel(CreateObject<LogicalLoraChannel>(868.5, 0, 5));
+
+    ///////////////////
+    // SingleChannel //
+    ///////////////////
+
+    m_singleChannelHelper.AddSubBand(868, 868.6, 0.01, 14);
+    m_singleChannelHelper.AddSubBand(868.7, 869.2, 0.001, 14);
+    m_singleChannelHelper.AddSubBand(869.4, 869.65, 0.1, 27);
+    m_singleChannelHelper.AddChannel(CreateObject<LogicalLoraChannel>(868.1, 0, 5));
+
+    ///////////
+    // ALOHA //
+    ///////////
+
+    m_alohaChannelHelper.AddSubBand(868, 868.6, 1, 14);
+    m_alohaChannelHelper.AddChannel(CreateObject<LogicalLoraChannel>(868.1, 0, 5));
 }
 
 void
@@ -62,6 +92,46 @@ LorawanMacHelper::SetRegion(enum LorawanMacHelper::Regions region)
     m_region = region;
 }
 
+LogicalLoraChannelHelper
+LorawanMacHelper::GetLogicalLoraChannelHelper() const
+{
+    NS_LOG_FUNCTION(this);
+
+    switch (m_region)
+    {
+    case LorawanMacHelper::EU:
+        return m_euChannelHelper;
+    case LorawanMacHelper::SingleChannel:
+        return m_singleChannelHelper;
+    case LorawanMacHelper::ALOHA:
+        return m_alohaChannelHelper;
+    default:
+        NS_ABORT_MSG("This region isn't supported yet!");
+    }
+}
+
+void
+LorawanMacHelper::ConfigureFleet(Ptr<LoraEndDeviceFleet> fleet) const
+{
+    NS_LOG_FUNCTION(this << fleet);
+
+    fleet->SetLogicalLoraChannelHelper(GetLogicalLoraChannelHelper());
+
+    // The same conversions as in ApplyCommon*Configurations
+    switch (m_region)
+    {
+    case LorawanMacHelper::EU:
+    case LorawanMacHelper::SingleChannel:
+    case LorawanMacHelper::ALOHA:
+        fleet->SetSfForDataRate(std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
+        fleet->SetBandwidthForDataRate(
+            std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
+        break;
+    default:
+        NS_ABORT_MSG("This region isn't supported yet!");
+    }
+}
+
 Ptr<LorawanMac>
 LorawanMacHelper::Create(Ptr<Node> node, Ptr<NetDevice> device) const
 {
@@ -196,20 +266,11 @@ LorawanMacHelper::ApplyCommonAlohaConfigurations(Ptr<LorawanMac> lorawanMac) con
 {
     NS_LOG_FUNCTION_NOARGS();
 
-    //////////////
-    // SubBands //
-    //////////////
-
-    LogicalLoraChannelHelper channelHelper;
-    channelHelper.AddSubBand(868, 868.6, 1, 14);
+    ///////////////////////////////////
+    // SubBands and default channels //
+    ///////////////////////////////////
 
-    //////////////////////
-    // Default channels //
-    //////////////////////
-    Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel>(868.1, 0, 5);
-    channelHelper.AddChannel(lc1);
-
-    lorawanMac->SetLogicalLoraChannelHelper(channelHelper);
+    lorawanMac->SetLogicalLoraChannelHelper(m_alohaChannelHelper);
 
     ///////////////////////////////////////////////////////////
     // Data rate -> Spreading factor, Data rate -> Bandwidth //
@@ -302,26 +363,11 @@ LorawanMacHelper::ApplyCommonEuConfigurations(Ptr<LorawanMac> lorawanMac) const
 {
     NS_LOG_FUNCTION_NOARGS();
 
-    //////////////
-    // SubBands //
-    //////////////
-
-    LogicalLoraChannelHelper channelHelper;
-    channelHelper.AddSubBand(868, 868.6, 0.01, 14);
-    channelHelper.AddSubBand(868.7, 869.2, 0.001, 14);
-    channelHelper.AddSubBand(869.4, 869.65, 0.1, 27);
-
-    //////////////////////
-    // Default channels //
-    //////////////////////
-    Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel>(868.1, 0, 5);
-    Ptr<LogicalLoraChannel> lc2 = CreateObject<LogicalLoraChannel>(868.3, 0, 5);
-    Ptr<LogicalLoraChannel> lc3 = CreateObject<LogicalLoraChannel>(868.5, 0, 5);
-    channelHelper.AddChannel(lc1);
-    channelHelper.AddChannel(lc2);
-    channelHelper.AddChannel(lc3);
+    ///////////////////////////////////
+    // SubBands and default channels //
+    ///////////////////////////////////
 
-    lorawanMac->SetLogicalLoraChannelHelper(channelHelper);
+    lorawanMac->SetLogicalLoraChannelHelper(m_euChannelHelper);
 
     ///////////////////////////////////////////////////////////
     // Data rate -> Spreading factor, Data rate -> Bandwidth //
@@ -414,22 +460,11 @@ LorawanMacHelper::ApplyCommonSingleChannelConfigurations(Ptr<LorawanMac> lorawan
 {
     NS_LOG_FUNCTION_NOARGS();
 
-    //////////////
-    // SubBands //
-    //////////////
-
-    LogicalLoraChannelHelper channelHelper;
-    channelHelper.AddSubBand(868, 868.6, 0.01, 14);
-    channelHelper.AddSubBand(868.7, 869.2, 0.001, 14);
-    channelHelper.AddSubBand(869.4, 869.65, 0.1, 27);
-
-    //////////////////////
-    // Default channels //
-    //////////////////////
-    Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel>(868.1, 0, 5);
-    channelHelper.AddChannel(lc1);
+    ///////////////////////////////////
+    // SubBands and default channels //
+    ///////////////////////////////////
 
-    lorawanMac->SetLogicalLoraChannelHelper(channelHelper);
+    lorawanMac->SetLogicalLoraChannelHelper(m_singleChannelHelper);
 
     ///////////////////////////////////////////////////////////
     // Data rate -> Spreading factor, Data rate -> Bandwidth //
@@ -11,8 +11,10 @@
 
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/gateway-lorawan-mac.h"
+#include "ns3/logical-lora-channel-helper.h"
 #include "ns3/lora-channel.h"
 #include "ns3/lora-device-address-generator.h"
+#include "ns3/lora-end-device-fleet.h"
 #include "ns3/lora-phy.h"
 #include "ns3/lorawan-mac.h"
 #include "ns3/net-device.h"
@@ -90,6 +92,23 @@ class LorawanMacHelper
      */
     void SetRegion(enum Regions region);
 
+    /**
+     * Get the channel plan of the region set on this helper, shared with the
+     * MAC layers it creates.
+     *
+     * \return A LogicalLoraChannelHelper with the channels and SubBands of the
+     * region.
+     */
+    LogicalLoraChannelHelper GetLogicalLoraChannelHelper() const;
+
+    /**
+     * Configure a fleet of end devices for the region set on this helper: its
+     * channel plan, and the spreading factor and bandwidth of each data rate.
+     *
+     * \param fleet The fleet to configure, before devices are added to it.
+     */
+    void ConfigureFleet(Ptr<LoraEndDeviceFleet> fleet) const;
+
     /**
      * Create the LorawanMac instance and connect it to a device.
      *
@@ -247,6 +266,10 @@ class LorawanMacHelper
     Ptr<LoraDeviceAddressGenerator> m_addrGen; //!< Pointer to the address generator to use
     enum DeviceType m_deviceType;              //!< The kind of device to install
     enum Regions m_region;                     //!< The region in which the device will operate
+
+    LogicalLoraChannelHelper m_euChannelHelper;     //!< Shared EU channel plan
+    LogicalLoraChannelHelper m_singleChannelHelper; //!< Shared SingleChannel channel plan
+    LogicalLoraChannelHelper m_alohaChannelHelper;  //!< Shared ALOHA channel plan
 };
 
 } // namespace lorawan
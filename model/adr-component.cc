@@ -8,6 +8,13 @@
 
 #include "adr-component.h"
 
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
 namespace ns3
 {
 namespace lorawan
@@ -58,27 +65,66 @@ AdrComponent::GetTypeId()
                           "Whether to toggle the transmission power or not",
                           BooleanValue(true),
                           MakeBooleanAccessor(&AdrComponent::m_toggleTxPower),
-                          MakeBooleanChecker());
+                          MakeBooleanChecker())
+            .AddAttribute("BatchPeriod",
+                          "The period of the epochs at whose end the pending ADR decisions are "
+                          "evaluated in a batch. Zero decides on each request immediately",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&AdrComponent::m_batchPeriod),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("BatchThreads",
+                          "The number of threads evaluating a batch of ADR decisions",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&AdrComponent::m_batchThreads),
+                          MakeUintegerChecker<uint32_t>(1, 256));
     return tid;
 }
 
 AdrComponent::AdrComponent()
+    : m_batchThreads(1)
 {
 }
 
 AdrComponent::~AdrComponent()
 {
+    StopWorkers();
 }
 
 void
-AdrComponent::OnReceivedPacket(Ptr<const Packet> packet,
-                               Ptr<EndDeviceStatus> status,
-                               Ptr<NetworkStatus> networkStatus)
+AdrComponent::OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus)
 {
-    NS_LOG_FUNCTION(this->GetTypeId() << packet << networkStatus);
+    NS_LOG_FUNCTION(this->GetTypeId() << context.packet << networkStatus);
 
     // We will only act just before reply, when all Gateways will have received
-    // the packet, since we need their respective received power.
+    // the packet, since we need their respective received power. Here, we only
+    // keep the SNR statistics of the device up to date.
+
+    // Copies of packets preceding the last one do not affect the statistics
+    const EndDeviceStatus::ReceivedPacketInfo& info =
+        context.endDeviceStatus->GetLastReceivedPacketInfo();
+    uint16_t fCnt = context.frameHeader.GetFCnt();
+    if (info.fCnt != fCnt)
+    {
+        return;
+    }
+
+    uint32_t address = context.frameHeader.GetAddress().Get();
+    auto it = m_snrHistories.find(address);
+    if (it == m_snrHistories.end())
+    {
+        it = m_snrHistories.emplace(address, DeviceSnrHistory(std::max(historyRange, 1))).first;
+        it->second.transmissionPower = max_transmissionPower;
+    }
+    else if (it->second.lastFCnt != fCnt)
+    {
+        // A new packet: the previous one will not receive more copies
+        it->second.previousSnrs.Push(it->second.lastSnr);
+    }
+
+    // Combine the reception power of all gateways that received this packet so far
+    it->second.lastSnr = RxPowerToSNR(GetReceivedPower(info.gwList));
+    it->second.lastFCnt = fCnt;
+    it->second.lastAdr = context.frameHeader.GetAdr();
 }
 
 void
@@ -86,70 +132,57 @@ AdrComponent::BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus>
 {
     NS_LOG_FUNCTION(this << status << networkStatus);
 
-    Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice()->Copy();
-    LorawanMacHeader mHdr;
-    LoraFrameHeader fHdr;
-    fHdr.SetAsUplink();
-    myPacket->RemoveHeader(mHdr);
-    myPacket->RemoveHeader(fHdr);
+    auto it = m_snrHistories.find(status->m_endDeviceAddress.Get());
+    if (it == m_snrHistories.end())
+    {
+        NS_LOG_DEBUG("No packet of this device was seen by this component");
+        return;
+    }
+    DeviceSnrHistory& history = it->second;
+
+    // Copies received after the deduplication window are merged into the
+    // status without reaching OnReceivedPacket, so the SNR of the last packet
+    // is computed again now that all gateways should have received it
+    const EndDeviceStatus::ReceivedPacketInfo& info = status->GetLastReceivedPacketInfo();
+    if (info.fCnt == history.lastFCnt)
+    {
+        history.lastSnr = RxPowerToSNR(GetReceivedPower(info.gwList));
+    }
 
     // Execute the Adaptive Data Rate (ADR) algorithm only if the request bit is set
-    if (fHdr.GetAdr())
+    if (history.lastAdr)
     {
-        if (int(status->GetReceivedPacketList().size()) < historyRange)
+        // A batched decision rides the reply to the first ADR uplink after its
+        // epoch. The state of the device in that uplink predates the decision,
+        // so no new decision is taken upon it.
+        auto undelivered = m_undeliveredDecisions.find(status->m_endDeviceAddress.Get());
+        if (undelivered != m_undeliveredDecisions.end())
+        {
+            AddLinkAdrReq(status, undelivered->second);
+            m_undeliveredDecisions.erase(undelivered);
+        }
+        else if (int(history.previousSnrs.GetN()) + 1 < historyRange)
         {
             NS_LOG_ERROR("Not enough packets received by this device ("
-                         << status->GetReceivedPacketList().size()
+                         << history.previousSnrs.GetN() + 1
                          << ") for the algorithm to work (need " << historyRange << ")");
         }
         else
         {
             NS_LOG_DEBUG("New Adaptive Data Rate (ADR) request");
 
-            // Get the spreading factor used by the device
-            uint8_t spreadingFactor = status->GetFirstReceiveWindowSpreadingFactor();
-
-            // Get the device transmission power (dBm)
-            uint8_t transmissionPower = status->GetMac()->GetTransmissionPower();
-
-            // New parameters for the end-device
-            uint8_t newDataRate;
-            uint8_t newTxPower;
-
-            // Adaptive Data Rate (ADR) Algorithm
-            AdrImplementation(&newDataRate, &newTxPower, status);
-
-            // Change the power back to the default if we don't want to change it
-            if (!m_toggleTxPower)
+            AdrInput input = GetAdrInput(status, history);
+            if (m_batchPeriod.IsZero())
             {
-                newTxPower = transmissionPower;
-            }
-
-            if (newDataRate != SfToDr(spreadingFactor) || newTxPower != transmissionPower)
-            {
-                // Create a list with mandatory channel indexes
-                int channels[] = {0, 1, 2};
-                std::list<int> enabledChannels(channels, channels + sizeof(channels) / sizeof(int));
-
-                // Repetitions Setting
-                const int rep = 1;
-
-                NS_LOG_DEBUG("Sending LinkAdrReq with DR = " << (unsigned)newDataRate
-                                                             << " and TP = " << (unsigned)newTxPower
-                                                             << " dBm");
-
-                status->m_reply.frameHeader.AddLinkAdrReq(newDataRate,
-                                                          GetTxPowerIndex(newTxPower),
-                                                          enabledChannels,
-                                                          rep);
-                status->m_reply.frameHeader.SetAsDownlink();
-                status->m_reply.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
-
-                status->m_reply.needsReply = true;
+                AdrDecision decision = Decide(input);
+                if (FinalizeDecision(input, decision))
+                {
+                    AddLinkAdrReq(status, decision);
+                }
             }
             else
             {
-                NS_LOG_DEBUG("Skipped request");
+                EnqueueDecision(status->m_endDeviceAddress.Get(), input);
             }
         }
     }
@@ -165,54 +198,88 @@ AdrComponent::OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> netw
     NS_LOG_FUNCTION(this->GetTypeId() << networkStatus);
 }
 
+NetworkControllerComponent::Subscription
+AdrComponent::GetReceivedPacketSubscription() const
+{
+    return Subscription::None()
+        .WithMType(LorawanMacHeader::UNCONFIRMED_DATA_UP)
+        .WithMType(LorawanMacHeader::CONFIRMED_DATA_UP);
+}
+
+NetworkControllerComponent::Subscription
+AdrComponent::GetReplySubscription() const
+{
+    return Subscription::None().WithFCtrl(FCTRL_ADR);
+}
+
+uint32_t
+AdrComponent::GetReceivedPacketHistorySize() const
+{
+    return 1;
+}
+
 void
-AdrComponent::AdrImplementation(uint8_t* newDataRate,
-                                uint8_t* newTxPower,
-                                Ptr<EndDeviceStatus> status)
+AdrComponent::DoDispose()
 {
+    NS_LOG_FUNCTION(this);
+
+    Simulator::Cancel(m_batchEvent);
+    m_pendingDecisions.clear();
+    m_undeliveredDecisions.clear();
+    StopWorkers();
+
+    NetworkControllerComponent::DoDispose();
+}
+
+AdrComponent::AdrInput
+AdrComponent::GetAdrInput(Ptr<EndDeviceStatus> status, const DeviceSnrHistory& history)
+{
+    AdrInput input = {};
+
     // Compute the maximum or median SNR, based on the boolean value historyAveraging
-    double m_SNR = 0;
     switch (historyAveraging)
     {
     case AdrComponent::AVERAGE:
-        m_SNR = GetAverageSNR(status->GetReceivedPacketList(), historyRange);
+        input.snr = GetAverageSNR(history);
         break;
     case AdrComponent::MAXIMUM:
-        m_SNR = GetMaxSNR(status->GetReceivedPacketList(), historyRange);
+        input.snr = GetMaxSNR(history);
         break;
     case AdrComponent::MINIMUM:
-        m_SNR = GetMinSNR(status->GetReceivedPacketList(), historyRange);
+        input.snr = GetMinSNR(history);
     }
 
-    NS_LOG_DEBUG("m_SNR = " << m_SNR);
-
     // Get the spreading factor used by the device
-    uint8_t spreadingFactor = status->GetFirstReceiveWindowSpreadingFactor();
+    input.spreadingFactor = status->GetFirstReceiveWindowSpreadingFactor();
 
-    NS_LOG_DEBUG("SF = " << (unsigned)spreadingFactor);
+    // Get the device transmission power (dBm), or the one it was last asked to
+    // use if its MAC is not known to the network server
+    Ptr<ClassAEndDeviceLorawanMac> mac = status->GetMac();
+    input.transmissionPower = mac ? mac->GetTransmissionPower() : history.transmissionPower;
 
-    // Get the device data rate and use it to get the SNR demodulation threshold
-    double req_SNR = threshold[SfToDr(spreadingFactor)];
+    NS_LOG_DEBUG("m_SNR = " << input.snr << ", SF = " << (unsigned)input.spreadingFactor
+                            << ", Transmission Power = " << (unsigned)input.transmissionPower);
 
-    NS_LOG_DEBUG("Required SNR = " << req_SNR);
+    return input;
+}
 
-    // Get the device transmission power (dBm)
-    double transmissionPower = status->GetMac()->GetTransmissionPower();
+AdrComponent::AdrDecision
+AdrComponent::Decide(const AdrInput& input) const
+{
+    uint8_t spreadingFactor = input.spreadingFactor;
+    double transmissionPower = input.transmissionPower;
 
-    NS_LOG_DEBUG("Transmission Power = " << transmissionPower);
+    // Get the device data rate and use it to get the SNR demodulation threshold
+    double req_SNR = threshold[SfToDr(spreadingFactor)];
 
     // Compute the SNR margin taking into consideration the SNR of
     // previously received packets
-    double margin_SNR = m_SNR - req_SNR;
-
-    NS_LOG_DEBUG("Margin = " << margin_SNR);
+    double margin_SNR = input.snr - req_SNR;
 
     // Number of steps to decrement the spreading factor (thereby increasing the data rate)
     // and the TP.
     int steps = std::floor(margin_SNR / 3);
 
-    NS_LOG_DEBUG("steps = " << steps);
-
     // If the number of steps is positive (margin_SNR is positive, so its
     // decimal value is high) increment the data rate, if there are some
     // leftover steps after reaching the maximum possible data rate
@@ -226,27 +293,219 @@ AdrComponent::AdrImplementation(uint8_t* newDataRate,
     {
         spreadingFactor--;
         steps--;
-        NS_LOG_DEBUG("Decreased SF by 1");
     }
     while (steps > 0 && transmissionPower > min_transmissionPower)
     {
         transmissionPower -= 2;
         steps--;
-        NS_LOG_DEBUG("Decreased Ptx by 2");
     }
     while (steps < 0 && transmissionPower < max_transmissionPower)
     {
         transmissionPower += 2;
         steps++;
-        NS_LOG_DEBUG("Increased Ptx by 2");
     }
 
-    *newDataRate = SfToDr(spreadingFactor);
-    *newTxPower = transmissionPower;
+    AdrDecision decision;
+    decision.dataRate = SfToDr(spreadingFactor);
+    decision.transmissionPower = transmissionPower;
+    return decision;
+}
+
+bool
+AdrComponent::FinalizeDecision(const AdrInput& input, AdrDecision& decision) const
+{
+    // Change the power back to the default if we don't want to change it
+    if (!m_toggleTxPower)
+    {
+        decision.transmissionPower = input.transmissionPower;
+    }
+
+    if (decision.dataRate == SfToDr(input.spreadingFactor) &&
+        decision.transmissionPower == input.transmissionPower)
+    {
+        NS_LOG_DEBUG("Skipped request");
+        return false;
+    }
+    return true;
+}
+
+void
+AdrComponent::AddLinkAdrReq(Ptr<EndDeviceStatus> status, const AdrDecision& decision)
+{
+    NS_LOG_FUNCTION(this << status);
+
+    // Create a list with mandatory channel indexes
+    int channels[] = {0, 1, 2};
+    std::list<int> enabledChannels(channels, channels + sizeof(channels) / sizeof(int));
+
+    // Repetitions Setting
+    const int rep = 1;
+
+    NS_LOG_DEBUG("Sending LinkAdrReq with DR = " << (unsigned)decision.dataRate << " and TP = "
+                                                 << (unsigned)decision.transmissionPower
+                                                 << " dBm");
+
+    status->m_reply.frameHeader.AddLinkAdrReq(decision.dataRate,
+                                              GetTxPowerIndex(decision.transmissionPower),
+                                              enabledChannels,
+                                              rep);
+    status->m_reply.frameHeader.SetAsDownlink();
+    status->m_reply.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+
+    status->m_reply.needsReply = true;
+
+    m_snrHistories.at(status->m_endDeviceAddress.Get()).transmissionPower =
+        decision.transmissionPower;
+}
+
+void
+AdrComponent::EnqueueDecision(uint32_t address, const AdrInput& input)
+{
+    NS_LOG_FUNCTION(this << address);
+
+    // A device enqueued again before the end of the epoch is decided upon its
+    // most recent state
+    m_pendingDecisions[address] = PendingDecision{address, input};
+
+    if (!m_batchEvent.IsPending())
+    {
+        // Epochs end at multiples of the batch period, so that the
+        // synchronization points do not depend on the traffic
+        int64_t periodNs = m_batchPeriod.GetNanoSeconds();
+        int64_t nowNs = Simulator::Now().GetNanoSeconds();
+        int64_t boundaryNs = (nowNs / periodNs + 1) * periodNs;
+        m_batchEvent = Simulator::Schedule(NanoSeconds(boundaryNs - nowNs),
+                                           &AdrComponent::EvaluatePendingDecisions,
+                                           this);
+    }
+}
+
+void
+AdrComponent::EvaluatePendingDecisions()
+{
+    NS_LOG_FUNCTION(this << m_pendingDecisions.size());
+
+    // The map keeps the batch sorted by device address
+    std::vector<PendingDecision> batch;
+    batch.reserve(m_pendingDecisions.size());
+    for (auto& [address, pending] : m_pendingDecisions)
+    {
+        batch.push_back(std::move(pending));
+    }
+    m_pendingDecisions.clear();
+
+    // Each thread decides on a contiguous slice of the batch, and writes the
+    // outcomes in its own slots
+    std::vector<AdrDecision> decisions(batch.size());
+    std::size_t nSlices = std::min<std::size_t>(m_batchThreads, batch.size());
+    std::size_t sliceSize = nSlices > 0 ? (batch.size() + nSlices - 1) / nSlices : 0;
+    auto decideSlice = [this, &batch, &decisions, sliceSize](std::size_t slice) {
+        std::size_t begin = std::min(batch.size(), slice * sliceSize);
+        std::size_t end = std::min(batch.size(), begin + sliceSize);
+        for (std::size_t i = begin; i < end; i++)
+        {
+            decisions[i] = Decide(batch[i].input);
+        }
+    };
+
+    if (nSlices > 1)
+    {
+        StartWorkers();
+        {
+            std::lock_guard<std::mutex> lock(m_workerMutex);
+            m_decideSlice = decideSlice;
+            m_nBusyWorkers = m_workers.size();
+            m_nBatches++;
+        }
+        m_batchReady.notify_all();
+        decideSlice(0);
+
+        std::unique_lock<std::mutex> lock(m_workerMutex);
+        m_sliceDone.wait(lock, [this] { return m_nBusyWorkers == 0; });
+        m_decideSlice = nullptr;
+    }
+    else
+    {
+        decideSlice(0);
+    }
+
+    // Keep the outcomes until the next reply to each device, replacing any
+    // that was not delivered yet
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+        if (FinalizeDecision(batch[i].input, decisions[i]))
+        {
+            m_undeliveredDecisions[batch[i].address] = decisions[i];
+        }
+        else
+        {
+            m_undeliveredDecisions.erase(batch[i].address);
+        }
+    }
+}
+
+void
+AdrComponent::StartWorkers()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_workers.size() + 1 == m_batchThreads)
+    {
+        return;
+    }
+
+    // BatchThreads was changed since the workers were started
+    StopWorkers();
+    for (std::size_t worker = 1; worker < m_batchThreads; worker++)
+    {
+        m_workers.emplace_back(&AdrComponent::RunWorker, this, worker, m_nBatches);
+    }
+}
+
+void
+AdrComponent::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workerMutex);
+        m_stoppingWorkers = true;
+    }
+    m_batchReady.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    m_stoppingWorkers = false;
+}
+
+void
+AdrComponent::RunWorker(std::size_t worker, uint64_t nBatches)
+{
+    std::unique_lock<std::mutex> lock(m_workerMutex);
+    while (true)
+    {
+        m_batchReady.wait(lock, [this, nBatches] {
+            return m_nBatches != nBatches || m_stoppingWorkers;
+        });
+        if (m_stoppingWorkers)
+        {
+            return;
+        }
+        nBatches = m_nBatches;
+        lock.unlock();
+
+        m_decideSlice(worker);
+
+        lock.lock();
+        if (--m_nBusyWorkers == 0)
+        {
+            m_sliceDone.notify_one();
+        }
+    }
 }
 
 uint8_t
-AdrComponent::SfToDr(uint8_t sf)
+AdrComponent::SfToDr(uint8_t sf) const
 {
     switch (sf)
     {
@@ -280,7 +539,7 @@ AdrComponent::RxPowerToSNR(double transmissionPower) const
 
 // Get the maximum received power (it considers the values in dB!)
 double
-AdrComponent::GetMinTxFromGateways(EndDeviceStatus::GatewayList gwList)
+AdrComponent::GetMinTxFromGateways(const EndDeviceStatus::GatewayList& gwList)
 {
     auto it = gwList.begin();
     double min = it->second.rxPower;
@@ -298,7 +557,7 @@ AdrComponent::GetMinTxFromGateways(EndDeviceStatus::GatewayList gwList)
 
 // Get the maximum received power (it considers the values in dB!)
 double
-AdrComponent::GetMaxTxFromGateways(EndDeviceStatus::GatewayList gwList)
+AdrComponent::GetMaxTxFromGateways(const EndDeviceStatus::GatewayList& gwList)
 {
     auto it = gwList.begin();
     double max = it->second.rxPower;
@@ -316,7 +575,7 @@ AdrComponent::GetMaxTxFromGateways(EndDeviceStatus::GatewayList gwList)
 
 // Get the maximum received power
 double
-AdrComponent::GetAverageTxFromGateways(EndDeviceStatus::GatewayList gwList)
+AdrComponent::GetAverageTxFromGateways(const EndDeviceStatus::GatewayList& gwList)
 {
     double sum = 0;
 
@@ -334,7 +593,7 @@ AdrComponent::GetAverageTxFromGateways(EndDeviceStatus::GatewayList gwList)
 }
 
 double
-AdrComponent::GetReceivedPower(EndDeviceStatus::GatewayList gwList)
+AdrComponent::GetReceivedPower(const EndDeviceStatus::GatewayList& gwList)
 {
     switch (tpAveraging)
     {
@@ -349,27 +608,13 @@ AdrComponent::GetReceivedPower(EndDeviceStatus::GatewayList gwList)
     }
 }
 
-// TODO Make this more elegant
 double
-AdrComponent::GetMinSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange)
+AdrComponent::GetMinSNR(const DeviceSnrHistory& history)
 {
-    double m_SNR;
-
-    // Take elements from the list starting at the end
-    auto it = packetList.rbegin();
-    double min = RxPowerToSNR(GetReceivedPower(it->second.gwList));
-
-    for (int i = 0; i < historyRange; i++, it++)
+    double min = history.lastSnr;
+    if (history.previousSnrs.GetN() > 0)
     {
-        m_SNR = RxPowerToSNR(GetReceivedPower(it->second.gwList));
-
-        NS_LOG_DEBUG("Received power: " << GetReceivedPower(it->second.gwList));
-        NS_LOG_DEBUG("m_SNR = " << m_SNR);
-
-        if (m_SNR < min)
-        {
-            min = m_SNR;
-        }
+        min = std::min(min, history.previousSnrs.GetMin());
     }
 
     NS_LOG_DEBUG("SNR (min) = " << min);
@@ -378,25 +623,12 @@ AdrComponent::GetMinSNR(EndDeviceStatus::ReceivedPacketList packetList, int hist
 }
 
 double
-AdrComponent::GetMaxSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange)
+AdrComponent::GetMaxSNR(const DeviceSnrHistory& history)
 {
-    double m_SNR;
-
-    // Take elements from the list starting at the end
-    auto it = packetList.rbegin();
-    double max = RxPowerToSNR(GetReceivedPower(it->second.gwList));
-
-    for (int i = 0; i < historyRange; i++, it++)
+    double max = history.lastSnr;
+    if (history.previousSnrs.GetN() > 0)
     {
-        m_SNR = RxPowerToSNR(GetReceivedPower(it->second.gwList));
-
-        NS_LOG_DEBUG("Received power: " << GetReceivedPower(it->second.gwList));
-        NS_LOG_DEBUG("m_SNR = " << m_SNR);
-
-        if (m_SNR > max)
-        {
-            max = m_SNR;
-        }
+        max = std::max(max, history.previousSnrs.GetMax());
     }
 
     NS_LOG_DEBUG("SNR (max) = " << max);
@@ -405,24 +637,10 @@ AdrComponent::GetMaxSNR(EndDeviceStatus::ReceivedPacketList packetList, int hist
 }
 
 double
-AdrComponent::GetAverageSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange)
+AdrComponent::GetAverageSNR(const DeviceSnrHistory& history)
 {
-    double sum = 0;
-    double m_SNR;
-
-    // Take elements from the list starting at the end
-    auto it = packetList.rbegin();
-    for (int i = 0; i < historyRange; i++, it++)
-    {
-        m_SNR = RxPowerToSNR(GetReceivedPower(it->second.gwList));
-
-        NS_LOG_DEBUG("Received power: " << GetReceivedPower(it->second.gwList));
-        NS_LOG_DEBUG("m_SNR = " << m_SNR);
-
-        sum += m_SNR;
-    }
-
-    double average = sum / historyRange;
+    double average =
+        (history.previousSnrs.GetSum() + history.lastSnr) / (history.previousSnrs.GetN() + 1);
 
     NS_LOG_DEBUG("SNR (average) = " << average);
 
@@ -465,5 +683,115 @@ AdrComponent::GetTxPowerIndex(int txPower)
         return 7;
     }
 }
+
+///////////////////////////////
+// SNR statistics management //
+///////////////////////////////
+
+AdrComponent::DeviceSnrHistory::DeviceSnrHistory(uint32_t historyRange)
+    : previousSnrs(historyRange - 1),
+      lastSnr(0),
+      lastFCnt(0),
+      lastAdr(false),
+      transmissionPower(0)
+{
+}
+
+AdrComponent::SlidingWindow::SlidingWindow(uint32_t size)
+    : m_values(size),
+      m_nPushed(0),
+      m_sum(0)
+{
+    m_maxQueue.ring.resize(size);
+    m_minQueue.ring.resize(size);
+}
+
+void
+AdrComponent::SlidingWindow::Push(double value)
+{
+    std::size_t size = m_values.size();
+    if (size == 0)
+    {
+        return;
+    }
+
+    uint64_t sequence = m_nPushed++;
+
+    // Discard the oldest value, which is stored where the new one goes
+    if (sequence >= size)
+    {
+        uint64_t expired = sequence - size;
+        m_sum -= m_values[expired % size];
+        for (auto queue : {&m_maxQueue, &m_minQueue})
+        {
+            if (queue->size > 0 && queue->ring[queue->head] == expired)
+            {
+                queue->head = (queue->head + 1) % size;
+                queue->size--;
+            }
+        }
+    }
+
+    m_values[sequence % size] = value;
+    m_sum += value;
+
+    // Once per turn of the ring, drop the error accumulated by the updates
+    if (sequence % size == size - 1)
+    {
+        m_sum = std::accumulate(m_values.begin(), m_values.end(), 0.0);
+    }
+
+    PushToQueue(m_maxQueue, sequence, [](double newer, double older) { return newer >= older; });
+    PushToQueue(m_minQueue, sequence, [](double newer, double older) { return newer <= older; });
+}
+
+void
+AdrComponent::SlidingWindow::PushToQueue(MonotonicQueue& queue,
+                                         uint64_t sequence,
+                                         bool (*dominates)(double, double)) const
+{
+    std::size_t size = m_values.size();
+    double value = m_values[sequence % size];
+
+    // Older values that are dominated by the new one can never be the result
+    while (queue.size > 0)
+    {
+        uint64_t back = queue.ring[(queue.head + queue.size - 1) % size];
+        if (!dominates(value, m_values[back % size]))
+        {
+            break;
+        }
+        queue.size--;
+    }
+
+    queue.ring[(queue.head + queue.size) % size] = sequence;
+    queue.size++;
+}
+
+uint32_t
+AdrComponent::SlidingWindow::GetN() const
+{
+    return std::min<uint64_t>(m_nPushed, m_values.size());
+}
+
+double
+AdrComponent::SlidingWindow::GetSum() const
+{
+    return m_sum;
+}
+
+double
+AdrComponent::SlidingWindow::GetMax() const
+{
+    NS_ASSERT(m_maxQueue.size > 0);
+    return m_values[m_maxQueue.ring[m_maxQueue.head] % m_values.size()];
+}
+
+double
+AdrComponent::SlidingWindow::GetMin() const
+{
+    NS_ASSERT(m_minQueue.size > 0);
+    return m_values[m_minQueue.ring[m_minQueue.head] % m_values.size()];
+}
 } // namespace lorawan
 } // namespace ns3
@@ -12,10 +12,21 @@
 #include "network-controller-components.h"
 #include "network-status.h"
 
+#include "ns3/event-id.h"
 #include "ns3/log.h"
+#include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "ns3/packet.h"
 
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 namespace ns3
 {
 namespace lorawan
@@ -25,6 +36,22 @@ namespace lorawan
  * \ingroup lorawan
  *
  * LinkAdrRequest commands management
+ *
+ * The SNR statistics the algorithm is based on are kept for each device over
+ * a sliding window of the last HistoryRange packets, and updated as each copy
+ * of a packet is received, so that no packet history needs to be walked when
+ * deciding on new parameters.
+ *
+ * When the BatchPeriod attribute is not zero, the component works in batch
+ * mode: devices needing a decision are enqueued, together with a snapshot of
+ * their state, and decisions are taken at the end of each epoch by the
+ * BatchThreads threads calling Decide in parallel. The threads helping the
+ * main one are started with the first batch and kept until the component is
+ * disposed of. Outcomes do not depend on the number of threads, and are kept
+ * by the component until the reply to the next uplink of the device with the
+ * ADR bit set, even if replies without a gateway are given up in between.
+ * Decisions are therefore one uplink late, and the uplink that carries one
+ * does not trigger a new decision, since the device had not applied it yet.
  */
 class AdrComponent : public NetworkControllerComponent
 {
@@ -48,15 +75,56 @@ class AdrComponent : public NetworkControllerComponent
     AdrComponent();           //!< Default constructor
     ~AdrComponent() override; //!< Destructor
 
-    void OnReceivedPacket(Ptr<const Packet> packet,
-                          Ptr<EndDeviceStatus> status,
-                          Ptr<NetworkStatus> networkStatus) override;
+    void OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus) override;
 
     void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
 
     void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
 
-  private:
+    /**
+     * Subscribe to all data uplinks, which contribute to the SNR statistics.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReceivedPacketSubscription() const override;
+
+    /**
+     * Subscribe to uplinks with the ADR bit set.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReplySubscription() const override;
+
+    /**
+     * Only the last packet of each device is needed, since SNR statistics are
+     * kept by the component.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetReceivedPacketHistorySize() const override;
+
+  protected:
+    void DoDispose() override;
+
+    /**
+     * The state of a device an ADR decision is based on.
+     */
+    struct AdrInput
+    {
+        double snr;                //!< SNR of the packet history, combined as configured
+        uint8_t spreadingFactor;   //!< Spreading factor used by the device
+        uint8_t transmissionPower; //!< Transmission power of the device (dBm)
+    };
+
+    /**
+     * The outcome of an ADR decision.
+     */
+    struct AdrDecision
+    {
+        uint8_t dataRate;          //!< New data rate for the device
+        uint8_t transmissionPower; //!< New transmission power for the device (dBm)
+    };
+
     /**
      * Implementation of the default Adaptive Data Rate (ADR) procedure.
      *
@@ -64,11 +132,190 @@ class AdrComponent : public NetworkControllerComponent
      * consuption and radio resource utilization. For more details see
      * https://doi.org/10.1109/NOMS.2018.8406255 .
      *
-     * \param newDataRate [out] new data rate value selected for the end device.
-     * \param newTxPower [out] new tx power value selected for the end device.
+     * In batch mode this method is called concurrently by several threads: it,
+     * and any override of it, must only depend on its input and on the
+     * attributes of the component, and must neither modify any state nor log.
+     *
+     * \param input The state of the end device.
+     * \return The new parameters selected for the end device.
+     */
+    virtual AdrDecision Decide(const AdrInput& input) const;
+
+    /**
+     * Statistics over a sliding window of the most recent values of a
+     * sequence. Values are stored in a ring, and the candidates for the
+     * maximum and the minimum in two monotonic queues, so that all
+     * statistics are available in constant time. The sum is updated
+     * incrementally, and recomputed from the ring each time it wraps around
+     * so that rounding errors do not build up over long simulations.
+     */
+    class SlidingWindow
+    {
+      public:
+        /**
+         * Constructor.
+         *
+         * \param size The number of values in the window.
+         */
+        SlidingWindow(uint32_t size);
+
+        /**
+         * Add a value to the window, discarding the oldest one if the window
+         * is full.
+         *
+         * \param value The new value.
+         */
+        void Push(double value);
+
+        /**
+         * Get the number of values currently in the window.
+         *
+         * \return The number of values.
+         */
+        uint32_t GetN() const;
+
+        /**
+         * Get the sum of the values in the window.
+         *
+         * \return The sum.
+         */
+        double GetSum() const;
+
+        /**
+         * Get the maximum of the values in the window, which must not be empty.
+         *
+         * \return The maximum.
+         */
+        double GetMax() const;
+
+        /**
+         * Get the minimum of the values in the window, which must not be empty.
+         *
+         * \return The minimum.
+         */
+        double GetMin() const;
+
+      private:
+        /**
+         * A monotonic queue of the sequence numbers of the values that can
+         * still become the maximum (or minimum) of the window.
+         */
+        struct MonotonicQueue
+        {
+            std::vector<uint64_t> ring; //!< Sequence numbers, in a ring
+            std::size_t head = 0;       //!< Position of the front of the queue
+            std::size_t size = 0;       //!< Number of elements in the queue
+        };
+
+        /**
+         * Add the sequence number of a new value to a monotonic queue.
+         *
+         * \param queue The queue.
+         * \param sequence The sequence number of the value.
+         * \param dominates Whether a value makes a previous one useless in the queue.
+         */
+        void PushToQueue(MonotonicQueue& queue,
+                         uint64_t sequence,
+                         bool (*dominates)(double, double)) const;
+
+        std::vector<double> m_values; //!< The values in the window, by sequence number
+        uint64_t m_nPushed;           //!< The number of values pushed so far
+        double m_sum;                 //!< The sum of the values in the window
+        MonotonicQueue m_maxQueue;    //!< Candidates for the maximum, in decreasing order
+        MonotonicQueue m_minQueue;    //!< Candidates for the minimum, in increasing order
+    };
+
+  private:
+    /**
+     * The SNR history of a device, and the transmission power it is assumed to
+     * use when the network server has no access to its MAC (e.g., devices of a
+     * LoraEndDeviceFleet).
+     */
+    struct DeviceSnrHistory
+    {
+        /**
+         * Constructor.
+         *
+         * \param historyRange The number of packets to consider.
+         */
+        DeviceSnrHistory(uint32_t historyRange);
+
+        SlidingWindow previousSnrs; //!< SNR of the packets preceding the last one
+        double lastSnr;             //!< SNR of the last packet, over the copies received so far
+        uint16_t lastFCnt;          //!< Frame counter of the last packet
+        bool lastAdr;               //!< Whether the last packet had the ADR bit set
+        uint8_t transmissionPower;  //!< Last power requested to the device, initially the maximum
+    };
+
+    /**
+     * A device waiting for an ADR decision in batch mode.
+     */
+    struct PendingDecision
+    {
+        uint32_t address; //!< The address of the device
+        AdrInput input;   //!< The state of the device when it was enqueued
+    };
+
+    /**
+     * Take a snapshot of the state of a device for an ADR decision.
+     *
      * \param status State representation of the current end device.
+     * \param history The SNR history of the end device.
+     * \return The inputs of the decision.
+     */
+    AdrInput GetAdrInput(Ptr<EndDeviceStatus> status, const DeviceSnrHistory& history);
+
+    /**
+     * Adjust the outcome of a decision to the configuration of the component,
+     * and check whether it changes the parameters of the device.
+     *
+     * \param input The state of the device the decision is based on.
+     * \param decision The outcome of the decision, adjusted in place.
+     * \return Whether a LinkAdrReq needs to be sent.
+     */
+    bool FinalizeDecision(const AdrInput& input, AdrDecision& decision) const;
+
+    /**
+     * Add the LinkAdrReq command carrying a decision to the reply of a device.
+     *
+     * \param status State representation of the end device.
+     * \param decision The outcome of the decision.
      */
-    void AdrImplementation(uint8_t* newDataRate, uint8_t* newTxPower, Ptr<EndDeviceStatus> status);
+    void AddLinkAdrReq(Ptr<EndDeviceStatus> status, const AdrDecision& decision);
+
+    /**
+     * Enqueue a device for a decision at the end of the current epoch.
+     *
+     * \param address The address of the end device.
+     * \param input The state of the device the decision is based on.
+     */
+    void EnqueueDecision(uint32_t address, const AdrInput& input);
+
+    /**
+     * Decide on all enqueued devices in parallel, and keep the outcomes until
+     * the next reply to each device.
+     */
+    void EvaluatePendingDecisions();
+
+    /**
+     * Start the threads helping the main one with the batches, unless they
+     * are already running.
+     */
+    void StartWorkers();
+
+    /**
+     * Stop the threads helping the main one with the batches.
+     */
+    void StopWorkers();
+
+    /**
+     * Decide on the slice of each batch assigned to a worker, until the
+     * workers are stopped. Run by the worker threads.
+     *
+     * \param worker The index of the worker, from one (the main thread decides on slice zero).
+     * \param nBatches The number of batches handed to the workers before this one started.
+     */
+    void RunWorker(std::size_t worker, uint64_t nBatches);
 
     /**
      * Convert spreading factor values [7:12] to respective data rate values [0:5].
@@ -76,7 +323,7 @@ class AdrComponent : public NetworkControllerComponent
      * \param sf The spreading factor value.
      * \return Value of the data rate as uint8_t.
      */
-    uint8_t SfToDr(uint8_t sf);
+    uint8_t SfToDr(uint8_t sf) const;
 
     /**
      * Convert reception power values [dBm] to Signal to Noise Ratio (SNR) values [dB].
@@ -98,53 +345,50 @@ class AdrComponent : public NetworkControllerComponent
      * \param gwList List of gateways paired with reception information.
      * \return Min RSSI of transmission as double.
      */
-    double GetMinTxFromGateways(EndDeviceStatus::GatewayList gwList);
+    double GetMinTxFromGateways(const EndDeviceStatus::GatewayList& gwList);
     /**
      * Get the max RSSI (dBm) among gateways receiving the same transmission.
      *
      * \param gwList List of gateways paired with packet reception information.
      * \return Max RSSI of transmission as double.
      */
-    double GetMaxTxFromGateways(EndDeviceStatus::GatewayList gwList);
+    double GetMaxTxFromGateways(const EndDeviceStatus::GatewayList& gwList);
     /**
      * Get the average RSSI (dBm) of gateways receiving the same transmission.
      *
      * \param gwList List of gateways paired with packet reception information.
      * \return Average RSSI of transmission as double.
      */
-    double GetAverageTxFromGateways(EndDeviceStatus::GatewayList gwList);
+    double GetAverageTxFromGateways(const EndDeviceStatus::GatewayList& gwList);
     /**
      * Get RSSI metric for a transmission according to chosen gateway aggregation policy.
      *
      * \param gwList List of gateways paired with packet reception information.
      * \return RSSI of tranmsmission as double.
      */
-    double GetReceivedPower(EndDeviceStatus::GatewayList gwList);
+    double GetReceivedPower(const EndDeviceStatus::GatewayList& gwList);
 
     /**
      * Get the min Signal to Noise Ratio (SNR) of the receive packet history.
      *
-     * \param packetList History of received packets with reception information.
-     * \param historyRange Number of packets to consider going back in time.
+     * \param history The SNR history of the device.
      * \return Min SNR among packets as double.
      */
-    double GetMinSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange);
+    double GetMinSNR(const DeviceSnrHistory& history);
     /**
      * Get the max Signal to Noise Ratio (SNR) of the receive packet history.
      *
-     * \param packetList History of received packets with reception information.
-     * \param historyRange Number of packets to consider going back in time.
+     * \param history The SNR history of the device.
      * \return Max SNR among packets as double.
      */
-    double GetMaxSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange);
+    double GetMaxSNR(const DeviceSnrHistory& history);
     /**
      * Get the average Signal to Noise Ratio (SNR) of the received packet history.
      *
-     * \param packetList History of received packets with reception information.
-     * \param historyRange Number of packets to consider going back in time.
+     * \param history The SNR history of the device.
      * \return Average SNR of packets as double.
      */
-    double GetAverageSNR(EndDeviceStatus::ReceivedPacketList packetList, int historyRange);
+    double GetAverageSNR(const DeviceSnrHistory& history);
 
     /**
      * Get the LoRaWAN protocol TXPower configuration index from the Equivalent Isotropically
@@ -175,6 +419,35 @@ class AdrComponent : public NetworkControllerComponent
                //!< levels ranging from 7 to 12 (the SNR values are in dB).
 
     bool m_toggleTxPower; //!< Whether to control transmission power of end devices or not
+
+    /**
+     * The SNR history of each device, by device address.
+     */
+    std::unordered_map<uint32_t, DeviceSnrHistory> m_snrHistories;
+
+    Time m_batchPeriod;      //!< The period of batch epochs, zero to decide immediately
+    uint32_t m_batchThreads; //!< The number of threads evaluating a batch
+
+    /**
+     * The devices waiting for a decision in the current epoch, by device address.
+     */
+    std::map<uint32_t, PendingDecision> m_pendingDecisions;
+
+    /**
+     * The outcomes of batches not sent to their device yet, by device address.
+     */
+    std::unordered_map<uint32_t, AdrDecision> m_undeliveredDecisions;
+
+    EventId m_batchEvent; //!< The event ending the current epoch
+
+    std::vector<std::thread> m_workers;             //!< The threads helping the main one
+    std::mutex m_workerMutex;                       //!< Protects the members below
+    std::condition_variable m_batchReady;           //!< Signals a new batch or the stop
+    std::condition_variable m_sliceDone;            //!< Signals the last slice decided
+    std::function<void(std::size_t)> m_decideSlice; //!< Decides on a slice of the batch
+    uint64_t m_nBatches = 0;                        //!< Batches handed to the workers
+    std::size_t m_nBusyWorkers = 0;                 //!< Workers deciding on their slice
+    bool m_stoppingWorkers = false;                 //!< Whether the workers should stop
 };
 } // namespace lorawan
 } // namespace ns3
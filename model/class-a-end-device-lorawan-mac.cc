@@ -15,6 +15,7 @@
 #include "end-device-lora-phy.h"
 #include "end-device-lorawan-mac.h"
 
+#include "ns3/boolean.h"
 #include "ns3/log.h"
 
 #include <algorithm>
@@ -31,10 +32,19 @@ NS_OBJECT_ENSURE_REGISTERED(ClassAEndDeviceLorawanMac);
 TypeId
 ClassAEndDeviceLorawanMac::GetTypeId()
 {
-    static TypeId tid = TypeId("ns3::ClassAEndDeviceLorawanMac")
-                            .SetParent<EndDeviceLorawanMac>()
-                            .SetGroupName("lorawan")
-                            .AddConstructor<ClassAEndDeviceLorawanMac>();
+    static TypeId tid =
+        TypeId("ns3::ClassAEndDeviceLorawanMac")
+            .SetParent<EndDeviceLorawanMac>()
+            .SetGroupName("lorawan")
+            .AddConstructor<ClassAEndDeviceLorawanMac>()
+            .AddAttribute("SkipEmptyReceiveWindows",
+                          "Whether to skip opening receive windows after uplinks that can not "
+                          "trigger a reply from the network server, accounting for them "
+                          "analytically instead",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(
+                              &ClassAEndDeviceLorawanMac::m_skipEmptyReceiveWindows),
+                          MakeBooleanChecker());
     return tid;
 }
 
@@ -43,7 +53,8 @@ ClassAEndDeviceLorawanMac::ClassAEndDeviceLorawanMac()
       m_receiveDelay1(Seconds(1)),
       // LoraWAN default
       m_receiveDelay2(Seconds(2)),
-      m_rx1DrOffset(0)
+      m_rx1DrOffset(0),
+      m_skipEmptyReceiveWindows(false)
 {
     NS_LOG_FUNCTION(this);
 
@@ -94,7 +105,7 @@ ClassAEndDeviceLorawanMac::SendToPhy(Ptr<Packet> packetToSend)
 
     // Wake up PHY layer and directly send the packet
 
-    Ptr<LogicalLoraChannel> txChannel = GetChannelForTx();
+    Ptr<const LogicalLoraChannel> txChannel = GetChannelForTx();
 
     NS_LOG_DEBUG("PacketToSend: " << packetToSend);
     m_phy->Send(packetToSend, params, txChannel->GetFrequency(), m_txPower);
@@ -265,6 +276,14 @@ ClassAEndDeviceLorawanMac::TxFinished(Ptr<const Packet> packet)
 {
     NS_LOG_FUNCTION_NOARGS();
 
+    // If no reply can be addressed to us, there is no need to open the windows
+    if (m_skipEmptyReceiveWindows && !m_downlinkExpected)
+    {
+        DynamicCast<EndDeviceLoraPhy>(m_phy)->SwitchToSleep();
+        SkipEmptyReceiveWindows();
+        return;
+    }
+
     // Schedule the opening of the first receive window
     Simulator::Schedule(m_receiveDelay1, &ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow, this);
 
@@ -439,6 +458,35 @@ ClassAEndDeviceLorawanMac::CloseSecondReceiveWindow()
     }
 }
 
+void
+ClassAEndDeviceLorawanMac::SkipEmptyReceiveWindows()
+{
+    NS_LOG_FUNCTION_NOARGS();
+
+    Ptr<EndDeviceLoraPhy> phy = DynamicCast<EndDeviceLoraPhy>(m_phy);
+
+    // Compute the duration of the two windows, as they would have been opened
+    double tSym1 = pow(2, GetSfFromDataRate(GetFirstReceiveWindowDataRate())) /
+                   GetBandwidthFromDataRate(GetFirstReceiveWindowDataRate());
+    double tSym2 = pow(2, GetSfFromDataRate(GetSecondReceiveWindowDataRate())) /
+                   GetBandwidthFromDataRate(GetSecondReceiveWindowDataRate());
+    Time firstWindowDuration = Seconds(m_receiveWindowDurationInSymbols * tSym1);
+    Time secondWindowDuration = Seconds(m_receiveWindowDurationInSymbols * tSym2);
+
+    NS_LOG_INFO("No downlink can be addressed to us: skipping receive windows.");
+
+    // Let listeners (e.g., the energy model) account for the time the radio
+    // would have spent in STANDBY, that is while the windows are open
+    phy->AccountIdleReceiveWindow(Simulator::Now() + m_receiveDelay1, firstWindowDuration);
+    phy->AccountIdleReceiveWindow(Simulator::Now() + m_receiveDelay2, secondWindowDuration);
+
+    // Closing the second window concludes the transmission procedure
+    m_closeSecondWindow =
+        Simulator::Schedule(m_receiveDelay2 + secondWindowDuration,
+                            &ClassAEndDeviceLorawanMac::CloseSecondReceiveWindow,
+                            this);
+}
+
 /////////////////////////
 // Getters and Setters //
 /////////////////////////
@@ -461,8 +509,17 @@ ClassAEndDeviceLorawanMac::GetNextClassTransmissionDelay(Time waitingTime)
             double tSym = pow(2, GetSfFromDataRate(GetSecondReceiveWindowDataRate())) /
                           GetBandwidthFromDataRate(GetSecondReceiveWindowDataRate());
             // Compute the closing time of the second receive window
-            Time endSecondRxWindow = Time(m_secondReceiveWindow.GetTs()) +
-                                     Seconds(m_receiveWindowDurationInSymbols * tSym);
+            Time endSecondRxWindow;
+            if (m_secondReceiveWindow.IsExpired() && m_closeSecondWindow.IsPending())
+            {
+                // Either the window is open, or it was skipped: use its closing event
+                endSecondRxWindow = Time(m_closeSecondWindow.GetTs());
+            }
+            else
+            {
+                endSecondRxWindow = Time(m_secondReceiveWindow.GetTs()) +
+                                    Seconds(m_receiveWindowDurationInSymbols * tSym);
+            }
 
             NS_LOG_DEBUG("Duration until endSecondRxWindow for new transmission:"
                          << (endSecondRxWindow - Simulator::Now()).GetSeconds());
@@ -554,7 +611,7 @@ ClassAEndDeviceLorawanMac::OnRxClassParamSetupReq(Ptr<RxParamSetupReq> rxParamSe
 
     // Craft a RxParamSetupAns as response
     NS_LOG_INFO("Adding RxParamSetupAns reply");
-    m_macCommandList.emplace_back(CreateObject<RxParamSetupAns>(offsetOk, dataRateOk, true));
+    m_macCommandAnswers.AddRxParamSetupAns(offsetOk, dataRateOk, true);
 }
 
 } /* namespace lorawan */
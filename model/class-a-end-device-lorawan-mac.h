@@ -91,6 +91,15 @@ class ClassAEndDeviceLorawanMac : public EndDeviceLorawanMac
      */
     void CloseSecondReceiveWindow();
 
+    /**
+     * Account for both receive windows without opening them, in case the
+     * last uplink can not trigger a reply from the network server.
+     *
+     * The PHY is expected to be in SLEEP. Listeners are notified of the skipped
+     * windows and only the event closing the second receive window is scheduled.
+     */
+    void SkipEmptyReceiveWindows();
+
     /////////////////////////
     // Getters and Setters //
     /////////////////////////
@@ -202,6 +211,16 @@ class ClassAEndDeviceLorawanMac : public EndDeviceLorawanMac
      */
     uint8_t m_rx1DrOffset;
 
+    /**
+     * Whether receive windows that can not contain a downlink should be skipped.
+     *
+     * If enabled, after an uplink that can not trigger a reply from the network
+     * server the device stays in SLEEP instead of opening its receive windows,
+     * and the two windows are accounted analytically by the PHY listeners. Only
+     * a single event, closing the second receive window, is scheduled.
+     */
+    bool m_skipEmptyReceiveWindows;
+
 }; /* ClassAEndDeviceLorawanMac */
 } /* namespace lorawan */
 } /* namespace ns3 */
@@ -32,6 +32,11 @@ EndDeviceLoraPhyListener::~EndDeviceLoraPhyListener()
 {
 }
 
+void
+EndDeviceLoraPhyListener::NotifyIdleReceiveWindow(Time start, Time duration)
+{
+}
+
 TypeId
 EndDeviceLoraPhy::GetTypeId()
 {
@@ -182,6 +187,20 @@ EndDeviceLoraPhy::SwitchToSleep()
     }
 }
 
+void
+EndDeviceLoraPhy::AccountIdleReceiveWindow(Time start, Time duration)
+{
+    NS_LOG_FUNCTION(this << start << duration);
+
+    NS_ASSERT(m_state == SLEEP);
+
+    // Notify listeners of the skipped window
+    for (auto i = m_listeners.begin(); i != m_listeners.end(); i++)
+    {
+        (*i)->NotifyIdleReceiveWindow(start, duration);
+    }
+}
+
 EndDeviceLoraPhy::State
 EndDeviceLoraPhy::GetState()
 {
@@ -69,6 +69,18 @@ class EndDeviceLoraPhyListener
      * Notify listeners that we woke up.
      */
     virtual void NotifyStandby() = 0;
+
+    /**
+     * Notify listeners that the radio, while remaining in SLEEP, has to be
+     * accounted as if it was in STANDBY for the specified interval.
+     *
+     * This is used by upper layers that skip opening receive windows which are
+     * known to be empty. The default implementation ignores the notification.
+     *
+     * \param start The time at which the skipped window would have opened.
+     * \param duration The duration of the skipped window.
+     */
+    virtual void NotifyIdleReceiveWindow(Time start, Time duration);
 };
 
 /**
@@ -207,6 +219,18 @@ class EndDeviceLoraPhy : public LoraPhy
      */
     void SwitchToSleep();
 
+    /**
+     * Inform listeners of a receive window that will not be opened because it
+     * is known to be empty, so that they can account for it analytically.
+     *
+     * The PHY does not change state: it is expected to be in SLEEP for the
+     * whole duration of the window.
+     *
+     * \param start The time at which the window would have opened.
+     * \param duration The duration of the window.
+     */
+    void AccountIdleReceiveWindow(Time start, Time duration);
+
     /**
      * Add the input listener to the list of objects to be notified of PHY-level
      * events.
@@ -109,6 +109,7 @@ EndDeviceLorawanMac::EndDeviceLorawanMac()
       m_address(LoraDeviceAddress(0)),
       // LoraWAN default
       m_receiveWindowDurationInSymbols(8),
+      m_downlinkExpected(true),
       // LoraWAN default
       m_controlDataRate(false),
       m_lastKnownLinkMargin(0),
@@ -146,6 +147,18 @@ EndDeviceLorawanMac::Send(Ptr<Packet> packet)
 {
     NS_LOG_FUNCTION(this << packet);
 
+    // A DutyCycleReq with a null duty cycle silenced the device
+    if (m_aggregatedDutyCycle == 0)
+    {
+        NS_LOG_INFO("Transmissions are disabled by the network: packet not transmitted.");
+        if (packet == m_retxParams.packet)
+        {
+            resetRetransmissionParameters();
+        }
+        m_cannotSendBecauseDutyCycle(packet);
+        return;
+    }
+
     // If it is not possible to transmit now because of the duty cycle,
     // or because we are receiving, schedule a tx/retx later
 
@@ -157,7 +170,7 @@ EndDeviceLorawanMac::Send(Ptr<Packet> packet)
     }
 
     // Pick a channel on which to transmit the packet
-    Ptr<LogicalLoraChannel> txChannel = GetChannelForTx();
+    Ptr<const LogicalLoraChannel> txChannel = GetChannelForTx();
 
     if (!(txChannel && m_retxParams.retxLeft > 0))
     {
@@ -228,6 +241,7 @@ EndDeviceLorawanMac::DoSend(Ptr<Packet> packet)
 
         // Reset MAC command list
         m_macCommandList.clear();
+        m_macCommandAnswers.Clear();
 
         if (m_retxParams.waitingAck)
         {
@@ -459,9 +473,29 @@ EndDeviceLorawanMac::ApplyNecessaryOptions(LoraFrameHeader& frameHeader)
     // FPending does not exist in uplink messages
     frameHeader.SetFCnt(m_currentFCnt);
 
-    // Add listed MAC commands
+    // The network server only replies to confirmed uplinks, to uplinks requesting
+    // data rate control and to uplinks carrying MAC commands
+    m_downlinkExpected = (m_mType == LorawanMacHeader::CONFIRMED_DATA_UP) || m_controlDataRate ||
+                         !m_macCommandList.empty() || !m_macCommandAnswers.IsEmpty();
+
+    // Add pending answers, already in serialized form
+    NS_LOG_INFO("Applying " << unsigned(m_macCommandAnswers.GetSize())
+                            << " bytes of MAC command answers");
+    frameHeader.AddSerializedCommands(m_macCommandAnswers.GetBuffer(),
+                                      m_macCommandAnswers.GetSize());
+
+    // Add listed MAC commands, as long as they fit in the FOpts field
     for (const auto& command : m_macCommandList)
     {
+        if (frameHeader.GetFOptsLen() + command->GetSerializedSize() >
+            MacCommandAnswerBuffer::MAX_SIZE)
+        {
+            NS_LOG_WARN("MAC command of CID "
+                        << unsigned(MacCommand::GetCIDFromMacCommand(command->GetCommandType()))
+                        << " does not fit in the FOpts field: not applied.");
+            continue;
+        }
+
         NS_LOG_INFO("Applying a MAC Command of CID "
                     << unsigned(MacCommand::GetCIDFromMacCommand(command->GetCommandType())));
 
@@ -491,6 +525,12 @@ EndDeviceLorawanMac::GetMType()
     return m_mType;
 }
 
+Ptr<const Packet>
+EndDeviceLorawanMac::GetRetransmissionPacket() const
+{
+    return m_retxParams.packet;
+}
+
 void
 EndDeviceLorawanMac::TxFinished(Ptr<const Packet> packet)
 {
@@ -510,50 +550,64 @@ EndDeviceLorawanMac::GetNextTransmissionDelay()
 
     //    Check duty cycle    //
 
-    // Pick a random channel to transmit on
-    std::vector<Ptr<LogicalLoraChannel>> logicalChannels;
-    logicalChannels =
-        m_channelHelper.GetEnabledChannelList(); // Use a separate list to do the shuffle
-    // logicalChannels = Shuffle (logicalChannels);
+    // Earliest time any enabled channel can be used, according to both
+    // SubBand and aggregated duty cycle limitations
+    Time nextTxTime = m_channelHelper.GetNextTransmissionTime();
 
     Time waitingTime = Time::Max();
-
-    // Try every channel
-    std::vector<Ptr<LogicalLoraChannel>>::iterator it;
-    for (it = logicalChannels.begin(); it != logicalChannels.end(); ++it)
+    if (nextTxTime != Time::Max())
     {
-        // Pointer to the current channel
-        Ptr<LogicalLoraChannel> logicalChannel = *it;
-        double frequency = logicalChannel->GetFrequency();
-
-        waitingTime = std::min(waitingTime, m_channelHelper.GetWaitingTime(logicalChannel));
-
-        NS_LOG_DEBUG("Waiting time before the next transmission in channel with frequency "
-                     << frequency << " is = " << waitingTime.GetSeconds() << ".");
+        waitingTime = std::max(nextTxTime - Simulator::Now(), Seconds(0));
     }
 
+    NS_LOG_DEBUG("Waiting time before the next transmission because of duty cycle is = "
+                 << waitingTime.GetSeconds() << ".");
+
     waitingTime = GetNextClassTransmissionDelay(waitingTime);
 
     return waitingTime;
 }
 
-Ptr<LogicalLoraChannel>
+Time
+EndDeviceLorawanMac::GetNextTransmissionTime()
+{
+    NS_LOG_FUNCTION_NOARGS();
+
+    Time nextTxTime = m_channelHelper.GetNextTransmissionTime();
+    if (m_aggregatedDutyCycle == 0 || nextTxTime == Time::Max())
+    {
+        return Time::Max();
+    }
+
+    Time waitingTime = std::max(nextTxTime - Simulator::Now(), Seconds(0));
+
+    // Retransmission delays are randomized, so they are only known once the
+    // retransmission is actually scheduled
+    if (!m_retxParams.waitingAck)
+    {
+        waitingTime = GetNextClassTransmissionDelay(waitingTime);
+    }
+
+    return Simulator::Now() + waitingTime;
+}
+
+Ptr<const LogicalLoraChannel>
 EndDeviceLorawanMac::GetChannelForTx()
 {
     NS_LOG_FUNCTION_NOARGS();
 
     // Pick a random channel to transmit on
-    std::vector<Ptr<LogicalLoraChannel>> logicalChannels;
+    std::vector<Ptr<const LogicalLoraChannel>> logicalChannels;
     logicalChannels =
         m_channelHelper.GetEnabledChannelList(); // Use a separate list to do the shuffle
     logicalChannels = Shuffle(logicalChannels);
 
     // Try every channel
-    std::vector<Ptr<LogicalLoraChannel>>::iterator it;
+    std::vector<Ptr<const LogicalLoraChannel>>::iterator it;
     for (it = logicalChannels.begin(); it != logicalChannels.end(); ++it)
     {
         // Pointer to the current channel
-        Ptr<LogicalLoraChannel> logicalChannel = *it;
+        Ptr<const LogicalLoraChannel> logicalChannel = *it;
         double frequency = logicalChannel->GetFrequency();
 
         NS_LOG_DEBUG("Frequency of the current channel: " << frequency);
@@ -577,8 +631,8 @@ EndDeviceLorawanMac::GetChannelForTx()
     return nullptr; // In this case, no suitable channel was found
 }
 
-std::vector<Ptr<LogicalLoraChannel>>
-EndDeviceLorawanMac::Shuffle(std::vector<Ptr<LogicalLoraChannel>> vector)
+std::vector<Ptr<const LogicalLoraChannel>>
+EndDeviceLorawanMac::Shuffle(std::vector<Ptr<const LogicalLoraChannel>> vector)
 {
     NS_LOG_FUNCTION_NOARGS();
 
@@ -587,7 +641,7 @@ EndDeviceLorawanMac::Shuffle(std::vector<Ptr<LogicalLoraChannel>> vector)
     for (int i = 0; i < size; ++i)
     {
         uint16_t random = std::floor(m_uniformRV->GetValue(0, size));
-        Ptr<LogicalLoraChannel> temp = vector.at(random);
+        Ptr<const LogicalLoraChannel> temp = vector.at(random);
         vector.at(random) = vector.at(i);
         vector.at(i) = temp;
     }
@@ -765,17 +819,17 @@ EndDeviceLorawanMac::OnLinkAdrReq(uint8_t dataRate,
     if (channelMaskOk && dataRateOk && txPowerOk)
     {
         // Cycle over all channels in the list
-        for (uint32_t i = 0; i < m_channelHelper.GetChannelList().size(); i++)
+        for (int i = 0; i < channelListSize; i++)
         {
             if (std::find(enabledChannels.begin(), enabledChannels.end(), i) !=
                 enabledChannels.end())
             {
-                m_channelHelper.GetChannelList().at(i)->SetEnabledForUplink();
+                m_channelHelper.EnableChannel(i);
                 NS_LOG_DEBUG("Channel " << i << " enabled");
             }
             else
             {
-                m_channelHelper.GetChannelList().at(i)->DisableForUplink();
+                m_channelHelper.DisableChannel(i);
                 NS_LOG_DEBUG("Channel " << i << " disabled");
             }
         }
@@ -789,7 +843,7 @@ EndDeviceLorawanMac::OnLinkAdrReq(uint8_t dataRate,
 
     // Craft a LinkAdrAns MAC command as a response
     ///////////////////////////////////////////////
-    m_macCommandList.emplace_back(CreateObject<LinkAdrAns>(txPowerOk, dataRateOk, channelMaskOk));
+    m_macCommandAnswers.AddLinkAdrAns(txPowerOk, dataRateOk, channelMaskOk);
 }
 
 void
@@ -798,14 +852,25 @@ EndDeviceLorawanMac::OnDutyCycleReq(double dutyCycle)
     NS_LOG_FUNCTION(this << dutyCycle);
 
     // Make sure we get a value that makes sense
-    NS_ASSERT(0 <= dutyCycle && dutyCycle < 1);
+    NS_ASSERT(0 <= dutyCycle && dutyCycle <= 1);
 
-    // Set the new duty cycle value
+    // Set the new duty cycle value. A null duty cycle (MaxDCycle 255) means
+    // that the device must stop transmitting immediately, until another
+    // DutyCycleReq allows it again.
     m_aggregatedDutyCycle = dutyCycle;
+    if (dutyCycle > 0)
+    {
+        m_channelHelper.SetAggregatedDutyCycle(dutyCycle);
+    }
+    else
+    {
+        NS_LOG_INFO("Transmissions disabled by the network");
+        resetRetransmissionParameters();
+    }
 
     // Craft a DutyCycleAns as response
     NS_LOG_INFO("Adding DutyCycleAns reply");
-    m_macCommandList.emplace_back(CreateObject<DutyCycleAns>());
+    m_macCommandAnswers.AddDutyCycleAns();
 }
 
 void
@@ -832,7 +897,7 @@ EndDeviceLorawanMac::OnDevStatusReq()
 
     // Craft a RxParamSetupAns as response
     NS_LOG_INFO("Adding DevStatusAns reply");
-    m_macCommandList.emplace_back(CreateObject<DevStatusAns>(battery, margin));
+    m_macCommandAnswers.AddDevStatusAns(battery, margin);
 }
 
 void
@@ -852,7 +917,7 @@ EndDeviceLorawanMac::OnNewChannelReq(uint8_t chIndex,
     SetLogicalChannel(chIndex, frequency, minDataRate, maxDataRate);
 
     NS_LOG_INFO("Adding NewChannelAns reply");
-    m_macCommandList.emplace_back(CreateObject<NewChannelAns>(dataRateRangeOk, channelFrequencyOk));
+    m_macCommandAnswers.AddNewChannelAns(dataRateRangeOk, channelFrequencyOk);
 }
 
 void
@@ -16,6 +16,7 @@
 #include "lora-frame-header.h"
 #include "lorawan-mac-header.h"
 #include "lorawan-mac.h"
+#include "mac-command-answer-buffer.h"
 
 #include "ns3/random-variable-stream.h"
 #include "ns3/traced-value.h"
@@ -191,6 +192,21 @@ class EndDeviceLorawanMac : public LorawanMac
      */
     double GetAggregatedDutyCycle();
 
+    /**
+     * Get the earliest time at which a new packet handed to Send would be
+     * transmitted right away, instead of being postponed because of duty cycle
+     * limitations or of pending receive windows.
+     *
+     * Applications can use this to schedule their next packet in a legal slot.
+     * While waiting for an acknowledgment, the randomized retransmission delay
+     * is not taken into account.
+     *
+     * \return The absolute time of the next legal transmission slot, or
+     * Time::Max () if no channel is enabled for uplink or if transmissions were
+     * disabled by a DutyCycleReq.
+     */
+    Time GetNextTransmissionTime();
+
     /////////////////////////
     // MAC command methods //
     /////////////////////////
@@ -223,6 +239,13 @@ class EndDeviceLorawanMac : public LorawanMac
      */
     LorawanMacHeader::MType GetMType();
 
+    /**
+     * Get the confirmed packet kept for retransmission, if any.
+     *
+     * \return The packet, or nullptr if none is kept.
+     */
+    Ptr<const Packet> GetRetransmissionPacket() const;
+
     /**
      * Parse and take action on the commands contained on this FrameHeader.
      *
@@ -254,6 +277,10 @@ class EndDeviceLorawanMac : public LorawanMac
     /**
      * Perform the actions that need to be taken when receiving a DutyCycleReq command.
      *
+     * A null duty cycle, sent as MaxDCycle 255, silences the device: pending
+     * transmissions are cancelled and packets handed to Send are dropped until a
+     * DutyCycleReq with a positive duty cycle is received.
+     *
      * \param dutyCycle The aggregate duty cycle prescribed by the command, in
      * fraction form.
      */
@@ -384,7 +411,7 @@ class EndDeviceLorawanMac : public LorawanMac
      *
      * \return A pointer to the channel.
      */
-    Ptr<LogicalLoraChannel> GetChannelForTx();
+    Ptr<const LogicalLoraChannel> GetChannelForTx();
 
     /**
      * The duration of a receive window in number of symbols. This should be
@@ -403,6 +430,20 @@ class EndDeviceLorawanMac : public LorawanMac
      */
     std::list<Ptr<MacCommand>> m_macCommandList;
 
+    /**
+     * Answers to the MAC commands received from the network server, in serialized
+     * form, that need to be applied to the next UL packet.
+     */
+    MacCommandAnswerBuffer m_macCommandAnswers;
+
+    /**
+     * Whether the last uplink can trigger a reply from the network server, i.e.,
+     * whether it was confirmed, requested data rate control or carried MAC
+     * commands. Uplinks for which this is false can not receive a downlink in
+     * their receive windows.
+     */
+    bool m_downlinkExpected;
+
     /**
      * Structure containing the retransmission parameters for this device.
      */
@@ -432,7 +473,8 @@ class EndDeviceLorawanMac : public LorawanMac
      * \param vector The vector of pointers to logical LoRa channels.
      * \return The shuffled vector.
      */
-    std::vector<Ptr<LogicalLoraChannel>> Shuffle(std::vector<Ptr<LogicalLoraChannel>> vector);
+    std::vector<Ptr<const LogicalLoraChannel>> Shuffle(
+        std::vector<Ptr<const LogicalLoraChannel>> vector);
 
     /**
      * Find the base minimum waiting time before the next possible transmission.
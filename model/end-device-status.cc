@@ -42,7 +42,6 @@ EndDeviceStatus::EndDeviceStatus(LoraDeviceAddress endDeviceAddress,
                                  Ptr<ClassAEndDeviceLorawanMac> endDeviceMac)
     : m_reply(EndDeviceStatus::Reply()),
       m_endDeviceAddress(endDeviceAddress),
-      m_receivedPacketList(ReceivedPacketList()),
       m_mac(endDeviceMac)
 {
     NS_LOG_FUNCTION(endDeviceAddress);
@@ -54,7 +53,6 @@ EndDeviceStatus::EndDeviceStatus()
 
     // Initialize data structure
     m_reply = EndDeviceStatus::Reply();
-    m_receivedPacketList = ReceivedPacketList();
 }
 
 EndDeviceStatus::~EndDeviceStatus()
@@ -115,15 +113,9 @@ EndDeviceStatus::GetCompleteReplyPacket()
         replyPacket = Create<Packet>(0);
     }
 
-    // Add headers
+    // Add headers, taking the frame counter from the fields cached on reception
     m_reply.frameHeader.SetAddress(m_endDeviceAddress);
-    Ptr<Packet> lastPacket = GetLastPacketReceivedFromDevice()->Copy();
-    LorawanMacHeader mHdr;
-    LoraFrameHeader fHdr;
-    fHdr.SetAsUplink();
-    lastPacket->RemoveHeader(mHdr);
-    lastPacket->RemoveHeader(fHdr);
-    m_reply.frameHeader.SetFCnt(fHdr.GetFCnt());
+    m_reply.frameHeader.SetFCnt(m_lastUplink.fCnt);
     m_reply.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
     replyPacket->AddHeader(m_reply.frameHeader);
     replyPacket->AddHeader(m_reply.macHeader);
@@ -173,7 +165,60 @@ EndDeviceStatus::ReceivedPacketList
 EndDeviceStatus::GetReceivedPacketList() const
 {
     NS_LOG_FUNCTION_NOARGS();
-    return m_receivedPacketList;
+
+    ReceivedPacketList packetList;
+    for (uint32_t age = GetNReceivedPackets(); age > 0; age--)
+    {
+        packetList.push_back(m_receivedPackets[GetReceivedPacketIndex(age - 1)]);
+    }
+    return packetList;
+}
+
+uint32_t
+EndDeviceStatus::GetNReceivedPackets() const
+{
+    return m_receivedPackets.size();
+}
+
+void
+EndDeviceStatus::SetReceivedPacketHistorySize(uint32_t historySize)
+{
+    NS_LOG_FUNCTION(this << historySize);
+
+    NS_ASSERT_MSG(historySize > 0, "At least one received packet needs to be kept");
+
+    // Rebuild the ring with the most recent packets, from the oldest one
+    ReceivedPacketList packetList = GetReceivedPacketList();
+    while (packetList.size() > historySize)
+    {
+        packetList.pop_front();
+    }
+
+    m_receivedPacketHistorySize = historySize;
+    m_receivedPackets.assign(packetList.begin(), packetList.end());
+    m_receivedPackets.reserve(historySize);
+    m_nextReceivedPacket = m_receivedPackets.size() % historySize;
+    m_fCntIndex.clear();
+    for (std::size_t i = 0; i < m_receivedPackets.size(); i++)
+    {
+        m_fCntIndex[m_receivedPackets[i].second.fCnt] = i;
+    }
+}
+
+uint32_t
+EndDeviceStatus::GetReceivedPacketHistorySize() const
+{
+    return m_receivedPacketHistorySize;
+}
+
+std::size_t
+EndDeviceStatus::GetReceivedPacketIndex(uint32_t age) const
+{
+    NS_ASSERT(age < m_receivedPackets.size());
+
+    // The most recent packet is the one before the next write position
+    return (m_nextReceivedPacket + m_receivedPacketHistorySize - 1 - age) %
+           m_receivedPacketHistorySize;
 }
 
 void
@@ -230,24 +275,16 @@ EndDeviceStatus::SetReplyPayload(Ptr<Packet> replyPayload)
 ///////////////////////
 
 void
-EndDeviceStatus::InsertReceivedPacket(Ptr<const Packet> receivedPacket, const Address& gwAddress)
+EndDeviceStatus::InsertReceivedPacket(const UplinkContext& context)
 {
     NS_LOG_FUNCTION_NOARGS();
 
-    // Create a copy of the packet
-    Ptr<Packet> myPacket = receivedPacket->Copy();
-
-    // Extract the headers
-    LorawanMacHeader macHdr;
-    myPacket->RemoveHeader(macHdr);
-
-    LoraFrameHeader frameHdr;
-    frameHdr.SetAsUplink();
-    myPacket->RemoveHeader(frameHdr);
+    Ptr<const Packet> receivedPacket = context.packet;
+    const Address& gwAddress = context.gwAddress;
+    const LoraFrameHeader& frameHdr = context.frameHeader;
 
     // Update current parameters
-    LoraTag tag;
-    myPacket->RemovePacketTag(tag);
+    const LoraTag& tag = context.tag;
     SetFirstReceiveWindowSpreadingFactor(tag.GetSpreadingFactor());
     SetFirstReceiveWindowFrequency(tag.GetFrequency());
 
@@ -259,81 +296,100 @@ EndDeviceStatus::InsertReceivedPacket(Ptr<const Packet> receivedPacket, const Ad
 
     double rcvPower = tag.GetReceivePower();
 
-    // Perform insertion in list, also checking that the packet isn't already in
-    // the list (it could have been already received by another gateway)
+    // Perform insertion in the history, also checking that the packet isn't
+    // already there (it could have been already received by another gateway)
+    PacketInfoPerGw gwInfo;
+    gwInfo.receivedTime = Simulator::Now();
+    gwInfo.rxPower = rcvPower;
+    gwInfo.gwAddress = gwAddress;
 
-    // Start searching from the end
-    auto it = m_receivedPacketList.rbegin();
-    for (; it != m_receivedPacketList.rend(); it++)
+    auto it = m_fCntIndex.find(frameHdr.GetFCnt());
+    if (it != m_fCntIndex.end())
     {
-        // Get the frame counter of the current packet to compare it with the
-        // newly received one
-        Ptr<Packet> packetCopy = ((*it).first)->Copy();
-        LorawanMacHeader currentMacHdr;
-        packetCopy->RemoveHeader(currentMacHdr);
-        LoraFrameHeader currentFrameHdr;
-        frameHdr.SetAsUplink();
-        packetCopy->RemoveHeader(currentFrameHdr);
-
-        NS_LOG_DEBUG("Received packet's frame counter: " << unsigned(frameHdr.GetFCnt())
-                                                         << "\nCurrent packet's frame counter: "
-                                                         << unsigned(currentFrameHdr.GetFCnt()));
-
-        if (frameHdr.GetFCnt() == currentFrameHdr.GetFCnt())
-        {
-            NS_LOG_INFO("Packet was already received by another gateway");
+        NS_LOG_INFO("Packet was already received by another gateway");
 
-            // This packet had already been received from another gateway:
-            // add this gateway's reception information.
-            GatewayList& gwList = it->second.gwList;
+        // This packet had already been received from another gateway:
+        // add this gateway's reception information.
+        GatewayList& gwList = m_receivedPackets[it->second].second.gwList;
+        gwList.insert(std::pair<Address, PacketInfoPerGw>(gwAddress, gwInfo));
 
-            PacketInfoPerGw gwInfo;
-            gwInfo.receivedTime = Simulator::Now();
-            gwInfo.rxPower = rcvPower;
-            gwInfo.gwAddress = gwAddress;
-            gwList.insert(std::pair<Address, PacketInfoPerGw>(gwAddress, gwInfo));
+        NS_LOG_DEBUG("Size of gateway list: " << gwList.size());
 
-            NS_LOG_DEBUG("Size of gateway list: " << gwList.size());
-
-            break; // Exit from the cycle
+        // Only the gateways of the last packet are candidates for a reply
+        if (it->second == GetReceivedPacketIndex(0))
+        {
+            AddGatewayCandidate(rcvPower, context.gwIndex);
         }
     }
-    if (it == m_receivedPacketList.rend())
+    else
     {
         NS_LOG_INFO("Packet was received for the first time");
-        PacketInfoPerGw gwInfo;
-        gwInfo.receivedTime = Simulator::Now();
-        gwInfo.rxPower = rcvPower;
-        gwInfo.gwAddress = gwAddress;
+        info.fCnt = frameHdr.GetFCnt();
         info.gwList.insert(std::pair<Address, PacketInfoPerGw>(gwAddress, gwInfo));
-        m_receivedPacketList.emplace_back(receivedPacket, info);
+
+        std::size_t index = m_nextReceivedPacket;
+        if (m_receivedPackets.size() < m_receivedPacketHistorySize)
+        {
+            m_receivedPackets.emplace_back(receivedPacket, info);
+        }
+        else
+        {
+            // Overwrite the oldest packet
+            m_fCntIndex.erase(m_receivedPackets[index].second.fCnt);
+            m_receivedPackets[index] = std::make_pair(receivedPacket, info);
+        }
+        m_fCntIndex[info.fCnt] = index;
+        m_nextReceivedPacket = (index + 1) % m_receivedPacketHistorySize;
+
+        m_gatewayCandidates.clear();
+        AddGatewayCandidate(rcvPower, context.gwIndex);
+
+        m_lastUplink.fCnt = info.fCnt;
+        m_lastUplink.mType = LorawanMacHeader::MType(context.macHeader.GetMType());
+        m_lastUplink.adr = frameHdr.GetAdr();
+        m_lastUplink.commands = 0;
+        for (const auto& command : frameHdr.GetCommands())
+        {
+            m_lastUplink.commands |= 1U << command->GetCommandType();
+        }
     }
     NS_LOG_DEBUG(*this);
 }
 
-EndDeviceStatus::ReceivedPacketInfo
-EndDeviceStatus::GetLastReceivedPacketInfo()
+const EndDeviceStatus::ReceivedPacketInfo&
+EndDeviceStatus::GetLastReceivedPacketInfo() const
 {
     NS_LOG_FUNCTION_NOARGS();
-    auto it = m_receivedPacketList.rbegin();
-    if (it != m_receivedPacketList.rend())
+    if (!m_receivedPackets.empty())
     {
-        return it->second;
+        return m_receivedPackets[GetReceivedPacketIndex(0)].second;
     }
     else
     {
-        return EndDeviceStatus::ReceivedPacketInfo();
+        static const EndDeviceStatus::ReceivedPacketInfo noPacket;
+        return noPacket;
     }
 }
 
+const EndDeviceStatus::LastUplinkFields&
+EndDeviceStatus::GetLastUplinkFields() const
+{
+    return m_lastUplink;
+}
+
+bool
+EndDeviceStatus::LastUplinkFields::HasCommand(MacCommandType command) const
+{
+    return commands & (1U << command);
+}
+
 Ptr<const Packet>
 EndDeviceStatus::GetLastPacketReceivedFromDevice()
 {
     NS_LOG_FUNCTION_NOARGS();
-    auto it = m_receivedPacketList.rbegin();
-    if (it != m_receivedPacketList.rend())
+    if (!m_receivedPackets.empty())
     {
-        return it->first;
+        return m_receivedPackets[GetReceivedPacketIndex(0)].first;
     }
     else
     {
@@ -358,7 +414,7 @@ EndDeviceStatus::AddMACCommand(Ptr<MacCommand> macCommand)
 bool
 EndDeviceStatus::HasReceiveWindowOpportunityScheduled()
 {
-    return m_receiveWindowEvent.IsPending();
+    return m_receiveWindowQueued || m_receiveWindowEvent.IsPending();
 }
 
 void
@@ -367,10 +423,38 @@ EndDeviceStatus::SetReceiveWindowOpportunity(EventId event)
     m_receiveWindowEvent = event;
 }
 
+uint32_t
+EndDeviceStatus::SetReceiveWindowOpportunity(Callback<void> removedCallback)
+{
+    // The previous opportunity, if any, is replaced
+    if (m_receiveWindowQueued && !m_receiveWindowRemoved.IsNull())
+    {
+        m_receiveWindowRemoved();
+    }
+    m_receiveWindowQueued = true;
+    m_receiveWindowRemoved = removedCallback;
+    return ++m_receiveWindowTicket;
+}
+
+bool
+EndDeviceStatus::IsReceiveWindowOpportunityValid(uint32_t ticket) const
+{
+    return m_receiveWindowQueued && ticket == m_receiveWindowTicket;
+}
+
 void
 EndDeviceStatus::RemoveReceiveWindowOpportunity()
 {
     Simulator::Cancel(m_receiveWindowEvent);
+    if (m_receiveWindowQueued)
+    {
+        m_receiveWindowQueued = false;
+        if (!m_receiveWindowRemoved.IsNull())
+        {
+            m_receiveWindowRemoved();
+        }
+        m_receiveWindowRemoved = MakeNullCallback<void>();
+    }
 }
 
 std::map<double, Address>
@@ -379,8 +463,7 @@ EndDeviceStatus::GetPowerGatewayMap()
     // Create a map of the gateways
     // Key: received power
     // Value: address of the corresponding gateway
-    ReceivedPacketInfo info = m_receivedPacketList.back().second;
-    GatewayList gwList = info.gwList;
+    const GatewayList& gwList = m_receivedPackets[GetReceivedPacketIndex(0)].second.gwList;
 
     std::map<double, Address> gatewayPowers;
 
@@ -394,12 +477,43 @@ EndDeviceStatus::GetPowerGatewayMap()
     return gatewayPowers;
 }
 
+const std::vector<EndDeviceStatus::GatewayCandidate>&
+EndDeviceStatus::GetGatewayCandidates() const
+{
+    return m_gatewayCandidates;
+}
+
+void
+EndDeviceStatus::AddGatewayCandidate(double rxPower, uint32_t gwIndex)
+{
+    NS_LOG_FUNCTION(this << rxPower << gwIndex);
+
+    // A gateway may forward the same packet more than once
+    for (const auto& candidate : m_gatewayCandidates)
+    {
+        if (candidate.gwIndex == gwIndex)
+        {
+            return;
+        }
+    }
+
+    // Insert after the gateways with a higher or equal power
+    auto it = std::upper_bound(m_gatewayCandidates.begin(),
+                               m_gatewayCandidates.end(),
+                               rxPower,
+                               [](double power, const GatewayCandidate& candidate) {
+                                   return power > candidate.rxPower;
+                               });
+    m_gatewayCandidates.insert(it, {rxPower, gwIndex});
+}
+
 std::ostream&
 operator<<(std::ostream& os, const EndDeviceStatus& status)
 {
-    os << "Total packets received: " << status.m_receivedPacketList.size() << std::endl;
+    EndDeviceStatus::ReceivedPacketList packetList = status.GetReceivedPacketList();
+    os << "Total packets received: " << packetList.size() << std::endl;
 
-    for (auto j = status.m_receivedPacketList.begin(); j != status.m_receivedPacketList.end(); j++)
+    for (auto j = packetList.begin(); j != packetList.end(); j++)
     {
         EndDeviceStatus::ReceivedPacketInfo info = (*j).second;
         EndDeviceStatus::GatewayList gatewayList = info.gwList;
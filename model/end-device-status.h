@@ -14,18 +14,25 @@
 #include "lora-device-address.h"
 #include "lora-frame-header.h"
 #include "lora-net-device.h"
+#include "lora-tag.h"
 #include "lorawan-mac-header.h"
 
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "ns3/pointer.h"
 
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
 namespace lorawan
 {
 
+struct UplinkContext;
+
 /**
  * \ingroup lorawan
  *
@@ -60,13 +67,20 @@ namespace lorawan
  *
  * Private Access:
  *
- *  (Received packets list) - List of gateways that received the packet (see below)
+ *  (Received packets list) - Frame counter of the packet
+ *                          - List of gateways that received the packet (see below)
  *                          - Spreading Factor (SF) of the received packet
  *                          - Frequency of the received packet
  *                          - Bandwidth of the received packet
  *
  *  (Gateway list) - Time at which the packet was received
  *                 - Reception power
+ *
+ * Only the most recent received packets are kept, in a ring whose capacity is
+ * set with SetReceivedPacketHistorySize, so that the memory used by each
+ * instance does not grow with the simulation length. Packets are also indexed by
+ * their frame counter, in order to quickly find the packet a copy forwarded by
+ * another gateway belongs to.
  */
 class EndDeviceStatus : public Object
 {
@@ -153,6 +167,7 @@ class EndDeviceStatus : public Object
         // Members
         Ptr<const Packet> packet = nullptr; //!< The received packet
         GatewayList gwList;                 //!< List of gateways that received this packet
+        uint16_t fCnt = 0;                  //!< Frame counter of this packet
         uint8_t sf;                         //!< Spreading factor used to send this packet
         double frequency;                   //!< Carrier frequency [MHz] used to send this packet
     };
@@ -162,6 +177,31 @@ class EndDeviceStatus : public Object
      */
     typedef std::list<std::pair<Ptr<const Packet>, ReceivedPacketInfo>> ReceivedPacketList;
 
+    /**
+     * The fields of the last received packet a reply depends on, decoded once
+     * when the packet is inserted so that the packet does not need to be
+     * parsed again to assemble the reply.
+     */
+    struct LastUplinkFields
+    {
+        uint16_t fCnt = 0;     //!< Frame counter of the packet
+        bool adr = false;      //!< Whether the ADR bit of the packet was set
+        uint32_t commands = 0; //!< Bitmask of the types of the MAC commands of the packet
+
+        /**
+         * Message type of the packet.
+         */
+        LorawanMacHeader::MType mType = LorawanMacHeader::UNCONFIRMED_DATA_UP;
+
+        /**
+         * Check whether the packet carried a MAC command of a given type.
+         *
+         * \param command The type of MAC command.
+         * \return True if the packet carried a command of that type.
+         */
+        bool HasCommand(MacCommandType command) const;
+    };
+
     /*******************************************/
     /* Proper EndDeviceStatus class definition */
     /*******************************************/
@@ -214,12 +254,34 @@ class EndDeviceStatus : public Object
     double GetSecondReceiveWindowFrequency() const;
 
     /**
-     * Get the received packet list.
+     * Get the received packet list, from the oldest to the most recent packet.
      *
      * \return The received packet list.
      */
     ReceivedPacketList GetReceivedPacketList() const;
 
+    /**
+     * Get the number of packets currently kept in the received packet history.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetNReceivedPackets() const;
+
+    /**
+     * Set the maximum number of received packets to keep. If packets in excess
+     * are already stored, the oldest ones are discarded.
+     *
+     * \param historySize The number of packets, at least one.
+     */
+    void SetReceivedPacketHistorySize(uint32_t historySize);
+
+    /**
+     * Get the maximum number of received packets to keep.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetReceivedPacketHistorySize() const;
+
     /**
      * Set the spreading factor this device is using in the first receive window.
      *
@@ -283,10 +345,9 @@ class EndDeviceStatus : public Object
     /**
      * Insert a received packet in the packet list.
      *
-     * \param receivedPacket The packet received.
-     * \param gwAddress The address of the receiver gateway.
+     * \param context The decoded packet and the address of the receiver gateway.
      */
-    void InsertReceivedPacket(Ptr<const Packet> receivedPacket, const Address& gwAddress);
+    void InsertReceivedPacket(const UplinkContext& context);
 
     /**
      * Return the last packet that was received from this device.
@@ -301,7 +362,15 @@ class EndDeviceStatus : public Object
      *
      * \return The information about the last received packet.
      */
-    EndDeviceStatus::ReceivedPacketInfo GetLastReceivedPacketInfo();
+    const EndDeviceStatus::ReceivedPacketInfo& GetLastReceivedPacketInfo() const;
+
+    /**
+     * Return the fields of the last packet that was received from the device
+     * a reply depends on.
+     *
+     * \return The fields of the last received packet.
+     */
+    const LastUplinkFields& GetLastUplinkFields() const;
 
     /**
      * Reset the next reply state.
@@ -329,6 +398,26 @@ class EndDeviceStatus : public Object
      */
     void SetReceiveWindowOpportunity(EventId event);
 
+    /**
+     * Mark a reception window opportunity as scheduled without a simulator
+     * event, e.g., in a queue of the NetworkScheduler.
+     *
+     * \param removedCallback Called once when the opportunity is removed or
+     * replaced by another one.
+     * \return A ticket identifying the opportunity, that is no longer valid
+     * once the opportunity is removed or another one is scheduled.
+     */
+    uint32_t SetReceiveWindowOpportunity(Callback<void> removedCallback);
+
+    /**
+     * Check whether a reception window opportunity scheduled without a
+     * simulator event is still valid.
+     *
+     * \param ticket The ticket returned when the opportunity was scheduled.
+     * \return True if the opportunity is still scheduled, false otherwise.
+     */
+    bool IsReceiveWindowOpportunityValid(uint32_t ticket) const;
+
     /**
      * Cancel next scheduled reception window event.
      */
@@ -342,6 +431,27 @@ class EndDeviceStatus : public Object
      */
     std::map<double, Address> GetPowerGatewayMap();
 
+    /**
+     * A gateway that received the last packet from the end device.
+     */
+    struct GatewayCandidate
+    {
+        double rxPower;   //!< The reception power of the packet at the gateway [dBm]
+        uint32_t gwIndex; //!< The index of the gateway in the NetworkStatus
+    };
+
+    /**
+     * Get the gateways which received the last packet from the end device, by
+     * decreasing reception power. Gateways with the same reception power are
+     * sorted by the arrival time of their copy.
+     *
+     * The array is kept sorted as copies of the packet arrive, so that no
+     * allocation is needed when selecting a gateway for a reply.
+     *
+     * \return The gateways.
+     */
+    const std::vector<GatewayCandidate>& GetGatewayCandidates() const;
+
     struct Reply m_reply;                 //!< Next reply intended for this device
     LoraDeviceAddress m_endDeviceAddress; //!< The address of this device
 
@@ -361,13 +471,73 @@ class EndDeviceStatus : public Object
     uint8_t m_secondReceiveWindowSpreadingFactor = 0; //!< Spreading Factor (SF) for RX2 window.
     double m_secondReceiveWindowFrequency = 869.525;  //!< Frequency [MHz] for RX2 window
     EventId m_receiveWindowEvent; //!< Event storing the next scheduled downlink transmission
+    bool m_receiveWindowQueued = false; //!< Whether an opportunity is scheduled without an event
+    uint32_t m_receiveWindowTicket = 0; //!< Ticket of the last opportunity without an event
+    Callback<void> m_receiveWindowRemoved; //!< Called when that opportunity is removed
 
-    ReceivedPacketList m_receivedPacketList; //!< List of received packets
+    /**
+     * Get the position in m_receivedPackets of a packet in the history.
+     *
+     * \param age The age of the packet, 0 being the most recent one.
+     * \return The index of the packet.
+     */
+    std::size_t GetReceivedPacketIndex(uint32_t age) const;
+
+    /**
+     * Ring of the most recently received packets, paired to their reception
+     * info. Up to m_receivedPacketHistorySize packets are stored, the next one
+     * being written at m_nextReceivedPacket.
+     */
+    std::vector<std::pair<Ptr<const Packet>, ReceivedPacketInfo>> m_receivedPackets;
+    std::size_t m_nextReceivedPacket = 0;     //!< Position of the next packet in the ring
+    uint32_t m_receivedPacketHistorySize = 1; //!< Capacity of the ring
+
+    /**
+     * Position in m_receivedPackets of the packets in the history, by frame
+     * counter.
+     */
+    std::unordered_map<uint16_t, std::size_t> m_fCntIndex;
+
+    LastUplinkFields m_lastUplink; //!< The fields of the last received packet
+
+    /**
+     * Gateways which received the last packet, by decreasing reception power.
+     */
+    std::vector<GatewayCandidate> m_gatewayCandidates;
+
+    /**
+     * Add a gateway which received the last packet to m_gatewayCandidates.
+     *
+     * \param rxPower The reception power [dBm].
+     * \param gwIndex The index of the gateway in the NetworkStatus.
+     */
+    void AddGatewayCandidate(double rxPower, uint32_t gwIndex);
 
     /// \note Using this attribute is 'cheating', since we are assuming perfect
     /// synchronization between the info at the device and at the network server
     Ptr<ClassAEndDeviceLorawanMac> m_mac; //!< Pointer to the MAC layer of this device
 };
+
+/**
+ * \ingroup lorawan
+ *
+ * The information decoded from an uplink packet as it is received by the
+ * NetworkServer. It is created once for each packet forwarded by a gateway,
+ * and passed to the NetworkServer's scheduler, status and controller
+ * components, so that headers do not need to be parsed again by each of them.
+ */
+struct UplinkContext
+{
+    Ptr<const Packet> packet;             //!< The packet, as forwarded by the gateway
+    LorawanMacHeader macHeader;           //!< The MAC header of the packet
+    LoraFrameHeader frameHeader;          //!< The frame header of the packet
+    LoraTag tag;                          //!< The reception information of the packet
+    Address gwAddress;                    //!< The address of the forwarding gateway
+    Ptr<EndDeviceStatus> endDeviceStatus; //!< The status of the device that sent the packet
+    Time receptionTime;                   //!< The time the packet reached the server
+    uint32_t gwIndex = 0;                 //!< The index of the gateway in the NetworkStatus
+};
+
 } // namespace lorawan
 
 } // namespace ns3
@@ -11,6 +11,10 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace ns3
 {
 namespace lorawan
@@ -29,10 +33,14 @@ LogicalLoraChannelHelper::GetTypeId()
 }
 
 LogicalLoraChannelHelper::LogicalLoraChannelHelper()
-    : m_nextAggregatedTransmissionTime(Seconds(0)),
+    : m_plan(Create<ChannelPlan>()),
+      m_nextAggregatedTransmissionNs(0),
       m_aggregatedDutyCycle(1)
 {
     NS_LOG_FUNCTION(this);
+
+    m_nextSubBandTransmissionNs.fill(0);
+    m_subBandAirtimeNs.fill(0);
 }
 
 LogicalLoraChannelHelper::~LogicalLoraChannelHelper()
@@ -40,67 +48,81 @@ LogicalLoraChannelHelper::~LogicalLoraChannelHelper()
     NS_LOG_FUNCTION(this);
 }
 
-std::vector<Ptr<LogicalLoraChannel>>
-LogicalLoraChannelHelper::GetChannelList()
+std::vector<Ptr<const LogicalLoraChannel>>
+LogicalLoraChannelHelper::GetChannelList() const
 {
     NS_LOG_FUNCTION(this);
 
-    // Make a copy of the channel vector
-    std::vector<Ptr<LogicalLoraChannel>> vector;
-    vector.reserve(m_channelList.size());
-    std::copy(m_channelList.begin(), m_channelList.end(), std::back_inserter(vector));
+    // Make a read-only copy of the channel vector
+    std::vector<Ptr<const LogicalLoraChannel>> vector;
+    vector.reserve(m_plan->channels.size());
+    std::copy(m_plan->channels.begin(), m_plan->channels.end(), std::back_inserter(vector));
 
     return vector;
 }
 
-std::vector<Ptr<LogicalLoraChannel>>
-LogicalLoraChannelHelper::GetEnabledChannelList()
+std::vector<Ptr<const LogicalLoraChannel>>
+LogicalLoraChannelHelper::GetEnabledChannelList() const
 {
     NS_LOG_FUNCTION(this);
 
-    // Make a copy of the channel vector
-    std::vector<Ptr<LogicalLoraChannel>> vector;
-    vector.reserve(m_channelList.size());
-    std::copy(m_channelList.begin(),
-              m_channelList.end(),
-              std::back_inserter(vector)); // Working on a copy
-
-    std::vector<Ptr<LogicalLoraChannel>> channels;
-    std::vector<Ptr<LogicalLoraChannel>>::iterator it;
-    for (it = vector.begin(); it != vector.end(); it++)
+    // Make a read-only copy of the enabled channels
+    std::vector<Ptr<const LogicalLoraChannel>> channels;
+    for (const auto& channel : m_plan->channels)
     {
-        if ((*it)->IsEnabledForUplink())
+        if (channel->IsEnabledForUplink())
         {
-            channels.push_back(*it);
+            channels.push_back(channel);
         }
     }
 
     return channels;
 }
 
-Ptr<SubBand>
-LogicalLoraChannelHelper::GetSubBandFromChannel(Ptr<LogicalLoraChannel> channel)
+Ptr<const SubBand>
+LogicalLoraChannelHelper::GetSubBandFromChannel(Ptr<const LogicalLoraChannel> channel) const
 {
     return GetSubBandFromFrequency(channel->GetFrequency());
 }
 
-Ptr<SubBand>
-LogicalLoraChannelHelper::GetSubBandFromFrequency(double frequency)
+Ptr<const SubBand>
+LogicalLoraChannelHelper::GetSubBandFromFrequency(double frequency) const
+{
+    return m_plan->subBands.at(GetSubBandIndexFromFrequency(frequency));
+}
+
+std::size_t
+LogicalLoraChannelHelper::GetSubBandIndexFromFrequency(double frequency) const
 {
     // Get the SubBand this frequency belongs to
-    std::list<Ptr<SubBand>>::iterator it;
-    for (it = m_subBandList.begin(); it != m_subBandList.end(); it++)
+    for (std::size_t i = 0; i < m_plan->subBands.size(); i++)
     {
-        if ((*it)->BelongsToSubBand(frequency))
+        if (m_plan->subBands[i]->BelongsToSubBand(frequency))
         {
-            return *it;
+            return i;
         }
     }
 
     NS_LOG_ERROR("Requested frequency: " << frequency);
     NS_ABORT_MSG("Warning: frequency is outside any known SubBand.");
 
-    return nullptr; // If no SubBand is found, return 0
+    return 0;
+}
+
+std::vector<Ptr<const SubBand>>
+LogicalLoraChannelHelper::GetSubBandList() const
+{
+    NS_LOG_FUNCTION(this);
+
+    return std::vector<Ptr<const SubBand>>(m_plan->subBands.begin(), m_plan->subBands.end());
+}
+
+Time
+LogicalLoraChannelHelper::GetSubBandAirtime(std::size_t index) const
+{
+    NS_ABORT_MSG_IF(index >= m_plan->subBands.size(), "Unknown SubBand " << index);
+
+    return NanoSeconds(m_subBandAirtimeNs[index]);
 }
 
 void
@@ -112,9 +134,11 @@ LogicalLoraChannelHelper::AddChannel(double frequency)
     Ptr<LogicalLoraChannel> channel = Create<LogicalLoraChannel>(frequency);
 
     // Add it to the list
-    m_channelList.push_back(channel);
+    DetachChannelPlan();
+    m_plan->channels.push_back(channel);
 
-    NS_LOG_DEBUG("Added a channel. Current number of channels in list is " << m_channelList.size());
+    NS_LOG_DEBUG("Added a channel. Current number of channels in list is "
+                 << m_plan->channels.size());
 }
 
 void
@@ -123,7 +147,8 @@ LogicalLoraChannelHelper::AddChannel(Ptr<LogicalLoraChannel> logicalChannel)
     NS_LOG_FUNCTION(this << logicalChannel);
 
     // Add it to the list
-    m_channelList.push_back(logicalChannel);
+    DetachChannelPlan();
+    m_plan->channels.push_back(logicalChannel);
 }
 
 void
@@ -132,7 +157,8 @@ LogicalLoraChannelHelper::SetChannel(uint8_t chIndex, Ptr<LogicalLoraChannel> lo
 {
     NS_LOG_FUNCTION(this << chIndex << logicalChannel);
 
-    m_channelList.at(chIndex) = logicalChannel;
+    DetachChannelPlan();
+    m_plan->channels.at(chIndex) = logicalChannel;
 }
 
 void
@@ -145,7 +171,7 @@ LogicalLoraChannelHelper::AddSubBand(double firstFrequency,
 
     Ptr<SubBand> subBand = Create<SubBand>(firstFrequency, lastFrequency, dutyCycle, maxTxPowerDbm);
 
-    m_subBandList.push_back(subBand);
+    AddSubBand(subBand);
 }
 
 void
@@ -153,20 +179,26 @@ LogicalLoraChannelHelper::AddSubBand(Ptr<SubBand> subBand)
 {
     NS_LOG_FUNCTION(this << subBand);
 
-    m_subBandList.push_back(subBand);
+    NS_ABORT_MSG_IF(m_plan->subBands.size() >= MAX_SUB_BANDS,
+                    "Cannot register more than " << MAX_SUB_BANDS << " SubBands.");
+
+    DetachChannelPlan();
+    m_nextSubBandTransmissionNs[m_plan->subBands.size()] = 0;
+    m_subBandAirtimeNs[m_plan->subBands.size()] = 0;
+    m_plan->subBands.push_back(subBand);
 }
 
 void
 LogicalLoraChannelHelper::RemoveChannel(Ptr<LogicalLoraChannel> logicalChannel)
 {
     // Search and remove the channel from the list
-    std::vector<Ptr<LogicalLoraChannel>>::iterator it;
-    for (it = m_channelList.begin(); it != m_channelList.end(); it++)
+    for (std::size_t i = 0; i < m_plan->channels.size(); i++)
     {
-        Ptr<LogicalLoraChannel> currentChannel = *it;
+        Ptr<LogicalLoraChannel> currentChannel = m_plan->channels[i];
         if (currentChannel == logicalChannel)
         {
-            m_channelList.erase(it);
+            DetachChannelPlan();
+            m_plan->channels.erase(m_plan->channels.begin() + i);
             return;
         }
     }
@@ -175,11 +207,9 @@ LogicalLoraChannelHelper::RemoveChannel(Ptr<LogicalLoraChannel> logicalChannel)
 Time
 LogicalLoraChannelHelper::GetAggregatedWaitingTime()
 {
-    // Aggregate waiting time
-    Time aggregatedWaitingTime = m_nextAggregatedTransmissionTime - Simulator::Now();
-
-    // Handle case in which waiting time is negative
-    aggregatedWaitingTime = Seconds(std::max(aggregatedWaitingTime.GetSeconds(), double(0)));
+    // Aggregate waiting time, handling the case in which it is negative
+    Time aggregatedWaitingTime = NanoSeconds(
+        std::max<int64_t>(m_nextAggregatedTransmissionNs - Simulator::Now().GetNanoSeconds(), 0));
 
     NS_LOG_DEBUG("Aggregated waiting time: " << aggregatedWaitingTime.GetSeconds());
 
@@ -187,61 +217,124 @@ LogicalLoraChannelHelper::GetAggregatedWaitingTime()
 }
 
 Time
-LogicalLoraChannelHelper::GetWaitingTime(Ptr<LogicalLoraChannel> channel)
+LogicalLoraChannelHelper::GetWaitingTime(Ptr<const LogicalLoraChannel> channel)
 {
     NS_LOG_FUNCTION(this << channel);
 
-    // SubBand waiting time
-    Time subBandWaitingTime =
-        GetSubBandFromChannel(channel)->GetNextTransmissionTime() - Simulator::Now();
-
-    // Handle case in which waiting time is negative
-    subBandWaitingTime = Seconds(std::max(subBandWaitingTime.GetSeconds(), double(0)));
+    // SubBand waiting time, handling the case in which it is negative
+    std::size_t index = GetSubBandIndexFromFrequency(channel->GetFrequency());
+    Time subBandWaitingTime = NanoSeconds(
+        std::max<int64_t>(m_nextSubBandTransmissionNs[index] - Simulator::Now().GetNanoSeconds(),
+                          0));
 
     NS_LOG_DEBUG("Waiting time: " << subBandWaitingTime.GetSeconds());
 
     return subBandWaitingTime;
 }
 
+Time
+LogicalLoraChannelHelper::GetNextTransmissionTime()
+{
+    NS_LOG_FUNCTION(this);
+
+    // Earliest time any of the SubBands of the enabled channels frees up
+    int64_t nextTransmissionNs = std::numeric_limits<int64_t>::max();
+    for (const auto& channel : m_plan->channels)
+    {
+        if (channel->IsEnabledForUplink())
+        {
+            std::size_t index = GetSubBandIndexFromFrequency(channel->GetFrequency());
+            nextTransmissionNs = std::min(nextTransmissionNs, m_nextSubBandTransmissionNs[index]);
+        }
+    }
+
+    if (nextTransmissionNs == std::numeric_limits<int64_t>::max())
+    {
+        NS_LOG_DEBUG("No channel is enabled for uplink.");
+        return Time::Max();
+    }
+
+    // The aggregated timer applies on top of the SubBand ones
+    nextTransmissionNs = std::max(nextTransmissionNs, m_nextAggregatedTransmissionNs);
+
+    NS_LOG_DEBUG("Next transmission allowed at time: "
+                 << NanoSeconds(nextTransmissionNs).GetSeconds());
+
+    return NanoSeconds(nextTransmissionNs);
+}
+
 void
-LogicalLoraChannelHelper::AddEvent(Time duration, Ptr<LogicalLoraChannel> channel)
+LogicalLoraChannelHelper::SetAggregatedDutyCycle(double aggregatedDutyCycle)
+{
+    NS_LOG_FUNCTION(this << aggregatedDutyCycle);
+
+    NS_ASSERT_MSG(0 < aggregatedDutyCycle && aggregatedDutyCycle <= 1,
+                  "The aggregated duty cycle must be in (0, 1].");
+
+    m_aggregatedDutyCycle = aggregatedDutyCycle;
+}
+
+double
+LogicalLoraChannelHelper::GetAggregatedDutyCycle() const
+{
+    return m_aggregatedDutyCycle;
+}
+
+int64_t
+LogicalLoraChannelHelper::GetOffTimeNs(int64_t durationNs, double dutyCycle)
+{
+    // Regional duty cycles (and those set by DutyCycleReq) are the inverse of
+    // an integer: in this case, the off time is computed exactly.
+    double inverse = 1 / dutyCycle;
+    double roundedInverse = std::round(inverse);
+    if (std::abs(inverse - roundedInverse) < 1e-9 * inverse)
+    {
+        return durationNs * (static_cast<int64_t>(roundedInverse) - 1);
+    }
+
+    return std::llround(durationNs * (inverse - 1));
+}
+
+void
+LogicalLoraChannelHelper::AddEvent(Time duration, Ptr<const LogicalLoraChannel> channel)
 {
     NS_LOG_FUNCTION(this << duration << channel);
 
-    Ptr<SubBand> subBand = GetSubBandFromChannel(channel);
+    std::size_t index = GetSubBandIndexFromFrequency(channel->GetFrequency());
+    Ptr<SubBand> subBand = m_plan->subBands[index];
+
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    int64_t timeOnAirNs = duration.GetNanoSeconds();
 
-    double dutyCycle = subBand->GetDutyCycle();
-    double timeOnAir = duration.GetSeconds();
+    m_subBandAirtimeNs[index] += timeOnAirNs;
 
     // Computation of necessary waiting time on this sub-band
-    subBand->SetNextTransmissionTime(Simulator::Now() + Seconds(timeOnAir / dutyCycle - timeOnAir));
+    m_nextSubBandTransmissionNs[index] = nowNs + GetOffTimeNs(timeOnAirNs, subBand->GetDutyCycle());
 
     // Computation of necessary aggregate waiting time
-    m_nextAggregatedTransmissionTime =
-        Simulator::Now() + Seconds(timeOnAir / m_aggregatedDutyCycle - timeOnAir);
+    m_nextAggregatedTransmissionNs = nowNs + GetOffTimeNs(timeOnAirNs, m_aggregatedDutyCycle);
 
-    NS_LOG_DEBUG("Time on air: " << timeOnAir);
+    NS_LOG_DEBUG("Time on air: " << duration.GetSeconds());
     NS_LOG_DEBUG("m_aggregatedDutyCycle: " << m_aggregatedDutyCycle);
     NS_LOG_DEBUG("Current time: " << Simulator::Now().GetSeconds());
     NS_LOG_DEBUG("Next transmission on this sub-band allowed at time: "
-                 << (subBand->GetNextTransmissionTime()).GetSeconds());
+                 << NanoSeconds(m_nextSubBandTransmissionNs[index]).GetSeconds());
     NS_LOG_DEBUG("Next aggregated transmission allowed at time "
-                 << m_nextAggregatedTransmissionTime.GetSeconds());
+                 << NanoSeconds(m_nextAggregatedTransmissionNs).GetSeconds());
 }
 
 double
-LogicalLoraChannelHelper::GetTxPowerForChannel(Ptr<LogicalLoraChannel> logicalChannel)
+LogicalLoraChannelHelper::GetTxPowerForChannel(Ptr<const LogicalLoraChannel> logicalChannel) const
 {
     NS_LOG_FUNCTION_NOARGS();
 
     // Get the maxTxPowerDbm from the SubBand this channel is in
-    std::list<Ptr<SubBand>>::iterator it;
-    for (it = m_subBandList.begin(); it != m_subBandList.end(); it++)
+    for (const auto& subBand : m_plan->subBands)
     {
         // Check whether this channel is in this SubBand
-        if ((*it)->BelongsToSubBand(logicalChannel->GetFrequency()))
+        if (subBand->BelongsToSubBand(logicalChannel->GetFrequency()))
         {
-            return (*it)->GetMaxTxPowerDbm();
+            return subBand->GetMaxTxPowerDbm();
         }
     }
     NS_ABORT_MSG("Logical channel doesn't belong to a known SubBand");
@@ -254,7 +347,64 @@ LogicalLoraChannelHelper::DisableChannel(int index)
 {
     NS_LOG_FUNCTION(this << index);
 
-    m_channelList.at(index)->DisableForUplink();
+    if (!m_plan->channels.at(index)->IsEnabledForUplink())
+    {
+        return;
+    }
+
+    DetachChannelPlan();
+    m_plan->channels.at(index)->DisableForUplink();
+}
+
+void
+LogicalLoraChannelHelper::EnableChannel(int index)
+{
+    NS_LOG_FUNCTION(this << index);
+
+    if (m_plan->channels.at(index)->IsEnabledForUplink())
+    {
+        return;
+    }
+
+    DetachChannelPlan();
+    m_plan->channels.at(index)->SetEnabledForUplink();
+}
+
+bool
+LogicalLoraChannelHelper::SharesChannelPlanWith(const LogicalLoraChannelHelper& other) const
+{
+    return m_plan == other.m_plan;
+}
+
+void
+LogicalLoraChannelHelper::DetachChannelPlan()
+{
+    if (m_plan->GetReferenceCount() == 1)
+    {
+        return;
+    }
+
+    NS_LOG_DEBUG("Copying the shared channel plan");
+
+    // SubBands are never modified once registered, so they can stay shared,
+    // while channels can be enabled and disabled and need to be copied
+    Ptr<ChannelPlan> plan = Create<ChannelPlan>();
+    plan->subBands = m_plan->subBands;
+    plan->channels.reserve(m_plan->channels.size());
+    for (const auto& channel : m_plan->channels)
+    {
+        Ptr<LogicalLoraChannel> copy =
+            CreateObject<LogicalLoraChannel>(channel->GetFrequency(),
+                                             channel->GetMinimumDataRate(),
+                                             channel->GetMaximumDataRate());
+        if (!channel->IsEnabledForUplink())
+        {
+            copy->DisableForUplink();
+        }
+        plan->channels.push_back(copy);
+    }
+
+    m_plan = plan;
 }
 } // namespace lorawan
 } // namespace ns3
@@ -15,9 +15,11 @@
 #include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "ns3/packet.h"
+#include "ns3/simple-ref-count.h"
 
+#include <array>
+#include <cstdint>
 #include <iterator>
-#include <list>
 #include <vector>
 
 namespace ns3
@@ -32,9 +34,18 @@ namespace lorawan
  * channels that the device is supposed to be using, and establishes their
  * relationship with SubBands.
  *
- * This class also takes into account duty cycle limitations, by updating a list
- * of SubBand objects and providing methods to query whether transmission on a
- * set channel is admissible or not.
+ * This class also takes into account duty cycle limitations, by keeping track
+ * of the next time transmission is allowed on each SubBand and according to the
+ * aggregated duty cycle, and providing methods to query whether transmission on
+ * a set channel is admissible or not.
+ *
+ * The channels and SubBands, which are usually the same for all devices of a
+ * region, are kept in a channel plan that is shared among copies of the helper
+ * and never modified while shared: only duty cycle timers are stored per copy.
+ * Changes to the channels or SubBands (e.g., following a NewChannelReq or a
+ * LinkAdrReq) make the modified copy take its own plan first. For this reason,
+ * the channels and SubBands obtained from this helper are read-only, and duty
+ * cycle timers are only available through the helper.
  */
 class LogicalLoraChannelHelper : public Object
 {
@@ -68,7 +79,34 @@ class LogicalLoraChannelHelper : public Object
      * \return A Time instance containing the waiting time before transmission is.
      * allowed on the channel.
      */
-    Time GetWaitingTime(Ptr<LogicalLoraChannel> channel);
+    Time GetWaitingTime(Ptr<const LogicalLoraChannel> channel);
+
+    /**
+     * Get the earliest time at which transmission will be allowed on at least
+     * one of the channels enabled for uplink, taking into account both the
+     * SubBand and the aggregated duty cycle limitations.
+     *
+     * The returned time can be in the past, meaning that transmission is
+     * allowed right away.
+     *
+     * \return The absolute time of the next admissible transmission, or
+     * Time::Max () if no channel is enabled for uplink.
+     */
+    Time GetNextTransmissionTime();
+
+    /**
+     * Set the aggregated duty cycle, enforced across all SubBands.
+     *
+     * \param aggregatedDutyCycle The aggregated duty cycle, in fractional form.
+     */
+    void SetAggregatedDutyCycle(double aggregatedDutyCycle);
+
+    /**
+     * Get the aggregated duty cycle, enforced across all SubBands.
+     *
+     * \return The aggregated duty cycle, in fractional form.
+     */
+    double GetAggregatedDutyCycle() const;
 
     /**
      * Register the transmission of a packet.
@@ -76,14 +114,26 @@ class LogicalLoraChannelHelper : public Object
      * \param duration The duration of the transmission event.
      * \param channel The channel the transmission was made on.
      */
-    void AddEvent(Time duration, Ptr<LogicalLoraChannel> channel);
+    void AddEvent(Time duration, Ptr<const LogicalLoraChannel> channel);
+
+    /**
+     * Compute the time transmission is forbidden for after a transmission.
+     *
+     * Duty cycles that are the inverse of an integer, as regional ones, give
+     * an exact result.
+     *
+     * \param durationNs The duration of the transmission [ns].
+     * \param dutyCycle The duty cycle to enforce, in fractional form.
+     * \return The off time following the transmission [ns].
+     */
+    static int64_t GetOffTimeNs(int64_t durationNs, double dutyCycle);
 
     /**
      * Get the list of LogicalLoraChannels currently registered on this helper.
      *
      * \return A list of the managed channels.
      */
-    std::vector<Ptr<LogicalLoraChannel>> GetChannelList();
+    std::vector<Ptr<const LogicalLoraChannel>> GetChannelList() const;
 
     /**
      * Get the list of LogicalLoraChannels currently registered on this helper
@@ -91,7 +141,22 @@ class LogicalLoraChannelHelper : public Object
      *
      * \return A list of the managed channels enabled for Uplink transmission.
      */
-    std::vector<Ptr<LogicalLoraChannel>> GetEnabledChannelList();
+    std::vector<Ptr<const LogicalLoraChannel>> GetEnabledChannelList() const;
+
+    /**
+     * Get the list of SubBands currently registered on this helper.
+     *
+     * \return A list of the SubBands.
+     */
+    std::vector<Ptr<const SubBand>> GetSubBandList() const;
+
+    /**
+     * Get the total time spent transmitting on a SubBand, as registered with AddEvent.
+     *
+     * \param index The index of the SubBand, as in GetSubBandList.
+     * \return The total transmission time.
+     */
+    Time GetSubBandAirtime(std::size_t index) const;
 
     /**
      * Add a new channel to the list.
@@ -150,7 +215,7 @@ class LogicalLoraChannelHelper : public Object
      * transmission power.
      * \return The power in dBm.
      */
-    double GetTxPowerForChannel(Ptr<LogicalLoraChannel> logicalChannel);
+    double GetTxPowerForChannel(Ptr<const LogicalLoraChannel> logicalChannel) const;
 
     /**
      * Get the SubBand a channel belongs to.
@@ -158,7 +223,7 @@ class LogicalLoraChannelHelper : public Object
      * \param channel The channel whose SubBand we want to get.
      * \return The SubBand the channel belongs to.
      */
-    Ptr<SubBand> GetSubBandFromChannel(Ptr<LogicalLoraChannel> channel);
+    Ptr<const SubBand> GetSubBandFromChannel(Ptr<const LogicalLoraChannel> channel) const;
 
     /**
      * Get the SubBand a frequency belongs to.
@@ -166,7 +231,7 @@ class LogicalLoraChannelHelper : public Object
      * \param frequency The frequency we want to check.
      * \return The SubBand the frequency belongs to.
      */
-    Ptr<SubBand> GetSubBandFromFrequency(double frequency);
+    Ptr<const SubBand> GetSubBandFromFrequency(double frequency) const;
 
     /**
      * Disable the channel at a specified index.
@@ -175,28 +240,77 @@ class LogicalLoraChannelHelper : public Object
      */
     void DisableChannel(int index);
 
+    /**
+     * Enable the channel at a specified index.
+     *
+     * \param index The index of the channel to enable.
+     */
+    void EnableChannel(int index);
+
+    /**
+     * Check whether this helper shares its channels and SubBands with another
+     * helper.
+     *
+     * \param other The other helper.
+     * \return True if the two helpers use the same channel plan.
+     */
+    bool SharesChannelPlanWith(const LogicalLoraChannelHelper& other) const;
+
   private:
     /**
-     * A list of the SubBands that are currently registered within this helper.
+     * The channels and SubBands of a helper, shared among its copies.
      */
-    std::list<Ptr<SubBand>> m_subBandList;
+    struct ChannelPlan : public SimpleRefCount<ChannelPlan>
+    {
+        /**
+         * A list of the SubBands that are currently registered.
+         */
+        std::vector<Ptr<SubBand>> subBands;
+
+        /**
+         * A vector of the LogicalLoraChannels that are currently registered.
+         * This vector represents the node's channel mask. The first N channels
+         * are the default ones for a fixed region.
+         */
+        std::vector<Ptr<LogicalLoraChannel>> channels;
+    };
 
     /**
-     * A vector of the LogicalLoraChannels that are currently registered within
-     * this helper. This vector represents the node's channel mask. The first N
-     * channels are the default ones for a fixed region.
+     * Make sure the channel plan of this helper is not shared with other
+     * helpers before modifying it, copying it if necessary.
      */
-    std::vector<Ptr<LogicalLoraChannel>> m_channelList;
+    void DetachChannelPlan();
 
-    Time m_nextAggregatedTransmissionTime; //!< The next time at which
+    /**
+     * Get the index of the SubBand a frequency belongs to.
+     *
+     * \param frequency The frequency we want to check.
+     * \return The index of the SubBand in m_subBandList.
+     */
+    std::size_t GetSubBandIndexFromFrequency(double frequency) const;
+
+    static constexpr std::size_t MAX_SUB_BANDS = 8; //!< Maximum number of SubBands
+
+    Ptr<ChannelPlan> m_plan; //!< The channels and SubBands of this helper
+
+    /**
+     * The next time [ns] at which transmission will be possible on each
+     * SubBand, with the same indexing as the SubBands of m_plan.
+     */
+    std::array<int64_t, MAX_SUB_BANDS> m_nextSubBandTransmissionNs;
+
+    /**
+     * The total time [ns] spent transmitting on each SubBand, with the same
+     * indexing as the SubBands of m_plan.
+     */
+    std::array<int64_t, MAX_SUB_BANDS> m_subBandAirtimeNs;
+
+    int64_t m_nextAggregatedTransmissionNs; //!< The next time [ns] at which
     //! transmission will be possible
     //! according to the aggregated
     //! transmission timer
 
-    double m_aggregatedDutyCycle; //!< The next time at which
-                                  //! transmission will be possible
-    //! according to the aggregated
-    //! transmission timer
+    double m_aggregatedDutyCycle; //!< The aggregated duty cycle, in fractional form
 };
 } // namespace lorawan
 
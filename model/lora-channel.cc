@@ -10,6 +10,7 @@
 
 #include "end-device-lora-phy.h"
 #include "gateway-lora-phy.h"
+#include "lora-instrumentation.h"
 
 #include "ns3/log.h"
 #include "ns3/object-factory.h"
@@ -108,6 +109,9 @@ LoraChannel::Send(Ptr<LoraPhy> sender,
 {
     NS_LOG_FUNCTION(this << sender << packet << txPowerDbm << txParams << duration << frequencyMHz);
 
+    LORAWAN_TIME_SCOPE("LoraChannel/Send");
+    LORAWAN_COUNT("LoraChannel/Sends", 1);
+
     // Get the mobility model of the sender
     Ptr<MobilityModel> senderMobility = sender->GetMobility()->GetObject<MobilityModel>();
 
@@ -170,6 +174,7 @@ LoraChannel::Send(Ptr<LoraPhy> sender,
                                            j,
                                            packet,
                                            parameters);
+            LORAWAN_COUNT("LoraChannel/Deliveries", 1);
 
             // Fire the trace source for sent packet
             m_packetSent(packet);
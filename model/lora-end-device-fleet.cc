@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-end-device-fleet.h"
+
+#include "lora-frame-header.h"
+#include "lora-tag.h"
+#include "lorawan-mac-header.h"
+#include "simple-end-device-lora-phy.h"
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraEndDeviceFleet");
+
+NS_OBJECT_ENSURE_REGISTERED(LoraEndDeviceFleet);
+
+TypeId
+LoraEndDeviceFleet::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::LoraEndDeviceFleet")
+            .SetParent<Object>()
+            .SetGroupName("lorawan")
+            .AddConstructor<LoraEndDeviceFleet>()
+            .AddAttribute("Period",
+                          "The interval between packet sends of each device",
+                          TimeValue(Seconds(600)),
+                          MakeTimeAccessor(&LoraEndDeviceFleet::m_period),
+                          MakeTimeChecker())
+            .AddAttribute("PacketSize",
+                          "The size of the application payload sent by each device, in bytes",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&LoraEndDeviceFleet::m_packetSize),
+                          MakeUintegerChecker<uint8_t>())
+            .AddAttribute("TxPowerDbm",
+                          "The transmission power of each device, in dBm",
+                          DoubleValue(14),
+                          MakeDoubleAccessor(&LoraEndDeviceFleet::m_txPowerDbm),
+                          MakeDoubleChecker<double>())
+            .AddTraceSource("SentNewPacket",
+                            "Trace source indicating a new packet "
+                            "was sent by a device of the fleet",
+                            MakeTraceSourceAccessor(&LoraEndDeviceFleet::m_sentNewPacket),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("StartSending",
+                            "Trace source indicating a device of the fleet "
+                            "started transmitting a packet on the channel",
+                            MakeTraceSourceAccessor(&LoraEndDeviceFleet::m_startSending),
+                            "ns3::lorawan::LoraEndDeviceFleet::StartSendingTracedCallback");
+    return tid;
+}
+
+LoraEndDeviceFleet::LoraEndDeviceFleet()
+    : m_running(false)
+{
+    NS_LOG_FUNCTION(this);
+
+    m_mobility = CreateObject<ConstantPositionMobilityModel>();
+    m_phy = CreateObject<SimpleEndDeviceLoraPhy>();
+    m_phy->SetMobility(m_mobility);
+
+    m_uniformRV = CreateObject<UniformRandomVariable>();
+
+    // EU868 data rates, until the region sets its own
+    m_sfForDataRate = {12, 11, 10, 9, 8, 7, 7};
+    m_bandwidthForDataRate = {125000, 125000, 125000, 125000, 125000, 125000, 250000};
+}
+
+LoraEndDeviceFleet::~LoraEndDeviceFleet()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+LoraEndDeviceFleet::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+
+    Simulator::Cancel(m_nextEvent);
+    m_channel = nullptr;
+    m_phy = nullptr;
+    m_mobility = nullptr;
+
+    Object::DoDispose();
+}
+
+void
+LoraEndDeviceFleet::SetChannel(Ptr<LoraChannel> channel)
+{
+    NS_LOG_FUNCTION(this << channel);
+
+    m_channel = channel;
+}
+
+void
+LoraEndDeviceFleet::SetLogicalLoraChannelHelper(LogicalLoraChannelHelper helper)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_addresses.empty(), "The channel plan must be set before adding devices");
+
+    m_channelHelper = helper;
+
+    // Flatten the enabled channels, with a duty cycle timer for each of their
+    // SubBands, so that transmissions do not need to look them up
+    m_frequencies.clear();
+    m_channelTimers.clear();
+    m_timerDutyCycles.clear();
+    std::vector<Ptr<const SubBand>> timerSubBands;
+    for (const auto& channel : m_channelHelper.GetEnabledChannelList())
+    {
+        Ptr<const SubBand> subBand = m_channelHelper.GetSubBandFromChannel(channel);
+        auto it = std::find(timerSubBands.begin(), timerSubBands.end(), subBand);
+        if (it == timerSubBands.end())
+        {
+            timerSubBands.push_back(subBand);
+            m_timerDutyCycles.push_back(subBand->GetDutyCycle());
+            it = timerSubBands.end() - 1;
+        }
+        m_frequencies.push_back(channel->GetFrequency());
+        m_channelTimers.push_back(it - timerSubBands.begin());
+    }
+    NS_ASSERT_MSG(!m_frequencies.empty(), "The channel plan has no channel enabled for uplink");
+    m_freeChannels.reserve(m_frequencies.size());
+}
+
+void
+LoraEndDeviceFleet::SetSfForDataRate(std::vector<uint8_t> sfForDataRate)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_addresses.empty(), "Data rates must be set before adding devices");
+    m_sfForDataRate = std::move(sfForDataRate);
+}
+
+void
+LoraEndDeviceFleet::SetBandwidthForDataRate(std::vector<double> bandwidthForDataRate)
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_addresses.empty(), "Data rates must be set before adding devices");
+    m_bandwidthForDataRate = std::move(bandwidthForDataRate);
+}
+
+void
+LoraEndDeviceFleet::Reserve(uint32_t nDevices)
+{
+    NS_LOG_FUNCTION(this << nDevices);
+
+    m_addresses.reserve(nDevices);
+    m_positions.reserve(nDevices);
+    m_dataRates.reserve(nDevices);
+    m_fCnts.reserve(nDevices);
+    m_nextAllowedNs.reserve(std::size_t(nDevices) * m_timerDutyCycles.size());
+}
+
+uint32_t
+LoraEndDeviceFleet::AddDevice(LoraDeviceAddress address, Vector position, uint8_t dataRate)
+{
+    NS_LOG_FUNCTION(this << address << position << unsigned(dataRate));
+
+    NS_ASSERT_MSG(!m_running, "Devices cannot be added to a running fleet");
+    NS_ASSERT_MSG(!m_frequencies.empty(), "The channel plan must be set before adding devices");
+    NS_ASSERT_MSG(dataRate < m_sfForDataRate.size(), "Data rate not defined in the region");
+
+    m_addresses.push_back(address.Get());
+    m_positions.push_back(position);
+    m_dataRates.push_back(dataRate);
+    m_fCnts.push_back(0);
+    m_nextAllowedNs.insert(m_nextAllowedNs.end(), m_timerDutyCycles.size(), 0);
+
+    return m_addresses.size() - 1;
+}
+
+void
+LoraEndDeviceFleet::AddDevices(uint32_t nDevices,
+                               Ptr<PositionAllocator> positionAllocator,
+                               Ptr<LoraDeviceAddressGenerator> addressGenerator)
+{
+    NS_LOG_FUNCTION(this << nDevices);
+
+    Reserve(m_addresses.size() + nDevices);
+    for (uint32_t i = 0; i < nDevices; i++)
+    {
+        AddDevice(addressGenerator->NextAddress(), positionAllocator->GetNext());
+    }
+}
+
+uint32_t
+LoraEndDeviceFleet::GetNDevices() const
+{
+    return m_addresses.size();
+}
+
+LoraDeviceAddress
+LoraEndDeviceFleet::GetDeviceAddress(uint32_t index) const
+{
+    return LoraDeviceAddress(m_addresses.at(index));
+}
+
+Vector
+LoraEndDeviceFleet::GetPosition(uint32_t index) const
+{
+    return m_positions.at(index);
+}
+
+void
+LoraEndDeviceFleet::SetDataRate(uint32_t index, uint8_t dataRate)
+{
+    NS_LOG_FUNCTION(this << index << unsigned(dataRate));
+
+    NS_ASSERT_MSG(dataRate < m_sfForDataRate.size(), "Data rate not defined in the region");
+    m_dataRates.at(index) = dataRate;
+}
+
+uint8_t
+LoraEndDeviceFleet::GetDataRate(uint32_t index) const
+{
+    return m_dataRates.at(index);
+}
+
+void
+LoraEndDeviceFleet::Start(Time start)
+{
+    NS_LOG_FUNCTION(this << start);
+
+    Simulator::Schedule(start, &LoraEndDeviceFleet::DoStart, this);
+}
+
+void
+LoraEndDeviceFleet::Stop(Time stop)
+{
+    NS_LOG_FUNCTION(this << stop);
+
+    Simulator::Schedule(stop, &LoraEndDeviceFleet::DoStop, this);
+}
+
+int64_t
+LoraEndDeviceFleet::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+
+    m_uniformRV->SetStream(stream);
+    return 1;
+}
+
+void
+LoraEndDeviceFleet::DoStart()
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT_MSG(m_channel, "The fleet needs a channel to transmit on");
+
+    m_running = true;
+
+    // Spread the first transmission of each device over one period, and build
+    // the heap in linear time
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    std::vector<PendingTransmission> transmissions;
+    transmissions.reserve(m_addresses.size());
+    for (uint32_t i = 0; i < m_addresses.size(); i++)
+    {
+        auto offsetNs =
+            static_cast<int64_t>(m_uniformRV->GetValue(0, m_period.GetNanoSeconds()));
+        transmissions.emplace_back(nowNs + offsetNs, i);
+    }
+    m_pendingTransmissions = decltype(m_pendingTransmissions)(std::greater<PendingTransmission>(),
+                                                              std::move(transmissions));
+
+    ScheduleNextEvent();
+}
+
+void
+LoraEndDeviceFleet::DoStop()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_running = false;
+    Simulator::Cancel(m_nextEvent);
+}
+
+void
+LoraEndDeviceFleet::ScheduleNextEvent()
+{
+    if (!m_running || m_pendingTransmissions.empty())
+    {
+        return;
+    }
+
+    Time delay = NanoSeconds(m_pendingTransmissions.top().first) - Simulator::Now();
+    m_nextEvent = Simulator::Schedule(delay, &LoraEndDeviceFleet::ServeTransmissions, this);
+}
+
+void
+LoraEndDeviceFleet::ServeTransmissions()
+{
+    NS_LOG_FUNCTION(this);
+
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    while (!m_pendingTransmissions.empty() && m_pendingTransmissions.top().first <= nowNs)
+    {
+        uint32_t index = m_pendingTransmissions.top().second;
+        m_pendingTransmissions.pop();
+
+        // Find the channels whose SubBand allows the transmission
+        const int64_t* timers = &m_nextAllowedNs[index * m_timerDutyCycles.size()];
+        m_freeChannels.clear();
+        for (std::size_t channel = 0; channel < m_frequencies.size(); channel++)
+        {
+            if (timers[m_channelTimers[channel]] <= nowNs)
+            {
+                m_freeChannels.push_back(channel);
+            }
+        }
+
+        // Postpone the transmission if the duty cycle does not allow it yet,
+        // until the first SubBand is available
+        if (m_freeChannels.empty())
+        {
+            NS_LOG_DEBUG("Device " << index << " postponed because of duty cycle limitations");
+            m_pendingTransmissions.emplace(
+                *std::min_element(timers, timers + m_timerDutyCycles.size()),
+                index);
+            continue;
+        }
+
+        Transmit(index,
+                 m_freeChannels[m_uniformRV->GetInteger(0, m_freeChannels.size() - 1)]);
+        m_pendingTransmissions.emplace(nowNs + m_period.GetNanoSeconds(), index);
+    }
+
+    ScheduleNextEvent();
+}
+
+void
+LoraEndDeviceFleet::Transmit(uint32_t index, std::size_t channel)
+{
+    NS_LOG_FUNCTION(this << index << channel);
+
+    // Craft the packet as a Class A device would for an unconfirmed uplink
+    Ptr<Packet> packet = Create<Packet>(m_packetSize);
+
+    LoraFrameHeader frameHdr;
+    frameHdr.SetAsUplink();
+    frameHdr.SetFPort(1);
+    frameHdr.SetAddress(LoraDeviceAddress(m_addresses[index]));
+    frameHdr.SetAdr(false);
+    frameHdr.SetAdrAckReq(false);
+    frameHdr.SetFCnt(m_fCnts[index]++);
+    packet->AddHeader(frameHdr);
+
+    LorawanMacHeader macHdr;
+    macHdr.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_UP);
+    macHdr.SetMajor(1);
+    packet->AddHeader(macHdr);
+
+    m_sentNewPacket(packet);
+
+    LoraTxParameters params;
+    params.sf = m_sfForDataRate[m_dataRates[index]];
+    params.bandwidthHz = m_bandwidthForDataRate[m_dataRates[index]];
+    params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym(params) > MilliSeconds(16);
+
+    LoraTag tag;
+    tag.SetSpreadingFactor(params.sf);
+    packet->AddPacketTag(tag);
+
+    Time duration = LoraPhy::GetOnAirTime(packet, params);
+    double frequency = m_frequencies[channel];
+
+    // The shared PHY stands for the device on the channel
+    m_mobility->SetPosition(m_positions[index]);
+    m_channel->Send(m_phy, packet, m_txPowerDbm, params, duration, frequency);
+
+    m_startSending(packet, index);
+
+    // Off time according to the duty cycle of the SubBand, and to the
+    // aggregated duty cycle, which holds for all SubBands
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    int64_t durationNs = duration.GetNanoSeconds();
+    int64_t* timers = &m_nextAllowedNs[index * m_timerDutyCycles.size()];
+    std::size_t timer = m_channelTimers[channel];
+    timers[timer] =
+        nowNs + LogicalLoraChannelHelper::GetOffTimeNs(durationNs, m_timerDutyCycles[timer]);
+    int64_t aggregatedNs =
+        nowNs + LogicalLoraChannelHelper::GetOffTimeNs(durationNs,
+                                                       m_channelHelper.GetAggregatedDutyCycle());
+    for (std::size_t i = 0; i < m_timerDutyCycles.size(); i++)
+    {
+        timers[i] = std::max(timers[i], aggregatedNs);
+    }
+
+    NS_LOG_DEBUG("Device " << index << " sent a packet on frequency " << frequency << " with SF"
+                           << unsigned(params.sf));
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_END_DEVICE_FLEET_H
+#define LORA_END_DEVICE_FLEET_H
+
+#include "logical-lora-channel-helper.h"
+#include "lora-channel.h"
+#include "lora-device-address-generator.h"
+#include "lora-device-address.h"
+#include "lora-phy.h"
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/position-allocator.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A set of lightweight end devices that periodically send unconfirmed uplink
+ * packets, without a Node, NetDevice, PHY, MAC and application per device.
+ *
+ * The state of each device (address, position, data rate, frame counter, duty
+ * cycle and traffic timers) is kept in contiguous arrays, and all devices are
+ * driven by a single pending simulator event, which serves the earliest
+ * transmission among those of the whole fleet. Packets are sent on a regular
+ * LoraChannel, so that they are received by the gateways and forwarded to the
+ * NetworkServer as any other uplink.
+ *
+ * Devices of a fleet follow a simplified behavior: they only send unconfirmed
+ * packets, do not request ADR and never open receive windows. As the MAC of
+ * regular end devices, they pick a random channel among the enabled ones of
+ * the regional channel plan, and respect the duty cycle of each SubBand and the
+ * aggregated duty cycle of the plan. Data rates are converted to a spreading
+ * factor and a bandwidth with the tables of the region, which
+ * LorawanMacHelper::ConfigureFleet sets along with the channel plan; by
+ * default, the EU868 ones are used. Propagation loss models that require
+ * objects to be aggregated to the mobility model of the devices (e.g.,
+ * buildings) are not supported.
+ */
+class LoraEndDeviceFleet : public Object
+{
+  public:
+    /**
+     *  Register this type.
+     *  \return The object TypeId.
+     */
+    static TypeId GetTypeId();
+
+    LoraEndDeviceFleet();           //!< Default constructor
+    ~LoraEndDeviceFleet() override; //!< Destructor
+
+    /**
+     * TracedCallback signature for the start of a transmission by a device of
+     * the fleet.
+     *
+     * \param packet The packet being sent.
+     * \param index The index of the device in the fleet.
+     */
+    typedef void (*StartSendingTracedCallback)(Ptr<const Packet> packet, uint32_t index);
+
+    /**
+     * Set the channel the devices of this fleet transmit on.
+     *
+     * \param channel A pointer to the LoraChannel object.
+     */
+    void SetChannel(Ptr<LoraChannel> channel);
+
+    /**
+     * Set the channel plan of the region the devices operate in, usually the one
+     * given by LorawanMacHelper::GetLogicalLoraChannelHelper. It must be set
+     * before devices are added.
+     *
+     * \param helper The LogicalLoraChannelHelper with the channels and SubBands
+     * of the region.
+     */
+    void SetLogicalLoraChannelHelper(LogicalLoraChannelHelper helper);
+
+    /**
+     * Set the spreading factor of each data rate, as in LorawanMac. It must be
+     * set before devices are added.
+     *
+     * \param sfForDataRate A vector holding the spreading factor of each data rate.
+     */
+    void SetSfForDataRate(std::vector<uint8_t> sfForDataRate);
+
+    /**
+     * Set the bandwidth of each data rate, as in LorawanMac. It must be set
+     * before devices are added.
+     *
+     * \param bandwidthForDataRate A vector holding the bandwidth of each data rate [Hz].
+     */
+    void SetBandwidthForDataRate(std::vector<double> bandwidthForDataRate);
+
+    /**
+     * Reserve memory for a number of devices.
+     *
+     * \param nDevices The expected number of devices.
+     */
+    void Reserve(uint32_t nDevices);
+
+    /**
+     * Add a device to the fleet.
+     *
+     * \param address The network address of the device.
+     * \param position The position of the device.
+     * \param dataRate The data rate the device uses to transmit.
+     * \return The index of the device in the fleet.
+     */
+    uint32_t AddDevice(LoraDeviceAddress address, Vector position, uint8_t dataRate = 0);
+
+    /**
+     * Add a number of devices to the fleet.
+     *
+     * \param nDevices The number of devices to add.
+     * \param positionAllocator The allocator to get the position of each device from.
+     * \param addressGenerator The generator to get the address of each device from.
+     */
+    void AddDevices(uint32_t nDevices,
+                    Ptr<PositionAllocator> positionAllocator,
+                    Ptr<LoraDeviceAddressGenerator> addressGenerator);
+
+    /**
+     * Get the number of devices in the fleet.
+     *
+     * \return The number of devices.
+     */
+    uint32_t GetNDevices() const;
+
+    /**
+     * Get the network address of a device.
+     *
+     * \param index The index of the device in the fleet.
+     * \return The address of the device.
+     */
+    LoraDeviceAddress GetDeviceAddress(uint32_t index) const;
+
+    /**
+     * Get the position of a device.
+     *
+     * \param index The index of the device in the fleet.
+     * \return The position of the device.
+     */
+    Vector GetPosition(uint32_t index) const;
+
+    /**
+     * Set the data rate a device uses to transmit.
+     *
+     * \param index The index of the device in the fleet.
+     * \param dataRate The data rate, one of those of the region.
+     */
+    void SetDataRate(uint32_t index, uint8_t dataRate);
+
+    /**
+     * Get the data rate a device uses to transmit.
+     *
+     * \param index The index of the device in the fleet.
+     * \return The data rate.
+     */
+    uint8_t GetDataRate(uint32_t index) const;
+
+    /**
+     * Start the traffic of all devices. The first packet of each device is
+     * sent at a random time within one period after the start time.
+     *
+     * \param start The time at which to start, relative to now.
+     */
+    void Start(Time start);
+
+    /**
+     * Stop the traffic of all devices.
+     *
+     * \param stop The time at which to stop, relative to now.
+     */
+    void Stop(Time stop);
+
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by this fleet.
+     *
+     * \param stream The first stream index to use.
+     * \return The number of stream indices assigned by this fleet.
+     */
+    int64_t AssignStreams(int64_t stream);
+
+  private:
+    void DoDispose() override;
+
+    /**
+     * Schedule the first transmission of all devices.
+     */
+    void DoStart();
+
+    /**
+     * Stop serving transmissions.
+     */
+    void DoStop();
+
+    /**
+     * Serve all transmissions that are due, and schedule the event for the next
+     * one.
+     */
+    void ServeTransmissions();
+
+    /**
+     * Craft a packet for a device and send it on the channel.
+     *
+     * \param index The index of the device in the fleet.
+     * \param channel The index of the channel to transmit on, in m_frequencies.
+     */
+    void Transmit(uint32_t index, std::size_t channel);
+
+    /**
+     * Make sure the pending event fires for the earliest transmission.
+     */
+    void ScheduleNextEvent();
+
+    /**
+     * A pending transmission, as the pair of its time [ns] and of the index
+     * of the device.
+     */
+    typedef std::pair<int64_t, uint32_t> PendingTransmission;
+
+    std::vector<uint32_t> m_addresses;    //!< Network address of each device
+    std::vector<Vector> m_positions;      //!< Position of each device
+    std::vector<uint8_t> m_dataRates;     //!< Data rate of each device
+    std::vector<uint16_t> m_fCnts;        //!< Next frame counter of each device
+
+    /**
+     * The duty cycle timers [ns] of each device, one for each SubBand of the
+     * enabled channels, stored device after device.
+     */
+    std::vector<int64_t> m_nextAllowedNs;
+
+    /**
+     * Min-heap of the next transmission of each device.
+     */
+    std::priority_queue<PendingTransmission,
+                        std::vector<PendingTransmission>,
+                        std::greater<PendingTransmission>>
+        m_pendingTransmissions;
+
+    EventId m_nextEvent; //!< The single event serving the earliest transmission
+    bool m_running;      //!< Whether the fleet is sending packets
+
+    Time m_period;        //!< The time between two packets of a device
+    uint8_t m_packetSize; //!< The application payload size [bytes]
+    double m_txPowerDbm;  //!< The transmission power [dBm]
+
+    LogicalLoraChannelHelper m_channelHelper;   //!< The channel plan of the region
+    std::vector<double> m_frequencies;          //!< The enabled channel frequencies [MHz]
+    std::vector<std::size_t> m_channelTimers;   //!< The duty cycle timer of each channel
+    std::vector<double> m_timerDutyCycles;      //!< The SubBand duty cycle of each timer
+    std::vector<std::size_t> m_freeChannels;    //!< Channels available to a transmission
+    std::vector<uint8_t> m_sfForDataRate;       //!< The spreading factor of each data rate
+    std::vector<double> m_bandwidthForDataRate; //!< The bandwidth of each data rate [Hz]
+
+    Ptr<LoraChannel> m_channel; //!< The channel devices transmit on
+
+    /**
+     * A PHY standing for the transmitting device when sending on the channel.
+     * It is never registered with the channel.
+     */
+    Ptr<LoraPhy> m_phy;
+
+    /**
+     * The mobility of m_phy, moved to the position of the transmitting device
+     * before each transmission.
+     */
+    Ptr<ConstantPositionMobilityModel> m_mobility;
+
+    Ptr<UniformRandomVariable> m_uniformRV; //!< Random offsets and channel selection
+
+    /**
+     * The trace source fired when a device sends a new packet.
+     *
+     * \see class CallBackTraceSource
+     */
+    TracedCallback<Ptr<const Packet>> m_sentNewPacket;
+
+    /**
+     * The trace source fired when a packet is sent on the channel, along with
+     * the index of the device in the fleet.
+     *
+     * \see class CallBackTraceSource
+     */
+    TracedCallback<Ptr<const Packet>, uint32_t> m_startSending;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_END_DEVICE_FLEET_H */
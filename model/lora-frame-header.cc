@@ -10,6 +10,7 @@
 
 #include "ns3/log.h"
 
+#include <algorithm>
 #include <bitset>
 
 namespace ns3
@@ -28,7 +29,8 @@ LoraFrameHeader::LoraFrameHeader()
       m_ack(false),
       m_fPending(false),
       m_fOptsLen(0),
-      m_fCnt(0)
+      m_fCnt(0),
+      m_serializedCommandsLen(0)
 {
 }
 
@@ -87,7 +89,9 @@ LoraFrameHeader::Serialize(Buffer::Iterator start) const
     // FCnt field
     start.WriteU16(m_fCnt);
 
-    // FOpts field
+    // FOpts field: commands added in serialized form come first, followed by
+    // the ones added as MacCommand objects
+    start.Write(m_serializedCommands.data(), m_serializedCommandsLen);
     for (auto it = m_macCommands.begin(); it != m_macCommands.end(); it++)
     {
         NS_LOG_DEBUG("Serializing a MAC command");
@@ -114,6 +118,7 @@ LoraFrameHeader::Deserialize(Buffer::Iterator start)
 
     // Empty the list of MAC commands
     m_macCommands.clear();
+    m_serializedCommandsLen = 0;
 
     // Read from buffer and save into local variables
     m_address.Set(start.ReadU32());
@@ -312,6 +317,10 @@ LoraFrameHeader::Print(std::ostream& os) const
     {
         (*it)->Print(os);
     }
+    if (m_serializedCommandsLen > 0)
+    {
+        os << "SerializedCommandsLen=" << unsigned(m_serializedCommandsLen) << std::endl;
+    }
 
     os << "FPort=" << unsigned(m_fPort) << std::endl;
 }
@@ -410,7 +419,7 @@ uint8_t
 LoraFrameHeader::GetFOptsLen() const
 {
     // Sum the serialized length of all commands in the list
-    uint8_t fOptsLen = 0;
+    uint8_t fOptsLen = m_serializedCommandsLen;
     std::list<Ptr<MacCommand>>::const_iterator it;
     for (it = m_macCommands.begin(); it != m_macCommands.end(); it++)
     {
@@ -571,8 +580,8 @@ LoraFrameHeader::AddNewChannelReq(uint8_t chIndex,
     m_fOptsLen += command->GetSerializedSize();
 }
 
-std::list<Ptr<MacCommand>>
-LoraFrameHeader::GetCommands()
+const std::list<Ptr<MacCommand>>&
+LoraFrameHeader::GetCommands() const
 {
     NS_LOG_FUNCTION_NOARGS();
 
@@ -588,5 +597,18 @@ LoraFrameHeader::AddCommand(Ptr<MacCommand> macCommand)
     m_fOptsLen += macCommand->GetSerializedSize();
 }
 
+void
+LoraFrameHeader::AddSerializedCommands(const uint8_t* commands, uint8_t length)
+{
+    NS_LOG_FUNCTION(this << unsigned(length));
+
+    NS_ASSERT_MSG(m_serializedCommandsLen + length <= m_serializedCommands.size(),
+                  "Serialized commands exceed the maximum FOpts length");
+
+    std::copy(commands, commands + length, m_serializedCommands.begin() + m_serializedCommandsLen);
+    m_serializedCommandsLen += length;
+    m_fOptsLen += length;
+}
+
 } // namespace lorawan
 } // namespace ns3
@@ -14,6 +14,8 @@
 
 #include "ns3/header.h"
 
+#include <array>
+
 namespace ns3
 {
 namespace lorawan
@@ -302,7 +304,7 @@ class LoraFrameHeader : public Header
      *
      * \return The list of pointers to MacCommand objects.
      */
-    std::list<Ptr<MacCommand>> GetCommands();
+    const std::list<Ptr<MacCommand>>& GetCommands() const;
 
     /**
      * Add a predefined command to the list in this frame header.
@@ -311,6 +313,17 @@ class LoraFrameHeader : public Header
      */
     void AddCommand(Ptr<MacCommand> macCommand);
 
+    /**
+     * Append already serialized MAC commands to the FOpts field.
+     *
+     * The commands are written before the ones added as MacCommand objects.
+     * After deserialization, they are available through GetCommands.
+     *
+     * \param commands A pointer to the first byte of the serialized commands.
+     * \param length The length of the serialized commands [bytes].
+     */
+    void AddSerializedCommands(const uint8_t* commands, uint8_t length);
+
   private:
     uint8_t m_fPort; //!< The FPort field
 
@@ -328,6 +341,9 @@ class LoraFrameHeader : public Header
     std::list<Ptr<MacCommand>> m_macCommands; //!< List containing all the MacCommand instances that
                                               //!< are contained in this LoraFrameHeader
 
+    std::array<uint8_t, 15> m_serializedCommands; //!< Commands added in serialized form
+    uint8_t m_serializedCommandsLen;              //!< Length of m_serializedCommands in use
+
     bool m_isUplink; //!< Whether this frame header is uplink or not
 };
 
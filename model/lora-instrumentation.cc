@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "lora-instrumentation.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <fstream>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("LoraInstrumentation");
+
+bool LoraInstrumentation::m_timersEnabled = false;
+
+LoraInstrumentation::ScopedTimer::ScopedTimer(TimerStats& stats)
+    : m_stats(m_timersEnabled ? &stats : nullptr)
+{
+    if (m_stats)
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+LoraInstrumentation::ScopedTimer::~ScopedTimer()
+{
+    if (m_stats)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_stats->calls++;
+        m_stats->totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+}
+
+bool
+LoraInstrumentation::IsCompiledIn()
+{
+#ifdef NS3_LORAWAN_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+LoraInstrumentation::EnableTimers(bool enable)
+{
+    NS_LOG_FUNCTION(enable);
+
+    m_timersEnabled = enable;
+}
+
+uint64_t&
+LoraInstrumentation::GetCounter(const std::string& name)
+{
+    NS_LOG_FUNCTION(name);
+
+    // Map nodes are never erased, so references to counters stay valid
+    return GetCounters()[name];
+}
+
+LoraInstrumentation::TimerStats&
+LoraInstrumentation::GetTimer(const std::string& name)
+{
+    NS_LOG_FUNCTION(name);
+
+    return GetTimers()[name];
+}
+
+void
+LoraInstrumentation::Reset()
+{
+    NS_LOG_FUNCTION_NOARGS();
+
+    // Call sites keep references to counters and timers, so they are zeroed
+    // rather than erased
+    for (auto& [name, value] : GetCounters())
+    {
+        value = 0;
+    }
+    for (auto& [name, stats] : GetTimers())
+    {
+        stats = TimerStats();
+    }
+}
+
+void
+LoraInstrumentation::WriteCsv(std::ostream& os)
+{
+    os << "kind,name,count,total_ns\n";
+    for (const auto& [name, value] : GetCounters())
+    {
+        os << "counter," << name << "," << value << ",\n";
+    }
+    for (const auto& [name, stats] : GetTimers())
+    {
+        os << "timer," << name << "," << stats.calls << "," << stats.totalNs << "\n";
+    }
+}
+
+void
+LoraInstrumentation::WriteJson(std::ostream& os)
+{
+    // Names are C++ identifiers separated by slashes, and need no escaping
+    os << "{\n  \"counters\": {";
+    const char* separator = "\n";
+    for (const auto& [name, value] : GetCounters())
+    {
+        os << separator << "    \"" << name << "\": " << value;
+        separator = ",\n";
+    }
+    os << "\n  },\n  \"timers\": {";
+    separator = "\n";
+    for (const auto& [name, stats] : GetTimers())
+    {
+        os << separator << "    \"" << name << "\": {\"calls\": " << stats.calls
+           << ", \"total_ns\": " << stats.totalNs << "}";
+        separator = ",\n";
+    }
+    os << "\n  }\n}\n";
+}
+
+void
+LoraInstrumentation::Dump(std::string filename)
+{
+    NS_LOG_FUNCTION(filename);
+
+    std::ofstream outputFile(filename, std::ofstream::out | std::ofstream::trunc);
+    NS_ABORT_MSG_IF(!outputFile, "Could not open " << filename);
+
+    const std::string json = ".json";
+    if (filename.size() >= json.size() &&
+        filename.compare(filename.size() - json.size(), json.size(), json) == 0)
+    {
+        WriteJson(outputFile);
+    }
+    else
+    {
+        WriteCsv(outputFile);
+    }
+}
+
+std::map<std::string, uint64_t>&
+LoraInstrumentation::GetCounters()
+{
+    static std::map<std::string, uint64_t> counters;
+    return counters;
+}
+
+std::map<std::string, LoraInstrumentation::TimerStats>&
+LoraInstrumentation::GetTimers()
+{
+    static std::map<std::string, TimerStats> timers;
+    return timers;
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef LORA_INSTRUMENTATION_H
+#define LORA_INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+/**
+ * \ingroup lorawan
+ *
+ * Add a value to a named counter of the LoraInstrumentation registry. The counter is looked up
+ * once per call site. Compiled out unless NS3_LORAWAN_INSTRUMENTATION is defined.
+ *
+ * \param name The name of the counter, as Class/Counter.
+ * \param value The value to add.
+ */
+#ifdef NS3_LORAWAN_INSTRUMENTATION
+#define LORAWAN_COUNT(name, value)                                                                 \
+    do                                                                                             \
+    {                                                                                              \
+        static uint64_t& lorawanCounter = ns3::lorawan::LoraInstrumentation::GetCounter(name);     \
+        lorawanCounter += (value);                                                                 \
+    } while (false)
+#else
+#define LORAWAN_COUNT(name, value)                                                                 \
+    do                                                                                             \
+    {                                                                                              \
+    } while (false)
+#endif
+
+/**
+ * \ingroup lorawan
+ *
+ * Measure the wall-clock time spent in the enclosing scope with a named timer of the
+ * LoraInstrumentation registry, if timers are enabled at run time. At most one timer can be used
+ * per scope. Compiled out unless NS3_LORAWAN_INSTRUMENTATION is defined.
+ *
+ * \param name The name of the timer, as Class/Timer.
+ */
+#ifdef NS3_LORAWAN_INSTRUMENTATION
+#define LORAWAN_TIME_SCOPE(name)                                                                   \
+    static ns3::lorawan::LoraInstrumentation::TimerStats& lorawanTimerStats =                      \
+        ns3::lorawan::LoraInstrumentation::GetTimer(name);                                         \
+    ns3::lorawan::LoraInstrumentation::ScopedTimer lorawanScopedTimer(lorawanTimerStats)
+#else
+#define LORAWAN_TIME_SCOPE(name)
+#endif
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * A registry of named monotonic counters and wall-clock timers, fed from the hot paths of the
+ * module (channel, interference, gateway PHY, network server and packet tracker) through the
+ * LORAWAN_COUNT and LORAWAN_TIME_SCOPE macros.
+ *
+ * The macros are compiled out, leaving the registry empty, unless the module is built with the
+ * NS3_LORAWAN_INSTRUMENTATION CMake option. Timers also need to be enabled at run time, since
+ * reading the clock costs more than incrementing a counter. The registry is not thread safe, and
+ * must only be fed from the simulation thread.
+ */
+class LoraInstrumentation
+{
+  public:
+    /**
+     * The measurements of a timer.
+     */
+    struct TimerStats
+    {
+        uint64_t calls = 0;   //!< Number of scopes measured
+        uint64_t totalNs = 0; //!< Total wall-clock time spent in the scopes [ns]
+    };
+
+    /**
+     * Adds the wall-clock time between its construction and destruction to a timer.
+     */
+    class ScopedTimer
+    {
+      public:
+        /**
+         * Start measuring, if timers are enabled.
+         *
+         * \param stats The timer to add the measurement to.
+         */
+        ScopedTimer(TimerStats& stats);
+
+        ~ScopedTimer(); //!< Stop measuring, and add the measurement to the timer
+
+      private:
+        TimerStats* m_stats;                           //!< The timer, or nullptr if disabled
+        std::chrono::steady_clock::time_point m_start; //!< The start of the measurement
+    };
+
+    /**
+     * Check whether the module was built with instrumentation.
+     *
+     * \return True if the macros feed the registry.
+     */
+    static bool IsCompiledIn();
+
+    /**
+     * Enable or disable timers at run time. Timers are disabled by default.
+     *
+     * \param enable Whether to measure time in timed scopes.
+     */
+    static void EnableTimers(bool enable);
+
+    /**
+     * Get a counter, creating it if needed. The reference stays valid until the end of the
+     * program.
+     *
+     * \param name The name of the counter.
+     * \return The counter.
+     */
+    static uint64_t& GetCounter(const std::string& name);
+
+    /**
+     * Get a timer, creating it if needed. The reference stays valid until the end of the program.
+     *
+     * \param name The name of the timer.
+     * \return The timer.
+     */
+    static TimerStats& GetTimer(const std::string& name);
+
+    /**
+     * Set all counters and timers to zero.
+     */
+    static void Reset();
+
+    /**
+     * Write all counters and timers as CSV, with one row per counter or timer and columns kind,
+     * name, count (the value of a counter, or the number of calls of a timer) and total_ns.
+     *
+     * \param os The stream to write to.
+     */
+    static void WriteCsv(std::ostream& os);
+
+    /**
+     * Write all counters and timers as a JSON object, with a "counters" object mapping names to
+     * values and a "timers" object mapping names to objects with "calls" and "total_ns".
+     *
+     * \param os The stream to write to.
+     */
+    static void WriteJson(std::ostream& os);
+
+    /**
+     * Write all counters and timers to a file, as JSON if its name ends with .json, and as CSV
+     * otherwise.
+     *
+     * \param filename The name of the file.
+     */
+    static void Dump(std::string filename);
+
+  private:
+    /**
+     * Get the counters, by name.
+     *
+     * \return The counters.
+     */
+    static std::map<std::string, uint64_t>& GetCounters();
+
+    /**
+     * Get the timers, by name.
+     *
+     * \return The timers.
+     */
+    static std::map<std::string, TimerStats>& GetTimers();
+
+    static bool m_timersEnabled; //!< Whether timers measure time
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_INSTRUMENTATION_H */
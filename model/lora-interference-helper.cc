@@ -8,6 +8,8 @@
 
 #include "lora-interference-helper.h"
 
+#include "lora-instrumentation.h"
+
 #include "ns3/enum.h"
 #include "ns3/log.h"
 
@@ -256,6 +258,11 @@ LoraInterferenceHelper::IsDestroyedByInterference(Ptr<LoraInterferenceHelper::Ev
 
     NS_LOG_INFO("Current number of events in LoraInterferenceHelper: " << m_events.size());
 
+    // The mean length of the event list is EventsScanned / InterferenceChecks
+    LORAWAN_TIME_SCOPE("LoraInterferenceHelper/IsDestroyedByInterference");
+    LORAWAN_COUNT("LoraInterferenceHelper/InterferenceChecks", 1);
+    LORAWAN_COUNT("LoraInterferenceHelper/EventsScanned", m_events.size());
+
     // We want to see the interference affecting this event: cycle through events
     // that overlap with this one and see whether it survives the interference or
     // not.
@@ -79,6 +79,12 @@ LoraPhy::GetDevice() const
     return m_device;
 }
 
+std::list<Ptr<LoraInterferenceHelper::Event>>
+LoraPhy::GetInterferenceEvents()
+{
+    return m_interference.GetInterferers();
+}
+
 void
 LoraPhy::SetDevice(Ptr<NetDevice> device)
 {
@@ -227,6 +227,13 @@ class LoraPhy : public Object
      */
     Ptr<NetDevice> GetDevice() const;
 
+    /**
+     * Get the events currently registered at the interference helper of this PHY.
+     *
+     * \return The list of pointers to interference Event objects.
+     */
+    std::list<Ptr<LoraInterferenceHelper::Event>> GetInterferenceEvents();
+
     /**
      * Set the NetDevice that owns this PHY.
      *
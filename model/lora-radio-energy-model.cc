@@ -13,6 +13,8 @@
 #include "ns3/pointer.h"
 #include "ns3/simulator.h"
 
+#include <algorithm>
+
 namespace ns3
 {
 namespace lorawan
@@ -72,6 +74,7 @@ LoraRadioEnergyModel::LoraRadioEnergyModel()
     NS_LOG_FUNCTION(this);
     m_currentState = EndDeviceLoraPhy::SLEEP; // initially STANDBY
     m_lastUpdateTime = Seconds(0.0);
+    m_lastCurrentQuery = Seconds(0.0);
     m_nPendingChangeState = 0;
     m_isSupersededChangeState = false;
     m_energyDepletionCallback.Nullify();
@@ -82,6 +85,9 @@ LoraRadioEnergyModel::LoraRadioEnergyModel()
     // set callback for updating the tx current
     m_listener->SetUpdateTxCurrentCallback(
         MakeCallback(&LoraRadioEnergyModel::SetTxCurrentFromModel, this));
+    // set callback for accounting skipped receive windows
+    m_listener->SetIdleReceiveWindowCallback(
+        MakeCallback(&LoraRadioEnergyModel::AddIdleReceiveWindow, this));
 }
 
 LoraRadioEnergyModel::~LoraRadioEnergyModel()
@@ -102,7 +108,16 @@ double
 LoraRadioEnergyModel::GetTotalEnergyConsumption() const
 {
     NS_LOG_FUNCTION(this);
-    return m_totalEnergyConsumption;
+
+    // Include the energy consumed since the last state change, so that skipped receive windows
+    // are charged even if no state change follows them
+    if (!m_source)
+    {
+        return m_totalEnergyConsumption;
+    }
+    Time duration = Simulator::Now() - m_lastUpdateTime;
+    return m_totalEnergyConsumption + duration.GetSeconds() * GetAverageCurrentA(m_lastUpdateTime) *
+                                          m_source->GetSupplyVoltage();
 }
 
 double
@@ -214,25 +229,9 @@ LoraRadioEnergyModel::ChangeState(int newState)
     NS_ASSERT(duration.GetNanoSeconds() >= 0); // check if duration is valid
 
     // energy to decrease = current * voltage * time
-    double energyToDecrease = 0.0;
     double supplyVoltage = m_source->GetSupplyVoltage();
-    switch (m_currentState)
-    {
-    case EndDeviceLoraPhy::STANDBY:
-        energyToDecrease = duration.GetSeconds() * m_idleCurrentA * supplyVoltage;
-        break;
-    case EndDeviceLoraPhy::TX:
-        energyToDecrease = duration.GetSeconds() * m_txCurrentA * supplyVoltage;
-        break;
-    case EndDeviceLoraPhy::RX:
-        energyToDecrease = duration.GetSeconds() * m_rxCurrentA * supplyVoltage;
-        break;
-    case EndDeviceLoraPhy::SLEEP:
-        energyToDecrease = duration.GetSeconds() * m_sleepCurrentA * supplyVoltage;
-        break;
-    default:
-        NS_FATAL_ERROR("LoraRadioEnergyModel:Undefined radio state: " << m_currentState);
-    }
+    double energyToDecrease =
+        duration.GetSeconds() * GetAverageCurrentA(m_lastUpdateTime) * supplyVoltage;
 
     // update total energy consumption
     m_totalEnergyConsumption += energyToDecrease;
@@ -245,6 +244,13 @@ LoraRadioEnergyModel::ChangeState(int newState)
     // notify energy source
     m_source->UpdateEnergySource();
 
+    // Both this model and the energy source are now up to date, so skipped receive windows that
+    // are over will not be needed anymore
+    while (!m_idleReceiveWindows.empty() && m_idleReceiveWindows.front().second <= Simulator::Now())
+    {
+        m_idleReceiveWindows.pop_front();
+    }
+
     // in case the energy source is found to be depleted during the last update, a callback might be
     // invoked that might cause a change in the Lora PHY state (e.g., the PHY is put into SLEEP
     // mode). This in turn causes a new call to this member function, with the consequence that the
@@ -298,6 +304,18 @@ LoraRadioEnergyModel::HandleEnergyRecharged()
     }
 }
 
+void
+LoraRadioEnergyModel::AddIdleReceiveWindow(Time start, Time duration)
+{
+    NS_LOG_FUNCTION(this << start << duration);
+
+    NS_ASSERT(m_currentState == EndDeviceLoraPhy::SLEEP);
+    NS_ASSERT(start >= Simulator::Now());
+
+    // The window is settled by the next state change or energy source update
+    m_idleReceiveWindows.emplace_back(start, start + duration);
+}
+
 LoraRadioEnergyModelPhyListener*
 LoraRadioEnergyModel::GetPhyListener()
 {
@@ -315,25 +333,63 @@ LoraRadioEnergyModel::DoDispose()
     NS_LOG_FUNCTION(this);
     m_source = nullptr;
     m_energyDepletionCallback.Nullify();
+    m_idleReceiveWindows.clear();
 }
 
 double
 LoraRadioEnergyModel::DoGetCurrentA() const
 {
     NS_LOG_FUNCTION(this);
+
+    // The energy source multiplies the current by the time since its last update, which is
+    // when it last asked for the current
+    double currentA = GetAverageCurrentA(m_lastCurrentQuery);
+    m_lastCurrentQuery = Simulator::Now();
+    return currentA;
+}
+
+double
+LoraRadioEnergyModel::GetAverageCurrentA(Time from) const
+{
+    NS_LOG_FUNCTION(this << from);
+
+    double currentA = 0;
     switch (m_currentState)
     {
     case EndDeviceLoraPhy::STANDBY:
-        return m_idleCurrentA;
+        currentA = m_idleCurrentA;
+        break;
     case EndDeviceLoraPhy::TX:
-        return m_txCurrentA;
+        currentA = m_txCurrentA;
+        break;
     case EndDeviceLoraPhy::RX:
-        return m_rxCurrentA;
+        currentA = m_rxCurrentA;
+        break;
     case EndDeviceLoraPhy::SLEEP:
-        return m_sleepCurrentA;
+        currentA = m_sleepCurrentA;
+        break;
     default:
         NS_FATAL_ERROR("LoraRadioEnergyModel:Undefined radio state:" << m_currentState);
     }
+
+    Time duration = Simulator::Now() - from;
+    if (m_currentState != EndDeviceLoraPhy::SLEEP || !duration.IsStrictlyPositive())
+    {
+        return currentA;
+    }
+
+    // Skipped receive windows are charged at the STANDBY current
+    Time idle = Seconds(0);
+    for (const auto& window : m_idleReceiveWindows)
+    {
+        Time start = std::max(window.first, from);
+        Time end = std::min(window.second, Simulator::Now());
+        if (end > start)
+        {
+            idle += end - start;
+        }
+    }
+    return currentA + (m_idleCurrentA - currentA) * idle.GetSeconds() / duration.GetSeconds();
 }
 
 void
@@ -368,6 +424,7 @@ LoraRadioEnergyModelPhyListener::LoraRadioEnergyModelPhyListener()
     NS_LOG_FUNCTION(this);
     m_changeStateCallback.Nullify();
     m_updateTxCurrentCallback.Nullify();
+    m_idleReceiveWindowCallback.Nullify();
 }
 
 LoraRadioEnergyModelPhyListener::~LoraRadioEnergyModelPhyListener()
@@ -392,6 +449,14 @@ LoraRadioEnergyModelPhyListener::SetUpdateTxCurrentCallback(UpdateTxCurrentCallb
     m_updateTxCurrentCallback = callback;
 }
 
+void
+LoraRadioEnergyModelPhyListener::SetIdleReceiveWindowCallback(IdleReceiveWindowCallback callback)
+{
+    NS_LOG_FUNCTION(this << &callback);
+    NS_ASSERT(!callback.IsNull());
+    m_idleReceiveWindowCallback = callback;
+}
+
 void
 LoraRadioEnergyModelPhyListener::NotifyRxStart()
 {
@@ -441,6 +506,17 @@ LoraRadioEnergyModelPhyListener::NotifyStandby()
     m_changeStateCallback(EndDeviceLoraPhy::STANDBY);
 }
 
+void
+LoraRadioEnergyModelPhyListener::NotifyIdleReceiveWindow(Time start, Time duration)
+{
+    NS_LOG_FUNCTION(this << start << duration);
+    if (m_idleReceiveWindowCallback.IsNull())
+    {
+        NS_FATAL_ERROR("LoraRadioEnergyModelPhyListener:Idle receive window callback not set!");
+    }
+    m_idleReceiveWindowCallback(start, duration);
+}
+
 /*
  * Private function state here.
  */
@@ -16,6 +16,9 @@
 #include "ns3/device-energy-model.h"
 #include "ns3/traced-value.h"
 
+#include <deque>
+#include <utility>
+
 namespace ns3
 {
 namespace lorawan
@@ -36,6 +39,11 @@ class LoraRadioEnergyModelPhyListener : public EndDeviceLoraPhyListener
      */
     typedef Callback<void, double> UpdateTxCurrentCallback;
 
+    /**
+     * Callback type for accounting a receive window that was skipped while sleeping.
+     */
+    typedef Callback<void, Time, Time> IdleReceiveWindowCallback;
+
     LoraRadioEnergyModelPhyListener();           //!< Default constructor
     ~LoraRadioEnergyModelPhyListener() override; //!< Destructor
 
@@ -53,6 +61,13 @@ class LoraRadioEnergyModelPhyListener : public EndDeviceLoraPhyListener
      */
     void SetUpdateTxCurrentCallback(UpdateTxCurrentCallback callback);
 
+    /**
+     * Sets the idle receive window callback.
+     *
+     * \param callback Idle receive window callback.
+     */
+    void SetIdleReceiveWindowCallback(IdleReceiveWindowCallback callback);
+
     /**
      * Switches the LoraRadioEnergyModel to RX state.
      *
@@ -80,6 +95,16 @@ class LoraRadioEnergyModelPhyListener : public EndDeviceLoraPhyListener
      */
     void NotifyStandby() override;
 
+    /**
+     * Forwards the skipped receive window to the LoraRadioEnergyModel.
+     *
+     * \param start The time at which the skipped window would have opened.
+     * \param duration The duration of the skipped window.
+     *
+     * Defined in ns3::LoraEndDevicePhyListener.
+     */
+    void NotifyIdleReceiveWindow(Time start, Time duration) override;
+
   private:
     /**
      * A helper function that makes scheduling m_changeStateCallback possible.
@@ -97,6 +122,12 @@ class LoraRadioEnergyModelPhyListener : public EndDeviceLoraPhyListener
      * the nominal tx power used to transmit the current frame.
      */
     UpdateTxCurrentCallback m_updateTxCurrentCallback;
+
+    /**
+     * Callback used to notify the LoraRadioEnergyModel of a receive window that
+     * was skipped while the radio was sleeping.
+     */
+    IdleReceiveWindowCallback m_idleReceiveWindowCallback;
 };
 
 /**
@@ -151,7 +182,7 @@ class LoraRadioEnergyModel : public DeviceEnergyModel
     void SetEnergySource(Ptr<EnergySource> source) override;
 
     /**
-     * \return Total energy consumption of the wifi device.
+     * \return Total energy consumption of the wifi device, up to now.
      *
      * Implements DeviceEnergyModel::GetTotalEnergyConsumption.
      */
@@ -241,6 +272,21 @@ class LoraRadioEnergyModel : public DeviceEnergyModel
     // NOTICE VERY WELL: Current  Model linear or constant as possible choices
     void SetTxCurrentFromModel(double txPowerDbm);
 
+    /**
+     * Account a receive window that the MAC layer decided not to open because
+     * it was known to be empty.
+     *
+     * The radio stays in SLEEP, but the interval [start, start + duration] is
+     * charged at the STANDBY current, exactly as if the window had been opened
+     * and closed through the PHY state machine. No event is scheduled: the
+     * window is settled by the next state change, and the current reported to
+     * the energy source is averaged over the time since it last asked for it.
+     *
+     * \param start The time at which the window would have opened.
+     * \param duration The duration of the window.
+     */
+    void AddIdleReceiveWindow(Time start, Time duration);
+
     /**
      * Changes state of the LoraRadioEnergyMode.
      *
@@ -294,6 +340,16 @@ class LoraRadioEnergyModel : public DeviceEnergyModel
      */
     void SetLoraRadioState(const EndDeviceLoraPhy::State state);
 
+    /**
+     * Get the average current drawn in the current state from a time in the
+     * past until now, including the skipped receive windows in that interval.
+     *
+     * \param from The start of the interval, which must not precede the last
+     * state change.
+     * \return The average current, in Ampere.
+     */
+    double GetAverageCurrentA(Time from) const;
+
     Ptr<EnergySource> m_source; ///< energy source
 
     // Member variables for current draw in different radio modes.
@@ -311,6 +367,10 @@ class LoraRadioEnergyModel : public DeviceEnergyModel
     EndDeviceLoraPhy::State m_currentState; ///< current state the radio is in
     Time m_lastUpdateTime;                  ///< time stamp of previous energy update
 
+    mutable Time m_lastCurrentQuery; ///< time the energy source last asked for the current
+    /// start and end times of the skipped receive windows that are not settled yet
+    std::deque<std::pair<Time, Time>> m_idleReceiveWindows;
+
     uint8_t m_nPendingChangeState;  ///< pending state change
     bool m_isSupersededChangeState; ///< superseded change state
 
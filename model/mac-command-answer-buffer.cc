@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#include "mac-command-answer-buffer.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+NS_LOG_COMPONENT_DEFINE("MacCommandAnswerBuffer");
+
+MacCommandAnswerBuffer::MacCommandAnswerBuffer()
+    : m_size(0)
+{
+}
+
+bool
+MacCommandAnswerBuffer::AddLinkAdrAns(bool powerAck, bool dataRateAck, bool channelMaskAck)
+{
+    NS_LOG_FUNCTION(this << powerAck << dataRateAck << channelMaskAck);
+
+    uint8_t payload =
+        (uint8_t(powerAck) << 2) | (uint8_t(dataRateAck) << 1) | uint8_t(channelMaskAck);
+    return Insert(LINK_ADR_ANS, &payload, 1, true);
+}
+
+bool
+MacCommandAnswerBuffer::AddDutyCycleAns()
+{
+    NS_LOG_FUNCTION(this);
+
+    return Insert(DUTY_CYCLE_ANS, nullptr, 0, true);
+}
+
+bool
+MacCommandAnswerBuffer::AddRxParamSetupAns(bool rx1DrOffsetAck,
+                                           bool rx2DataRateAck,
+                                           bool channelAck)
+{
+    NS_LOG_FUNCTION(this << rx1DrOffsetAck << rx2DataRateAck << channelAck);
+
+    uint8_t payload =
+        (uint8_t(rx1DrOffsetAck) << 2) | (uint8_t(rx2DataRateAck) << 1) | uint8_t(channelAck);
+    return Insert(RX_PARAM_SETUP_ANS, &payload, 1, true);
+}
+
+bool
+MacCommandAnswerBuffer::AddDevStatusAns(uint8_t battery, uint8_t margin)
+{
+    NS_LOG_FUNCTION(this << unsigned(battery) << unsigned(margin));
+
+    uint8_t payload[2] = {battery, margin};
+    return Insert(DEV_STATUS_ANS, payload, 2, true);
+}
+
+bool
+MacCommandAnswerBuffer::AddNewChannelAns(bool dataRateRangeOk, bool channelFrequencyOk)
+{
+    NS_LOG_FUNCTION(this << dataRateRangeOk << channelFrequencyOk);
+
+    // Each NewChannelReq refers to a different channel, so answers are kept separate
+    uint8_t payload = (uint8_t(dataRateRangeOk) << 1) | uint8_t(channelFrequencyOk);
+    return Insert(NEW_CHANNEL_ANS, &payload, 1, false);
+}
+
+const uint8_t*
+MacCommandAnswerBuffer::GetBuffer() const
+{
+    return m_buffer.data();
+}
+
+uint8_t
+MacCommandAnswerBuffer::GetSize() const
+{
+    return m_size;
+}
+
+bool
+MacCommandAnswerBuffer::IsEmpty() const
+{
+    return m_size == 0;
+}
+
+void
+MacCommandAnswerBuffer::Clear()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_size = 0;
+}
+
+bool
+MacCommandAnswerBuffer::Insert(MacCommandType commandType,
+                               const uint8_t* payload,
+                               uint8_t payloadSize,
+                               bool coalesce)
+{
+    uint8_t cid = MacCommand::GetCIDFromMacCommand(commandType);
+
+    // Overwrite the previous answer of the same type, if any
+    if (coalesce)
+    {
+        for (uint8_t i = 0; i < m_size; i += GetSerializedSizeFromCid(m_buffer[i]))
+        {
+            if (m_buffer[i] == cid)
+            {
+                NS_LOG_DEBUG("Replacing previous answer of CID " << unsigned(cid));
+                std::copy(payload, payload + payloadSize, m_buffer.begin() + i + 1);
+                return true;
+            }
+        }
+    }
+
+    if (m_size + 1 + payloadSize > MAX_SIZE)
+    {
+        NS_LOG_WARN("Answer of CID " << unsigned(cid) << " does not fit in the FOpts field.");
+        return false;
+    }
+
+    m_buffer[m_size] = cid;
+    std::copy(payload, payload + payloadSize, m_buffer.begin() + m_size + 1);
+    m_size += 1 + payloadSize;
+
+    NS_LOG_DEBUG("Stored answer of CID " << unsigned(cid) << ", buffer size is "
+                                         << unsigned(m_size));
+
+    return true;
+}
+
+uint8_t
+MacCommandAnswerBuffer::GetSerializedSizeFromCid(uint8_t cid)
+{
+    switch (cid)
+    {
+    case (0x02): // LinkCheckReq
+    case (0x04): // DutyCycleAns
+    case (0x08): // RxTimingSetupAns
+    case (0x09): // TxParamSetupAns
+        return 1;
+    case (0x03): // LinkAdrAns
+    case (0x05): // RxParamSetupAns
+    case (0x07): // NewChannelAns
+    case (0x0A): // DlChannelAns
+        return 2;
+    case (0x06): // DevStatusAns
+        return 3;
+    default:
+        NS_ABORT_MSG("Unknown uplink CID " << unsigned(cid));
+        return 1;
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
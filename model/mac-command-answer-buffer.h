@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: agent <agent@local>
+ */
+
+#ifndef MAC_COMMAND_ANSWER_BUFFER_H
+#define MAC_COMMAND_ANSWER_BUFFER_H
+
+#include "mac-command.h"
+
+#include <array>
+#include <cstdint>
+
+namespace ns3
+{
+namespace lorawan
+{
+
+/**
+ * \ingroup lorawan
+ *
+ * Fixed-capacity buffer holding, in serialized form, the MAC command answers an
+ * end device still has to send to the network server.
+ *
+ * Answers are written directly in their FOpts representation, so that they can
+ * be appended to the next uplink without allocating MacCommand objects. The
+ * capacity of the buffer matches the maximum length of the FOpts field: answers
+ * that would not fit are rejected at insertion time. Answers that only need to
+ * be sent once per uplink (i.e., all but NewChannelAns) replace any previous
+ * answer of the same kind that is still waiting in the buffer.
+ */
+class MacCommandAnswerBuffer
+{
+  public:
+    static constexpr uint8_t MAX_SIZE = 15; //!< Maximum length of the FOpts field [bytes]
+
+    MacCommandAnswerBuffer(); //!< Default constructor
+
+    /**
+     * Add a LinkAdrAns answer.
+     *
+     * \param powerAck Whether the power can be set or not.
+     * \param dataRateAck Whether the data rate can be set or not.
+     * \param channelMaskAck Whether the channel mask is coherent with the device's current state or
+     * not.
+     * \return Whether the answer could be stored.
+     */
+    bool AddLinkAdrAns(bool powerAck, bool dataRateAck, bool channelMaskAck);
+
+    /**
+     * Add a DutyCycleAns answer.
+     *
+     * \return Whether the answer could be stored.
+     */
+    bool AddDutyCycleAns();
+
+    /**
+     * Add a RxParamSetupAns answer.
+     *
+     * \param rx1DrOffsetAck Whether or not the offset was correctly set.
+     * \param rx2DataRateAck Whether or not the second slot data rate was correctly set.
+     * \param channelAck Whether or not the second slot frequency was correctly set.
+     * \return Whether the answer could be stored.
+     */
+    bool AddRxParamSetupAns(bool rx1DrOffsetAck, bool rx2DataRateAck, bool channelAck);
+
+    /**
+     * Add a DevStatusAns answer.
+     *
+     * \param battery The battery level in [0, 255].
+     * \param margin The demodulation margin of the last received DevStatusReq packet.
+     * \return Whether the answer could be stored.
+     */
+    bool AddDevStatusAns(uint8_t battery, uint8_t margin);
+
+    /**
+     * Add a NewChannelAns answer.
+     *
+     * \param dataRateRangeOk Whether or not the requested data rate range was set correctly.
+     * \param channelFrequencyOk Whether or not the requested channel frequency was set correctly.
+     * \return Whether the answer could be stored.
+     */
+    bool AddNewChannelAns(bool dataRateRangeOk, bool channelFrequencyOk);
+
+    /**
+     * Get the serialized answers.
+     *
+     * \return A pointer to the first byte of the serialized answers.
+     */
+    const uint8_t* GetBuffer() const;
+
+    /**
+     * Get the length of the serialized answers.
+     *
+     * \return The length of the serialized answers [bytes].
+     */
+    uint8_t GetSize() const;
+
+    /**
+     * Check whether there are answers waiting to be sent.
+     *
+     * \return True if the buffer is empty, false otherwise.
+     */
+    bool IsEmpty() const;
+
+    /**
+     * Remove all answers from the buffer.
+     */
+    void Clear();
+
+  private:
+    /**
+     * Store an answer in the buffer.
+     *
+     * \param commandType The type of the answer.
+     * \param payload The payload of the answer, CID excluded.
+     * \param payloadSize The length of the payload [bytes].
+     * \param coalesce Whether the answer replaces a previous one of the same type.
+     * \return Whether the answer could be stored.
+     */
+    bool Insert(MacCommandType commandType,
+                const uint8_t* payload,
+                uint8_t payloadSize,
+                bool coalesce);
+
+    /**
+     * Get the serialized size of an uplink MAC command, CID included.
+     *
+     * \param cid The CID of the command.
+     * \return The serialized size of the command [bytes].
+     */
+    static uint8_t GetSerializedSizeFromCid(uint8_t cid);
+
+    std::array<uint8_t, MAX_SIZE> m_buffer; //!< The serialized answers
+    uint8_t m_size;                         //!< The length of the serialized answers [bytes]
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* MAC_COMMAND_ANSWER_BUFFER_H */
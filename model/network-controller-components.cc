@@ -33,6 +33,59 @@ NetworkControllerComponent::~NetworkControllerComponent()
 {
 }
 
+uint32_t
+NetworkControllerComponent::GetReceivedPacketHistorySize() const
+{
+    return 4;
+}
+
+NetworkControllerComponent::Subscription
+NetworkControllerComponent::GetReceivedPacketSubscription() const
+{
+    return Subscription::All();
+}
+
+NetworkControllerComponent::Subscription
+NetworkControllerComponent::GetReplySubscription() const
+{
+    return GetReceivedPacketSubscription();
+}
+
+NetworkControllerComponent::Subscription
+NetworkControllerComponent::Subscription::None()
+{
+    return Subscription();
+}
+
+NetworkControllerComponent::Subscription
+NetworkControllerComponent::Subscription::All()
+{
+    Subscription subscription;
+    subscription.mTypes = 0xff;
+    return subscription;
+}
+
+NetworkControllerComponent::Subscription&
+NetworkControllerComponent::Subscription::WithMType(LorawanMacHeader::MType mType)
+{
+    mTypes |= 1 << mType;
+    return *this;
+}
+
+NetworkControllerComponent::Subscription&
+NetworkControllerComponent::Subscription::WithFCtrl(uint8_t bits)
+{
+    fCtrl |= bits;
+    return *this;
+}
+
+NetworkControllerComponent::Subscription&
+NetworkControllerComponent::Subscription::WithCommand(MacCommandType command)
+{
+    commands.push_back(command);
+    return *this;
+}
+
 ////////////////////////////////
 // ConfirmedMessagesComponent //
 ////////////////////////////////
@@ -55,19 +108,15 @@ ConfirmedMessagesComponent::~ConfirmedMessagesComponent()
 }
 
 void
-ConfirmedMessagesComponent::OnReceivedPacket(Ptr<const Packet> packet,
-                                             Ptr<EndDeviceStatus> status,
+ConfirmedMessagesComponent::OnReceivedPacket(const UplinkContext& context,
                                              Ptr<NetworkStatus> networkStatus)
 {
-    NS_LOG_FUNCTION(this->GetTypeId() << packet << networkStatus);
+    NS_LOG_FUNCTION(this->GetTypeId() << context.packet << networkStatus);
 
     // Check whether the received packet requires an acknowledgment.
-    LorawanMacHeader mHdr;
-    LoraFrameHeader fHdr;
-    fHdr.SetAsUplink();
-    Ptr<Packet> myPacket = packet->Copy();
-    myPacket->RemoveHeader(mHdr);
-    myPacket->RemoveHeader(fHdr);
+    const LorawanMacHeader& mHdr = context.macHeader;
+    const LoraFrameHeader& fHdr = context.frameHeader;
+    Ptr<EndDeviceStatus> status = context.endDeviceStatus;
 
     NS_LOG_INFO("Received packet Mac Header: " << mHdr);
     NS_LOG_INFO("Received packet Frame Header: " << fHdr);
@@ -111,6 +160,24 @@ ConfirmedMessagesComponent::OnFailedReply(Ptr<EndDeviceStatus> status,
     status->m_reply.frameHeader.SetAck(false);
 }
 
+NetworkControllerComponent::Subscription
+ConfirmedMessagesComponent::GetReceivedPacketSubscription() const
+{
+    return Subscription::None().WithMType(LorawanMacHeader::CONFIRMED_DATA_UP);
+}
+
+NetworkControllerComponent::Subscription
+ConfirmedMessagesComponent::GetReplySubscription() const
+{
+    return Subscription::None();
+}
+
+uint32_t
+ConfirmedMessagesComponent::GetReceivedPacketHistorySize() const
+{
+    return 1;
+}
+
 ////////////////////////
 // LinkCheckComponent //
 ////////////////////////
@@ -133,11 +200,10 @@ LinkCheckComponent::~LinkCheckComponent()
 }
 
 void
-LinkCheckComponent::OnReceivedPacket(Ptr<const Packet> packet,
-                                     Ptr<EndDeviceStatus> status,
+LinkCheckComponent::OnReceivedPacket(const UplinkContext& context,
                                      Ptr<NetworkStatus> networkStatus)
 {
-    NS_LOG_FUNCTION(this->GetTypeId() << packet << networkStatus);
+    NS_LOG_FUNCTION(this->GetTypeId() << context.packet << networkStatus);
 
     // We will only act just before reply, when all Gateways will have received
     // the packet.
@@ -149,17 +215,8 @@ LinkCheckComponent::BeforeSendingReply(Ptr<EndDeviceStatus> status,
 {
     NS_LOG_FUNCTION(this << status << networkStatus);
 
-    Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice()->Copy();
-    LorawanMacHeader mHdr;
-    LoraFrameHeader fHdr;
-    fHdr.SetAsUplink();
-    myPacket->RemoveHeader(mHdr);
-    myPacket->RemoveHeader(fHdr);
-
-    Ptr<LinkCheckReq> command = fHdr.GetMacCommand<LinkCheckReq>();
-
-    // GetMacCommand returns 0 if no command is found
-    if (command)
+    // The commands of the last packet were decoded when it was received
+    if (status->GetLastUplinkFields().HasCommand(LINK_CHECK_REQ))
     {
         status->m_reply.needsReply = true;
 
@@ -184,5 +241,23 @@ LinkCheckComponent::OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus
 {
     NS_LOG_FUNCTION(this->GetTypeId() << networkStatus);
 }
+
+NetworkControllerComponent::Subscription
+LinkCheckComponent::GetReceivedPacketSubscription() const
+{
+    return Subscription::None();
+}
+
+NetworkControllerComponent::Subscription
+LinkCheckComponent::GetReplySubscription() const
+{
+    return Subscription::None().WithCommand(LINK_CHECK_REQ);
+}
+
+uint32_t
+LinkCheckComponent::GetReceivedPacketHistorySize() const
+{
+    return 1;
+}
 } // namespace lorawan
 } // namespace ns3
@@ -9,12 +9,17 @@
 #ifndef NETWORK_CONTROLLER_COMPONENTS_H
 #define NETWORK_CONTROLLER_COMPONENTS_H
 
+#include "lorawan-mac-header.h"
+#include "mac-command.h"
 #include "network-status.h"
 
 #include "ns3/log.h"
 #include "ns3/object.h"
 #include "ns3/packet.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace ns3
 {
 namespace lorawan
@@ -34,10 +39,76 @@ class NetworkStatus;
  * This is the class that is meant to be extended by all NetworkController
  * components, and provides a common interface for the NetworkController to
  * query available components and prompt them to act on new packet arrivals.
+ *
+ * Components declare the uplinks they are interested in through a
+ * Subscription, and are only called for matching packets.
  */
 class NetworkControllerComponent : public Object
 {
   public:
+    /**
+     * Bits of the uplink FCtrl field a component can subscribe to, as they
+     * appear in the serialized field.
+     */
+    enum FCtrlBit : uint8_t
+    {
+        FCTRL_ADR = 0x80,
+        FCTRL_ADR_ACK_REQ = 0x40,
+        FCTRL_ACK = 0x20,
+        FCTRL_F_PENDING = 0x10,
+    };
+
+    /**
+     * The uplinks a component is interested in. An uplink matches a
+     * subscription if it has any of the subscribed message types, any of the
+     * subscribed FCtrl bits set, or contains any of the subscribed MAC
+     * commands.
+     */
+    struct Subscription
+    {
+        /**
+         * Build a subscription to no uplink.
+         *
+         * \return The subscription.
+         */
+        static Subscription None();
+
+        /**
+         * Build a subscription to every uplink.
+         *
+         * \return The subscription.
+         */
+        static Subscription All();
+
+        /**
+         * Add a message type to the subscription.
+         *
+         * \param mType The message type.
+         * \return This subscription.
+         */
+        Subscription& WithMType(LorawanMacHeader::MType mType);
+
+        /**
+         * Add FCtrl bits to the subscription.
+         *
+         * \param bits The bitwise or of FCtrlBit values.
+         * \return This subscription.
+         */
+        Subscription& WithFCtrl(uint8_t bits);
+
+        /**
+         * Add a MAC command to the subscription.
+         *
+         * \param command The type of the MAC command.
+         * \return This subscription.
+         */
+        Subscription& WithCommand(MacCommandType command);
+
+        uint8_t mTypes = 0; //!< Bitmask of message types, bit i standing for MType i
+        uint8_t fCtrl = 0;  //!< Bitmask of FCtrlBit values
+        std::vector<MacCommandType> commands; //!< Types of MAC commands
+    };
+
     /**
      *  Register this type.
      *  \return The object TypeId.
@@ -51,12 +122,11 @@ class NetworkControllerComponent : public Object
     /**
      * Function called as a new uplink packet is received by the NetworkServer application.
      *
-     * \param packet The newly received packet.
-     * \param status A pointer to the status of the end device that sent the packet.
+     * \param context The newly received packet, its decoded headers and the
+     * status of the end device that sent it.
      * \param networkStatus A pointer to the NetworkStatus object.
      */
-    virtual void OnReceivedPacket(Ptr<const Packet> packet,
-                                  Ptr<EndDeviceStatus> status,
+    virtual void OnReceivedPacket(const UplinkContext& context,
                                   Ptr<NetworkStatus> networkStatus) = 0;
     /**
      * Function called as a downlink reply is about to leave the NetworkServer application.
@@ -73,6 +143,34 @@ class NetworkControllerComponent : public Object
      * \param networkStatus A pointer to the NetworkStatus object.
      */
     virtual void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) = 0;
+
+    /**
+     * Get the number of most recent packets of each device this component
+     * needs the EndDeviceStatus to keep. Components that read more packets
+     * through EndDeviceStatus::GetReceivedPacketList must override it, and
+     * components that only read the last one should, to save memory.
+     *
+     * \return The number of packets (by default, the four packets the
+     * AdrComponent used to read with its default HistoryRange).
+     */
+    virtual uint32_t GetReceivedPacketHistorySize() const;
+
+    /**
+     * Get the uplinks this component needs OnReceivedPacket to be called for.
+     * The subscription is read once, when the component is installed.
+     *
+     * \return The subscription (every uplink by default).
+     */
+    virtual Subscription GetReceivedPacketSubscription() const;
+
+    /**
+     * Get the uplinks this component needs BeforeSendingReply to be called
+     * for, when they are the last ones received from the device being replied
+     * to. The subscription is read once, when the component is installed.
+     *
+     * \return The subscription (the received packet one by default).
+     */
+    virtual Subscription GetReplySubscription() const;
 };
 
 /**
@@ -96,17 +194,35 @@ class ConfirmedMessagesComponent : public NetworkControllerComponent
      * This method checks whether the received packet requires an acknowledgment
      * and sets up the appropriate reply in case it does.
      *
-     * \param packet The newly received packet.
-     * \param status A pointer to the EndDeviceStatus object of the sender.
+     * \param context The newly received packet, decoded.
      * \param networkStatus A pointer to the NetworkStatus object.
      */
-    void OnReceivedPacket(Ptr<const Packet> packet,
-                          Ptr<EndDeviceStatus> status,
-                          Ptr<NetworkStatus> networkStatus) override;
+    void OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus) override;
 
     void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
 
     void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
+
+    /**
+     * Subscribe to confirmed uplinks only.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReceivedPacketSubscription() const override;
+
+    /**
+     * Do not subscribe to replies, since nothing needs to be done before them.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReplySubscription() const override;
+
+    /**
+     * Only the last packet of each device is needed.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetReceivedPacketHistorySize() const override;
 };
 
 /**
@@ -130,18 +246,37 @@ class LinkCheckComponent : public NetworkControllerComponent
      * This method checks whether the received packet requires an acknowledgment
      * and sets up the appropriate reply in case it does.
      *
-     * \param packet The newly received packet.
-     * \param status A pointer to the EndDeviceStatus object of the sender.
+     * \param context The newly received packet, decoded.
      * \param networkStatus A pointer to the NetworkStatus object.
      */
-    void OnReceivedPacket(Ptr<const Packet> packet,
-                          Ptr<EndDeviceStatus> status,
-                          Ptr<NetworkStatus> networkStatus) override;
+    void OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus) override;
 
     void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
 
     void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
 
+    /**
+     * Do not subscribe to uplinks, since the component only acts before
+     * replies.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReceivedPacketSubscription() const override;
+
+    /**
+     * Subscribe to uplinks containing a LinkCheckReq command.
+     *
+     * \return The subscription.
+     */
+    Subscription GetReplySubscription() const override;
+
+    /**
+     * Only the last packet of each device is needed.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetReceivedPacketHistorySize() const override;
+
   private:
 };
 } // namespace lorawan
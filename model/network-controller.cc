@@ -8,6 +8,8 @@
 
 #include "network-controller.h"
 
+#include "ns3/abort.h"
+
 namespace ns3
 {
 namespace lorawan
@@ -47,23 +49,42 @@ void
 NetworkController::Install(Ptr<NetworkControllerComponent> component)
 {
     NS_LOG_FUNCTION(this);
+
+    NS_ABORT_MSG_IF(m_components.size() >= 64, "At most 64 components can be installed");
+    uint32_t index = m_components.size();
     m_components.push_back(component);
+
+    // Compile the subscriptions of the component into the dispatch tables
+    m_receivedPacketTable.Add(component->GetReceivedPacketSubscription(), index);
+    m_replyTable.Add(component->GetReplySubscription(), index);
+
+    // Make sure devices keep enough packets for this component
+    uint32_t historySize = component->GetReceivedPacketHistorySize();
+    if (m_status && historySize > m_status->GetReceivedPacketHistorySize())
+    {
+        m_status->SetReceivedPacketHistorySize(historySize);
+    }
 }
 
 void
-NetworkController::OnNewPacket(Ptr<const Packet> packet)
+NetworkController::OnNewPacket(const UplinkContext& context)
 {
-    NS_LOG_FUNCTION(this << packet);
-
-    // NOTE As a future optimization, we can allow components to register their
-    // callbacks and only be called in case a certain MAC command is contained.
-    // For now, we call all components.
+    NS_LOG_FUNCTION(this << context.packet);
 
-    // Inform each component about the new packet
-    for (auto it = m_components.begin(); it != m_components.end(); ++it)
+    // Remember which components to call before replying to this packet. Copies
+    // received by other gateways match the same components.
+    uint16_t fCnt = context.frameHeader.GetFCnt();
+    auto& replySubscribers = m_replySubscribers[context.frameHeader.GetAddress().Get()];
+    if (replySubscribers.first != fCnt || replySubscribers.second == 0)
     {
-        (*it)->OnReceivedPacket(packet, m_status->GetEndDeviceStatus(packet), m_status);
+        replySubscribers = {fCnt, m_replyTable.Match(context)};
     }
+
+    // Inform each interested component about the new packet
+    Dispatch(m_receivedPacketTable.Match(context),
+             [this, &context](Ptr<NetworkControllerComponent> component) {
+                 component->OnReceivedPacket(context, m_status);
+             });
 }
 
 void
@@ -71,11 +92,63 @@ NetworkController::BeforeSendingReply(Ptr<EndDeviceStatus> endDeviceStatus)
 {
     NS_LOG_FUNCTION(this);
 
-    // Inform each component about the imminent reply
-    for (auto it = m_components.begin(); it != m_components.end(); ++it)
+    auto it = m_replySubscribers.find(endDeviceStatus->m_endDeviceAddress.Get());
+    if (it == m_replySubscribers.end())
+    {
+        return;
+    }
+
+    // Inform each interested component about the imminent reply
+    Dispatch(it->second.second,
+             [this, &endDeviceStatus](Ptr<NetworkControllerComponent> component) {
+                 component->BeforeSendingReply(endDeviceStatus, m_status);
+             });
+}
+
+NetworkController::DispatchTable::DispatchTable()
+{
+    m_mTypes.fill(0);
+    m_fCtrl.fill(0);
+    m_commands.fill(0);
+}
+
+void
+NetworkController::DispatchTable::Add(const NetworkControllerComponent::Subscription& subscription,
+                                      uint32_t index)
+{
+    uint64_t bit = uint64_t(1) << index;
+    for (std::size_t i = 0; i < 8; i++)
+    {
+        if (subscription.mTypes & (1 << i))
+        {
+            m_mTypes[i] |= bit;
+        }
+        if (subscription.fCtrl & (1 << i))
+        {
+            m_fCtrl[i] |= bit;
+        }
+    }
+    for (auto command : subscription.commands)
+    {
+        m_commands.at(command) |= bit;
+    }
+}
+
+uint64_t
+NetworkController::DispatchTable::Match(const UplinkContext& context) const
+{
+    const LoraFrameHeader& fHdr = context.frameHeader;
+
+    uint64_t mask = m_mTypes[context.macHeader.GetMType() & 0x07];
+    mask |= fHdr.GetAdr() ? m_fCtrl[7] : 0;
+    mask |= fHdr.GetAdrAckReq() ? m_fCtrl[6] : 0;
+    mask |= fHdr.GetAck() ? m_fCtrl[5] : 0;
+    mask |= fHdr.GetFPending() ? m_fCtrl[4] : 0;
+    for (const auto& command : fHdr.GetCommands())
     {
-        (*it)->BeforeSendingReply(endDeviceStatus, m_status);
+        mask |= m_commands[command->GetCommandType()];
     }
+    return mask;
 }
 
 } // namespace lorawan
@@ -15,6 +15,12 @@
 #include "ns3/object.h"
 #include "ns3/packet.h"
 
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace ns3
 {
 namespace lorawan
@@ -29,6 +35,10 @@ class NetworkControllerComponent;
  * This class collects a series of components that deal with various aspects
  * of managing the network, and queries them for action when a new packet is
  * received or other events occur in the network.
+ *
+ * The subscriptions of the components are compiled into bitmask tables when
+ * they are installed, so that each event only reaches the interested
+ * components. At most 64 components can be installed.
  */
 class NetworkController : public Object
 {
@@ -59,9 +69,9 @@ class NetworkController : public Object
     /**
      * Method that is called by the NetworkServer application when a new packet is received.
      *
-     * \param packet The newly received packet.
+     * \param context The newly received packet, decoded.
      */
-    void OnNewPacket(Ptr<const Packet> packet);
+    void OnNewPacket(const UplinkContext& context);
 
     /**
      * Method that is called by the NetworkScheduler just before sending a reply
@@ -72,11 +82,73 @@ class NetworkController : public Object
     void BeforeSendingReply(Ptr<EndDeviceStatus> endDeviceStatus);
 
   private:
+    /**
+     * For each feature of an uplink, the bitmask of the components subscribed
+     * to it, bit i standing for the i-th installed component.
+     */
+    class DispatchTable
+    {
+      public:
+        DispatchTable(); //!< Default constructor
+
+        /**
+         * Add the subscription of a component to the table.
+         *
+         * \param subscription The subscription.
+         * \param index The index of the component.
+         */
+        void Add(const NetworkControllerComponent::Subscription& subscription, uint32_t index);
+
+        /**
+         * Get the components subscribed to an uplink.
+         *
+         * \param context The decoded uplink.
+         * \return The bitmask of the components.
+         */
+        uint64_t Match(const UplinkContext& context) const;
+
+      private:
+        std::array<uint64_t, 8> m_mTypes; //!< Subscribers to each message type
+        std::array<uint64_t, 8> m_fCtrl;  //!< Subscribers to each FCtrl bit, by bit position
+        std::array<uint64_t, DL_CHANNEL_ANS + 1> m_commands; //!< Subscribers to each MAC command
+    };
+
+    /**
+     * Call a function on the components whose bit is set in a bitmask.
+     *
+     * \param mask The bitmask of the components.
+     * \param function The function to call on each component.
+     */
+    template <typename F>
+    void Dispatch(uint64_t mask, F function);
+
     Ptr<NetworkStatus> m_status; //!< A pointer to the NetworkStatus object.
-    std::list<Ptr<NetworkControllerComponent>>
-        m_components; //!< List of NetworkControllerComponent objects.
+    std::vector<Ptr<NetworkControllerComponent>>
+        m_components; //!< NetworkControllerComponent objects, in installation order.
+
+    DispatchTable m_receivedPacketTable; //!< Subscriptions to received packets
+    DispatchTable m_replyTable;          //!< Subscriptions to replies
+
+    /**
+     * For each device, the frame counter of its last uplink and the bitmask of
+     * the components subscribed to replies to it.
+     */
+    std::unordered_map<uint32_t, std::pair<uint16_t, uint64_t>> m_replySubscribers;
 };
 
+template <typename F>
+void
+NetworkController::Dispatch(uint64_t mask, F function)
+{
+    for (std::size_t i = 0; mask != 0; i++, mask >>= 1)
+    {
+        if (mask & 1)
+        {
+            function(m_components[i]);
+        }
+    }
+}
+
 } // namespace lorawan
 
 } // namespace ns3
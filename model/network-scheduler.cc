@@ -1,5 +1,7 @@
 #include "network-scheduler.h"
 
+#include <algorithm>
+
 namespace ns3
 {
 namespace lorawan
@@ -25,11 +27,15 @@ NetworkScheduler::GetTypeId()
 }
 
 NetworkScheduler::NetworkScheduler()
+    : m_nPendingWindows(0),
+      m_nextEventNs(0)
 {
 }
 
 NetworkScheduler::NetworkScheduler(Ptr<NetworkStatus> status, Ptr<NetworkController> controller)
-    : m_status(status),
+    : m_nPendingWindows(0),
+      m_nextEventNs(0),
+      m_status(status),
       m_controller(controller)
 {
 }
@@ -38,45 +44,34 @@ NetworkScheduler::~NetworkScheduler()
 {
 }
 
+const Time NetworkScheduler::receiveDelay1 = Seconds(1);
+
 void
-NetworkScheduler::OnReceivedPacket(Ptr<const Packet> packet)
+NetworkScheduler::OnReceivedPacket(const UplinkContext& context)
 {
-    NS_LOG_FUNCTION(packet);
-
-    // Get the current packet's frame counter
-    Ptr<Packet> packetCopy = packet->Copy();
-    LorawanMacHeader receivedMacHdr;
-    packetCopy->RemoveHeader(receivedMacHdr);
-    LoraFrameHeader receivedFrameHdr;
-    receivedFrameHdr.SetAsUplink();
-    packetCopy->RemoveHeader(receivedFrameHdr);
+    NS_LOG_FUNCTION(context.packet);
 
     // Need to decide whether to schedule a receive window
-    if (!m_status->GetEndDeviceStatus(packet)->HasReceiveWindowOpportunityScheduled())
+    if (!context.endDeviceStatus->HasReceiveWindowOpportunityScheduled())
     {
-        // Extract the address
-        LoraDeviceAddress deviceAddress = receivedFrameHdr.GetAddress();
-
-        // Schedule OnReceiveWindowOpportunity event
-        m_status->GetEndDeviceStatus(packet)->SetReceiveWindowOpportunity(
-            Simulator::Schedule(Seconds(1),
-                                &NetworkScheduler::OnReceiveWindowOpportunity,
-                                this,
-                                deviceAddress,
-                                1)); // This will be the first receive window
+        // Schedule the first receive window, one second after the packet
+        // reached the server
+        Time delay = receiveDelay1 - (Simulator::Now() - context.receptionTime);
+        ScheduleReceiveWindow(context.endDeviceStatus, 1, delay);
     }
 }
 
 void
-NetworkScheduler::OnReceiveWindowOpportunity(LoraDeviceAddress deviceAddress, int window)
+NetworkScheduler::OnReceiveWindowOpportunity(Ptr<EndDeviceStatus> edStatus, int window)
 {
-    NS_LOG_FUNCTION(deviceAddress);
+    NS_LOG_FUNCTION(edStatus->m_endDeviceAddress);
 
-    NS_LOG_DEBUG("Opening receive window number " << window << " for device " << deviceAddress);
+    NS_LOG_DEBUG("Opening receive window number " << window << " for device "
+                                                  << edStatus->m_endDeviceAddress);
 
     // Check whether we can send a reply to the device, again by using
     // NetworkStatus
-    Address gwAddress = m_status->GetBestGatewayForDevice(deviceAddress, window);
+    Address gwAddress = m_status->GetBestGatewayForDevice(edStatus, window);
 
     if (gwAddress == Address() && window == 1)
     {
@@ -84,14 +79,8 @@ NetworkScheduler::OnReceiveWindowOpportunity(LoraDeviceAddress deviceAddress, in
 
         // No suitable gateway was found, but there's still hope to find one for the
         // second window.
-        // Schedule another OnReceiveWindowOpportunity event
-        m_status->GetEndDeviceStatus(deviceAddress)
-            ->SetReceiveWindowOpportunity(
-                Simulator::Schedule(Seconds(1),
-                                    &NetworkScheduler::OnReceiveWindowOpportunity,
-                                    this,
-                                    deviceAddress,
-                                    2)); // This will be the second receive window
+        // Schedule the second receive window
+        ScheduleReceiveWindow(edStatus, 2, Seconds(1));
     }
     else if (gwAddress == Address() && window == 2)
     {
@@ -102,8 +91,8 @@ NetworkScheduler::OnReceiveWindowOpportunity(LoraDeviceAddress deviceAddress, in
 
         // Reset the reply
         // XXX Should we reset it here or keep it for the next opportunity?
-        m_status->GetEndDeviceStatus(deviceAddress)->RemoveReceiveWindowOpportunity();
-        m_status->GetEndDeviceStatus(deviceAddress)->InitializeReply();
+        edStatus->RemoveReceiveWindowOpportunity();
+        edStatus->InitializeReply();
     }
     else
     {
@@ -111,24 +100,139 @@ NetworkScheduler::OnReceiveWindowOpportunity(LoraDeviceAddress deviceAddress, in
 
         NS_LOG_DEBUG("Found available gateway with address: " << gwAddress);
 
-        m_controller->BeforeSendingReply(m_status->GetEndDeviceStatus(deviceAddress));
+        m_controller->BeforeSendingReply(edStatus);
 
-        // Check whether this device needs a response by querying m_status
-        bool needsReply = m_status->NeedsReply(deviceAddress);
+        // Check whether this device needs a response
+        bool needsReply = edStatus->NeedsReply();
 
         if (needsReply)
         {
             NS_LOG_INFO("A reply is needed");
 
             // Send the reply through that gateway
-            m_status->SendThroughGateway(m_status->GetReplyForDevice(deviceAddress, window),
-                                         gwAddress);
+            m_status->SendThroughGateway(m_status->GetReplyForDevice(edStatus, window), gwAddress);
 
             // Reset the reply
-            m_status->GetEndDeviceStatus(deviceAddress)->RemoveReceiveWindowOpportunity();
-            m_status->GetEndDeviceStatus(deviceAddress)->InitializeReply();
+            edStatus->RemoveReceiveWindowOpportunity();
+            edStatus->InitializeReply();
         }
     }
 }
+
+std::size_t
+NetworkScheduler::GetNPendingReceiveWindows() const
+{
+    return m_nPendingWindows;
+}
+
+void
+NetworkScheduler::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+
+    Simulator::Cancel(m_nextEvent);
+
+    // Valid opportunities would otherwise keep calling back this scheduler
+    for (const auto& pending : m_pendingWindows)
+    {
+        if (pending.edStatus->IsReceiveWindowOpportunityValid(pending.ticket))
+        {
+            pending.edStatus->RemoveReceiveWindowOpportunity();
+        }
+    }
+    m_pendingWindows.clear();
+    m_status = nullptr;
+    m_controller = nullptr;
+
+    Object::DoDispose();
+}
+
+void
+NetworkScheduler::ScheduleReceiveWindow(Ptr<EndDeviceStatus> edStatus, int window, Time delay)
+{
+    NS_LOG_FUNCTION(this << edStatus->m_endDeviceAddress << window << delay);
+
+    int64_t deadlineNs = (Simulator::Now() + delay).GetNanoSeconds();
+    Callback<void> removedCallback =
+        MakeCallback(&NetworkScheduler::OnReceiveWindowOpportunityRemoved, this);
+    PendingReceiveWindow pending = {deadlineNs,
+                                    edStatus,
+                                    edStatus->SetReceiveWindowOpportunity(removedCallback),
+                                    window};
+    m_nPendingWindows++;
+
+    // Keep the queue sorted, serving windows with the same deadline in the
+    // order they were scheduled
+    if (m_pendingWindows.empty() || m_pendingWindows.back().deadlineNs <= deadlineNs)
+    {
+        m_pendingWindows.push_back(pending);
+    }
+    else
+    {
+        auto it = std::upper_bound(m_pendingWindows.begin(),
+                                   m_pendingWindows.end(),
+                                   deadlineNs,
+                                   [](int64_t deadline, const PendingReceiveWindow& other) {
+                                       return deadline < other.deadlineNs;
+                                   });
+        m_pendingWindows.insert(it, pending);
+    }
+
+    ScheduleNextEvent();
+}
+
+void
+NetworkScheduler::OnReceiveWindowOpportunityRemoved()
+{
+    NS_LOG_FUNCTION(this);
+
+    NS_ASSERT(m_nPendingWindows > 0);
+    m_nPendingWindows--;
+}
+
+void
+NetworkScheduler::ScheduleNextEvent()
+{
+    if (m_pendingWindows.empty())
+    {
+        return;
+    }
+
+    // Make sure the pending event fires for the earliest deadline
+    int64_t deadlineNs = m_pendingWindows.front().deadlineNs;
+    if (!m_nextEvent.IsPending() || deadlineNs < m_nextEventNs)
+    {
+        Simulator::Cancel(m_nextEvent);
+        m_nextEventNs = deadlineNs;
+        m_nextEvent = Simulator::Schedule(NanoSeconds(deadlineNs) - Simulator::Now(),
+                                          &NetworkScheduler::ServeReceiveWindows,
+                                          this);
+    }
+}
+
+void
+NetworkScheduler::ServeReceiveWindows()
+{
+    NS_LOG_FUNCTION(this);
+
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    while (!m_pendingWindows.empty() && m_pendingWindows.front().deadlineNs <= nowNs)
+    {
+        PendingReceiveWindow pending = m_pendingWindows.front();
+        m_pendingWindows.pop_front();
+
+        // Skip opportunities that were removed or replaced
+        if (!pending.edStatus->IsReceiveWindowOpportunityValid(pending.ticket))
+        {
+            continue;
+        }
+
+        // The opportunity is not scheduled anymore while it is being served
+        pending.edStatus->RemoveReceiveWindowOpportunity();
+        OnReceiveWindowOpportunity(pending.edStatus, pending.window);
+    }
+
+    ScheduleNextEvent();
+}
 } // namespace lorawan
 } // namespace ns3
@@ -19,6 +19,9 @@
 #include "ns3/object.h"
 #include "ns3/packet.h"
 
+#include <cstdint>
+#include <deque>
+
 namespace ns3
 {
 namespace lorawan
@@ -32,6 +35,13 @@ class NetworkController; // Forward declaration
  *
  * Network server component in charge of scheduling downling packets onto devices' reception windows
  *
+ * Receive window opportunities of all devices are kept in a single queue,
+ * sorted by deadline, and served by a single simulator event, scheduled for
+ * the earliest deadline. All devices whose window opens at the same time are
+ * served as a batch. Since every deadline follows the reception of a packet by
+ * the same delay, opportunities are almost always appended at the back of the
+ * queue.
+ *
  * \todo We should probably add getters and setters or remove default constructor
  */
 class NetworkScheduler : public Object
@@ -55,26 +65,81 @@ class NetworkScheduler : public Object
      */
     NetworkScheduler(Ptr<NetworkStatus> status, Ptr<NetworkController> controller);
 
+    static const Time receiveDelay1; //!< The delay of the first receive window after an uplink
+
     /**
      * Method called by NetworkServer application to inform the Scheduler of a newly arrived uplink
      * packet.
      *
      * This function schedules the OnReceiveWindowOpportunity events 1 and 2 seconds later.
      *
-     * \param packet A pointer to the new Packet instance.
+     * \param context The decoded packet.
      */
-    void OnReceivedPacket(Ptr<const Packet> packet);
+    void OnReceivedPacket(const UplinkContext& context);
 
     /**
      * Method that is scheduled after packet arrival in order to take action on
      * sender's receive windows openings.
      *
-     * \param deviceAddress The Address of the end device.
+     * \param edStatus The status of the end device.
      * \param window The reception window number (1 or 2).
      */
-    void OnReceiveWindowOpportunity(LoraDeviceAddress deviceAddress, int window);
+    void OnReceiveWindowOpportunity(Ptr<EndDeviceStatus> edStatus, int window);
+
+    /**
+     * Get the number of receive window opportunities waiting in the queue.
+     * Opportunities that were removed or replaced since they were queued are
+     * not counted, even if they were not discarded yet.
+     *
+     * \return The number of opportunities.
+     */
+    std::size_t GetNPendingReceiveWindows() const;
 
   private:
+    void DoDispose() override;
+
+    /**
+     * Add a receive window opportunity to the queue.
+     *
+     * \param edStatus The status of the end device.
+     * \param window The reception window number (1 or 2).
+     * \param delay The time to the opening of the window, relative to now.
+     */
+    void ScheduleReceiveWindow(Ptr<EndDeviceStatus> edStatus, int window, Time delay);
+
+    /**
+     * Serve all receive window opportunities that are due, and schedule the
+     * event for the next one.
+     */
+    void ServeReceiveWindows();
+
+    /**
+     * Update the count of valid opportunities when the status of an end device
+     * removes or replaces one of them.
+     */
+    void OnReceiveWindowOpportunityRemoved();
+
+    /**
+     * Make sure the pending event fires for the earliest opportunity.
+     */
+    void ScheduleNextEvent();
+
+    /**
+     * A receive window opportunity waiting in the queue.
+     */
+    struct PendingReceiveWindow
+    {
+        int64_t deadlineNs;            //!< The opening time of the window [ns]
+        Ptr<EndDeviceStatus> edStatus; //!< The status of the end device
+        uint32_t ticket;               //!< The ticket of the opportunity in edStatus
+        int window;                    //!< The reception window number (1 or 2)
+    };
+
+    std::deque<PendingReceiveWindow> m_pendingWindows; //!< Opportunities, by deadline
+    std::size_t m_nPendingWindows; //!< Valid opportunities in m_pendingWindows
+    EventId m_nextEvent;           //!< The single event serving the earliest opportunity
+    int64_t m_nextEventNs;         //!< The time m_nextEvent is scheduled for [ns]
+
     TracedCallback<Ptr<const Packet>>
         m_receiveWindowOpened;           //!< Trace callback source for reception windows openings.
                                          //!< \todo Never called. Place calls in the right places.
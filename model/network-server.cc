@@ -12,6 +12,7 @@
 #include "class-a-end-device-lorawan-mac.h"
 #include "lora-device-address.h"
 #include "lora-frame-header.h"
+#include "lora-instrumentation.h"
 #include "lorawan-mac-header.h"
 #include "mac-command.h"
 #include "network-status.h"
@@ -20,6 +21,7 @@
 #include "ns3/node-container.h"
 #include "ns3/packet.h"
 #include "ns3/point-to-point-net-device.h"
+#include "ns3/simulator.h"
 
 namespace ns3
 {
@@ -37,6 +39,13 @@ NetworkServer::GetTypeId()
         TypeId("ns3::NetworkServer")
             .SetParent<Application>()
             .AddConstructor<NetworkServer>()
+            .AddAttribute("DeduplicationWindow",
+                          "The time to wait for copies of an uplink received by other gateways "
+                          "before processing it. It must be shorter than the receive delay of "
+                          "the first window (one second). Zero processes every copy.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&NetworkServer::m_deduplicationWindow),
+                          MakeTimeChecker(Seconds(0), Seconds(1)))
             .AddTraceSource(
                 "ReceivedPacket",
                 "Trace source that is fired when a packet arrives at the network server",
@@ -47,7 +56,8 @@ NetworkServer::GetTypeId()
 }
 
 NetworkServer::NetworkServer()
-    : m_status(Create<NetworkStatus>()),
+    : m_deduplicationWindow(Seconds(0)),
+      m_status(Create<NetworkStatus>()),
       m_controller(Create<NetworkController>(m_status)),
       m_scheduler(Create<NetworkScheduler>(m_status, m_controller))
 {
@@ -59,6 +69,24 @@ NetworkServer::~NetworkServer()
     NS_LOG_FUNCTION_NOARGS();
 }
 
+void
+NetworkServer::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+
+    for (auto& [edAddress, uplink] : m_uplinks)
+    {
+        uplink.event.Cancel();
+    }
+    m_uplinks.clear();
+    m_scheduler->Dispose();
+    m_scheduler = nullptr;
+    m_controller = nullptr;
+    m_status = nullptr;
+
+    Application::DoDispose();
+}
+
 void
 NetworkServer::StartApplication()
 {
@@ -140,6 +168,17 @@ NetworkServer::AddNode(Ptr<Node> node)
     m_status->AddNode(edLorawanMac);
 }
 
+void
+NetworkServer::AddFleet(Ptr<LoraEndDeviceFleet> fleet)
+{
+    NS_LOG_FUNCTION(this << fleet);
+
+    for (uint32_t i = 0; i < fleet->GetNDevices(); i++)
+    {
+        m_status->AddNode(fleet->GetDeviceAddress(i));
+    }
+}
+
 bool
 NetworkServer::Receive(Ptr<NetDevice> device,
                        Ptr<const Packet> packet,
@@ -148,24 +187,111 @@ NetworkServer::Receive(Ptr<NetDevice> device,
 {
     NS_LOG_FUNCTION(this << packet << protocol << address);
 
-    // Create a copy of the packet
+    LORAWAN_TIME_SCOPE("NetworkServer/Receive");
+    LORAWAN_COUNT("NetworkServer/HeaderParses", 1);
+
+    // Decode the packet once for the scheduler, the status and the controller
+    UplinkContext context;
+    context.packet = packet;
+    context.gwAddress = address;
     Ptr<Packet> myPacket = packet->Copy();
+    myPacket->RemoveHeader(context.macHeader);
+    context.frameHeader.SetAsUplink();
+    myPacket->RemoveHeader(context.frameHeader);
+    myPacket->PeekPacketTag(context.tag);
+    context.endDeviceStatus = m_status->GetEndDeviceStatus(context.frameHeader.GetAddress());
+    context.receptionTime = Simulator::Now();
+    context.gwIndex = m_status->GetGatewayIndex(address);
+    NS_ASSERT_MSG(context.endDeviceStatus,
+                  "Received a packet from unknown device " << context.frameHeader.GetAddress());
 
     // Fire the trace source
     m_receivedPacket(packet);
 
-    // Inform the scheduler of the newly arrived packet
-    m_scheduler->OnReceivedPacket(packet);
+    if (m_deduplicationWindow.IsZero())
+    {
+        // Inform the scheduler of the newly arrived packet
+        m_scheduler->OnReceivedPacket(context);
+
+        // Inform the status of the newly arrived packet
+        m_status->OnReceivedPacket(context);
+
+        // Inform the controller of the newly arrived packet
+        m_controller->OnNewPacket(context);
+
+        return true;
+    }
+
+    // The status collects the information of every copy
+    m_status->OnReceivedPacket(context);
+
+    // A copy of the last uplink if it carries the same frame counter and
+    // arrives before the first receive window, a new uplink otherwise (e.g.,
+    // a retransmission of a confirmed packet)
+    uint32_t edAddress = context.frameHeader.GetAddress().Get();
+    auto it = m_uplinks.find(edAddress);
+    if (it != m_uplinks.end() &&
+        it->second.context.frameHeader.GetFCnt() == context.frameHeader.GetFCnt() &&
+        context.receptionTime - it->second.context.receptionTime < NetworkScheduler::receiveDelay1)
+    {
+        NS_LOG_DEBUG("Copy of an uplink already received, "
+                     << (it->second.processed ? "after" : "within")
+                     << " the deduplication window");
+        return true;
+    }
 
-    // Inform the status of the newly arrived packet
-    m_status->OnReceivedPacket(packet, address);
+    if (it != m_uplinks.end())
+    {
+        // Do not leave the previous uplink unprocessed
+        if (!it->second.processed)
+        {
+            it->second.event.Cancel();
+            ProcessUplink(edAddress);
+        }
+        // The new uplink replaces it, so it must not be forgotten
+        it->second.event.Cancel();
+    }
 
-    // Inform the controller of the newly arrived packet
-    m_controller->OnNewPacket(packet);
+    EventId event =
+        Simulator::Schedule(m_deduplicationWindow, &NetworkServer::ProcessUplink, this, edAddress);
+    m_uplinks[edAddress] = {context, event, false};
 
     return true;
 }
 
+void
+NetworkServer::ProcessUplink(uint32_t edAddress)
+{
+    NS_LOG_FUNCTION(this << edAddress);
+
+    DeduplicatedUplink& uplink = m_uplinks.at(edAddress);
+    if (uplink.processed)
+    {
+        return;
+    }
+    uplink.processed = true;
+
+    // Late copies are recognized until the first receive window
+    Time untilWindow =
+        NetworkScheduler::receiveDelay1 - (Simulator::Now() - uplink.context.receptionTime);
+    uplink.event = Simulator::Schedule(Max(untilWindow, Seconds(0)),
+                                       &NetworkServer::ForgetUplink,
+                                       this,
+                                       edAddress);
+
+    // Inform the scheduler and the controller once for all copies
+    m_scheduler->OnReceivedPacket(uplink.context);
+    m_controller->OnNewPacket(uplink.context);
+}
+
+void
+NetworkServer::ForgetUplink(uint32_t edAddress)
+{
+    NS_LOG_FUNCTION(this << edAddress);
+
+    m_uplinks.erase(edAddress);
+}
+
 void
 NetworkServer::AddComponent(Ptr<NetworkControllerComponent> component)
 {
@@ -180,5 +306,17 @@ NetworkServer::GetNetworkStatus()
     return m_status;
 }
 
+Ptr<NetworkScheduler>
+NetworkServer::GetNetworkScheduler()
+{
+    return m_scheduler;
+}
+
+std::size_t
+NetworkServer::GetNKeptUplinks() const
+{
+    return m_uplinks.size();
+}
+
 } // namespace lorawan
 } // namespace ns3
@@ -13,11 +13,13 @@
 #include "class-a-end-device-lorawan-mac.h"
 #include "gateway-status.h"
 #include "lora-device-address.h"
+#include "lora-end-device-fleet.h"
 #include "network-controller.h"
 #include "network-scheduler.h"
 #include "network-status.h"
 
 #include "ns3/application.h"
+#include "ns3/event-id.h"
 #include "ns3/log.h"
 #include "ns3/net-device.h"
 #include "ns3/node-container.h"
@@ -25,6 +27,9 @@
 #include "ns3/packet.h"
 #include "ns3/point-to-point-net-device.h"
 
+#include <cstdint>
+#include <unordered_map>
+
 namespace ns3
 {
 namespace lorawan
@@ -38,6 +43,12 @@ namespace lorawan
  *
  * This version of the NetworkServer application attempts to closely mimic an actual
  * network server, by providing as much functionality as possible.
+ *
+ * Like actual network servers, the application can wait for a deduplication
+ * window after the first copy of an uplink is received, so that the
+ * scheduler and the controller process the packet only once, with the
+ * information of all the gateways that received it. Copies received after
+ * the window closes only update the gateway list of the packet.
  */
 class NetworkServer : public Application
 {
@@ -81,6 +92,14 @@ class NetworkServer : public Application
      */
     void AddNode(Ptr<Node> node);
 
+    /**
+     * Inform the NetworkServer application that the devices of this fleet are
+     * connected to the network.
+     *
+     * \param fleet A pointer to the LoraEndDeviceFleet object.
+     */
+    void AddFleet(Ptr<LoraEndDeviceFleet> fleet);
+
     /**
      * Add the gateway to the list of gateways connected to this network server.
      *
@@ -118,7 +137,58 @@ class NetworkServer : public Application
      */
     Ptr<NetworkStatus> GetNetworkStatus();
 
+    /**
+     * Get the NetworkScheduler object of this NetworkServer application.
+     *
+     * \return A pointer to the NetworkScheduler object.
+     */
+    Ptr<NetworkScheduler> GetNetworkScheduler();
+
+    /**
+     * Get the number of uplinks kept to recognize their copies, when a
+     * deduplication window is set.
+     *
+     * \return The number of uplinks.
+     */
+    std::size_t GetNKeptUplinks() const;
+
   protected:
+    void DoDispose() override;
+
+    /**
+     * Run the scheduler and the controller on the last uplink of a device, as
+     * its deduplication window closes.
+     *
+     * \param edAddress The address of the device.
+     */
+    void ProcessUplink(uint32_t edAddress);
+
+    /**
+     * Forget the last uplink of a device, once no more copies of it are
+     * expected.
+     *
+     * \param edAddress The address of the device.
+     */
+    void ForgetUplink(uint32_t edAddress);
+
+    /**
+     * The last uplink of a device and the state of its deduplication.
+     */
+    struct DeduplicatedUplink
+    {
+        UplinkContext context; //!< The first copy of the uplink
+        EventId event;         //!< The closing of the deduplication window, then the forgetting
+        bool processed;        //!< Whether the deduplication window is closed
+    };
+
+    Time m_deduplicationWindow; //!< The time to wait for copies of an uplink
+
+    /**
+     * The last uplink of each device, by device address, until the first
+     * receive window of the device.
+     */
+    std::unordered_map<uint32_t, DeduplicatedUplink> m_uplinks;
+
     Ptr<NetworkStatus> m_status;         //!< Ptr to the NetworkStatus object.
     Ptr<NetworkController> m_controller; //!< Ptr to the NetworkController object.
     Ptr<NetworkScheduler> m_scheduler;   //!< Ptr to the NetworkScheduler object.
@@ -12,12 +12,19 @@
 #include "end-device-status.h"
 #include "gateway-status.h"
 #include "lora-device-address.h"
+#include "lora-instrumentation.h"
+#include "lora-phy.h"
+#include "lora-tag.h"
 
 #include "ns3/log.h"
 #include "ns3/net-device.h"
 #include "ns3/node-container.h"
 #include "ns3/packet.h"
 #include "ns3/pointer.h"
+#include "ns3/simulator.h"
+
+#include <functional>
+#include <string_view>
 
 namespace ns3
 {
@@ -39,6 +46,7 @@ NetworkStatus::GetTypeId()
 }
 
 NetworkStatus::NetworkStatus()
+    : m_receivedPacketHistorySize(1)
 {
     NS_LOG_FUNCTION_NOARGS();
 }
@@ -55,15 +63,34 @@ NetworkStatus::AddNode(Ptr<ClassAEndDeviceLorawanMac> edMac)
 
     // Check whether this device already exists in our list
     LoraDeviceAddress edAddress = edMac->GetDeviceAddress();
-    if (m_endDeviceStatuses.find(edAddress) == m_endDeviceStatuses.end())
+    if (m_endDeviceStatuses.find(edAddress.Get()) == m_endDeviceStatuses.end())
     {
         // The device doesn't exist. Create new EndDeviceStatus
         Ptr<EndDeviceStatus> edStatus =
             CreateObject<EndDeviceStatus>(edAddress, DynamicCast<ClassAEndDeviceLorawanMac>(edMac));
+        edStatus->SetReceivedPacketHistorySize(m_receivedPacketHistorySize);
+
+        // Add it to the map
+        m_endDeviceStatuses.emplace(edAddress.Get(), edStatus);
+        NS_LOG_DEBUG("Added to the list a device with address " << edAddress.Print());
+    }
+}
+
+void
+NetworkStatus::AddNode(LoraDeviceAddress edAddress)
+{
+    NS_LOG_FUNCTION(this << edAddress);
+
+    // Check whether this device already exists in our list
+    if (m_endDeviceStatuses.find(edAddress.Get()) == m_endDeviceStatuses.end())
+    {
+        // The device doesn't exist. Create new EndDeviceStatus, without a MAC
+        Ptr<EndDeviceStatus> edStatus =
+            CreateObject<EndDeviceStatus>(edAddress, Ptr<ClassAEndDeviceLorawanMac>());
+        edStatus->SetReceivedPacketHistorySize(m_receivedPacketHistorySize);
 
         // Add it to the map
-        m_endDeviceStatuses.insert(
-            std::pair<LoraDeviceAddress, Ptr<EndDeviceStatus>>(edAddress, edStatus));
+        m_endDeviceStatuses.emplace(edAddress.Get(), edStatus);
         NS_LOG_DEBUG("Added to the list a device with address " << edAddress.Print());
     }
 }
@@ -79,44 +106,57 @@ NetworkStatus::AddGateway(Address& address, Ptr<GatewayStatus> gwStatus)
         // The device doesn't exist.
 
         // Add it to the map
-        m_gatewayStatuses.insert(std::pair<Address, Ptr<GatewayStatus>>(address, gwStatus));
+        m_gatewayStatuses.emplace(address, gwStatus);
+        m_gatewayIndices.emplace(address, m_gateways.size());
+        m_gateways.push_back(gwStatus);
+        m_gatewayBusyUntilNs.push_back(0);
         NS_LOG_DEBUG("Added to the list a gateway with address " << address);
     }
 }
 
 void
-NetworkStatus::OnReceivedPacket(Ptr<const Packet> packet, const Address& gwAddress)
+NetworkStatus::ReserveEndDevices(uint32_t nDevices)
 {
-    NS_LOG_FUNCTION(this << packet << gwAddress);
+    NS_LOG_FUNCTION(this << nDevices);
 
-    // Create a copy of the packet
-    Ptr<Packet> myPacket = packet->Copy();
+    m_endDeviceStatuses.reserve(nDevices);
+}
+
+uint32_t
+NetworkStatus::GetGatewayIndex(const Address& address) const
+{
+    auto it = m_gatewayIndices.find(address);
+    NS_ABORT_MSG_IF(it == m_gatewayIndices.end(), "Unknown gateway " << address);
+    return it->second;
+}
 
-    // Extract the headers
-    LorawanMacHeader macHdr;
-    myPacket->RemoveHeader(macHdr);
-    LoraFrameHeader frameHdr;
-    frameHdr.SetAsUplink();
-    myPacket->RemoveHeader(frameHdr);
+void
+NetworkStatus::OnReceivedPacket(const UplinkContext& context)
+{
+    NS_LOG_FUNCTION(this << context.packet << context.gwAddress);
 
     // Update the correct EndDeviceStatus object
-    LoraDeviceAddress edAddr = frameHdr.GetAddress();
-    NS_LOG_DEBUG("Node address: " << edAddr);
-    m_endDeviceStatuses.at(edAddr)->InsertReceivedPacket(packet, gwAddress);
+    NS_LOG_DEBUG("Node address: " << context.frameHeader.GetAddress());
+    context.endDeviceStatus->InsertReceivedPacket(context);
 }
 
 bool
 NetworkStatus::NeedsReply(LoraDeviceAddress deviceAddress)
 {
     // Throws out of range if no device is found
-    return m_endDeviceStatuses.at(deviceAddress)->NeedsReply();
+    return m_endDeviceStatuses.at(deviceAddress.Get())->NeedsReply();
 }
 
 Address
 NetworkStatus::GetBestGatewayForDevice(LoraDeviceAddress deviceAddress, int window)
 {
-    // Get the endDeviceStatus we are interested in
-    Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.at(deviceAddress);
+    // Throws out of range if no device is found
+    return GetBestGatewayForDevice(m_endDeviceStatuses.at(deviceAddress.Get()), window);
+}
+
+Address
+NetworkStatus::GetBestGatewayForDevice(Ptr<EndDeviceStatus> edStatus, int window)
+{
     double replyFrequency;
     if (window == 1)
     {
@@ -131,28 +171,27 @@ NetworkStatus::GetBestGatewayForDevice(LoraDeviceAddress deviceAddress, int wind
         NS_ABORT_MSG("Invalid window value");
     }
 
-    // Get the list of gateways that this device can reach
+    // Go from the 'best' gateway, i.e. the one with the highest received
+    // power, to the worst.
     // NOTE: At this point, we could also take into account the whole network to
-    // identify the best gateway according to various metrics. For now, we just
-    // ask the EndDeviceStatus to pick the best gateway for us via its method.
-    std::map<double, Address> gwAddresses = edStatus->GetPowerGatewayMap();
-
-    // By iterating on the map in reverse, we go from the 'best'
-    // gateway, i.e. the one with the highest received power, to the
-    // worst.
-    Address bestGwAddress;
-    for (auto it = gwAddresses.rbegin(); it != gwAddresses.rend(); it++)
+    // identify the best gateway according to various metrics.
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    for (const auto& candidate : edStatus->GetGatewayCandidates())
     {
-        bool isAvailable =
-            m_gatewayStatuses.find(it->second)->second->IsAvailableForTransmission(replyFrequency);
-        if (isAvailable)
+        // Skip gateways we already booked for a transmission
+        if (m_gatewayBusyUntilNs[candidate.gwIndex] > nowNs)
+        {
+            continue;
+        }
+
+        const Ptr<GatewayStatus>& gwStatus = m_gateways[candidate.gwIndex];
+        if (gwStatus->IsAvailableForTransmission(replyFrequency))
         {
-            bestGwAddress = it->second;
-            break;
+            return gwStatus->GetAddress();
         }
     }
 
-    return bestGwAddress;
+    return Address();
 }
 
 void
@@ -160,14 +199,35 @@ NetworkStatus::SendThroughGateway(Ptr<Packet> packet, Address gwAddress)
 {
     NS_LOG_FUNCTION(packet << gwAddress);
 
-    m_gatewayStatuses.find(gwAddress)->second->GetNetDevice()->Send(packet, gwAddress, 0x0800);
+    uint32_t gwIndex = GetGatewayIndex(gwAddress);
+    Ptr<GatewayStatus> gwStatus = m_gateways[gwIndex];
+
+    // Book the gateway for the duration of the transmission, computed as the
+    // gateway will
+    LoraTag tag;
+    packet->PeekPacketTag(tag);
+    Ptr<GatewayLorawanMac> gwMac = gwStatus->GetGatewayMac();
+    LoraTxParameters params;
+    params.sf = gwMac->GetSfFromDataRate(tag.GetDataRate());
+    params.bandwidthHz = gwMac->GetBandwidthFromDataRate(tag.GetDataRate());
+    params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym(params) > MilliSeconds(16);
+    Time duration = LoraPhy::GetOnAirTime(packet, params);
+    m_gatewayBusyUntilNs[gwIndex] = (Simulator::Now() + duration).GetNanoSeconds();
+
+    gwStatus->GetNetDevice()->Send(packet, gwAddress, 0x0800);
 }
 
 Ptr<Packet>
 NetworkStatus::GetReplyForDevice(LoraDeviceAddress edAddress, int windowNumber)
+{
+    return GetReplyForDevice(m_endDeviceStatuses.find(edAddress.Get())->second, windowNumber);
+}
+
+Ptr<Packet>
+NetworkStatus::GetReplyForDevice(Ptr<EndDeviceStatus> edStatus, int windowNumber)
 {
     // Get the reply packet
-    Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.find(edAddress)->second;
+    NS_ASSERT_MSG(edStatus->GetMac(), "Cannot reply to a device without a MAC layer object");
     Ptr<Packet> packet = edStatus->GetCompleteReplyPacket();
 
     // Apply the appropriate tag
@@ -194,12 +254,13 @@ NetworkStatus::GetEndDeviceStatus(Ptr<const Packet> packet)
     NS_LOG_FUNCTION(this << packet);
 
     // Get the address
+    LORAWAN_COUNT("NetworkStatus/HeaderParses", 1);
     LorawanMacHeader mHdr;
     LoraFrameHeader fHdr;
     Ptr<Packet> myPacket = packet->Copy();
     myPacket->RemoveHeader(mHdr);
     myPacket->RemoveHeader(fHdr);
-    auto it = m_endDeviceStatuses.find(fHdr.GetAddress());
+    auto it = m_endDeviceStatuses.find(fHdr.GetAddress().Get());
     if (it != m_endDeviceStatuses.end())
     {
         return (*it).second;
@@ -216,7 +277,7 @@ NetworkStatus::GetEndDeviceStatus(LoraDeviceAddress address)
 {
     NS_LOG_FUNCTION(this << address);
 
-    auto it = m_endDeviceStatuses.find(address);
+    auto it = m_endDeviceStatuses.find(address.Get());
     if (it != m_endDeviceStatuses.end())
     {
         return (*it).second;
@@ -235,5 +296,34 @@ NetworkStatus::CountEndDevices()
 
     return m_endDeviceStatuses.size();
 }
+
+void
+NetworkStatus::SetReceivedPacketHistorySize(uint32_t historySize)
+{
+    NS_LOG_FUNCTION(this << historySize);
+
+    m_receivedPacketHistorySize = historySize;
+    for (auto& edStatus : m_endDeviceStatuses)
+    {
+        edStatus.second->SetReceivedPacketHistorySize(historySize);
+    }
+}
+
+uint32_t
+NetworkStatus::GetReceivedPacketHistorySize() const
+{
+    return m_receivedPacketHistorySize;
+}
+
+std::size_t
+NetworkStatus::AddressHash::operator()(const Address& address) const
+{
+    // Serialize the type and length along with the address bytes, so that
+    // addresses of different types do not collide
+    uint8_t buffer[Address::MAX_SIZE + 2];
+    uint32_t size = address.CopyAllTo(buffer, sizeof(buffer));
+    return std::hash<std::string_view>()(
+        std::string_view(reinterpret_cast<const char*>(buffer), size));
+}
 } // namespace lorawan
 } // namespace ns3
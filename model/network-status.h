@@ -16,7 +16,10 @@
 #include "lora-device-address.h"
 #include "network-scheduler.h"
 
+#include <cstdint>
 #include <iterator>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -27,9 +30,13 @@ namespace lorawan
  * \ingroup lorawan
  *
  * This class represents the knowledge about the state of the network that is
- * available at the network server. It is essentially a collection of two maps:
- * one containing DeviceStatus objects, and the other containing GatewayStatus
- * objects.
+ * available at the network server. It is essentially a collection of two hash
+ * tables: one containing DeviceStatus objects, and the other containing
+ * GatewayStatus objects.
+ *
+ * Lookups by address are meant to be performed once per event: the returned
+ * EndDeviceStatus pointer can then be used as a handle to the device, and
+ * passed to the methods of this class accepting it.
  *
  * This class is meant to be queried by NetworkController components, which
  * can decide to take action based on the current status of the network.
@@ -53,6 +60,18 @@ class NetworkStatus : public Object
      */
     void AddNode(Ptr<ClassAEndDeviceLorawanMac> edMac);
 
+    /**
+     * Add a device without a MAC layer object (e.g., part of a
+     * LoraEndDeviceFleet) to the ones that are tracked by this NetworkStatus
+     * object.
+     *
+     * Since the device parameters cannot be queried, replies to this device are
+     * not supported.
+     *
+     * \param edAddress The network address of the device to be tracked.
+     */
+    void AddNode(LoraDeviceAddress edAddress);
+
     /**
      * Add a new gateway to the list of gateways connected to the network.
      *
@@ -64,13 +83,29 @@ class NetworkStatus : public Object
      */
     void AddGateway(Address& address, Ptr<GatewayStatus> gwStatus);
 
+    /**
+     * Reserve memory for a number of tracked devices, so that adding them does
+     * not cause the registry to be rehashed.
+     *
+     * \param nDevices The expected number of devices.
+     */
+    void ReserveEndDevices(uint32_t nDevices);
+
+    /**
+     * Get the index of a gateway, assigned in the order gateways were added.
+     *
+     * \param address The gateway's NetDevice Address.
+     * \return The index of the gateway.
+     */
+    uint32_t GetGatewayIndex(const Address& address) const;
+
     /**
      * Update network status on a received packet.
      *
-     * \param packet The received packet.
-     * \param gwaddress Address of the gateway this packet was received from.
+     * \param context The decoded packet and the address of the gateway it was
+     * received from.
      */
-    void OnReceivedPacket(Ptr<const Packet> packet, const Address& gwaddress);
+    void OnReceivedPacket(const UplinkContext& context);
 
     /**
      * Return whether the specified device needs a reply.
@@ -91,11 +126,26 @@ class NetworkStatus : public Object
      */
     Address GetBestGatewayForDevice(LoraDeviceAddress deviceAddress, int window);
 
+    /**
+     * Return whether we have a gateway that is available to send a reply to the specified
+     * device.
+     *
+     * Gateways are checked by decreasing RSSI of the last packet from the device, skipping
+     * those already booked for a transmission by this NetworkStatus without querying them.
+     *
+     * \param edStatus The status of the device we are interested in.
+     * \param window The device reception window we are currently targeting (1 or 2).
+     * \return The Address of the gateway which measured the best RSSI of the last packet from the
+     * device, selected among the gateways being currently available for downlink transmission.
+     */
+    Address GetBestGatewayForDevice(Ptr<EndDeviceStatus> edStatus, int window);
+
     /**
      * Send a packet through a gateway.
      *
      * This function assumes that the packet is already tagged with a LoraTag
      * that will inform the gateway of the parameters to use for the
+     * transmission. The gateway is booked for the duration of the
      * transmission.
      *
      * \param packet The packet.
@@ -112,6 +162,15 @@ class NetworkStatus : public Object
      */
     Ptr<Packet> GetReplyForDevice(LoraDeviceAddress edAddress, int windowNumber);
 
+    /**
+     * Get the reply packet prepared for a reception window of a device.
+     *
+     * \param edStatus The status of the device.
+     * \param windowNumber The reception window number (1 or 2).
+     * \return The reply packet.
+     */
+    Ptr<Packet> GetReplyForDevice(Ptr<EndDeviceStatus> edStatus, int windowNumber);
+
     /**
      * Get the EndDeviceStatus of the device that sent a packet.
      *
@@ -135,11 +194,50 @@ class NetworkStatus : public Object
      */
     int CountEndDevices();
 
+    /**
+     * Set the number of received packets kept by the EndDeviceStatus of each
+     * device, both already tracked and added later.
+     *
+     * \param historySize The number of packets, at least one.
+     */
+    void SetReceivedPacketHistorySize(uint32_t historySize);
+
+    /**
+     * Get the number of received packets kept by the EndDeviceStatus of each
+     * device.
+     *
+     * \return The number of packets.
+     */
+    uint32_t GetReceivedPacketHistorySize() const;
+
+    /**
+     * Hash function for the addresses of the gateways.
+     */
+    struct AddressHash
+    {
+        /**
+         * Hash an address, including its type.
+         *
+         * \param address The address.
+         * \return The hash value.
+         */
+        std::size_t operator()(const Address& address) const;
+    };
+
+  private:
+    uint32_t m_receivedPacketHistorySize; //!< Received packets kept for each device
+
+    std::unordered_map<Address, uint32_t, AddressHash>
+        m_gatewayIndices;                       //!< Index of each gateway, by address
+    std::vector<Ptr<GatewayStatus>> m_gateways; //!< The gateways, by index
+    std::vector<int64_t> m_gatewayBusyUntilNs;  //!< End of the booked transmission of each
+                                                //!< gateway, by index [ns]
+
   public:
-    std::map<LoraDeviceAddress, Ptr<EndDeviceStatus>>
-        m_endDeviceStatuses; //!< Map tracking the state of devices connected to this network server
-    std::map<Address, Ptr<GatewayStatus>>
-        m_gatewayStatuses; //!< Map tracking the state of gateways connected to this network server
+    std::unordered_map<uint32_t, Ptr<EndDeviceStatus>>
+        m_endDeviceStatuses; //!< State of the devices connected to this network server, by address
+    std::unordered_map<Address, Ptr<GatewayStatus>, AddressHash>
+        m_gatewayStatuses; //!< State of the gateways connected to this network server
 };
 
 } // namespace lorawan
@@ -8,6 +8,7 @@
 
 #include "simple-gateway-lora-phy.h"
 
+#include "lora-instrumentation.h"
 #include "lora-tag.h"
 
 #include "ns3/log.h"
@@ -147,9 +148,11 @@ SimpleGatewayLoraPhy::StartReceive(Ptr<Packet> packet,
     // Cycle over the receive paths to check availability to receive the packet
     std::list<Ptr<SimpleGatewayLoraPhy::ReceptionPath>>::iterator it;
 
+    LORAWAN_COUNT("SimpleGatewayLoraPhy/ReceptionPathSearches", 1);
     for (it = m_receptionPaths.begin(); it != m_receptionPaths.end(); ++it)
     {
         Ptr<SimpleGatewayLoraPhy::ReceptionPath> currentPath = *it;
+        LORAWAN_COUNT("SimpleGatewayLoraPhy/ReceptionPathsScanned", 1);
 
         // If the receive path is available and listening on the channel of
         // interest, we have a candidate
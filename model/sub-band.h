@@ -71,26 +71,6 @@ class SubBand : public Object
      */
     double GetDutyCycle() const;
 
-    /**
-     * Update the next transmission time.
-     *
-     * This function is used by LogicalLoraChannelHelper, which computes the time
-     * based on the SubBand's duty cycle and on the transmission duration.
-     *
-     * \param nextTime The future time from which transmission should be allowed
-     * again.
-     */
-    void SetNextTransmissionTime(Time nextTime);
-
-    /**
-     * Returns the next time from which transmission on this subband will be
-     * possible.
-     *
-     * \return The next time at which transmission in this SubBand will be
-     * allowed.
-     */
-    Time GetNextTransmissionTime();
-
     /**
      * Return whether or not a frequency belongs to this SubBand.
      *
@@ -107,7 +87,7 @@ class SubBand : public Object
      * \return True if the channel's center frequency is between firstFrequency
      * and lastFrequency, false otherwise.
      */
-    bool BelongsToSubBand(Ptr<LogicalLoraChannel> channel) const;
+    bool BelongsToSubBand(Ptr<const LogicalLoraChannel> channel) const;
 
     /**
      * Set the maximum transmission power that is allowed on this SubBand.
@@ -124,11 +104,10 @@ class SubBand : public Object
     double GetMaxTxPowerDbm() const;
 
   private:
-    double m_firstFrequency;     //!< Starting frequency of the subband, in MHz
-    double m_lastFrequency;      //!< Ending frequency of the subband, in MHz
-    double m_dutyCycle;          //!< The duty cycle that needs to be enforced on this subband
-    Time m_nextTransmissionTime; //!< The next time a transmission will be allowed in this subband
-    double m_maxTxPowerDbm; //!< The maximum transmission power that is admitted on this subband
+    double m_firstFrequency; //!< Starting frequency of the subband, in MHz
+    double m_lastFrequency;  //!< Ending frequency of the subband, in MHz
+    double m_dutyCycle;      //!< The duty cycle that needs to be enforced on this subband
+    double m_maxTxPowerDbm;  //!< The maximum transmission power that is admitted on this subband
 };
 } // namespace lorawan
 } // namespace ns3
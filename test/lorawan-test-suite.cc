@@ -7,9 +7,14 @@
  */
 
 // Include headers of classes to test
+#include "ns3/basic-energy-source-helper.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/log.h"
 #include "ns3/lora-helper.h"
+#include "ns3/lora-instrumentation.h"
+#include "ns3/lora-radio-energy-model-helper.h"
+#include "ns3/lora-tag.h"
+#include "ns3/mac-command-answer-buffer.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/one-shot-sender-helper.h"
 #include "ns3/simple-end-device-lora-phy.h"
@@ -18,6 +23,12 @@
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -421,6 +432,82 @@ HeaderTest::DoRun()
     NS_TEST_EXPECT_MSG_EQ(linkCheckAns->GetGwCnt(),
                           1,
                           "Removed header's MAC command contents don't match");
+
+    ///////////////////////////////////////////
+    // Test the MacCommandAnswerBuffer class //
+    ///////////////////////////////////////////
+    MacCommandAnswerBuffer answers;
+    answers.AddLinkAdrAns(true, false, true);
+    answers.AddLinkAdrAns(true, true, true); // Replaces the previous LinkAdrAns
+    answers.AddDevStatusAns(10, 5);
+    answers.AddDevStatusAns(20, 5); // Replaces the previous DevStatusAns
+    answers.AddNewChannelAns(true, true);
+    answers.AddNewChannelAns(true, false); // Answers a different NewChannelReq
+
+    NS_TEST_EXPECT_MSG_EQ(unsigned(answers.GetSize()), 9, "Answers are not coalesced correctly");
+
+    // Fill the buffer up to the FOpts limit
+    answers.AddDutyCycleAns();
+    answers.AddRxParamSetupAns(true, true, true);
+    answers.AddNewChannelAns(false, false);
+    NS_TEST_EXPECT_MSG_EQ(answers.AddNewChannelAns(false, true),
+                          false,
+                          "Answers exceeding the FOpts limit are accepted");
+    NS_TEST_EXPECT_MSG_EQ(unsigned(answers.GetSize()),
+                          14,
+                          "Rejected answers change the buffer");
+
+    LoraFrameHeader uplinkHdr;
+    uplinkHdr.SetAsUplink();
+    uplinkHdr.AddSerializedCommands(answers.GetBuffer(), answers.GetSize());
+    Ptr<Packet> uplink = Create<Packet>(10);
+    uplink->AddHeader(uplinkHdr);
+
+    NS_TEST_EXPECT_MSG_EQ(uplink->GetSize(), 10 + 8 + 14, "Wrong size of packet + header");
+
+    LoraFrameHeader receivedHdr;
+    receivedHdr.SetAsUplink();
+    uplink->RemoveHeader(receivedHdr);
+
+    NS_TEST_EXPECT_MSG_EQ(receivedHdr.GetCommands().size(),
+                          7,
+                          "Serialized answers are not deserialized correctly");
+    Ptr<DevStatusAns> devStatusAns = receivedHdr.GetMacCommand<DevStatusAns>();
+    NS_TEST_EXPECT_MSG_EQ(unsigned(devStatusAns->GetBattery()),
+                          20,
+                          "Coalesced DevStatusAns doesn't carry the latest answer");
+
+    // Answers in serialized form are followed by commands added as objects
+    MacCommandAnswerBuffer dutyCycleAnswer;
+    dutyCycleAnswer.AddDutyCycleAns();
+    LoraFrameHeader mixedHdr;
+    mixedHdr.SetAsUplink();
+    mixedHdr.SetFCnt(7);
+    mixedHdr.AddLinkCheckReq();
+    mixedHdr.AddSerializedCommands(dutyCycleAnswer.GetBuffer(), dutyCycleAnswer.GetSize());
+    Ptr<Packet> mixed = Create<Packet>(10);
+    mixed->AddHeader(mixedHdr);
+
+    NS_TEST_EXPECT_MSG_EQ(mixed->GetSize(), 10 + 8 + 2, "Wrong size of packet + header");
+
+    LoraFrameHeader receivedMixedHdr;
+    receivedMixedHdr.SetAsUplink();
+    mixed->RemoveHeader(receivedMixedHdr);
+    std::list<Ptr<MacCommand>> mixedCommands = receivedMixedHdr.GetCommands();
+
+    NS_TEST_ASSERT_MSG_EQ(mixedCommands.size(), 2, "Mixed commands are not deserialized");
+    NS_TEST_EXPECT_MSG_EQ(mixedCommands.front()->GetCommandType(),
+                          DUTY_CYCLE_ANS,
+                          "Serialized answers are not written first");
+    NS_TEST_EXPECT_MSG_EQ(mixedCommands.back()->GetCommandType(),
+                          LINK_CHECK_REQ,
+                          "MacCommand objects are not written after the answers");
+    NS_TEST_EXPECT_MSG_EQ(receivedMixedHdr.GetFCnt(),
+                          7,
+                          "FCnt changes in the serialization/deserialization process");
+    NS_TEST_EXPECT_MSG_EQ(unsigned(mixed->GetSize()),
+                          10,
+                          "Wrong size of packet after removing the header");
 }
 
 /**
@@ -979,6 +1066,105 @@ LogicalLoraChannelTest::DoRun()
     NS_TEST_EXPECT_MSG_EQ(channelHelper->GetWaitingTime(channel5),
                           Time(0),
                           "Waiting time affects other subbands");
+
+    // Earliest transmission time tests
+    ///////////////////////////////////
+
+    // The free SubBand allows transmitting right away
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetNextTransmissionTime(),
+                          Time(0),
+                          "Next transmission time doesn't consider all enabled channels");
+
+    // With both SubBands busy, the one that frees up first counts
+    channelHelper->AddEvent(Seconds(1), channel4);
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetNextTransmissionTime(),
+                          Seconds(1 / 0.1 - 1),
+                          "Next transmission time doesn't behave as expected");
+
+    // Disabled channels are not considered
+    channelHelper->DisableChannel(3);
+    channelHelper->DisableChannel(4);
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetNextTransmissionTime(),
+                          expectedTimeOff,
+                          "Next transmission time considers disabled channels");
+    channelHelper->EnableChannel(3);
+    channelHelper->EnableChannel(4);
+
+    // Aggregated duty cycle tests
+    //////////////////////////////
+
+    channelHelper->SetAggregatedDutyCycle(1.0 / 1024);
+    channelHelper->AddEvent(Seconds(1), channel5);
+
+    // SubBand waiting times don't include the aggregated one
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetWaitingTime(channel5),
+                          Seconds(1 / 0.1 - 1),
+                          "Waiting time doesn't behave as expected");
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetAggregatedWaitingTime(),
+                          Seconds(1023),
+                          "Aggregated waiting time doesn't behave as expected");
+
+    // The aggregated timer dominates the next transmission time
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetNextTransmissionTime(),
+                          Seconds(1023),
+                          "Next transmission time doesn't consider the aggregated duty cycle");
+
+    // Transmission time is accumulated per SubBand
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetSubBandAirtime(0),
+                          Seconds(2),
+                          "Airtime doesn't behave as expected");
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetSubBandAirtime(1),
+                          Seconds(2),
+                          "Airtime doesn't behave as expected");
+
+    // Shared channel plan tests
+    ////////////////////////////
+
+    // Copies share channels and SubBands, but not duty cycle timers
+    LogicalLoraChannelHelper copy = *channelHelper;
+    NS_TEST_EXPECT_MSG_EQ(copy.SharesChannelPlanWith(*channelHelper),
+                          true,
+                          "Copies don't share the channel plan");
+    NS_TEST_EXPECT_MSG_EQ(PeekPointer(copy.GetChannelList().at(0)),
+                          PeekPointer(channelHelper->GetChannelList().at(0)),
+                          "Copies don't share the channels");
+    copy.AddEvent(Seconds(10), channel4);
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetWaitingTime(channel4),
+                          Seconds(1 / 0.1 - 1),
+                          "Duty cycle timers are shared among copies");
+
+    // The shared SubBand holds no timer, so each copy sees its own one
+    NS_TEST_EXPECT_MSG_EQ(PeekPointer(copy.GetSubBandFromChannel(channel4)),
+                          PeekPointer(channelHelper->GetSubBandFromChannel(channel4)),
+                          "Copies don't share the SubBands");
+    NS_TEST_EXPECT_MSG_EQ(copy.GetWaitingTime(channel4),
+                          Seconds(10 / 0.1 - 10),
+                          "Waiting time of the copy doesn't follow its own transmissions");
+
+    // Enabling an enabled channel leaves the plan shared
+    copy.EnableChannel(0);
+    NS_TEST_EXPECT_MSG_EQ(copy.SharesChannelPlanWith(*channelHelper),
+                          true,
+                          "Unchanged channel mask detached the channel plan");
+
+    // Modifications only affect the modified copy
+    copy.DisableChannel(0);
+    copy.SetChannel(1, CreateObject<LogicalLoraChannel>(868.9, 0, 5));
+    NS_TEST_EXPECT_MSG_EQ(copy.SharesChannelPlanWith(*channelHelper),
+                          false,
+                          "Modified copy still shares the channel plan");
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetChannelList().at(0)->IsEnabledForUplink(),
+                          true,
+                          "Disabling a channel affected another copy");
+    NS_TEST_EXPECT_MSG_EQ(channelHelper->GetChannelList().at(1)->GetFrequency(),
+                          868.3,
+                          "Setting a channel affected another copy");
+    NS_TEST_EXPECT_MSG_EQ(copy.GetEnabledChannelList().size(),
+                          4,
+                          "Copy doesn't preserve the channel mask");
+    NS_TEST_EXPECT_MSG_EQ(copy.GetChannelList().at(1)->GetFrequency(),
+                          868.9,
+                          "Channel was not set on the modified copy");
 }
 
 /**
@@ -1566,6 +1752,248 @@ PhyConnectivityTest::DoRun()
                           "State didn't switch to STANDBY as expected");
 }
 
+/**
+ * \ingroup lorawan
+ *
+ * It tests that skipping the empty receive windows of a Class A device does not change the
+ * energy it consumes
+ */
+class EnergyModelTest : public TestCase
+{
+  public:
+    EnergyModelTest();           //!< Default constructor
+    ~EnergyModelTest() override; //!< Destructor
+
+    /**
+     * Run a fixed sequence of unconfirmed uplinks of a device, with no gateway to reply.
+     *
+     * \param skipEmptyReceiveWindows Whether the device skips its receive windows.
+     * \return The remaining energy of the device at the end of the sequence.
+     */
+    double RunSequence(bool skipEmptyReceiveWindows);
+
+    /**
+     * Trace the state of the PHY of the device.
+     *
+     * \param oldState The previous state.
+     * \param newState The new state.
+     */
+    void StateChanged(EndDeviceLoraPhy::State oldState, EndDeviceLoraPhy::State newState);
+
+  private:
+    void DoRun() override;
+
+    int m_nStandby = 0;       //!< Times the PHY switched to STANDBY
+    double m_consumption = 0; //!< Total energy consumption of the radio at the end
+};
+
+// Add some help text to this case to describe what it is intended to test
+EnergyModelTest::EnergyModelTest()
+    : TestCase("Verify that skipped receive windows are charged as opened ones")
+{
+}
+
+// Reminder that the test case should clean up after itself
+EnergyModelTest::~EnergyModelTest()
+{
+}
+
+double
+EnergyModelTest::RunSequence(bool skipEmptyReceiveWindows)
+{
+    m_nStandby = 0;
+
+    Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel>();
+    Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel>();
+    Ptr<LoraChannel> channel = CreateObject<LoraChannel>(loss, delay);
+
+    NodeContainer endDevices;
+    endDevices.Create(1);
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(endDevices);
+
+    LoraPhyHelper phyHelper;
+    phyHelper.SetChannel(channel);
+    phyHelper.SetDeviceType(LoraPhyHelper::ED);
+    LorawanMacHelper macHelper;
+    macHelper.SetDeviceType(LorawanMacHelper::ED_A);
+    LoraHelper helper;
+    NetDeviceContainer devices = helper.Install(phyHelper, macHelper, endDevices);
+
+    Ptr<LoraNetDevice> device = DynamicCast<LoraNetDevice>(devices.Get(0));
+    device->GetMac()->SetAttribute("SkipEmptyReceiveWindows",
+                                   BooleanValue(skipEmptyReceiveWindows));
+    device->GetPhy()->TraceConnectWithoutContext(
+        "EndDeviceState",
+        MakeCallback(&EnergyModelTest::StateChanged, this));
+
+    BasicEnergySourceHelper sourceHelper;
+    sourceHelper.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(100));
+    sourceHelper.Set("BasicEnergySupplyVoltageV", DoubleValue(3.3));
+    EnergySourceContainer sources = sourceHelper.Install(endDevices);
+    LoraRadioEnergyModelHelper radioEnergyHelper;
+    DeviceEnergyModelContainer models = radioEnergyHelper.Install(devices, sources);
+
+    // Uplinks far enough apart for the duty cycle not to postpone them
+    for (int i = 0; i < 3; i++)
+    {
+        Simulator::Schedule(Seconds(1 + 200 * i),
+                            [device]() { device->Send(Create<Packet>(20), Address(), 0); });
+    }
+    Simulator::Stop(Seconds(700));
+    Simulator::Run();
+    double remainingEnergy = sources.Get(0)->GetRemainingEnergy();
+    m_consumption = models.Get(0)->GetTotalEnergyConsumption();
+    Simulator::Destroy();
+
+    return remainingEnergy;
+}
+
+void
+EnergyModelTest::StateChanged(EndDeviceLoraPhy::State oldState, EndDeviceLoraPhy::State newState)
+{
+    m_nStandby += (newState == EndDeviceLoraPhy::STANDBY);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+EnergyModelTest::DoRun()
+{
+    NS_LOG_DEBUG("EnergyModelTest");
+
+    double openedRemaining = RunSequence(false);
+    double openedConsumption = m_consumption;
+    int openedStandby = m_nStandby;
+
+    double skippedRemaining = RunSequence(true);
+    NS_TEST_EXPECT_MSG_LT(m_nStandby, openedStandby, "Receive windows were not skipped");
+    NS_TEST_EXPECT_MSG_GT(openedConsumption, 0, "No energy consumed");
+    NS_TEST_EXPECT_MSG_EQ_TOL(skippedRemaining,
+                              openedRemaining,
+                              1e-12,
+                              "Different remaining energy with skipped receive windows");
+    NS_TEST_EXPECT_MSG_EQ_TOL(m_consumption,
+                              openedConsumption,
+                              1e-12,
+                              "Different energy consumption with skipped receive windows");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests that a DutyCycleReq with a null duty cycle silences an end device until another
+ * DutyCycleReq allows it to transmit again
+ */
+class DutyCycleReqTest : public TestCase
+{
+  public:
+    DutyCycleReqTest();           //!< Default constructor
+    ~DutyCycleReqTest() override; //!< Destructor
+
+    /**
+     * Trace the start of a transmission by the PHY.
+     *
+     * \param packet The packet being sent.
+     * \param index The index of the transmitting PHY.
+     */
+    void StartSending(Ptr<const Packet> packet, uint32_t index);
+
+    /**
+     * Trace a packet dropped by the MAC because of duty cycle limitations.
+     *
+     * \param packet The dropped packet.
+     */
+    void CannotSend(Ptr<const Packet> packet);
+
+  private:
+    void DoRun() override;
+
+    int m_nSent = 0;    //!< Transmissions started by the PHY
+    int m_nDropped = 0; //!< Packets dropped by the MAC
+};
+
+// Add some help text to this case to describe what it is intended to test
+DutyCycleReqTest::DutyCycleReqTest()
+    : TestCase("Verify that a DutyCycleReq with MaxDCycle 255 disables transmissions")
+{
+}
+
+// Reminder that the test case should clean up after itself
+DutyCycleReqTest::~DutyCycleReqTest()
+{
+}
+
+void
+DutyCycleReqTest::StartSending(Ptr<const Packet> packet, uint32_t index)
+{
+    m_nSent++;
+}
+
+void
+DutyCycleReqTest::CannotSend(Ptr<const Packet> packet)
+{
+    m_nDropped++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DutyCycleReqTest::DoRun()
+{
+    NS_LOG_DEBUG("DutyCycleReqTest");
+
+    Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel>();
+    Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel>();
+    Ptr<LoraChannel> channel = CreateObject<LoraChannel>(loss, delay);
+
+    NodeContainer endDevices;
+    endDevices.Create(1);
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(endDevices);
+
+    LoraPhyHelper phyHelper;
+    phyHelper.SetChannel(channel);
+    phyHelper.SetDeviceType(LoraPhyHelper::ED);
+    LorawanMacHelper macHelper;
+    macHelper.SetDeviceType(LorawanMacHelper::ED_A);
+    LoraHelper helper;
+    NetDeviceContainer devices = helper.Install(phyHelper, macHelper, endDevices);
+
+    Ptr<LoraNetDevice> device = DynamicCast<LoraNetDevice>(devices.Get(0));
+    Ptr<EndDeviceLorawanMac> mac = DynamicCast<EndDeviceLorawanMac>(device->GetMac());
+    device->GetPhy()->TraceConnectWithoutContext(
+        "StartSending",
+        MakeCallback(&DutyCycleReqTest::StartSending, this));
+    mac->TraceConnectWithoutContext("CannotSendBecauseDutyCycle",
+                                    MakeCallback(&DutyCycleReqTest::CannotSend, this));
+
+    // The first packet is postponed by the duty cycle of the first one, and must be cancelled
+    // when the device is silenced
+    Simulator::Schedule(Seconds(1), [device]() {
+        device->Send(Create<Packet>(20), Address(), 0);
+        device->Send(Create<Packet>(20), Address(), 0);
+    });
+    Simulator::Schedule(Seconds(2), &EndDeviceLorawanMac::OnDutyCycleReq, mac, 0);
+    Simulator::Schedule(Seconds(3), [this, device, mac]() {
+        NS_TEST_EXPECT_MSG_EQ(mac->GetNextTransmissionTime(),
+                              Time::Max(),
+                              "A silenced device has a next transmission time");
+        device->Send(Create<Packet>(20), Address(), 0);
+    });
+    Simulator::Schedule(Seconds(400), &EndDeviceLorawanMac::OnDutyCycleReq, mac, 1);
+    Simulator::Schedule(Seconds(401),
+                        [device]() { device->Send(Create<Packet>(20), Address(), 0); });
+    Simulator::Stop(Seconds(500));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_nSent, 2, "Unexpected number of transmissions");
+    NS_TEST_EXPECT_MSG_EQ(m_nDropped, 1, "Unexpected number of dropped packets");
+}
+
 /**
  * \ingroup lorawan
  *
@@ -1602,6 +2030,831 @@ LorawanMacTest::DoRun()
     NS_LOG_DEBUG("LorawanMacTest");
 }
 
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the LoraPacketTracker counts packets in the same way in streaming mode as when
+ * it stores all packets, and that in streaming mode it releases packets once their outcomes are
+ * final
+ */
+class PacketTrackerTest : public TestCase
+{
+  public:
+    PacketTrackerTest();           //!< Default constructor
+    ~PacketTrackerTest() override; //!< Destructor
+
+    /**
+     * Send a new uplink packet, as traced by the MAC and PHY layers of a device. Each tracker is
+     * given its own copy of the packet.
+     *
+     * \param index The index of the packet.
+     * \param sf The spreading factor of the packet.
+     * \param confirmed Whether the packet is a confirmed uplink.
+     */
+    void Send(uint32_t index, uint8_t sf, bool confirmed);
+
+    /**
+     * Trace the outcome of the reception of a packet at a gateway.
+     *
+     * \param index The index of the packet.
+     * \param gwId The node id of the gateway.
+     * \param outcome The outcome of the reception.
+     */
+    void Receive(uint32_t index, uint32_t gwId, PhyPacketOutcome outcome);
+
+    /**
+     * End the retransmission process of a packet and drop the references to it held on behalf of
+     * the devices and gateways.
+     *
+     * \param index The index of the packet.
+     */
+    void Release(uint32_t index);
+
+    /**
+     * Check the number of packets the tracker in streaming mode still holds.
+     *
+     * \param expected The expected number of packets, in each of the PHY and MAC packet maps.
+     */
+    void CheckTrackedPackets(uint32_t expected);
+
+    /**
+     * Check that both trackers return the same counts for all the intervals within a time.
+     *
+     * \param lastSecond The end of the last interval to check, in seconds.
+     */
+    void CompareCounts(int lastSecond);
+
+  private:
+    void DoRun() override;
+
+    LoraPacketTracker m_storingTracker;   //!< The tracker storing all packets
+    LoraPacketTracker m_streamingTracker; //!< The tracker in streaming mode
+
+    /**
+     * The packets given to the storing and to the streaming tracker, while they are in flight.
+     */
+    std::vector<std::pair<Ptr<Packet>, Ptr<Packet>>> m_packets;
+};
+
+// Add some help text to this case to describe what it is intended to test
+PacketTrackerTest::PacketTrackerTest()
+    : TestCase("Verify that LoraPacketTracker counts packets in the same way in streaming mode")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PacketTrackerTest::~PacketTrackerTest()
+{
+}
+
+void
+PacketTrackerTest::Send(uint32_t index, uint8_t sf, bool confirmed)
+{
+    auto createPacket = [sf, confirmed]() {
+        Ptr<Packet> packet = Create<Packet>(10);
+
+        LorawanMacHeader macHdr;
+        macHdr.SetMType(confirmed ? LorawanMacHeader::CONFIRMED_DATA_UP
+                                  : LorawanMacHeader::UNCONFIRMED_DATA_UP);
+        packet->AddHeader(macHdr);
+
+        LoraTag tag;
+        tag.SetSpreadingFactor(sf);
+        packet->AddPacketTag(tag);
+        return packet;
+    };
+
+    m_packets.at(index) = {createPacket(), createPacket()};
+    for (auto [tracker, packet] : {std::make_pair(&m_storingTracker, m_packets.at(index).first),
+                                   std::make_pair(&m_streamingTracker, m_packets.at(index).second)})
+    {
+        NS_TEST_EXPECT_MSG_EQ(tracker->IsUplink(packet), true, "Uplink seen as downlink");
+        tracker->MacTransmissionCallback(packet);
+        tracker->TransmissionCallback(packet, Simulator::GetContext());
+    }
+}
+
+void
+PacketTrackerTest::Receive(uint32_t index, uint32_t gwId, PhyPacketOutcome outcome)
+{
+    for (auto [tracker, packet] : {std::make_pair(&m_storingTracker, m_packets.at(index).first),
+                                   std::make_pair(&m_streamingTracker, m_packets.at(index).second)})
+    {
+        switch (outcome)
+        {
+        case RECEIVED:
+            tracker->PacketReceptionCallback(packet, gwId);
+            tracker->MacGwReceptionCallback(packet);
+            break;
+        case INTERFERED:
+            tracker->InterferenceCallback(packet, gwId);
+            break;
+        case NO_MORE_RECEIVERS:
+            tracker->NoMoreReceiversCallback(packet, gwId);
+            break;
+        case UNDER_SENSITIVITY:
+            tracker->UnderSensitivityCallback(packet, gwId);
+            break;
+        default:
+            tracker->LostBecauseTxCallback(packet, gwId);
+        }
+    }
+}
+
+void
+PacketTrackerTest::Release(uint32_t index)
+{
+    for (auto [tracker, packet] : {std::make_pair(&m_storingTracker, m_packets.at(index).first),
+                                   std::make_pair(&m_streamingTracker, m_packets.at(index).second)})
+    {
+        tracker->RequiredTransmissionsCallback(1 + index % 4,
+                                               index % 3 != 0,
+                                               MilliSeconds(500 * index),
+                                               packet);
+    }
+    m_packets.at(index) = {nullptr, nullptr};
+}
+
+void
+PacketTrackerTest::CheckTrackedPackets(uint32_t expected)
+{
+    uint32_t nPhyPackets = 0;
+    uint32_t nMacPackets = 0;
+    m_streamingTracker.VisitPhyPackets([&nPhyPackets](Ptr<const Packet>) { nPhyPackets++; });
+    m_streamingTracker.VisitMacPackets([&nMacPackets](Ptr<const Packet>) { nMacPackets++; });
+    NS_TEST_EXPECT_MSG_EQ(nPhyPackets, expected, "Wrong number of PHY packets retired");
+    NS_TEST_EXPECT_MSG_EQ(nMacPackets, expected, "Wrong number of MAC packets retired");
+}
+
+void
+PacketTrackerTest::CompareCounts(int lastSecond)
+{
+    for (int start = 0; start <= lastSecond; start++)
+    {
+        for (int stop = start; stop <= lastSecond; stop++)
+        {
+            for (int gwId : {10, 11})
+            {
+                NS_TEST_EXPECT_MSG_EQ(
+                    m_streamingTracker.PrintPhyPacketsPerGw(Seconds(start), Seconds(stop), gwId),
+                    m_storingTracker.PrintPhyPacketsPerGw(Seconds(start), Seconds(stop), gwId),
+                    "Different PHY counts in [" << start << ", " << stop << "]");
+                for (uint8_t sf = 7; sf <= 12; sf++)
+                {
+                    auto streaming = m_streamingTracker.CountPhyPacketsPerGw(Seconds(start),
+                                                                             Seconds(stop),
+                                                                             gwId,
+                                                                             sf);
+                    auto storing = m_storingTracker.CountPhyPacketsPerGw(Seconds(start),
+                                                                         Seconds(stop),
+                                                                         gwId,
+                                                                         sf);
+                    NS_TEST_EXPECT_MSG_EQ((streaming == storing),
+                                          true,
+                                          "Different SF" << unsigned(sf) << " PHY counts");
+                }
+            }
+            NS_TEST_EXPECT_MSG_EQ(
+                m_streamingTracker.CountMacPacketsGlobally(Seconds(start), Seconds(stop)),
+                m_storingTracker.CountMacPacketsGlobally(Seconds(start), Seconds(stop)),
+                "Different MAC counts in [" << start << ", " << stop << "]");
+            NS_TEST_EXPECT_MSG_EQ(
+                m_streamingTracker.CountMacPacketsGloballyCpsr(Seconds(start), Seconds(stop)),
+                m_storingTracker.CountMacPacketsGloballyCpsr(Seconds(start), Seconds(stop)),
+                "Different retransmission counts in [" << start << ", " << stop << "]");
+            NS_TEST_EXPECT_MSG_EQ(
+                (m_streamingTracker.CountRetransmissionHistogram(Seconds(start), Seconds(stop)) ==
+                 m_storingTracker.CountRetransmissionHistogram(Seconds(start), Seconds(stop))),
+                true,
+                "Different retransmission histograms in [" << start << ", " << stop << "]");
+        }
+    }
+
+    // Intervals covering all packets are answered by totals, which must match the counts of the
+    // packets visited one by one
+    double sent = 0;
+    double received = 0;
+    for (uint32_t senderId = 0; senderId < 3; senderId++)
+    {
+        auto storing = m_storingTracker.CountMacPacketsPerDevice(senderId);
+        NS_TEST_EXPECT_MSG_EQ((m_streamingTracker.CountMacPacketsPerDevice(senderId) == storing),
+                              true,
+                              "Different counts for device " << senderId);
+        sent += storing.at(0);
+        received += storing.at(1);
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_storingTracker.CountMacPacketsGlobally(Seconds(0), Seconds(lastSecond)),
+                          std::to_string(sent) + " " + std::to_string(received),
+                          "Wrong MAC totals");
+
+    for (int gwId : {10, 11})
+    {
+        std::vector<int> bySf(6, 0);
+        for (uint8_t sf = 7; sf <= 12; sf++)
+        {
+            auto counts =
+                m_storingTracker.CountPhyPacketsPerGw(Seconds(0), Seconds(lastSecond), gwId, sf);
+            for (std::size_t i = 0; i < counts.size(); i++)
+            {
+                bySf.at(i) += counts.at(i);
+            }
+        }
+        NS_TEST_EXPECT_MSG_EQ(
+            (m_storingTracker.CountPhyPacketsPerGw(Seconds(0), Seconds(lastSecond), gwId) == bySf),
+            true,
+            "Wrong PHY totals at gateway " << gwId);
+    }
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PacketTrackerTest::DoRun()
+{
+    NS_LOG_DEBUG("PacketTrackerTest");
+
+    m_streamingTracker.EnableStreamingMode(Seconds(1), Seconds(1));
+
+    // Downlink packets are neither tracked nor counted at gateways
+    Ptr<Packet> downlink = Create<Packet>(10);
+    LorawanMacHeader macHdr;
+    macHdr.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+    downlink->AddHeader(macHdr);
+    for (LoraPacketTracker* tracker : {&m_storingTracker, &m_streamingTracker})
+    {
+        NS_TEST_EXPECT_MSG_EQ(tracker->IsUplink(downlink), false, "Downlink seen as uplink");
+        tracker->MacTransmissionCallback(downlink);
+        tracker->TransmissionCallback(downlink, 0);
+        tracker->InterferenceCallback(downlink, 10);
+    }
+    downlink = nullptr;
+
+    // Keep a sample of fewer retransmission processes than there are packets.
+    // With the same stream, both trackers choose the same processes, whether
+    // the stream is assigned before or after sampling is enabled.
+    m_storingTracker.EnableRetransmissionSampling(5);
+    NS_TEST_EXPECT_MSG_EQ(m_storingTracker.AssignStreams(7), 1, "Wrong number of streams");
+    m_streamingTracker.AssignStreams(7);
+    m_streamingTracker.EnableRetransmissionSampling(5);
+
+    // Packets are sent every half second, so that some are sent at the
+    // boundary of buckets, and received by two gateways. Odd packets are
+    // confirmed, and their retransmission process lasts longer than the
+    // retirement delay.
+    const uint32_t nPackets = 24;
+    m_packets.resize(nPackets);
+    for (uint32_t i = 0; i < nPackets; i++)
+    {
+        Time sendTime = MilliSeconds(500 * i);
+        bool confirmed = i % 2;
+        Simulator::ScheduleWithContext(i % 3,
+                                       sendTime,
+                                       &PacketTrackerTest::Send,
+                                       this,
+                                       i,
+                                       7 + i % 6,
+                                       confirmed);
+        Simulator::ScheduleWithContext(10,
+                                       sendTime + MilliSeconds(200),
+                                       &PacketTrackerTest::Receive,
+                                       this,
+                                       i,
+                                       10,
+                                       PhyPacketOutcome(i % 5));
+        Simulator::ScheduleWithContext(11,
+                                       sendTime + MilliSeconds(200),
+                                       &PacketTrackerTest::Receive,
+                                       this,
+                                       i,
+                                       11,
+                                       i % 2 ? RECEIVED : UNDER_SENSITIVITY);
+        Simulator::ScheduleWithContext(i % 3,
+                                       sendTime + MilliSeconds(confirmed ? 2500 : 300),
+                                       &PacketTrackerTest::Release,
+                                       this,
+                                       i);
+    }
+
+    // Compare while some packets are still in flight. Counting retires the
+    // packets sent more than a second ago, but the confirmed packet sent at
+    // 4.5 s, whose retransmission process did not end, is kept along with
+    // those sent at 5.5 s and 6 s.
+    Simulator::Schedule(MilliSeconds(6100), &PacketTrackerTest::CompareCounts, this, 6);
+    Simulator::Schedule(MilliSeconds(6100), &PacketTrackerTest::CheckTrackedPackets, this, 3);
+    Simulator::Stop(Seconds(15));
+    Simulator::Run();
+
+    // At the end, all packets are retired and the counts come from the buckets alone
+    CompareCounts(14);
+    CheckTrackedPackets(0);
+
+    // Packets are released with 1 to 4 attempts, one in three failing
+    NS_TEST_EXPECT_MSG_EQ(m_storingTracker.CountMacPacketsGloballyCpsr(Seconds(0), Seconds(12)),
+                          std::to_string(24.0) + " " + std::to_string(16.0),
+                          "Wrong retransmission totals");
+    NS_TEST_EXPECT_MSG_EQ(m_storingTracker.CountRetransmissions(Seconds(0), Seconds(12)),
+                          "4 4 4 4 0 0 0 0 0 0 0 0 0 0 0",
+                          "Wrong successful processes per number of attempts");
+    auto histogram = m_storingTracker.CountRetransmissionHistogram(Seconds(0), Seconds(12));
+    NS_TEST_EXPECT_MSG_EQ(histogram.at(LoraPacketTracker::GetRetransmissionBin(1, false, 7)),
+                          2,
+                          "Wrong number of failed single attempts at SF7");
+
+    const auto& samples = m_storingTracker.GetRetransmissionSamples();
+    NS_TEST_EXPECT_MSG_EQ(samples.size(), 5, "Wrong number of sampled processes");
+    for (const auto& sample : samples)
+    {
+        NS_TEST_EXPECT_MSG_EQ((sample.senderId < 3), true, "Sample without its sender");
+        NS_TEST_EXPECT_MSG_EQ((sample.sf >= 7 && sample.sf <= 12), true, "Sample without its SF");
+        NS_TEST_EXPECT_MSG_LT(sample.firstAttempt, sample.finishTime, "Wrong sample times");
+    }
+    const auto& streamingSamples = m_streamingTracker.GetRetransmissionSamples();
+    NS_TEST_EXPECT_MSG_EQ(streamingSamples.size(), 5, "Wrong number of sampled processes");
+    for (std::size_t i = 0; i < std::min(samples.size(), streamingSamples.size()); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(streamingSamples[i].firstAttempt,
+                              samples[i].firstAttempt,
+                              "Different samples with the same stream");
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests that LoraTraceWriter writes NumPy files with the expected records
+ */
+class TraceWriterTest : public TestCase
+{
+  public:
+    TraceWriterTest();           //!< Default constructor
+    ~TraceWriterTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+TraceWriterTest::TraceWriterTest()
+    : TestCase("Verify that LoraTraceWriter writes NumPy files with the expected records")
+{
+}
+
+// Reminder that the test case should clean up after itself
+TraceWriterTest::~TraceWriterTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+TraceWriterTest::DoRun()
+{
+    NS_LOG_DEBUG("TraceWriterTest");
+
+    LoraTraceWriter writer(CreateTempDirFilename("trace"));
+
+    Ptr<Packet> packet = Create<Packet>(10);
+    LorawanMacHeader macHdr;
+    macHdr.SetMType(LorawanMacHeader::CONFIRMED_DATA_UP);
+    packet->AddHeader(macHdr);
+    LoraTag tag;
+    tag.SetSpreadingFactor(9);
+    packet->AddPacketTag(tag);
+
+    // Write enough records to fill several buffers, then some after closing
+    const uint32_t nPackets = 100000;
+    for (uint32_t i = 0; i < nPackets; i++)
+    {
+        writer.TransmissionCallback(packet, i);
+    }
+    writer.InterferenceCallback(packet, 7);
+    writer.Close();
+    writer.TransmissionCallback(packet, 0);
+
+    NS_TEST_EXPECT_MSG_EQ(writer.GetNRecords(LoraTraceWriter::TRANSMISSION),
+                          uint64_t(nPackets),
+                          "Records written after closing");
+    NS_TEST_EXPECT_MSG_EQ(writer.GetNRecords(LoraTraceWriter::OUTCOME),
+                          uint64_t(1),
+                          "Wrong number of outcomes");
+
+    std::ifstream file(writer.GetFilename(LoraTraceWriter::TRANSMISSION), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    NS_TEST_ASSERT_MSG_EQ(content.compare(0, 6, "\x93NUMPY"), 0, "Wrong magic string");
+    std::size_t headerSize = 10 + uint8_t(content[8]) + (uint8_t(content[9]) << 8);
+    NS_TEST_EXPECT_MSG_EQ(headerSize % 64, 0, "Records are not aligned");
+    NS_TEST_EXPECT_MSG_NE(content.substr(0, headerSize).find("'shape': (100000,)"),
+                          std::string::npos,
+                          "Wrong shape in the header");
+
+    // Time, packet uid, node, MType and spreading factor
+    const std::size_t recordSize = 8 + 8 + 4 + 1 + 1;
+    NS_TEST_ASSERT_MSG_EQ(content.size(),
+                          headerSize + nPackets * recordSize,
+                          "Wrong size of the file");
+    const char* last = content.data() + headerSize + (nPackets - 1) * recordSize;
+    uint32_t node = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        node |= uint32_t(uint8_t(last[16 + i])) << (8 * i);
+    }
+    NS_TEST_EXPECT_MSG_EQ(node, nPackets - 1, "Wrong node of the last record");
+    NS_TEST_EXPECT_MSG_EQ(unsigned(uint8_t(last[20])),
+                          unsigned(LorawanMacHeader::CONFIRMED_DATA_UP),
+                          "Wrong MType of the last record");
+    NS_TEST_EXPECT_MSG_EQ(unsigned(uint8_t(last[21])), 9, "Wrong SF of the last record");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests that LoraFileWriter writes chunks of text in order
+ */
+class FileWriterTest : public TestCase
+{
+  public:
+    FileWriterTest();           //!< Default constructor
+    ~FileWriterTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+FileWriterTest::FileWriterTest()
+    : TestCase("Verify that LoraFileWriter writes chunks of text in order")
+{
+}
+
+// Reminder that the test case should clean up after itself
+FileWriterTest::~FileWriterTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+FileWriterTest::DoRun()
+{
+    NS_LOG_DEBUG("FileWriterTest");
+
+    std::string filename = CreateTempDirFilename("output.txt");
+    Ptr<LoraFileWriter> writer = Create<LoraFileWriter>();
+
+    // Write more chunks than can be pending, after some stale content
+    writer->Write(filename, "stale\n", false);
+    std::string expected;
+    for (int i = 0; i < 10; i++)
+    {
+        std::string chunk = std::to_string(i) + " " + std::string(i * 1000, 'x') + "\n";
+        writer->Write(filename, chunk, i == 0);
+        expected += chunk;
+    }
+    writer->Flush();
+
+    std::ifstream file(filename);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    NS_TEST_EXPECT_MSG_EQ((content == expected), true, "Wrong content of the file");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests the counters and timers of LoraInstrumentation, and their summaries
+ */
+class InstrumentationTest : public TestCase
+{
+  public:
+    InstrumentationTest();           //!< Default constructor
+    ~InstrumentationTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+InstrumentationTest::InstrumentationTest()
+    : TestCase("Verify the counters and timers of LoraInstrumentation")
+{
+}
+
+// Reminder that the test case should clean up after itself
+InstrumentationTest::~InstrumentationTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+InstrumentationTest::DoRun()
+{
+    NS_LOG_DEBUG("InstrumentationTest");
+
+    uint64_t& counter = LoraInstrumentation::GetCounter("InstrumentationTest/Counter");
+    counter += 3;
+    NS_TEST_EXPECT_MSG_EQ(LoraInstrumentation::GetCounter("InstrumentationTest/Counter"),
+                          3,
+                          "Counter not shared by name");
+
+    // Timers only measure when enabled
+    LoraInstrumentation::TimerStats& timer =
+        LoraInstrumentation::GetTimer("InstrumentationTest/Timer");
+    {
+        LoraInstrumentation::ScopedTimer scopedTimer(timer);
+    }
+    NS_TEST_EXPECT_MSG_EQ(timer.calls, 0, "Disabled timer measured time");
+    LoraInstrumentation::EnableTimers(true);
+    {
+        LoraInstrumentation::ScopedTimer scopedTimer(timer);
+    }
+    LoraInstrumentation::EnableTimers(false);
+    NS_TEST_EXPECT_MSG_EQ(timer.calls, 1, "Enabled timer did not measure time");
+
+    std::ostringstream csv;
+    LoraInstrumentation::WriteCsv(csv);
+    NS_TEST_EXPECT_MSG_NE(csv.str().find("\ncounter,InstrumentationTest/Counter,3,\n"),
+                          std::string::npos,
+                          "Counter missing from the CSV summary");
+    NS_TEST_EXPECT_MSG_NE(csv.str().find("\ntimer,InstrumentationTest/Timer,1,"),
+                          std::string::npos,
+                          "Timer missing from the CSV summary");
+
+    std::ostringstream json;
+    LoraInstrumentation::WriteJson(json);
+    NS_TEST_EXPECT_MSG_NE(json.str().find("\"InstrumentationTest/Counter\": 3"),
+                          std::string::npos,
+                          "Counter missing from the JSON summary");
+
+    // References stay valid across resets
+    LoraInstrumentation::Reset();
+    NS_TEST_EXPECT_MSG_EQ(counter, 0, "Counter not reset");
+    NS_TEST_EXPECT_MSG_EQ(timer.calls, 0, "Timer not reset");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests the per-device indicators accumulated by LoraKpiTracker, and the quantile sketch of
+ * latencies
+ */
+class KpiTrackerTest : public TestCase
+{
+  public:
+    KpiTrackerTest();           //!< Default constructor
+    ~KpiTrackerTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+KpiTrackerTest::KpiTrackerTest()
+    : TestCase("Verify the per-device indicators of LoraKpiTracker")
+{
+}
+
+// Reminder that the test case should clean up after itself
+KpiTrackerTest::~KpiTrackerTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+KpiTrackerTest::DoRun()
+{
+    NS_LOG_DEBUG("KpiTrackerTest");
+
+    // Quantiles of a uniform distribution are estimated within the relative accuracy
+    LoraQuantileSketch sketch(0.01);
+    for (int i = 1; i <= 1000; i++)
+    {
+        sketch.Add(i);
+    }
+    NS_TEST_EXPECT_MSG_EQ(sketch.GetCount(), 1000, "Wrong number of values");
+    NS_TEST_EXPECT_MSG_EQ_TOL(sketch.GetQuantile(0.5), 500, 5, "Wrong median");
+    NS_TEST_EXPECT_MSG_EQ_TOL(sketch.GetQuantile(0.99), 990, 10, "Wrong 99th percentile");
+
+    // Device 2 sends four packets: the first is received by two gateways, the second by one,
+    // the third only after the fourth is sent, and the fourth by none
+    LoraKpiTracker tracker;
+    std::vector<Ptr<Packet>> packets;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        packets.push_back(Create<Packet>(10 + i));
+        Simulator::ScheduleWithContext(2,
+                                       Seconds(10.0 * i),
+                                       &LoraKpiTracker::MacTransmissionCallback,
+                                       &tracker,
+                                       packets[i]);
+        Simulator::ScheduleWithContext(2,
+                                       Seconds(10.0 * i),
+                                       &LoraKpiTracker::TransmissionCallback,
+                                       &tracker,
+                                       packets[i],
+                                       2);
+    }
+    Simulator::ScheduleWithContext(5,
+                                   Seconds(0.1),
+                                   &LoraKpiTracker::MacGwReceptionCallback,
+                                   &tracker,
+                                   packets[0]);
+    Simulator::ScheduleWithContext(6,
+                                   Seconds(0.15),
+                                   &LoraKpiTracker::MacGwReceptionCallback,
+                                   &tracker,
+                                   packets[0]);
+    Simulator::ScheduleWithContext(5,
+                                   Seconds(10.3),
+                                   &LoraKpiTracker::MacGwReceptionCallback,
+                                   &tracker,
+                                   packets[1]);
+    Simulator::ScheduleWithContext(5,
+                                   Seconds(30.5),
+                                   &LoraKpiTracker::MacGwReceptionCallback,
+                                   &tracker,
+                                   packets[2]);
+    Simulator::ScheduleWithContext(2,
+                                   Seconds(31),
+                                   &LoraKpiTracker::RequiredTransmissionsCallback,
+                                   &tracker,
+                                   3,
+                                   true,
+                                   Seconds(30),
+                                   packets[3]);
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(tracker.GetNDevices(), 3, "Table not indexed by node id");
+    const LoraKpiTracker::DeviceKpis& kpis = tracker.GetDeviceKpis(2);
+    NS_TEST_EXPECT_MSG_EQ(kpis.sent, 4, "Wrong number of packets sent");
+    NS_TEST_EXPECT_MSG_EQ(kpis.delivered, 2, "Wrong number of packets delivered");
+    NS_TEST_EXPECT_MSG_EQ(kpis.deliveredBytes, 10 + 11, "Wrong number of bytes delivered");
+    NS_TEST_EXPECT_MSG_EQ(kpis.transmissions, 4, "Wrong number of transmissions");
+    NS_TEST_EXPECT_MSG_EQ(kpis.retxProcesses, 1, "Wrong number of retransmission processes");
+    NS_TEST_EXPECT_MSG_EQ(kpis.retxAttempts, 3, "Wrong number of attempts");
+    NS_TEST_EXPECT_MSG_EQ_TOL(kpis.latencySum, 0.4, 1e-9, "Wrong sum of latencies");
+    NS_TEST_EXPECT_MSG_EQ_TOL(kpis.latency.GetQuantile(1), 0.3, 0.003, "Wrong maximum latency");
+    NS_TEST_EXPECT_MSG_EQ(tracker.GetDeviceKpis(7).sent, 0, "Unknown device with packets");
+
+    std::ostringstream table;
+    tracker.WriteDeviceKpis(table);
+    NS_TEST_EXPECT_MSG_NE(table.str().find("\n2 4 2 0.5 21 4 1 3 1 0.2 "),
+                          std::string::npos,
+                          "Device missing from the table");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests that LoraMetricsSampler records gauges and counter rates in a ring buffer, and
+ * writes all rows to its output
+ */
+class MetricsSamplerTest : public TestCase
+{
+  public:
+    MetricsSamplerTest();           //!< Default constructor
+    ~MetricsSamplerTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+MetricsSamplerTest::MetricsSamplerTest()
+    : TestCase("Verify that LoraMetricsSampler records and writes time series")
+{
+}
+
+// Reminder that the test case should clean up after itself
+MetricsSamplerTest::~MetricsSamplerTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+MetricsSamplerTest::DoRun()
+{
+    NS_LOG_DEBUG("MetricsSamplerTest");
+
+    // The counter grows by 3 every second, and the gauge is the current time, with rows every
+    // two seconds and only four of them in memory
+    std::string filename = CreateTempDirFilename("metrics.csv");
+    LoraMetricsSampler sampler(4);
+    sampler.SetOutput(filename);
+    int updates = 0;
+    sampler.AddUpdate([&updates]() { updates++; });
+    sampler.AddGauge("now", []() { return Simulator::Now().GetSeconds(); });
+    sampler.AddCounter("counter", []() { return 3 * Simulator::Now().GetSeconds(); });
+    sampler.Start(Seconds(2));
+    Simulator::Stop(Seconds(21));
+    Simulator::Run();
+    sampler.Flush();
+    Simulator::Destroy();
+
+    // One update reading the counters at the start, then one per row
+    NS_TEST_EXPECT_MSG_EQ(sampler.GetNSamples(), 10, "Wrong number of rows");
+    NS_TEST_EXPECT_MSG_EQ(updates, 11, "Wrong number of updates");
+    NS_TEST_EXPECT_MSG_EQ(sampler.GetSampleTime(9), Seconds(20), "Wrong time of the last row");
+    NS_TEST_EXPECT_MSG_EQ_TOL(sampler.GetValue(6, 0), 14, 1e-9, "Wrong gauge value");
+    NS_TEST_EXPECT_MSG_EQ_TOL(sampler.GetValue(6, 1), 3, 1e-9, "Wrong counter rate");
+
+    // Older rows are only in the file
+    std::ifstream file(filename);
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    NS_TEST_ASSERT_MSG_EQ(lines.size(), 11, "Wrong number of lines in the file");
+    NS_TEST_EXPECT_MSG_EQ(lines[0], "time,now,counter", "Wrong header");
+    NS_TEST_EXPECT_MSG_EQ(lines[1], "2,2,3", "Wrong first row");
+    NS_TEST_EXPECT_MSG_EQ(lines[10], "20,20,3", "Wrong last row");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It tests that LoraPacketAudit counts the distinct packets of each holder and overall, and
+ * keeps their peaks
+ */
+class PacketAuditTest : public TestCase
+{
+  public:
+    PacketAuditTest();           //!< Default constructor
+    ~PacketAuditTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+PacketAuditTest::PacketAuditTest()
+    : TestCase("Verify that LoraPacketAudit counts retained packets")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PacketAuditTest::~PacketAuditTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PacketAuditTest::DoRun()
+{
+    NS_LOG_DEBUG("PacketAuditTest");
+
+    // The first holder references each of its packets twice, and the second one shares its
+    // packets with the first one after 1.5 seconds
+    std::vector<Ptr<Packet>> first = {Create<Packet>(10), Create<Packet>(10), Create<Packet>(10)};
+    std::vector<Ptr<Packet>> second;
+    LoraPacketAudit audit;
+    audit.AddHolder("first", [&first](const LoraPacketAudit::PacketVisitor& visit) {
+        for (const auto& packet : first)
+        {
+            visit(packet);
+            visit(packet);
+        }
+        visit(nullptr);
+    });
+    audit.AddHolder("second", [&second](const LoraPacketAudit::PacketVisitor& visit) {
+        for (const auto& packet : second)
+        {
+            visit(packet);
+        }
+    });
+    audit.Start(Seconds(1));
+    Simulator::Schedule(MilliSeconds(1500), [&]() {
+        second = first;
+        second.push_back(Create<Packet>(100));
+    });
+    Simulator::Schedule(MilliSeconds(2500), [&]() { first.clear(); });
+    Simulator::Stop(MilliSeconds(3500));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(audit.GetNAudits(), 4, "Wrong number of audits");
+    NS_TEST_EXPECT_MSG_EQ(audit.GetPackets(0), 0, "Released packets still counted");
+    NS_TEST_EXPECT_MSG_EQ(audit.GetPackets(1), 4, "Wrong number of packets");
+    NS_TEST_EXPECT_MSG_EQ(audit.GetBytes(1), 130, "Wrong number of bytes");
+    NS_TEST_EXPECT_MSG_EQ(audit.GetLivePackets(), 4, "Shared packets counted twice");
+
+    // Holders are sorted by peak bytes, and the packets of both holders peaked together
+    std::ostringstream report;
+    audit.WriteReport(report);
+    NS_TEST_EXPECT_MSG_EQ(report.str(),
+                          "holder packets bytes peak_packets peak_bytes peak_share\n"
+                          "second 4 130 4 130 0.8125\n"
+                          "first 0 0 3 30 0.1875\n"
+                          "live 4 130 4 130 0.8125\n",
+                          "Wrong report");
+}
+
 /**
  * \ingroup lorawan
  *
@@ -1626,6 +2879,15 @@ LorawanTestSuite::LorawanTestSuite()
     AddTestCase(new LogicalLoraChannelTest, Duration::QUICK);
     AddTestCase(new TimeOnAirTest, Duration::QUICK);
     AddTestCase(new PhyConnectivityTest, Duration::QUICK);
+    AddTestCase(new EnergyModelTest, Duration::QUICK);
+    AddTestCase(new DutyCycleReqTest, Duration::QUICK);
+    AddTestCase(new PacketTrackerTest, Duration::QUICK);
+    AddTestCase(new TraceWriterTest, Duration::QUICK);
+    AddTestCase(new FileWriterTest, Duration::QUICK);
+    AddTestCase(new InstrumentationTest, Duration::QUICK);
+    AddTestCase(new KpiTrackerTest, Duration::QUICK);
+    AddTestCase(new MetricsSamplerTest, Duration::QUICK);
+    AddTestCase(new PacketAuditTest, Duration::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -8,11 +8,16 @@
 
 // Include headers of classes to test
 #include "ns3/log.h"
+#include "ns3/network-controller.h"
 #include "ns3/network-scheduler.h"
+#include "ns3/network-status.h"
+#include "ns3/simulator.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <vector>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -53,6 +58,55 @@ NetworkSchedulerTest::DoRun()
 
     // If a packet is received at the network server, a reply event should be
     // scheduled to happen 1 second after the reception.
+
+    // Devices without gateways to reply through, so that both windows are opened
+    Ptr<NetworkStatus> status = CreateObject<NetworkStatus>();
+    Ptr<NetworkController> controller = CreateObject<NetworkController>(status);
+    Ptr<NetworkScheduler> scheduler = CreateObject<NetworkScheduler>(status, controller);
+
+    std::vector<Ptr<EndDeviceStatus>> edStatuses;
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        status->AddNode(LoraDeviceAddress(i));
+        edStatuses.push_back(status->GetEndDeviceStatus(LoraDeviceAddress(i)));
+
+        UplinkContext context;
+        context.endDeviceStatus = edStatuses.back();
+        context.frameHeader.SetAddress(LoraDeviceAddress(i));
+        scheduler->OnReceivedPacket(context);
+
+        // Further copies do not schedule other windows
+        scheduler->OnReceivedPacket(context);
+    }
+    NS_TEST_EXPECT_MSG_EQ(scheduler->GetNPendingReceiveWindows(), 3, "Wrong number of windows");
+
+    // The last device does not need its windows anymore
+    edStatuses[2]->RemoveReceiveWindowOpportunity();
+    NS_TEST_EXPECT_MSG_EQ(scheduler->GetNPendingReceiveWindows(),
+                          2,
+                          "Removed window is still counted");
+
+    std::size_t nPendingAfterFirst = 0;
+    std::size_t nPendingAfterSecond = 0;
+    bool scheduledAfterFirst = false;
+    bool scheduledAfterSecond = true;
+    Simulator::Schedule(MilliSeconds(1500), [&]() {
+        nPendingAfterFirst = scheduler->GetNPendingReceiveWindows();
+        scheduledAfterFirst = edStatuses[0]->HasReceiveWindowOpportunityScheduled();
+    });
+    Simulator::Schedule(MilliSeconds(2500), [&]() {
+        nPendingAfterSecond = scheduler->GetNPendingReceiveWindows();
+        scheduledAfterSecond = edStatuses[0]->HasReceiveWindowOpportunityScheduled();
+    });
+
+    Simulator::Stop(Seconds(3));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(nPendingAfterFirst, 2, "Second windows were not scheduled");
+    NS_TEST_EXPECT_MSG_EQ(scheduledAfterFirst, true, "Second window was not scheduled");
+    NS_TEST_EXPECT_MSG_EQ(nPendingAfterSecond, 0, "Windows were not served");
+    NS_TEST_EXPECT_MSG_EQ(scheduledAfterSecond, false, "Window is still scheduled");
 }
 
 /**
@@ -9,20 +9,34 @@
 /*
  * This file includes testing for the following components:
  * - NetworkServer
+ * - LoraEndDeviceFleet
+ * - NetworkController
+ * - AdrComponent
  */
 
 // Include headers of classes to test
 #include "utilities.h"
 
+#include "ns3/adr-component.h"
 #include "ns3/callback.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/core-module.h"
 #include "ns3/log.h"
+#include "ns3/lora-end-device-fleet.h"
+#include "ns3/lora-instrumentation.h"
+#include "ns3/lora-tag.h"
+#include "ns3/network-controller.h"
 #include "ns3/network-server-helper.h"
 #include "ns3/network-server.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -327,6 +341,1042 @@ LinkCheckTest::DoRun()
     NS_ASSERT(m_receivedPacketAtEd);
 }
 
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the NetworkServer application receives packets sent by the devices of a
+ * LoraEndDeviceFleet
+ */
+class FleetUplinkTest : public TestCase
+{
+  public:
+    FleetUplinkTest();           //!< Default constructor
+    ~FleetUplinkTest() override; //!< Destructor
+
+    /**
+     * Callback for tracing ReceivedPacket.
+     *
+     * \param packet The packet received.
+     */
+    void ReceivedPacket(Ptr<const Packet> packet);
+
+  private:
+    void DoRun() override;
+
+    std::set<uint32_t> m_receivedAddresses; //!< Addresses of the devices the server heard from
+    int m_receivedPackets = 0;              //!< Number of packets received by the server
+};
+
+// Add some help text to this case to describe what it is intended to test
+FleetUplinkTest::FleetUplinkTest()
+    : TestCase("Verify that the NetworkServer application can receive"
+               " packets sent by a fleet of lightweight devices")
+{
+}
+
+// Reminder that the test case should clean up after itself
+FleetUplinkTest::~FleetUplinkTest()
+{
+}
+
+void
+FleetUplinkTest::ReceivedPacket(Ptr<const Packet> packet)
+{
+    NS_LOG_DEBUG("Received a packet at the network server");
+
+    Ptr<Packet> myPacket = packet->Copy();
+    LorawanMacHeader macHdr;
+    myPacket->RemoveHeader(macHdr);
+    LoraFrameHeader frameHdr;
+    frameHdr.SetAsUplink();
+    myPacket->RemoveHeader(frameHdr);
+
+    m_receivedAddresses.insert(frameHdr.GetAddress().Get());
+    m_receivedPackets++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+FleetUplinkTest::DoRun()
+{
+    NS_LOG_DEBUG("FleetUplinkTest");
+
+    // A single gateway, without any Node-based end device
+    Ptr<LoraChannel> channel = CreateChannel();
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    NodeContainer gateways = CreateGateways(1, mobility, channel);
+    Ptr<Node> nsNode = CreateNetworkServer(NodeContainer(), gateways);
+
+    // Devices close to the gateway, on different spreading factors
+    Ptr<LoraEndDeviceFleet> fleet = CreateObject<LoraEndDeviceFleet>();
+    fleet->SetAttribute("Period", TimeValue(Seconds(100)));
+    fleet->SetChannel(channel);
+    LorawanMacHelper().ConfigureFleet(fleet);
+    fleet->AddDevice(LoraDeviceAddress(1), Vector(100, 0, 0), 5);
+    fleet->AddDevice(LoraDeviceAddress(2), Vector(0, 100, 0), 4);
+    fleet->AddDevice(LoraDeviceAddress(3), Vector(-100, 0, 0), 3);
+
+    Ptr<NetworkServer> networkServer = DynamicCast<NetworkServer>(nsNode->GetApplication(0));
+    networkServer->AddFleet(fleet);
+    networkServer->TraceConnectWithoutContext(
+        "ReceivedPacket",
+        MakeCallback(&FleetUplinkTest::ReceivedPacket, this));
+
+    // Each device sends exactly one packet within the first period
+    fleet->Start(Seconds(0));
+    fleet->Stop(Seconds(100));
+
+    Simulator::Stop(Seconds(105));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_receivedPackets, 3, "Wrong number of packets received by the server");
+    NS_TEST_EXPECT_MSG_EQ(m_receivedAddresses.size(),
+                          3,
+                          "The server did not receive a packet from every device");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the LoraPacketTracker ignores the gateway receptions of the packets sent by a
+ * LoraEndDeviceFleet, which are never tracked
+ */
+class FleetPacketTrackingTest : public TestCase
+{
+  public:
+    FleetPacketTrackingTest();           //!< Default constructor
+    ~FleetPacketTrackingTest() override; //!< Destructor
+
+    /**
+     * Callback for tracing ReceivedPacket.
+     *
+     * \param packet The packet received.
+     */
+    void ReceivedPacket(Ptr<const Packet> packet);
+
+  private:
+    void DoRun() override;
+
+    int m_receivedPackets = 0; //!< Number of packets received by the server
+};
+
+// Add some help text to this case to describe what it is intended to test
+FleetPacketTrackingTest::FleetPacketTrackingTest()
+    : TestCase("Verify that packet tracking can be enabled on gateways receiving"
+               " the packets of a fleet of lightweight devices")
+{
+}
+
+// Reminder that the test case should clean up after itself
+FleetPacketTrackingTest::~FleetPacketTrackingTest()
+{
+}
+
+void
+FleetPacketTrackingTest::ReceivedPacket(Ptr<const Packet> packet)
+{
+    NS_LOG_DEBUG("Received a packet at the network server");
+
+    m_receivedPackets++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+FleetPacketTrackingTest::DoRun()
+{
+    NS_LOG_DEBUG("FleetPacketTrackingTest");
+
+    // A single gateway whose receptions are traced by the packet tracker
+    Ptr<LoraChannel> channel = CreateChannel();
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+
+    LoraPhyHelper phyHelper;
+    phyHelper.SetChannel(channel);
+    phyHelper.SetDeviceType(LoraPhyHelper::GW);
+    LorawanMacHelper macHelper;
+    macHelper.SetDeviceType(LorawanMacHelper::GW);
+    LoraHelper helper;
+    helper.EnablePacketTracking();
+
+    NodeContainer gateways;
+    gateways.Create(1);
+    mobility.Install(gateways);
+    helper.Install(phyHelper, macHelper, gateways);
+    Ptr<Node> nsNode = CreateNetworkServer(NodeContainer(), gateways);
+
+    Ptr<LoraEndDeviceFleet> fleet = CreateObject<LoraEndDeviceFleet>();
+    fleet->SetAttribute("Period", TimeValue(Seconds(100)));
+    fleet->SetChannel(channel);
+    LorawanMacHelper().ConfigureFleet(fleet);
+    fleet->AddDevice(LoraDeviceAddress(1), Vector(100, 0, 0), 5);
+    fleet->AddDevice(LoraDeviceAddress(2), Vector(0, 100, 0), 4);
+
+    Ptr<NetworkServer> networkServer = DynamicCast<NetworkServer>(nsNode->GetApplication(0));
+    networkServer->AddFleet(fleet);
+    networkServer->TraceConnectWithoutContext(
+        "ReceivedPacket",
+        MakeCallback(&FleetPacketTrackingTest::ReceivedPacket, this));
+
+    fleet->Start(Seconds(0));
+    fleet->Stop(Seconds(100));
+
+    Simulator::Stop(Seconds(105));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_receivedPackets, 2, "Wrong number of packets received by the server");
+    NS_TEST_EXPECT_MSG_EQ(helper.GetPacketTracker().CountMacPacketsGlobally(Seconds(0),
+                                                                             Seconds(105)),
+                          "0.000000 0.000000",
+                          "The packets of the fleet were counted by the tracker");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the devices of a LoraEndDeviceFleet respect the duty cycle of the channel plan
+ * they are given, and use the spreading factors of their region
+ */
+class FleetDutyCycleTest : public TestCase
+{
+  public:
+    FleetDutyCycleTest();           //!< Default constructor
+    ~FleetDutyCycleTest() override; //!< Destructor
+
+    /**
+     * Run a single device sending a packet every second for 100 seconds.
+     *
+     * \param region The region whose channel plan the fleet uses.
+     * \param dataRate The data rate of the device.
+     */
+    void RunFleet(LorawanMacHelper::Regions region, uint8_t dataRate = 5);
+
+    /**
+     * Callback for tracing StartSending.
+     *
+     * \param packet The packet being sent.
+     * \param index The index of the device in the fleet.
+     */
+    void StartSending(Ptr<const Packet> packet, uint32_t index);
+
+  private:
+    void DoRun() override;
+
+    int m_nSent = 0;         //!< Number of packets sent
+    uint8_t m_sf = 0;        //!< Spreading factor of the last transmission
+    Time m_lastStart;        //!< Start of the last transmission
+    Time m_lastDuration;     //!< Duration of the last transmission
+    Time m_minExcessOffTime; //!< Smallest gap between transmissions, minus the expected off time
+};
+
+// Add some help text to this case to describe what it is intended to test
+FleetDutyCycleTest::FleetDutyCycleTest()
+    : TestCase("Verify that the devices of a fleet respect the duty cycle of their region")
+{
+}
+
+// Reminder that the test case should clean up after itself
+FleetDutyCycleTest::~FleetDutyCycleTest()
+{
+}
+
+void
+FleetDutyCycleTest::StartSending(Ptr<const Packet> packet, uint32_t index)
+{
+    LoraTag tag;
+    packet->PeekPacketTag(tag);
+    LoraTxParameters params;
+    params.sf = tag.GetSpreadingFactor();
+    params.bandwidthHz = 125000;
+    m_sf = params.sf;
+
+    // The EU868 channels are in a SubBand with a 1% duty cycle, which forbids
+    // transmissions for 99 times the duration of the last one
+    if (m_nSent > 0)
+    {
+        m_minExcessOffTime =
+            std::min(m_minExcessOffTime, Simulator::Now() - m_lastStart - m_lastDuration * 99);
+    }
+    m_nSent++;
+    m_lastStart = Simulator::Now();
+    m_lastDuration = LoraPhy::GetOnAirTime(packet, params);
+}
+
+void
+FleetDutyCycleTest::RunFleet(LorawanMacHelper::Regions region, uint8_t dataRate)
+{
+    m_nSent = 0;
+    m_minExcessOffTime = Time::Max();
+
+    LorawanMacHelper macHelper;
+    macHelper.SetRegion(region);
+
+    Ptr<LoraEndDeviceFleet> fleet = CreateObject<LoraEndDeviceFleet>();
+    fleet->SetAttribute("Period", TimeValue(Seconds(1)));
+    fleet->SetChannel(CreateChannel());
+    macHelper.ConfigureFleet(fleet);
+    fleet->AddDevice(LoraDeviceAddress(1), Vector(0, 0, 0), dataRate);
+    fleet->TraceConnectWithoutContext("StartSending",
+                                      MakeCallback(&FleetDutyCycleTest::StartSending, this));
+
+    fleet->Start(Seconds(0));
+    fleet->Stop(Seconds(100));
+
+    Simulator::Stop(Seconds(101));
+    Simulator::Run();
+    Simulator::Destroy();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+FleetDutyCycleTest::DoRun()
+{
+    NS_LOG_DEBUG("FleetDutyCycleTest");
+
+    // Without duty cycle limitations, the device sends a packet every period
+    RunFleet(LorawanMacHelper::ALOHA);
+    NS_TEST_EXPECT_MSG_EQ(m_nSent, 100, "Packets were postponed without duty cycle limitations");
+    NS_TEST_EXPECT_MSG_EQ(unsigned(m_sf), 7, "Wrong spreading factor for DR5");
+
+    // The highest data rate of the region uses SF7 at 250 kHz
+    RunFleet(LorawanMacHelper::ALOHA, 6);
+    NS_TEST_EXPECT_MSG_EQ(unsigned(m_sf), 7, "Wrong spreading factor for DR6");
+
+    // With the EU868 plan, the device is slowed down by the duty cycle of the SubBand
+    RunFleet(LorawanMacHelper::EU);
+    NS_TEST_EXPECT_MSG_GT(m_nSent, 1, "Too few packets sent");
+    NS_TEST_EXPECT_MSG_LT(m_nSent, 100, "Packets were not postponed by the duty cycle");
+    NS_TEST_EXPECT_MSG_GT_OR_EQ(m_minExcessOffTime,
+                                Seconds(0),
+                                "The off time of the SubBand was not respected");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * A NetworkControllerComponent counting the calls it receives, with
+ * configurable subscriptions
+ */
+class CountingComponent : public NetworkControllerComponent
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * \param receivedPacketSubscription The subscription to received packets.
+     * \param replySubscription The subscription to replies.
+     */
+    CountingComponent(Subscription receivedPacketSubscription, Subscription replySubscription)
+        : m_receivedPacketSubscription(receivedPacketSubscription),
+          m_replySubscription(replySubscription)
+    {
+    }
+
+    void OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus) override
+    {
+        m_nReceivedPackets++;
+    }
+
+    void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override
+    {
+        m_nReplies++;
+    }
+
+    void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override
+    {
+    }
+
+    Subscription GetReceivedPacketSubscription() const override
+    {
+        return m_receivedPacketSubscription;
+    }
+
+    Subscription GetReplySubscription() const override
+    {
+        return m_replySubscription;
+    }
+
+    int m_nReceivedPackets = 0; //!< Number of calls to OnReceivedPacket
+    int m_nReplies = 0;         //!< Number of calls to BeforeSendingReply
+
+  private:
+    Subscription m_receivedPacketSubscription; //!< The subscription to received packets
+    Subscription m_replySubscription;          //!< The subscription to replies
+};
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the NetworkController only calls the components subscribed to an uplink
+ */
+class ComponentDispatchTest : public TestCase
+{
+  public:
+    ComponentDispatchTest();           //!< Default constructor
+    ~ComponentDispatchTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+ComponentDispatchTest::ComponentDispatchTest()
+    : TestCase("Verify that the NetworkController dispatches uplinks to subscribed components")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ComponentDispatchTest::~ComponentDispatchTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ComponentDispatchTest::DoRun()
+{
+    NS_LOG_DEBUG("ComponentDispatchTest");
+
+    typedef NetworkControllerComponent::Subscription Subscription;
+
+    Ptr<NetworkStatus> status = CreateObject<NetworkStatus>();
+    LoraDeviceAddress address(1);
+    status->AddNode(address);
+    Ptr<NetworkController> controller = CreateObject<NetworkController>(status);
+
+    auto all = CreateObject<CountingComponent>(Subscription::All(), Subscription::All());
+    auto confirmed = CreateObject<CountingComponent>(
+        Subscription::None().WithMType(LorawanMacHeader::CONFIRMED_DATA_UP),
+        Subscription::None());
+    auto adr = CreateObject<CountingComponent>(
+        Subscription::None(),
+        Subscription::None().WithFCtrl(NetworkControllerComponent::FCTRL_ADR));
+    auto linkCheck = CreateObject<CountingComponent>(
+        Subscription::None(),
+        Subscription::None().WithCommand(LINK_CHECK_REQ));
+    controller->Install(all);
+    controller->Install(confirmed);
+    controller->Install(adr);
+    controller->Install(linkCheck);
+
+    UplinkContext context;
+    context.packet = Create<Packet>(10);
+    context.endDeviceStatus = status->GetEndDeviceStatus(address);
+    context.frameHeader.SetAsUplink();
+    context.frameHeader.SetAddress(address);
+
+    // An unconfirmed uplink with the ADR bit set
+    context.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_UP);
+    context.frameHeader.SetFCnt(0);
+    context.frameHeader.SetAdr(true);
+    controller->OnNewPacket(context);
+    controller->BeforeSendingReply(context.endDeviceStatus);
+
+    NS_TEST_EXPECT_MSG_EQ(all->m_nReceivedPackets, 1, "Uplink not dispatched");
+    NS_TEST_EXPECT_MSG_EQ(all->m_nReplies, 1, "Reply not dispatched");
+    NS_TEST_EXPECT_MSG_EQ(confirmed->m_nReceivedPackets, 0, "Unconfirmed uplink dispatched");
+    NS_TEST_EXPECT_MSG_EQ(adr->m_nReplies, 1, "Reply to an ADR uplink not dispatched");
+    NS_TEST_EXPECT_MSG_EQ(linkCheck->m_nReplies, 0, "Reply without LinkCheckReq dispatched");
+
+    // A confirmed uplink with a LinkCheckReq, received by two gateways
+    context.macHeader.SetMType(LorawanMacHeader::CONFIRMED_DATA_UP);
+    context.frameHeader.SetFCnt(1);
+    context.frameHeader.SetAdr(false);
+    context.frameHeader.AddLinkCheckReq();
+    controller->OnNewPacket(context);
+    controller->OnNewPacket(context);
+    controller->BeforeSendingReply(context.endDeviceStatus);
+
+    NS_TEST_EXPECT_MSG_EQ(all->m_nReceivedPackets, 3, "Uplink not dispatched");
+    NS_TEST_EXPECT_MSG_EQ(confirmed->m_nReceivedPackets, 2, "Confirmed uplink not dispatched");
+    NS_TEST_EXPECT_MSG_EQ(adr->m_nReceivedPackets, 0, "Uplink dispatched to no subscriber");
+    NS_TEST_EXPECT_MSG_EQ(adr->m_nReplies, 1, "Reply to a non-ADR uplink dispatched");
+    NS_TEST_EXPECT_MSG_EQ(linkCheck->m_nReplies, 1, "Reply with LinkCheckReq not dispatched");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * A CountingComponent needing a number of received packets of each device
+ */
+class HistoryComponent : public CountingComponent
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * \param historySize The number of packets the component needs.
+     */
+    HistoryComponent(uint32_t historySize)
+        : CountingComponent(Subscription::All(), Subscription::All()),
+          m_historySize(historySize)
+    {
+    }
+
+    uint32_t GetReceivedPacketHistorySize() const override
+    {
+        return m_historySize;
+    }
+
+  private:
+    uint32_t m_historySize; //!< The number of packets the component needs
+};
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that devices keep as many received packets as the installed components need
+ */
+class HistorySizeTest : public TestCase
+{
+  public:
+    HistorySizeTest();           //!< Default constructor
+    ~HistorySizeTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+HistorySizeTest::HistorySizeTest()
+    : TestCase("Verify that components set the received packet history size")
+{
+}
+
+// Reminder that the test case should clean up after itself
+HistorySizeTest::~HistorySizeTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+HistorySizeTest::DoRun()
+{
+    NS_LOG_DEBUG("HistorySizeTest");
+
+    typedef NetworkControllerComponent::Subscription Subscription;
+
+    Ptr<NetworkStatus> status = CreateObject<NetworkStatus>();
+    status->AddNode(LoraDeviceAddress(1));
+    Ptr<NetworkController> controller = CreateObject<NetworkController>(status);
+
+    // The components of the module only need the last packet
+    controller->Install(CreateObject<AdrComponent>());
+    controller->Install(CreateObject<ConfirmedMessagesComponent>());
+    controller->Install(CreateObject<LinkCheckComponent>());
+    NS_TEST_EXPECT_MSG_EQ(status->GetReceivedPacketHistorySize(),
+                          1,
+                          "Wrong history size of the module components");
+
+    // Other components keep a few packets by default
+    controller->Install(CreateObject<CountingComponent>(Subscription::All(), Subscription::All()));
+    NS_TEST_EXPECT_MSG_EQ(status->GetReceivedPacketHistorySize(),
+                          4,
+                          "Wrong default history size");
+
+    // The largest need applies to current and future devices
+    controller->Install(CreateObject<HistoryComponent>(8));
+    controller->Install(CreateObject<HistoryComponent>(2));
+    status->AddNode(LoraDeviceAddress(2));
+    NS_TEST_EXPECT_MSG_EQ(status->GetReceivedPacketHistorySize(),
+                          8,
+                          "History size does not follow the components");
+    NS_TEST_EXPECT_MSG_EQ(
+        status->GetEndDeviceStatus(LoraDeviceAddress(1))->GetReceivedPacketHistorySize(),
+        8,
+        "History size not applied to existing devices");
+    NS_TEST_EXPECT_MSG_EQ(
+        status->GetEndDeviceStatus(LoraDeviceAddress(2))->GetReceivedPacketHistorySize(),
+        8,
+        "History size not applied to new devices");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * A NetworkControllerComponent recording the UplinkContext objects it receives
+ */
+class ContextRecordingComponent : public NetworkControllerComponent
+{
+  public:
+    void OnReceivedPacket(const UplinkContext& context, Ptr<NetworkStatus> networkStatus) override
+    {
+        m_contexts.push_back(&context);
+        m_addresses.push_back(context.frameHeader.GetAddress().Get());
+        m_resolvedStatuses +=
+            (context.endDeviceStatus &&
+             context.endDeviceStatus ==
+                 networkStatus->GetEndDeviceStatus(context.frameHeader.GetAddress()));
+    }
+
+    void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override
+    {
+    }
+
+    void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override
+    {
+    }
+
+    std::vector<const UplinkContext*> m_contexts; //!< The contexts received, in order
+    std::vector<uint32_t> m_addresses;            //!< The decoded device addresses, in order
+    int m_resolvedStatuses = 0;                   //!< Contexts carrying their device status
+};
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the NetworkServer decodes each uplink once, and hands the same UplinkContext to
+ * all components
+ */
+class UplinkContextTest : public TestCase
+{
+  public:
+    UplinkContextTest();           //!< Default constructor
+    ~UplinkContextTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+UplinkContextTest::UplinkContextTest()
+    : TestCase("Verify that the NetworkServer decodes each uplink once for all components")
+{
+}
+
+// Reminder that the test case should clean up after itself
+UplinkContextTest::~UplinkContextTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+UplinkContextTest::DoRun()
+{
+    NS_LOG_DEBUG("UplinkContextTest");
+
+    Ptr<LoraChannel> channel = CreateChannel();
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    NodeContainer gateways = CreateGateways(1, mobility, channel);
+    Ptr<Node> nsNode = CreateNetworkServer(NodeContainer(), gateways);
+
+    Ptr<LoraEndDeviceFleet> fleet = CreateObject<LoraEndDeviceFleet>();
+    fleet->SetAttribute("Period", TimeValue(Seconds(100)));
+    fleet->SetChannel(channel);
+    LorawanMacHelper().ConfigureFleet(fleet);
+    fleet->AddDevice(LoraDeviceAddress(1), Vector(100, 0, 0), 5);
+    fleet->AddDevice(LoraDeviceAddress(2), Vector(0, 100, 0), 5);
+
+    auto first = CreateObject<ContextRecordingComponent>();
+    auto second = CreateObject<ContextRecordingComponent>();
+    Ptr<NetworkServer> networkServer = DynamicCast<NetworkServer>(nsNode->GetApplication(0));
+    networkServer->AddFleet(fleet);
+    networkServer->AddComponent(first);
+    networkServer->AddComponent(second);
+
+    uint64_t& serverParses = LoraInstrumentation::GetCounter("NetworkServer/HeaderParses");
+    uint64_t& statusParses = LoraInstrumentation::GetCounter("NetworkStatus/HeaderParses");
+    uint64_t serverParsesBefore = serverParses;
+    uint64_t statusParsesBefore = statusParses;
+
+    fleet->Start(Seconds(0));
+    fleet->Stop(Seconds(100));
+
+    Simulator::Stop(Seconds(105));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(first->m_contexts.size(), 2, "Wrong number of uplinks dispatched");
+    NS_TEST_ASSERT_MSG_EQ(second->m_contexts.size(), 2, "Wrong number of uplinks dispatched");
+    for (std::size_t i = 0; i < first->m_contexts.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(first->m_contexts[i],
+                              second->m_contexts[i],
+                              "Components received different contexts for the same uplink");
+    }
+    std::set<uint32_t> addresses(first->m_addresses.begin(), first->m_addresses.end());
+    NS_TEST_EXPECT_MSG_EQ((addresses == std::set<uint32_t>{1, 2}),
+                          true,
+                          "Device addresses decoded incorrectly");
+    NS_TEST_EXPECT_MSG_EQ(first->m_resolvedStatuses,
+                          2,
+                          "Contexts do not carry the status of their device");
+
+    // The counters are only fed when the module is built with instrumentation
+    if (LoraInstrumentation::IsCompiledIn())
+    {
+        NS_TEST_EXPECT_MSG_EQ(serverParses - serverParsesBefore,
+                              2,
+                              "Uplinks are not decoded exactly once by the NetworkServer");
+        NS_TEST_EXPECT_MSG_EQ(statusParses - statusParsesBefore,
+                              0,
+                              "Uplinks are decoded again to resolve the device status");
+    }
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the NetworkServer application processes copies of an uplink received by
+ * several gateways only once when a deduplication window is set
+ */
+class DeduplicationTest : public TestCase
+{
+  public:
+    DeduplicationTest();           //!< Default constructor
+    ~DeduplicationTest() override; //!< Destructor
+
+    /**
+     * Callback for tracing ReceivedPacket.
+     *
+     * \param packet The packet received.
+     */
+    void ReceivedPacket(Ptr<const Packet> packet);
+
+  private:
+    void DoRun() override;
+
+    int m_receivedCopies = 0; //!< Number of copies received by the server
+};
+
+// Add some help text to this case to describe what it is intended to test
+DeduplicationTest::DeduplicationTest()
+    : TestCase("Verify that the NetworkServer application processes each uplink once"
+               " when a deduplication window is set")
+{
+}
+
+// Reminder that the test case should clean up after itself
+DeduplicationTest::~DeduplicationTest()
+{
+}
+
+void
+DeduplicationTest::ReceivedPacket(Ptr<const Packet> packet)
+{
+    m_receivedCopies++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DeduplicationTest::DoRun()
+{
+    NS_LOG_DEBUG("DeduplicationTest");
+
+    // Three gateways in the same place, all receiving each packet
+    Ptr<LoraChannel> channel = CreateChannel();
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    NodeContainer gateways = CreateGateways(3, mobility, channel);
+    Ptr<Node> nsNode = CreateNetworkServer(NodeContainer(), gateways);
+
+    Ptr<LoraEndDeviceFleet> fleet = CreateObject<LoraEndDeviceFleet>();
+    fleet->SetAttribute("Period", TimeValue(Seconds(100)));
+    fleet->SetChannel(channel);
+    LorawanMacHelper().ConfigureFleet(fleet);
+    fleet->AddDevice(LoraDeviceAddress(1), Vector(100, 0, 0), 5);
+    fleet->AddDevice(LoraDeviceAddress(2), Vector(0, 100, 0), 5);
+
+    typedef NetworkControllerComponent::Subscription Subscription;
+    auto component = CreateObject<CountingComponent>(Subscription::All(), Subscription::All());
+
+    Ptr<NetworkServer> networkServer = DynamicCast<NetworkServer>(nsNode->GetApplication(0));
+    networkServer->SetAttribute("DeduplicationWindow", TimeValue(MilliSeconds(200)));
+    networkServer->AddFleet(fleet);
+    networkServer->AddComponent(component);
+    networkServer->TraceConnectWithoutContext(
+        "ReceivedPacket",
+        MakeCallback(&DeduplicationTest::ReceivedPacket, this));
+
+    // Each device sends two packets
+    fleet->Start(Seconds(0));
+    fleet->Stop(Seconds(200));
+
+    Simulator::Stop(Seconds(205));
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_EQ(m_receivedCopies, 12, "Wrong number of copies received by the server");
+    NS_TEST_EXPECT_MSG_EQ(component->m_nReceivedPackets, 4, "Copies were not deduplicated");
+
+    // The status holds the gateways of all copies
+    Ptr<EndDeviceStatus> edStatus =
+        networkServer->GetNetworkStatus()->GetEndDeviceStatus(LoraDeviceAddress(1));
+    NS_TEST_EXPECT_MSG_EQ(edStatus->GetLastReceivedPacketInfo().gwList.size(),
+                          3,
+                          "The gateway list misses some copies");
+
+    // Uplinks are forgotten after the first receive window
+    NS_TEST_EXPECT_MSG_EQ(networkServer->GetNKeptUplinks(), 0, "Uplinks were not forgotten");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the AdrComponent takes the same decisions in batch mode, whatever the number
+ * of threads, as when deciding on each request immediately, and for devices whose MAC is not
+ * known to the network server, like those of a LoraEndDeviceFleet
+ */
+class AdrBatchTest : public TestCase
+{
+  public:
+    AdrBatchTest();           //!< Default constructor
+    ~AdrBatchTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Make a number of devices request ADR, and collect the decisions of an AdrComponent.
+     *
+     * \param batchPeriod The BatchPeriod attribute of the component.
+     * \param batchThreads The BatchThreads attribute of the component.
+     * \param withMac Whether devices are registered with their MAC, or by address as the
+     * devices of a LoraEndDeviceFleet.
+     * \return The data rate and TX power index requested to each device, or a pair of 255 when
+     * no LinkAdrReq was sent.
+     */
+    std::vector<std::pair<uint8_t, uint8_t>> RunAdr(Time batchPeriod,
+                                                    uint32_t batchThreads,
+                                                    bool withMac);
+};
+
+// Add some help text to this case to describe what it is intended to test
+AdrBatchTest::AdrBatchTest()
+    : TestCase("Verify that batched ADR decisions do not depend on the number of threads")
+{
+}
+
+// Reminder that the test case should clean up after itself
+AdrBatchTest::~AdrBatchTest()
+{
+}
+
+std::vector<std::pair<uint8_t, uint8_t>>
+AdrBatchTest::RunAdr(Time batchPeriod, uint32_t batchThreads, bool withMac)
+{
+    const uint32_t nDevices = 16;
+    const int historyRange = 4;
+
+    Ptr<NetworkStatus> status = CreateObject<NetworkStatus>();
+    Ptr<NetworkController> controller = CreateObject<NetworkController>(status);
+    Ptr<AdrComponent> adr = CreateObject<AdrComponent>();
+    adr->SetAttribute("HistoryRange", IntegerValue(historyRange));
+    adr->SetAttribute("BatchPeriod", TimeValue(batchPeriod));
+    adr->SetAttribute("BatchThreads", UintegerValue(batchThreads));
+    controller->Install(adr);
+
+    std::vector<Ptr<EndDeviceStatus>> edStatuses;
+    for (uint32_t i = 0; i < nDevices; i++)
+    {
+        if (withMac)
+        {
+            Ptr<ClassAEndDeviceLorawanMac> mac = CreateObject<ClassAEndDeviceLorawanMac>();
+            mac->SetDeviceAddress(LoraDeviceAddress(i + 1));
+            status->AddNode(mac);
+        }
+        else
+        {
+            status->AddNode(LoraDeviceAddress(i + 1));
+        }
+        edStatuses.push_back(status->GetEndDeviceStatus(LoraDeviceAddress(i + 1)));
+    }
+
+    // Devices are heard with increasing power, so that they are sent different parameters
+    auto receive = [&](int fCnt) {
+        for (uint32_t i = 0; i < nDevices; i++)
+        {
+            UplinkContext context;
+            context.packet = Create<Packet>(10);
+            context.endDeviceStatus = edStatuses[i];
+            context.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_UP);
+            context.frameHeader.SetAsUplink();
+            context.frameHeader.SetAddress(LoraDeviceAddress(i + 1));
+            context.frameHeader.SetFCnt(fCnt);
+            context.frameHeader.SetAdr(true);
+            context.tag.SetSpreadingFactor(12);
+            context.tag.SetReceivePower(-140 + 3 * int(i) + fCnt);
+            status->OnReceivedPacket(context);
+            controller->OnNewPacket(context);
+        }
+    };
+    for (int fCnt = 0; fCnt < historyRange; fCnt++)
+    {
+        receive(fCnt);
+    }
+    for (uint32_t i = 0; i < nDevices; i++)
+    {
+        controller->BeforeSendingReply(edStatuses[i]);
+    }
+
+    if (!batchPeriod.IsZero())
+    {
+        Simulator::Stop(batchPeriod);
+        Simulator::Run();
+        for (uint32_t i = 0; i < nDevices; i++)
+        {
+            NS_TEST_EXPECT_MSG_EQ(edStatuses[i]->NeedsReply(),
+                                  false,
+                                  "A batched decision was applied outside of a reply");
+        }
+
+        // Decisions survive a reply that is given up for lack of a gateway, and
+        // are sent with the reply to the next uplink
+        receive(historyRange);
+        for (uint32_t i = 0; i < nDevices; i++)
+        {
+            edStatuses[i]->InitializeReply();
+        }
+        receive(historyRange + 1);
+        for (uint32_t i = 0; i < nDevices; i++)
+        {
+            controller->BeforeSendingReply(edStatuses[i]);
+        }
+    }
+
+    std::vector<std::pair<uint8_t, uint8_t>> decisions(nDevices, {255, 255});
+    for (uint32_t i = 0; i < nDevices; i++)
+    {
+        int nLinkAdrReqs = 0;
+        for (const auto& command : edStatuses[i]->m_reply.frameHeader.GetCommands())
+        {
+            if (Ptr<LinkAdrReq> linkAdrReq = DynamicCast<LinkAdrReq>(command))
+            {
+                decisions[i] = {linkAdrReq->GetDataRate(), linkAdrReq->GetTxPower()};
+                nLinkAdrReqs++;
+            }
+        }
+        NS_TEST_EXPECT_MSG_LT(nLinkAdrReqs, 2, "Several LinkAdrReq in the reply to device " << i);
+    }
+    Simulator::Destroy();
+
+    return decisions;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+AdrBatchTest::DoRun()
+{
+    NS_LOG_DEBUG("AdrBatchTest");
+
+    std::vector<std::pair<uint8_t, uint8_t>> immediate = RunAdr(Seconds(0), 1, true);
+    std::vector<std::pair<uint8_t, uint8_t>> serial = RunAdr(Seconds(10), 1, true);
+    std::vector<std::pair<uint8_t, uint8_t>> parallel = RunAdr(Seconds(10), 4, true);
+
+    // Devices without a MAC are assumed to use the default (maximum) power of the MAC
+    std::vector<std::pair<uint8_t, uint8_t>> withoutMac = RunAdr(Seconds(10), 4, false);
+
+    uint32_t nChanged = 0;
+    for (uint32_t i = 0; i < immediate.size(); i++)
+    {
+        nChanged += immediate[i].first != 255;
+        NS_TEST_EXPECT_MSG_EQ(unsigned(serial[i].first),
+                              unsigned(immediate[i].first),
+                              "Batched data rate differs for device " << i);
+        NS_TEST_EXPECT_MSG_EQ(unsigned(serial[i].second),
+                              unsigned(immediate[i].second),
+                              "Batched TX power differs for device " << i);
+        NS_TEST_EXPECT_MSG_EQ(unsigned(parallel[i].first),
+                              unsigned(serial[i].first),
+                              "Parallel data rate differs for device " << i);
+        NS_TEST_EXPECT_MSG_EQ(unsigned(parallel[i].second),
+                              unsigned(serial[i].second),
+                              "Parallel TX power differs for device " << i);
+        NS_TEST_EXPECT_MSG_EQ(unsigned(withoutMac[i].first),
+                              unsigned(serial[i].first),
+                              "Data rate differs without MAC for device " << i);
+        NS_TEST_EXPECT_MSG_EQ(unsigned(withoutMac[i].second),
+                              unsigned(serial[i].second),
+                              "TX power differs without MAC for device " << i);
+    }
+    NS_TEST_EXPECT_MSG_GT(nChanged, 0, "No device was sent new parameters");
+    NS_TEST_EXPECT_MSG_LT(nChanged, immediate.size(), "All devices were sent new parameters");
+}
+
+/**
+ * \ingroup lorawan
+ *
+ * It verifies that the SNR statistics of the AdrComponent match the values recomputed from
+ * scratch, also after a long sequence of values
+ */
+class AdrSlidingWindowTest : public TestCase
+{
+  public:
+    AdrSlidingWindowTest();           //!< Default constructor
+    ~AdrSlidingWindowTest() override; //!< Destructor
+
+  private:
+    void DoRun() override;
+};
+
+// Add some help text to this case to describe what it is intended to test
+AdrSlidingWindowTest::AdrSlidingWindowTest()
+    : TestCase("Verify that the ADR sliding window statistics do not drift")
+{
+}
+
+// Reminder that the test case should clean up after itself
+AdrSlidingWindowTest::~AdrSlidingWindowTest()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+AdrSlidingWindowTest::DoRun()
+{
+    NS_LOG_DEBUG("AdrSlidingWindowTest");
+
+    const std::size_t size = 20;
+    AdrComponent::SlidingWindow window(size);
+    std::vector<double> values;
+    auto fromScratch = [&values, size]() {
+        double sum = 0;
+        for (std::size_t i = values.size() - std::min(values.size(), size); i < values.size(); i++)
+        {
+            sum += values[i];
+        }
+        return sum;
+    };
+    Ptr<UniformRandomVariable> snr = CreateObject<UniformRandomVariable>();
+    snr->SetStream(1);
+
+    // Values of very different magnitudes make the incremental sum lose precision
+    for (int i = 0; i < 100000; i++)
+    {
+        values.push_back(snr->GetValue(-20, 10) + (i % 2 ? 1e9 : 0));
+        window.Push(values.back());
+    }
+
+    // Once the large values leave the window, the sum must be exact again
+    for (int i = 0; i < 10 * int(size); i++)
+    {
+        values.push_back(snr->GetValue(-20, 10));
+        window.Push(values.back());
+        if (i >= 2 * int(size))
+        {
+            NS_TEST_EXPECT_MSG_EQ_TOL(window.GetSum(), fromScratch(), 1e-9, "The sum drifted");
+        }
+    }
+
+    auto last = values.end() - size;
+    NS_TEST_EXPECT_MSG_EQ(window.GetN(), size, "Wrong number of values");
+    NS_TEST_EXPECT_MSG_EQ(window.GetMax(), *std::max_element(last, values.end()), "Wrong max");
+    NS_TEST_EXPECT_MSG_EQ(window.GetMin(), *std::min_element(last, values.end()), "Wrong min");
+}
+
 /**
  * \ingroup lorawan
  *
@@ -363,6 +1413,15 @@ NetworkServerTestSuite::NetworkServerTestSuite()
     AddTestCase(new UplinkPacketTest, Duration::QUICK);
     AddTestCase(new DownlinkPacketTest, Duration::QUICK);
     AddTestCase(new LinkCheckTest, Duration::QUICK);
+    AddTestCase(new FleetUplinkTest, Duration::QUICK);
+    AddTestCase(new FleetPacketTrackingTest, Duration::QUICK);
+    AddTestCase(new FleetDutyCycleTest, Duration::QUICK);
+    AddTestCase(new ComponentDispatchTest, Duration::QUICK);
+    AddTestCase(new HistorySizeTest, Duration::QUICK);
+    AddTestCase(new UplinkContextTest, Duration::QUICK);
+    AddTestCase(new DeduplicationTest, Duration::QUICK);
+    AddTestCase(new AdrBatchTest, Duration::QUICK);
+    AddTestCase(new AdrSlidingWindowTest, Duration::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
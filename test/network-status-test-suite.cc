@@ -18,6 +18,7 @@
 
 #include "ns3/end-device-status.h"
 #include "ns3/log.h"
+#include "ns3/mac48-address.h"
 #include "ns3/network-status.h"
 
 // An essential include is test.h
@@ -31,7 +32,8 @@ NS_LOG_COMPONENT_DEFINE("NetworkStatusTestSuite");
 /**
  * \ingroup lorawan
  *
- * It tests the constructor of the EndDeviceStatus class
+ * It tests the constructor of the EndDeviceStatus class, and the management of
+ * its received packet history
  */
 class EndDeviceStatusTest : public TestCase
 {
@@ -63,6 +65,121 @@ EndDeviceStatusTest::DoRun()
 
     // Create an EndDeviceStatus object
     EndDeviceStatus eds = EndDeviceStatus();
+
+    // Received packet history
+    //////////////////////////
+
+    Address gw1 = Mac48Address("00:00:00:00:00:01");
+    Address gw2 = Mac48Address("00:00:00:00:00:02");
+    eds.SetReceivedPacketHistorySize(3);
+
+    UplinkContext context;
+    for (uint16_t fCnt = 0; fCnt < 5; fCnt++)
+    {
+        context.packet = Create<Packet>(10);
+        context.frameHeader.SetFCnt(fCnt);
+        context.gwAddress = gw1;
+        eds.InsertReceivedPacket(context);
+    }
+
+    // Only the most recent packets are kept, from the oldest one
+    EndDeviceStatus::ReceivedPacketList packetList = eds.GetReceivedPacketList();
+    NS_TEST_EXPECT_MSG_EQ(eds.GetNReceivedPackets(), 3, "History is not bounded");
+    NS_TEST_EXPECT_MSG_EQ(packetList.front().second.fCnt, 2, "Oldest packets were not discarded");
+    NS_TEST_EXPECT_MSG_EQ(packetList.back().second.fCnt, 4, "Last packet is not the most recent");
+    NS_TEST_EXPECT_MSG_EQ(eds.GetLastPacketReceivedFromDevice(),
+                          context.packet,
+                          "Last packet is not the most recent");
+
+    // Copies from other gateways are merged with the packet they belong to
+    context.frameHeader.SetFCnt(3);
+    context.gwAddress = gw2;
+    eds.InsertReceivedPacket(context);
+    packetList = eds.GetReceivedPacketList();
+    NS_TEST_EXPECT_MSG_EQ(eds.GetNReceivedPackets(), 3, "Copy was inserted as a new packet");
+    NS_TEST_EXPECT_MSG_EQ((++packetList.begin())->second.gwList.size(),
+                          2,
+                          "Copy was not merged with its packet");
+
+    // Discarded packets are not found anymore
+    context.frameHeader.SetFCnt(1);
+    eds.InsertReceivedPacket(context);
+    NS_TEST_EXPECT_MSG_EQ(eds.GetLastReceivedPacketInfo().fCnt, 1, "Packet was not inserted");
+    NS_TEST_EXPECT_MSG_EQ(eds.GetLastReceivedPacketInfo().gwList.size(),
+                          1,
+                          "Packet was merged with a discarded one");
+
+    // Shrinking the history keeps the most recent packets
+    eds.SetReceivedPacketHistorySize(2);
+    packetList = eds.GetReceivedPacketList();
+    NS_TEST_EXPECT_MSG_EQ(packetList.size(), 2, "History was not shrunk");
+    NS_TEST_EXPECT_MSG_EQ(packetList.front().second.fCnt, 4, "Wrong packets were discarded");
+    NS_TEST_EXPECT_MSG_EQ(packetList.back().second.fCnt, 1, "Wrong packets were discarded");
+
+    // Gateway candidates for a reply
+    /////////////////////////////////
+
+    // Each copy carries the address and the index of the gateway that received it
+    Address gwAddresses[] = {gw1,
+                             gw2,
+                             Mac48Address("00:00:00:00:00:03"),
+                             Mac48Address("00:00:00:00:00:04")};
+    auto setGateway = [&context, &gwAddresses](uint32_t gwIndex) {
+        context.gwIndex = gwIndex;
+        context.gwAddress = gwAddresses[gwIndex];
+    };
+
+    // Copies of the last packet, with two gateways receiving the same power
+    context.frameHeader.SetFCnt(10);
+    uint32_t gwIndices[] = {0, 1, 2, 1};
+    double rxPowers[] = {-100, -90, -100, -90};
+    for (int i = 0; i < 4; i++)
+    {
+        setGateway(gwIndices[i]);
+        context.tag.SetReceivePower(rxPowers[i]);
+        eds.InsertReceivedPacket(context);
+    }
+    NS_TEST_EXPECT_MSG_EQ(eds.GetLastReceivedPacketInfo().gwList.size(),
+                          3,
+                          "Wrong number of gateways for the last packet");
+
+    // A late copy of a previous packet
+    context.frameHeader.SetFCnt(1);
+    setGateway(3);
+    context.tag.SetReceivePower(-80);
+    eds.InsertReceivedPacket(context);
+
+    const auto& candidates = eds.GetGatewayCandidates();
+    NS_TEST_ASSERT_MSG_EQ(candidates.size(), 3, "Wrong number of gateway candidates");
+    NS_TEST_EXPECT_MSG_EQ(candidates[0].gwIndex, 1, "Best gateway is not the first candidate");
+    NS_TEST_EXPECT_MSG_EQ(candidates[1].gwIndex, 0, "Gateways with the same power were swapped");
+    NS_TEST_EXPECT_MSG_EQ(candidates[2].gwIndex, 2, "Gateways with the same power were swapped");
+
+    // Reply assembly
+    /////////////////
+
+    // The fields a reply depends on are decoded when a new packet is received
+    context.frameHeader.SetFCnt(11);
+    context.frameHeader.SetAdr(true);
+    context.frameHeader.AddLinkCheckReq();
+    context.macHeader.SetMType(LorawanMacHeader::CONFIRMED_DATA_UP);
+    eds.InsertReceivedPacket(context);
+
+    const auto& fields = eds.GetLastUplinkFields();
+    NS_TEST_EXPECT_MSG_EQ(fields.fCnt, 11, "Wrong cached frame counter");
+    NS_TEST_EXPECT_MSG_EQ(fields.adr, true, "Wrong cached ADR bit");
+    NS_TEST_EXPECT_MSG_EQ(fields.mType, LorawanMacHeader::CONFIRMED_DATA_UP, "Wrong cached MType");
+    NS_TEST_EXPECT_MSG_EQ(fields.HasCommand(LINK_CHECK_REQ), true, "MAC command not cached");
+    NS_TEST_EXPECT_MSG_EQ(fields.HasCommand(LINK_ADR_ANS), false, "Wrong MAC command cached");
+
+    // The reply acknowledges the frame counter of the last packet
+    Ptr<Packet> reply = eds.GetCompleteReplyPacket();
+    LorawanMacHeader replyMacHdr;
+    LoraFrameHeader replyFrameHdr;
+    replyFrameHdr.SetAsDownlink();
+    reply->RemoveHeader(replyMacHdr);
+    reply->RemoveHeader(replyFrameHdr);
+    NS_TEST_EXPECT_MSG_EQ(replyFrameHdr.GetFCnt(), 11, "Wrong frame counter in the reply");
 }
 
 /**
@@ -109,6 +226,31 @@ NetworkStatusTest::DoRun()
     NodeContainer gateways = components.gateways;
 
     ns.AddNode(GetMacLayerFromNode<ClassAEndDeviceLorawanMac>(endDevices.Get(0)));
+
+    // Register devices by address, and look them up
+    ns.ReserveEndDevices(1001);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        ns.AddNode(LoraDeviceAddress(127, i));
+    }
+    NS_TEST_EXPECT_MSG_EQ(ns.CountEndDevices(), 1001, "Unexpected number of devices");
+
+    Ptr<EndDeviceStatus> edStatus = ns.GetEndDeviceStatus(LoraDeviceAddress(127, 500));
+    NS_TEST_ASSERT_MSG_EQ(bool(edStatus), true, "A registered device was not found");
+    NS_TEST_EXPECT_MSG_EQ(edStatus->m_endDeviceAddress,
+                          LoraDeviceAddress(127, 500),
+                          "The wrong device was found");
+
+    // Adding a device twice keeps its status
+    ns.AddNode(LoraDeviceAddress(127, 500));
+    NS_TEST_EXPECT_MSG_EQ(ns.CountEndDevices(), 1001, "A device was added twice");
+    NS_TEST_EXPECT_MSG_EQ(ns.GetEndDeviceStatus(LoraDeviceAddress(127, 500)),
+                          edStatus,
+                          "The status of a device was replaced");
+
+    NS_TEST_EXPECT_MSG_EQ(bool(ns.GetEndDeviceStatus(LoraDeviceAddress(126, 500))),
+                          false,
+                          "An unknown device was found");
 }
 
 /**